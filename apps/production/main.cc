@@ -14,36 +14,86 @@
 
 #define PW_LOG_MODULE_NAME "MAIN"
 
+#include <array>
+#include <cstddef>
+
 #include "apps/production/threads.h"
 #include "modules/air_sensor/service.h"
 #include "modules/board/service.h"
+#include "modules/event_log/service.h"
 #include "modules/event_timers/event_timers.h"
+#include "modules/led/compositor.h"
 #include "modules/morse_code/encoder.h"
+#include "modules/profiler/service.h"
 #include "modules/proximity/manager.h"
 #include "modules/pubsub/service.h"
 #include "modules/sampling_thread/sampling_thread.h"
+#include "modules/sampling_thread/service.h"
 #include "modules/state_manager/service.h"
 #include "modules/state_manager/state_manager.h"
+#include "modules/telemetry/service.h"
+#include "modules/watchdog/service.h"
+#include "modules/worker/work_queue_worker.h"
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
 #include "pw_system/system.h"
 #include "pw_thread/detached_thread.h"
+#include "pw_tokenizer/tokenize.h"
 #include "system/pubsub.h"
 #include "system/system.h"
+#include "system/timer_wheel.h"
 #include "system/worker.h"
 
 namespace sense {
 namespace {
 
+/// Returns the worker for RPC streams, which runs on its own thread, so that
+/// a congested transport does not delay the system worker. Mailboxes and the
+/// streaming services only queue a little work at a time, so the work queue
+/// can be small.
+Worker& RpcStreamWorker() {
+  static Worker& rpc_stream_worker = []() -> Worker& {
+    static WorkQueueWorker<8> worker;
+    worker.Start(RpcStreamThreadOptions());
+    return worker;
+  }();
+  return rpc_stream_worker;
+}
+
 void InitStateManager() {
-  static StateManager state_manager(system::PubSub(), system::PolychromeLed());
-  static StateManagerService state_manager_service(system::PubSub());
+  static LedCompositor led_compositor(
+      system::PolychromeLed(), AmbientLightAdjustedLed::kDefaultBrightness);
+  led_compositor.Init(system::GetWorker(), system::TimerWheel());
+  static StateManager state_manager(system::PubSub(), led_compositor);
+  state_manager.EnableAsyncTimeouts(pw::System().dispatcher(),
+                                    pw::System().allocator(),
+                                    system::GetWorker());
+  static StateManagerService state_manager_service(system::PubSub(),
+                                                   RpcStreamWorker());
   pw::System().rpc_server().RegisterService(state_manager_service);
 }
 
+void InitEventLog() {
+  // Records every pubsub event from boot, so that field issues can be captured
+  // with tools/sense/event_log_capture.py and replayed on a host.
+  constexpr size_t kLogSize = 2048;
+  static std::array<std::byte, kLogSize> log_buffer;
+  static std::array<std::byte, kLogSize + 16> snapshot_buffer;
+  static EventRecorder recorder(log_buffer);
+  PW_CHECK_OK(recorder.Start(system::PubSub()));
+  static EventLogService event_log_service(
+      recorder, system::PubSub(), snapshot_buffer);
+  pw::System().rpc_server().RegisterService(event_log_service);
+}
+
+void InitProfiler() {
+  static ProfilerService profiler_service(system::GetProfiler());
+  pw::System().rpc_server().RegisterService(profiler_service);
+}
+
 void InitEventTimers() {
   auto& pubsub = system::PubSub();
-  static EventTimers<3> event_timers(pubsub);
+  static EventTimers<3> event_timers(pubsub, system::TimerWheel());
   PW_CHECK_OK(event_timers.AddEventTimer(StateManager::kRepeatAlarmToken));
   PW_CHECK_OK(event_timers.AddEventTimer(StateManager::kSilenceAlarmToken));
   PW_CHECK_OK(event_timers.AddEventTimer(StateManager::kThresholdModeToken));
@@ -58,6 +108,8 @@ void InitBoardService() {
 void InitMorseEncoder() {
   // The morse encoder will emit pubsub events to the state manager.
   static Encoder morse_encoder;
+  static std::array<std::byte, Encoder::kTimelineBufferSize> morse_timeline;
+  morse_encoder.UseTimeline(morse_timeline);
   morse_encoder.Init(system::GetWorker(),
                      [](bool turn_on, const Encoder::State& state) {
                        std::ignore = system::PubSub().Publish(MorseCodeValue{
@@ -69,8 +121,9 @@ void InitMorseEncoder() {
   PW_CHECK(system::PubSub().SubscribeTo<MorseEncodeRequest>(
       [](MorseEncodeRequest request) {
         PW_CHECK_OK(morse_encoder.Encode(
-            request.message, request.repeat, Encoder::kDefaultIntervalMs));
-      }));
+            request.message(), request.repeat, Encoder::kDefaultIntervalMs));
+      },
+      PW_TOKENIZE_STRING("morse encode request")));
 }
 
 void InitProximitySensor() {
@@ -88,7 +141,8 @@ void InitProximitySensor() {
         } else {
           PW_LOG_INFO("Proximity NOT detected!");
         }
-      }));
+      },
+      PW_TOKENIZE_STRING("proximity log")));
 }
 
 void InitAirSensor() {
@@ -98,24 +152,53 @@ void InitAirSensor() {
   pw::System().rpc_server().RegisterService(air_sensor_service);
 }
 
+void InitTelemetry() {
+  static TelemetryService telemetry_service;
+  telemetry_service.Init(
+      system::GetWorker(), system::Board(), system::AirSensor());
+  pw::System().rpc_server().RegisterService(telemetry_service);
+}
+
+void InitSampling() {
+  static SamplingService sampling_service(GetSamplingReports());
+  pw::System().rpc_server().RegisterService(sampling_service);
+  pw::thread::DetachedThread(SamplingThreadOptions(), SamplingLoop);
+}
+
+void InitPubSubService() {
+  static PubSubService pubsub_service;
+  pubsub_service.Init(system::PubSub(), RpcStreamWorker());
+  pw::System().rpc_server().RegisterService(pubsub_service);
+}
+
+void InitWatchdog() {
+  // Breaches are streamed from the RPC stream worker, since the system worker
+  // may be the one that is stalled.
+  auto& watchdog = system::GetWorkerWatchdog();
+  static WatchdogService watchdog_service(watchdog, RpcStreamWorker());
+  pw::System().rpc_server().RegisterService(watchdog_service);
+  watchdog.Start();
+}
+
 [[noreturn]] void InitializeApp() {
   system::Init();
 
+  InitEventLog();
+  InitProfiler();
   InitStateManager();
   InitEventTimers();
   InitBoardService();
   InitMorseEncoder();
   InitProximitySensor();
   InitAirSensor();
-
-  pw::thread::DetachedThread(SamplingThreadOptions(), SamplingLoop);
-
-  static PubSubService pubsub_service;
-  pubsub_service.Init(system::PubSub());
-  pw::System().rpc_server().RegisterService(pubsub_service);
+  InitTelemetry();
+  InitSampling();
+  InitPubSubService();
+  InitWatchdog();
 
   auto& button_manager = system::ButtonManager();
-  button_manager.Init(system::PubSub(), system::GetWorker());
+  button_manager.Init(
+      system::PubSub(), system::GetWorker(), system::TimerWheel());
 
   PW_LOG_INFO("Welcome to Pigweed Sense 🌿☁️");
   system::Start();
@@ -21,4 +21,8 @@ namespace sense {
 /// target.
 const pw::thread::Options& SamplingThreadOptions();
 
+/// Thread options to use for the thread that writes RPC streams. Must be
+/// implemented by the target.
+const pw::thread::Options& RpcStreamThreadOptions();
+
 }  // namespace sense
@@ -18,6 +18,7 @@
 
 #include <chrono>
 #include <cstdint>
+#include <utility>
 
 #include "bme68x.h"
 #include "pw_assert/check.h"
@@ -28,6 +29,8 @@
 #include "pw_span/span.h"
 #include "pw_status/try.h"
 #include "pw_thread/sleep.h"
+#include "pw_tokenizer/tokenize.h"
+#include "pw_trace/trace.h"
 
 namespace sense {
 
@@ -42,6 +45,7 @@ static int8_t Write(uint8_t reg_address,
                     const uint8_t* data,
                     uint32_t length,
                     void* context) {
+  PW_TRACE_SCOPE("I2C write", "BME688");
   PW_LOG_INFO("Write(reg_address=0x%02x, data=%p, length=%u, context=%p)",
               reg_address,
               static_cast<const void*>(data),
@@ -61,6 +65,7 @@ static int8_t Read(uint8_t reg_address,
                    uint8_t* data,
                    uint32_t length,
                    void* context) {
+  PW_TRACE_SCOPE("I2C read", "BME688");
   PW_LOG_INFO("Read(reg_address=0x%02x, data=%p, length=%u, context=%p)",
               reg_address,
               static_cast<const void*>(data),
@@ -125,14 +130,16 @@ pw::Status Bme688::DoInit() {
   return pw::OkStatus();
 }
 
-pw::Status Bme688::DoMeasure(pw::sync::ThreadNotification& notification) {
+pw::Status Bme688::DoMeasure(MeasureCallback&& callback) {
   get_data_.Cancel();
+  MeasureCallback previous;
   {
     std::lock_guard lock(lock_);
-    if (notification_ != nullptr) {
-      notification_->release();
-    }
-    notification_ = &notification;
+    previous = std::move(callback_);
+    callback_ = nullptr;
+  }
+  if (previous != nullptr) {
+    previous(pw::Status::Aborted());
   }
 
   heater_.enable = BME68X_ENABLE;
@@ -140,8 +147,12 @@ pw::Status Bme688::DoMeasure(pw::sync::ThreadNotification& notification) {
   heater_.heatr_dur = kHeaterDuration;
   PW_TRY(Check(bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heater_, &bme688_)));
   PW_TRY(Check(bme68x_set_op_mode(BME68X_FORCED_MODE, &bme688_)));
+  {
+    std::lock_guard lock(lock_);
+    callback_ = std::move(callback);
+  }
 
-  worker_.RunOnce([this]() {
+  worker_.RunOnceLabeled(PW_TOKENIZE_STRING("bme688 measure"), [this]() {
     uint32_t delay_us =
         bme68x_get_meas_dur(BME68X_FORCED_MODE, &config_, &bme688_);
     delay_us += (heater_.heatr_dur * 1000);
@@ -155,13 +166,23 @@ pw::Status Bme688::DoMeasure(pw::sync::ThreadNotification& notification) {
 void Bme688::GetDataCallback(pw::chrono::SystemClock::time_point) {
   bme68x_data data;
   uint8_t n;
-  if (Check(bme68x_get_data(BME68X_FORCED_MODE, &data, &n, &bme688_)).ok() &&
-      n != 0) {
+  pw::Status status =
+      Check(bme68x_get_data(BME68X_FORCED_MODE, &data, &n, &bme688_));
+  if (status.ok() && n == 0) {
+    status = pw::Status::Unavailable();
+  }
+  if (status.ok()) {
     Update(data.temperature, data.pressure, data.humidity, data.gas_resistance);
   }
-  std::lock_guard lock(lock_);
-  notification_->release();
-  notification_ = nullptr;
+  MeasureCallback callback;
+  {
+    std::lock_guard lock(lock_);
+    callback = std::move(callback_);
+    callback_ = nullptr;
+  }
+  if (callback != nullptr) {
+    callback(status);
+  }
 }
 
 pw::Status Bme688::Check(int8_t result) {
@@ -31,7 +31,7 @@ class Bme688 : public AirSensor {
  private:
   pw::Status DoInit() override;
 
-  pw::Status DoMeasure(pw::sync::ThreadNotification& notification) override;
+  pw::Status DoMeasure(MeasureCallback&& callback) override;
 
   void GetDataCallback(pw::chrono::SystemClock::time_point);
 
@@ -44,7 +44,7 @@ class Bme688 : public AirSensor {
   pw::i2c::RegisterDevice i2c_device_;
   pw::chrono::SystemTimer get_data_;
   pw::sync::InterruptSpinLock lock_;
-  pw::sync::ThreadNotification* notification_ PW_GUARDED_BY(lock_) = nullptr;
+  MeasureCallback callback_ PW_GUARDED_BY(lock_);
 };
 
 }  // namespace sense
@@ -14,23 +14,83 @@
 
 #include "device/pico_board.h"
 
+#include <array>
+
 #include "hardware/adc.h"
+#include "hardware/dma.h"
 #include "hardware/flash.h"
 #include "pico/bootrom.h"
 #include "pw_bytes/endian.h"
 
 namespace sense {
 
-PicoBoard::PicoBoard() { adc_init(); }
+namespace {
 
-// See raspberry-pi-pico-c-sdk.pdf, Section '4.1.1. hardware_adc'
-float PicoBoard::ReadInternalTemperature() {
+constexpr unsigned kTemperatureSensorInput = 4;
+
+// The ADC is clocked at 48 MHz, and takes a sample every (1 + clkdiv) cycles.
+constexpr float kAdcClockHz = 48'000'000.f;
+
+// DMA transfer count of the capture. On the RP2350, the top four bits of
+// TRANS_COUNT select a mode rather than counting, and the endless mode never
+// finishes the transfer. The RP2040 counts with all 32 bits, so at 1 kHz its
+// largest count lasts for about 50 days before the capture is restarted.
+#if defined(PICO_RP2350) && PICO_RP2350
+constexpr uint32_t kCaptureTransferCount =
+    DMA_CH0_TRANS_COUNT_MODE_VALUE_ENDLESS << DMA_CH0_TRANS_COUNT_MODE_LSB;
+#else
+constexpr uint32_t kCaptureTransferCount = 0xffffffff;
+#endif  // defined(PICO_RP2350) && PICO_RP2350
+
+}  // namespace
+
+// See raspberry-pi-pico-c-sdk.pdf, Sections '4.1.1. hardware_adc' and
+// '4.1.7. hardware_dma'.
+PicoBoard::PicoBoard() {
+  adc_init();
   adc_set_temp_sensor_enabled(true);
-  adc_select_input(4);  // 4 is the on board temp sensor.
+  adc_select_input(kTemperatureSensorInput);
+
+  // Start from a single reading, so that readings are valid before the ring
+  // has been filled.
+  temperature_samples_.Fill(adc_read());
 
-  constexpr float kConversionFactor = 3.3f / (1 << 12);
-  float adc = static_cast<float>(adc_read()) * kConversionFactor;
-  return 27.0f - (adc - 0.706f) / 0.001721f;
+  adc_fifo_setup(/*en=*/true,
+                 /*dreq_en=*/true,
+                 /*dreq_thresh=*/1,
+                 /*err_in_fifo=*/false,
+                 /*byte_shift=*/false);
+  adc_set_clkdiv(kAdcClockHz / kTemperatureSampleRateHz - 1);
+
+  dma_channel_ = dma_claim_unused_channel(/*required=*/true);
+  StartTemperatureCapture();
+  adc_run(true);
+}
+
+void PicoBoard::StartTemperatureCapture() {
+  dma_channel_config config = dma_channel_get_default_config(dma_channel_);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+  channel_config_set_read_increment(&config, false);
+  channel_config_set_write_increment(&config, true);
+  channel_config_set_ring(&config,
+                          /*write=*/true,
+                          decltype(temperature_samples_)::kRingBits);
+  channel_config_set_dreq(&config, DREQ_ADC);
+  dma_channel_configure(dma_channel_,
+                        &config,
+                        temperature_samples_.data(),
+                        &adc_hw->fifo,
+                        kCaptureTransferCount,
+                        /*trigger=*/true);
+}
+
+float PicoBoard::ReadInternalTemperature() {
+  // Restart the capture in the unlikely case that its transfer has finished,
+  // which only happens on the RP2040.
+  if (!dma_channel_is_busy(dma_channel_)) {
+    StartTemperatureCapture();
+  }
+  return InternalTemperatureFromAdc(temperature_samples_.Average());
 }
 
 // See raspberry-pi-pico-c-sdk.pdf, Section '4.5.5. hardware_bootrom'
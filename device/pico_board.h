@@ -13,17 +13,40 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "modules/board/board.h"
+#include "modules/board/oversampled_adc.h"
 #include "pw_status/status.h"
 
 namespace sense {
 
+/// Pico board functions.
+///
+/// The internal temperature sensor is sampled continuously by the ADC in
+/// free-running mode, and a DMA channel copies each sample from the ADC FIFO
+/// into a ring. `ReadInternalTemperature` averages the ring without waiting
+/// for a conversion.
 class PicoBoard : public Board {
  public:
+  /// Number of samples averaged for each temperature reading.
+  static constexpr size_t kTemperatureOversampling = 64;
+
+  /// Rate at which the temperature sensor is sampled.
+  static constexpr uint32_t kTemperatureSampleRateHz = 1000;
+
   PicoBoard();
   float ReadInternalTemperature() override;
   pw::Status Reboot(board_RebootType_Enum reboot_type) override;
   uint64_t UniqueFlashId() const override;
+
+ private:
+  /// Starts or restarts the DMA channel that fills `temperature_samples_`.
+  void StartTemperatureCapture();
+
+  OversampledAdc<kTemperatureOversampling> temperature_samples_;
+  unsigned dma_channel_;
 };
 
 }  // namespace sense
\ No newline at end of file
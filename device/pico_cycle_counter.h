@@ -0,0 +1,33 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "modules/profiler/profiler.h"
+
+namespace sense {
+
+/// Reads the low word of the RP2's 1 MHz system timer.
+///
+/// SysTick is not used, since FreeRTOS reloads it on every tick. The timer
+/// runs freely, and only wraps every 71 minutes.
+class PicoCycleCounter final : public CycleCounter {
+ public:
+  uint32_t Read() override;
+
+  uint32_t frequency_hz() const override { return 1'000'000; }
+};
+
+}  // namespace sense
@@ -0,0 +1,102 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/pico_digital_in_interrupt.h"
+
+#include <utility>
+
+#include "pw_assert/check.h"
+
+namespace sense {
+
+using ::pw::digital_io::InterruptTrigger;
+using ::pw::digital_io::Polarity;
+using ::pw::digital_io::State;
+
+pw::Status PicoDigitalInInterrupt::DoEnable(bool enable) {
+  if (!enable) {
+    gpio_set_irq_enabled(config_.pin, events(), false);
+    gpio_deinit(config_.pin);
+    return pw::OkStatus();
+  }
+  gpio_init(config_.pin);
+  gpio_set_dir(config_.pin, GPIO_IN);
+  if (config_.enable_pull_up) {
+    gpio_pull_up(config_.pin);
+  }
+  return pw::OkStatus();
+}
+
+pw::Result<State> PicoDigitalInInterrupt::DoGetState() {
+  bool high = gpio_get(config_.pin);
+  bool active = config_.polarity == Polarity::kActiveLow ? !high : high;
+  return active ? State::kActive : State::kInactive;
+}
+
+pw::Status PicoDigitalInInterrupt::DoSetInterruptHandler(
+    InterruptTrigger trigger, pw::digital_io::InterruptHandler&& handler) {
+  trigger_ = trigger;
+  handler_ = std::move(handler);
+  return pw::OkStatus();
+}
+
+pw::Status PicoDigitalInInterrupt::DoEnableInterruptHandler(bool enable) {
+  if (!enable) {
+    gpio_set_irq_enabled(config_.pin, events(), false);
+    instances[config_.pin] = nullptr;
+    return pw::OkStatus();
+  }
+  PW_CHECK(instances[config_.pin] == nullptr || instances[config_.pin] == this,
+           "GPIO %u already has an interrupt handler",
+           static_cast<unsigned>(config_.pin));
+  instances[config_.pin] = this;
+
+  // Discard any edge latched while the handler was disabled.
+  gpio_acknowledge_irq(config_.pin, events());
+  gpio_set_irq_enabled_with_callback(config_.pin, events(), true, GpioCallback);
+  return pw::OkStatus();
+}
+
+uint32_t PicoDigitalInInterrupt::events() const {
+  uint32_t activating = config_.polarity == Polarity::kActiveLow
+                            ? GPIO_IRQ_EDGE_FALL
+                            : GPIO_IRQ_EDGE_RISE;
+  uint32_t deactivating = activating == GPIO_IRQ_EDGE_FALL ? GPIO_IRQ_EDGE_RISE
+                                                           : GPIO_IRQ_EDGE_FALL;
+  switch (trigger_) {
+    case InterruptTrigger::kActivatingEdge:
+      return activating;
+    case InterruptTrigger::kDeactivatingEdge:
+      return deactivating;
+    case InterruptTrigger::kBothEdges:
+      break;
+  }
+  return activating | deactivating;
+}
+
+// Runs in interrupt context. The SDK acknowledges the events before calling.
+void PicoDigitalInInterrupt::GpioCallback(uint gpio, uint32_t) {
+  PicoDigitalInInterrupt* input = instances[gpio];
+  if (input == nullptr || input->handler_ == nullptr) {
+    return;
+  }
+  // Pass the level after the edge, since several edges may have been latched
+  // by the time the interrupt is serviced.
+  input->handler_(*input->DoGetState());
+}
+
+std::array<PicoDigitalInInterrupt*, NUM_BANK0_GPIOS>
+    PicoDigitalInInterrupt::instances = {};
+
+}  // namespace sense
@@ -0,0 +1,59 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "hardware/gpio.h"
+#include "pw_digital_io/digital_io.h"
+#include "pw_digital_io_rp2040/digital_io.h"
+
+namespace sense {
+
+/// A GPIO input that runs a handler on its edges.
+///
+/// All instances share the pico-sdk's GPIO interrupt callback, which is
+/// installed when the first handler is enabled, and dispatch by pin number.
+class PicoDigitalInInterrupt : public pw::digital_io::DigitalInInterrupt {
+ public:
+  using Config = ::pw::digital_io::Rp2040Config;
+
+  PicoDigitalInInterrupt(const Config& config) : config_(config) {}
+
+ private:
+  pw::Status DoEnable(bool enable) override;
+
+  pw::Result<pw::digital_io::State> DoGetState() override;
+
+  pw::Status DoSetInterruptHandler(
+      pw::digital_io::InterruptTrigger trigger,
+      pw::digital_io::InterruptHandler&& handler) override;
+
+  pw::Status DoEnableInterruptHandler(bool enable) override;
+
+  /// Returns the GPIO events that correspond to the trigger.
+  uint32_t events() const;
+
+  static void GpioCallback(uint gpio, uint32_t events);
+
+  static std::array<PicoDigitalInInterrupt*, NUM_BANK0_GPIOS> instances;
+
+  const Config config_;
+  pw::digital_io::InterruptTrigger trigger_ =
+      pw::digital_io::InterruptTrigger::kBothEdges;
+  pw::digital_io::InterruptHandler handler_;
+};
+
+}  // namespace sense
@@ -17,16 +17,13 @@
 
 #include "hardware/pwm.h"
 #include "modules/pwm/digital_out.h"
-#include "pw_chrono/system_clock.h"
 #include "pw_digital_io_rp2040/digital_io.h"
-#include "pw_function/function.h"
 
 namespace sense {
 
 class PicoPwmGpio : public PwmDigitalOut {
  public:
   using GpioConfig = ::pw::digital_io::Rp2040Config;
-  using Callback = ::pw::Function<void()>;
 
   PicoPwmGpio(const GpioConfig& config);
 
@@ -34,16 +31,6 @@ class PicoPwmGpio : public PwmDigitalOut {
   void DoEnable() override;
   void DoDisable() override;
   void DoSetLevel(uint16_t level) override;
-  void DoSetCallback(uint16_t per_interval,
-                     pw::chrono::SystemClock::duration interval_ms) override;
-  void DoClearCallback() override;
-
-  void EnablePwmIrq() const;
-  void DisablePwmIrq() const;
-
-  static void IrqHandler();
-
-  static PicoPwmGpio* gpio_with_callback;
 
   uint16_t slice_num_;
   const GpioConfig& gpio_config_;
@@ -0,0 +1,84 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "PWM"
+
+#include "device/pico_pwm_ticker.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "pw_assert/check.h"
+#include "pw_log/log.h"
+
+namespace sense {
+
+void PicoPwmTicker::Start() {
+  PW_CHECK(active_ticker == nullptr || active_ticker == this,
+           "Only one PWM ticker may run at a time");
+
+  // Use the smallest integer divider that lets the counter fit in 16 bits, for
+  // the most accurate tick rate.
+  constexpr uint32_t kCounts = std::numeric_limits<uint16_t>::max() + 1;
+  uint32_t sys_hz = clock_get_hz(clk_sys);
+  uint32_t tick_hz = animator_.tick_hz();
+  uint32_t clkdiv = std::clamp<uint32_t>(
+      (sys_hz / tick_hz + kCounts - 1) / kCounts, 1, 255);
+  uint32_t wrap = sys_hz / (clkdiv * tick_hz) - 1;
+  wrap = std::min<uint32_t>(wrap, kCounts - 1);
+
+  pwm_config config = pwm_get_default_config();
+  pwm_config_set_clkdiv_int(&config, clkdiv);
+  pwm_config_set_wrap(&config, static_cast<uint16_t>(wrap));
+  pwm_init(slice_num_, &config, false);
+
+  active_ticker = this;
+  irq_set_exclusive_handler(PWM_IRQ_WRAP, IrqHandler);
+  pwm_clear_irq(slice_num_);
+  pwm_set_irq_enabled(slice_num_, true);
+  irq_set_enabled(PWM_IRQ_WRAP, true);
+  pwm_set_enabled(slice_num_, true);
+  PW_LOG_INFO("Animating at %u Hz using slice %hu", tick_hz, slice_num_);
+}
+
+void PicoPwmTicker::Stop() {
+  pwm_set_enabled(slice_num_, false);
+  irq_set_enabled(PWM_IRQ_WRAP, false);
+  pwm_set_irq_enabled(slice_num_, false);
+  pwm_clear_irq(slice_num_);
+  irq_remove_handler(PWM_IRQ_WRAP, IrqHandler);
+  active_ticker = nullptr;
+}
+
+void PicoPwmTicker::SetPaused(bool paused) {
+  pwm_set_enabled(slice_num_, !paused);
+}
+
+// Every animation is advanced from this one interrupt, each according to its
+// own rate divider, so the PWM frequency of the animated outputs never needs
+// to change.
+void PicoPwmTicker::IrqHandler() {
+  if (active_ticker == nullptr) {
+    return;
+  }
+  pwm_clear_irq(active_ticker->slice_num_);
+  active_ticker->animator_.Tick();
+}
+
+PicoPwmTicker* PicoPwmTicker::active_ticker = nullptr;
+
+}  // namespace sense
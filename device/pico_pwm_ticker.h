@@ -0,0 +1,52 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "modules/pwm/animator.h"
+
+namespace sense {
+
+/// Drives a `PwmAnimator` from the wrap interrupt of a PWM slice.
+///
+/// The slice is used only as a timer, and should not be shared with any
+/// output. Only one ticker may be started at a time, as it installs the
+/// exclusive handler for the PWM wrap interrupt.
+class PicoPwmTicker {
+ public:
+  PicoPwmTicker(uint16_t slice_num, PwmAnimator& animator)
+      : slice_num_(slice_num), animator_(animator) {}
+
+  /// Configures the slice to wrap at the animator's tick rate, and starts
+  /// ticking.
+  void Start();
+
+  /// Stops ticking.
+  void Stop();
+
+  /// Pauses or resumes ticking after `Start`, without reconfiguring the slice.
+  /// Interrupt safe.
+  void SetPaused(bool paused);
+
+ private:
+  static void IrqHandler();
+
+  static PicoPwmTicker* active_ticker;
+
+  const uint16_t slice_num_;
+  PwmAnimator& animator_;
+};
+
+}  // namespace sense
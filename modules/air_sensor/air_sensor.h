@@ -14,6 +14,7 @@
 #pragma once
 
 #include "modules/pubsub/pubsub_events.h"
+#include "pw_function/function.h"
 #include "pw_metric/metric.h"
 #include "pw_result/result.h"
 #include "pw_status/status.h"
@@ -25,6 +26,9 @@ namespace sense {
 
 class AirSensor {
  public:
+  /// Called with the result of a measurement.
+  using MeasureCallback = pw::Function<void(pw::Status)>;
+
   // Default starting values representing decent air quality.
   static constexpr float kDefaultTemperature = 20.f;
   static constexpr float kDefaultPressure = 100.f;
@@ -86,7 +90,20 @@ class AirSensor {
   /// given notification will be released.
   pw::Status Measure(pw::sync::ThreadNotification& notification)
       PW_LOCKS_EXCLUDED(lock_) {
-    return DoMeasure(notification);
+    return DoMeasure([&notification](pw::Status) { notification.release(); });
+  }
+
+  /// Requests an air measurement without waiting for it.
+  ///
+  /// When the measurement is complete, ``Update`` will be called if it
+  /// succeeded, and then the callback will be invoked with its status. If
+  /// another measurement is requested first, the callback is invoked with
+  /// ABORTED. If this method returns an error, the callback is not invoked.
+  ///
+  /// The callback may be invoked before this method returns, or from a timer or
+  /// worker context, and should not block.
+  pw::Status Measure(MeasureCallback&& callback) PW_LOCKS_EXCLUDED(lock_) {
+    return DoMeasure(std::move(callback));
   }
 
   /// Like `Measure`, but runs synchronously and returns the same score as
@@ -112,7 +129,7 @@ class AirSensor {
   virtual pw::Status DoInit() { return pw::OkStatus(); }
 
   /// @copydoc `AirSensor::Measure`.
-  virtual pw::Status DoMeasure(pw::sync::ThreadNotification& notification)
+  virtual pw::Status DoMeasure(MeasureCallback&& callback)
       PW_LOCKS_EXCLUDED(lock_) = 0;
 
   mutable pw::sync::InterruptSpinLock lock_;
@@ -13,10 +13,13 @@
 // the License.
 #pragma once
 
+#include <utility>
+
 #include "modules/air_sensor/air_sensor.h"
 #include "pw_assert/assert.h"
 #include "pw_status/status.h"
-#include "pw_sync/thread_notification.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
 
 namespace sense {
 
@@ -32,36 +35,57 @@ class AirSensorFake : public AirSensor {
     gas_resistance_ = gas_resistance;
   }
 
+  /// Makes later measurements fail to start with the given status.
+  void set_measure_status(pw::Status status) { measure_status_ = status; }
+
+  /// Completes the pending measurement with ABORTED, as a request for another
+  /// measurement would.
+  void Abort() { Complete(pw::Status::Aborted()); }
+
   void Publish() {
     Update(temperature_, pressure_, humidity_, gas_resistance_);
+    Complete(pw::OkStatus());
+  }
+
+ private:
+  void Complete(pw::Status status) {
+    MeasureCallback callback;
     {
       std::lock_guard lock(lock_);
-      PW_ASSERT(notification_ != nullptr);
-      notification_->release();
-      notification_ = nullptr;
+      PW_ASSERT(callback_ != nullptr);
+      callback = std::move(callback_);
+      callback_ = nullptr;
     }
+    callback(status);
   }
 
- private:
-  pw::Status DoMeasure(pw::sync::ThreadNotification& notification) override {
+  pw::Status DoMeasure(MeasureCallback&& callback) override {
+    if (!measure_status_.ok()) {
+      return measure_status_;
+    }
+    MeasureCallback previous;
     {
       std::lock_guard lock(lock_);
-      notification_ = &notification;
+      previous = std::move(callback_);
+      callback_ = std::move(callback);
+    }
+    if (previous != nullptr) {
+      previous(pw::Status::Aborted());
     }
     if (autopublish_) {
       Publish();
-    } else {
     }
     return pw::OkStatus();
   }
 
   bool autopublish_ = true;
+  pw::Status measure_status_;
   float temperature_ = AirSensor::kDefaultTemperature;
   float pressure_ = AirSensor::kDefaultPressure;
   float humidity_ = AirSensor::kDefaultHumidity;
   float gas_resistance_ = AirSensor::kDefaultGasResistance;
   pw::sync::InterruptSpinLock lock_;
-  pw::sync::ThreadNotification* notification_ PW_GUARDED_BY(lock_) = nullptr;
+  MeasureCallback callback_ PW_GUARDED_BY(lock_);
 };
 
 }  // namespace sense
@@ -14,9 +14,13 @@
 
 #include "modules/air_sensor/service.h"
 
+#include <mutex>
+#include <utility>
+
 #include "pw_assert/check.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_log/log.h"
+#include "pw_tokenizer/tokenize.h"
 
 namespace sense {
 
@@ -35,12 +39,86 @@ void AirSensorService::FillMeasurement(air_sensor_Measurement& response) {
   response.score = air_sensor_->score();
 }
 
-pw::Status AirSensorService::Measure(const pw_protobuf_Empty&,
-                                     air_sensor_Measurement& response) {
-  PW_TRY(air_sensor_->Measure(notification_));
-  notification_.acquire();
-  FillMeasurement(response);
-  return pw::OkStatus();
+void AirSensorService::Measure(const pw_protobuf_Empty&,
+                               MeasureResponder& responder) {
+  bool queued = false;
+  bool start_measurement = false;
+  {
+    std::lock_guard lock(lock_);
+    if (!pending_measures_.full()) {
+      pending_measures_.push_back(std::move(responder));
+      queued = true;
+      start_measurement = !measuring_;
+      measuring_ = true;
+    }
+  }
+  if (!queued) {
+    if (const auto status =
+            responder.Finish({}, pw::Status::ResourceExhausted());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+  if (start_measurement) {
+    StartMeasurement();
+  }
+}
+
+void AirSensorService::StartMeasurement() {
+  {
+    std::lock_guard lock(lock_);
+    ++measure_attempts_;
+  }
+  const pw::Status status = air_sensor_->Measure(
+      [this](pw::Status result) { OnMeasurement(result); });
+  if (!status.ok()) {
+    PW_LOG_ERROR("Failed to start air measurement: %s", status.str());
+    FinishMeasures(status);
+  }
+}
+
+void AirSensorService::OnMeasurement(pw::Status status) {
+  // The air sensor may call this from its timer, so respond on the worker.
+  worker_->RunOnceLabeled(
+      PW_TOKENIZE_STRING("air sensor measure"), [this, status]() {
+        if (status.IsAborted()) {
+          bool retry;
+          {
+            std::lock_guard lock(lock_);
+            retry = measure_attempts_ < kMaxMeasureAttempts;
+          }
+          if (retry) {
+            StartMeasurement();
+            return;
+          }
+        }
+        FinishMeasures(status);
+      });
+}
+
+void AirSensorService::FinishMeasures(pw::Status status) {
+  pw::Vector<MeasureResponder, kMaxPendingMeasures> responders;
+  {
+    std::lock_guard lock(lock_);
+    for (MeasureResponder& responder : pending_measures_) {
+      responders.push_back(std::move(responder));
+    }
+    pending_measures_.clear();
+    measuring_ = false;
+    measure_attempts_ = 0;
+  }
+
+  air_sensor_Measurement response = {};
+  if (status.ok()) {
+    FillMeasurement(response);
+  }
+  for (MeasureResponder& responder : responders) {
+    if (const auto finish_status = responder.Finish(response, status);
+        !finish_status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", finish_status.str());
+    }
+  }
 }
 
 void AirSensorService::MeasureStream(
@@ -81,7 +159,9 @@ void AirSensorService::SampleCallback(pw::chrono::SystemClock::time_point) {
 }
 
 void AirSensorService::ScheduleSample() {
-  worker_->RunOnce([this]() { sample_timer_.InvokeAfter(sample_interval_); });
+  worker_->RunOnceLabeled(
+      PW_TOKENIZE_STRING("air sensor sample"),
+      [this]() { sample_timer_.InvokeAfter(sample_interval_); });
 }
 
 }  // namespace sense
@@ -13,14 +13,20 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "modules/air_sensor/air_sensor.h"
 #include "modules/air_sensor/air_sensor.rpc.pb.h"
 #include "modules/worker/worker.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_chrono/system_timer.h"
+#include "pw_containers/vector.h"
 #include "pw_function/function.h"
+#include "pw_rpc/nanopb/server_reader_writer.h"
 #include "pw_status/status.h"
-#include "pw_sync/thread_notification.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
 
 namespace sense {
 
@@ -28,14 +34,28 @@ class AirSensorService final
     : public ::air_sensor::pw_rpc::nanopb::AirSensor::Service<
           AirSensorService> {
  public:
+  using MeasureResponder =
+      ::pw::rpc::NanopbUnaryResponder<air_sensor_Measurement>;
+
+  /// Maximum number of `Measure` calls waiting for a measurement. Further
+  /// calls fail with RESOURCE_EXHAUSTED.
+  static constexpr size_t kMaxPendingMeasures = 8;
+
+  /// Number of times a measurement is started for the pending `Measure` calls
+  /// while other requests keep aborting it. The calls then fail with ABORTED.
+  static constexpr uint8_t kMaxMeasureAttempts = 3;
+
   AirSensorService()
       : sample_timer_(
             pw::bind_member<&AirSensorService::SampleCallback>(this)) {}
 
   void Init(Worker& worker, AirSensor& air_sensor);
 
-  pw::Status Measure(const pw_protobuf_Empty&,
-                     air_sensor_Measurement& response);
+  /// Responds once the air sensor completes a measurement. Calls made while a
+  /// measurement is in progress share its result, rather than waiting for
+  /// one measurement each.
+  void Measure(const pw_protobuf_Empty&, MeasureResponder& responder)
+      PW_LOCKS_EXCLUDED(lock_);
 
   void MeasureStream(const air_sensor_MeasureStreamRequest& request,
                      ServerWriter<air_sensor_Measurement>& writer);
@@ -49,9 +69,26 @@ class AirSensorService final
 
   void FillMeasurement(air_sensor_Measurement& response);
 
+  /// Requests a measurement for the pending `Measure` calls, or fails them if
+  /// the air sensor cannot start one.
+  void StartMeasurement();
+
+  /// Called by the air sensor when a measurement completes. Hands the result
+  /// to the worker, which measures again if the measurement was aborted.
+  void OnMeasurement(pw::Status status);
+
+  /// Responds to every pending `Measure` call.
+  void FinishMeasures(pw::Status status) PW_LOCKS_EXCLUDED(lock_);
+
   Worker* worker_ = nullptr;
   AirSensor* air_sensor_ = nullptr;
-  pw::sync::ThreadNotification notification_;
+
+  pw::sync::InterruptSpinLock lock_;
+  pw::Vector<MeasureResponder, kMaxPendingMeasures> pending_measures_
+      PW_GUARDED_BY(lock_);
+  bool measuring_ PW_GUARDED_BY(lock_) = false;
+  uint8_t measure_attempts_ PW_GUARDED_BY(lock_) = 0;
+
   pw::chrono::SystemTimer sample_timer_;
   pw::chrono::SystemClock::duration sample_interval_;
   ServerWriter<air_sensor_Measurement> sample_writer_;
@@ -0,0 +1,117 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/service.h"
+
+#include "modules/air_sensor/air_sensor_fake.h"
+#include "modules/worker/test_worker.h"
+#include "pw_rpc/nanopb/test_method_context.h"
+#include "pw_rpc/test_helpers.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+class AirSensorServiceTest : public ::testing::Test {
+ protected:
+  void TearDown() override { worker_.Stop(); }
+
+  /// Waits for the worker to run the work queued so far.
+  void SyncWorker() {
+    pw::sync::ThreadNotification done;
+    worker_.RunOnce([&done]() { done.release(); });
+    done.acquire();
+  }
+
+  sense::TestWorker<> worker_;
+  sense::AirSensorFake air_sensor_;
+};
+
+TEST_F(AirSensorServiceTest, Measure) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::AirSensorService, Measure) ctx;
+  ctx.service().Init(worker_, air_sensor_);
+  air_sensor_.set_temperature(25.f);
+
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [&ctx] { ctx.call({}); });
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::OkStatus());
+  EXPECT_EQ(ctx.response().temperature, 25.f);
+}
+
+TEST_F(AirSensorServiceTest, MeasureRespondsAfterMeasurement) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::AirSensorService, Measure) ctx;
+  ctx.service().Init(worker_, air_sensor_);
+  air_sensor_.set_autopublish(false);
+
+  // The call returns without waiting for the sensor.
+  ctx.call({});
+  EXPECT_FALSE(ctx.done());
+
+  air_sensor_.set_humidity(55.f);
+  pw::rpc::test::WaitForPackets(
+      ctx.output(), 1, [this] { air_sensor_.Publish(); });
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::OkStatus());
+  EXPECT_EQ(ctx.response().humidity, 55.f);
+}
+
+TEST_F(AirSensorServiceTest, MeasureRetriesAbortedMeasurement) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::AirSensorService, Measure) ctx;
+  ctx.service().Init(worker_, air_sensor_);
+  air_sensor_.set_autopublish(false);
+
+  // Another request aborts the measurement, and the service measures again.
+  ctx.call({});
+  air_sensor_.Abort();
+  SyncWorker();
+  EXPECT_FALSE(ctx.done());
+
+  air_sensor_.set_pressure(101.f);
+  pw::rpc::test::WaitForPackets(
+      ctx.output(), 1, [this] { air_sensor_.Publish(); });
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::OkStatus());
+  EXPECT_EQ(ctx.response().pressure, 101.f);
+}
+
+TEST_F(AirSensorServiceTest, MeasureFailsWhenMeasurementCannotStart) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::AirSensorService, Measure) ctx;
+  ctx.service().Init(worker_, air_sensor_);
+  air_sensor_.set_measure_status(pw::Status::Unavailable());
+
+  ctx.call({});
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::Status::Unavailable());
+}
+
+TEST_F(AirSensorServiceTest, MeasureFailsPendingCallsWhenRetryCannotStart) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::AirSensorService, Measure) ctx;
+  ctx.service().Init(worker_, air_sensor_);
+  air_sensor_.set_autopublish(false);
+
+  ctx.call({});
+  EXPECT_FALSE(ctx.done());
+  air_sensor_.set_measure_status(pw::Status::Unavailable());
+  pw::rpc::test::WaitForPackets(
+      ctx.output(), 1, [this] { air_sensor_.Abort(); });
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::Status::Unavailable());
+}
+
+}  // namespace
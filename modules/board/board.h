@@ -27,6 +27,9 @@ class Board {
   virtual ~Board() = default;
 
   /// Returns the CPU core temperature, in degress Celsius.
+  ///
+  /// Readings are averaged from samples captured in the background, so this
+  /// returns without waiting for the ADC.
   virtual float ReadInternalTemperature() = 0;
 
   /// Reboot the board.
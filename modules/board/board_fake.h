@@ -13,20 +13,56 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/board/board.h"
 #include "modules/board/board.rpc.pb.h"
+#include "modules/board/oversampled_adc.h"
 
 namespace sense {
 
 /// Implements and extends the ``Board`` interface to facilitate unit testing.
 class BoardFake : public Board {
  public:
+  /// Number of samples averaged for each temperature reading, once ADC
+  /// samples have been pushed.
+  static constexpr size_t kTemperatureOversampling = 16;
+
   board_RebootType_Enum last_reboot_type() const { return last_reboot_type_; }
+
+  /// Sets the temperature returned until ADC samples are pushed.
   void set_internal_temperature(float internal_temperature) {
     internal_temperature_ = internal_temperature;
   }
 
+  /// Adds a raw temperature sensor sample, as the DMA does on the device.
+  /// Once a sample has been pushed, readings average the latest samples.
+  void PushAdcSample(uint16_t sample) {
+    if (!adc_started_) {
+      temperature_samples_.Fill(sample);
+      adc_started_ = true;
+    }
+    temperature_samples_.Push(sample);
+  }
+
+  /// Pushes `count` samples of a synthetic temperature sensor at `celsius`,
+  /// alternately `noise` counts above and below the true reading.
+  void PushSyntheticAdcSamples(float celsius, uint16_t noise, size_t count) {
+    const uint16_t reading = InternalTemperatureToAdc(celsius);
+    for (size_t i = 0; i < count; ++i) {
+      PushAdcSample(static_cast<uint16_t>(i % 2 == 0 ? reading + noise
+                                                     : reading - noise));
+    }
+  }
+
   /// @copydoc ``Board::ReadInternalTemperature``.
-  float ReadInternalTemperature() override { return internal_temperature_; }
+  float ReadInternalTemperature() override {
+    if (!adc_started_) {
+      return internal_temperature_;
+    }
+    return InternalTemperatureFromAdc(temperature_samples_.Average());
+  }
 
   /// @copydoc ``Board::Reboot``.
   pw::Status Reboot(board_RebootType_Enum reboot_type) override {
@@ -39,6 +75,8 @@ class BoardFake : public Board {
  private:
   static constexpr uint64_t kFakeFlashId = 0x0000aabbccddeeff;
   float internal_temperature_ = 20.0f;
+  OversampledAdc<kTemperatureOversampling> temperature_samples_;
+  bool adc_started_ = false;
   board_RebootType_Enum last_reboot_type_ = board_RebootType_Enum_UNKNOWN;
 };
 
@@ -0,0 +1,93 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace sense {
+
+/// Converts an average reading of the RP2's internal temperature sensor, in
+/// 12-bit ADC counts, to degrees Celsius.
+///
+/// See raspberry-pi-pico-c-sdk.pdf, Section '4.1.1. hardware_adc'.
+constexpr float InternalTemperatureFromAdc(float counts) {
+  constexpr float kConversionFactor = 3.3f / (1 << 12);
+  return 27.0f - (counts * kConversionFactor - 0.706f) / 0.001721f;
+}
+
+/// Converts degrees Celsius to the reading the RP2's internal temperature
+/// sensor would give, in 12-bit ADC counts.
+constexpr uint16_t InternalTemperatureToAdc(float celsius) {
+  constexpr float kConversionFactor = 3.3f / (1 << 12);
+  return static_cast<uint16_t>(
+      (0.706f - (celsius - 27.0f) * 0.001721f) / kConversionFactor + 0.5f);
+}
+
+/// A ring of ADC samples that is filled in the background, e.g. by DMA, and
+/// averaged on demand.
+///
+/// Averaging `kSamples` samples reduces uncorrelated noise by a factor of
+/// `sqrt(kSamples)`. Reading the average does not touch the ADC, and can be
+/// done at any time while the ring is being filled.
+///
+/// The ring is aligned to its size, so that a DMA channel can wrap its write
+/// address around it.
+///
+/// @tparam   kSamples  Number of samples averaged. Must be a power of two.
+template <size_t kSamples>
+class OversampledAdc {
+ public:
+  static_assert(kSamples > 0 && std::has_single_bit(kSamples),
+                "The ring size must be a power of two");
+
+  /// Size of the ring, in bytes.
+  static constexpr size_t kSizeBytes = kSamples * sizeof(uint16_t);
+
+  /// Base-2 logarithm of `kSizeBytes`, as used to configure a DMA ring.
+  static constexpr uint32_t kRingBits = std::countr_zero(kSizeBytes);
+
+  /// Sets every sample to `sample`, e.g. a first blocking reading.
+  void Fill(uint16_t sample) {
+    for (volatile uint16_t& s : samples_) {
+      s = sample;
+    }
+    next_ = 0;
+  }
+
+  /// Replaces the oldest sample. Only used when not filling the ring by DMA.
+  void Push(uint16_t sample) {
+    samples_[next_] = sample;
+    next_ = (next_ + 1) % kSamples;
+  }
+
+  /// Returns the mean of the samples in the ring, in ADC counts.
+  float Average() const {
+    uint32_t sum = 0;
+    for (const volatile uint16_t& sample : samples_) {
+      sum += sample;
+    }
+    return static_cast<float>(sum) / kSamples;
+  }
+
+  /// Returns the start of the ring, for a DMA channel to write to.
+  volatile uint16_t* data() { return samples_; }
+
+ private:
+  alignas(kSizeBytes) volatile uint16_t samples_[kSamples] = {};
+  size_t next_ = 0;
+};
+
+}  // namespace sense
@@ -0,0 +1,81 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/board/oversampled_adc.h"
+
+#include <cstdint>
+
+#include "modules/board/board_fake.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+TEST(OversampledAdcTest, RingIsAlignedToItsSize) {
+  OversampledAdc<64> adc;
+  EXPECT_EQ(OversampledAdc<64>::kSizeBytes, 128u);
+  EXPECT_EQ(OversampledAdc<64>::kRingBits, 7u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(adc.data()) % 128, 0u);
+}
+
+TEST(OversampledAdcTest, AveragesFilledValue) {
+  OversampledAdc<8> adc;
+  adc.Fill(1000);
+  EXPECT_FLOAT_EQ(adc.Average(), 1000.f);
+}
+
+TEST(OversampledAdcTest, AveragesOutNoise) {
+  OversampledAdc<16> adc;
+  for (int i = 0; i < 16; ++i) {
+    adc.Push(i % 2 == 0 ? 870 : 880);
+  }
+  EXPECT_FLOAT_EQ(adc.Average(), 875.f);
+}
+
+TEST(OversampledAdcTest, PushReplacesOldestSample) {
+  OversampledAdc<4> adc;
+  adc.Fill(100);
+  adc.Push(500);
+  EXPECT_FLOAT_EQ(adc.Average(), 200.f);
+  for (int i = 0; i < 4; ++i) {
+    adc.Push(500);
+  }
+  EXPECT_FLOAT_EQ(adc.Average(), 500.f);
+}
+
+TEST(OversampledAdcTest, ConvertsInternalTemperature) {
+  // 0.706 V is 27 degrees Celsius.
+  EXPECT_NEAR(InternalTemperatureFromAdc(0.706f / 3.3f * 4096), 27.f, 0.01f);
+  for (float celsius : {-10.f, 20.f, 45.5f}) {
+    EXPECT_NEAR(InternalTemperatureFromAdc(InternalTemperatureToAdc(celsius)),
+                celsius,
+                0.5f);
+  }
+}
+
+TEST(OversampledAdcTest, BoardFakeAveragesSyntheticSamples) {
+  BoardFake board;
+  board.set_internal_temperature(30.f);
+  EXPECT_EQ(board.ReadInternalTemperature(), 30.f);
+
+  board.PushSyntheticAdcSamples(25.f, 20, BoardFake::kTemperatureOversampling);
+  EXPECT_NEAR(board.ReadInternalTemperature(), 25.f, 0.5f);
+
+  // A single noisy sample only moves the average slightly.
+  board.PushAdcSample(InternalTemperatureToAdc(25.f) + 40);
+  EXPECT_NEAR(board.ReadInternalTemperature(), 25.f, 1.5f);
+}
+
+}  // namespace
+}  // namespace sense
@@ -17,6 +17,7 @@
 #include "modules/board/board.h"
 #include "pw_log/log.h"
 #include "pw_status/status.h"
+#include "pw_tokenizer/tokenize.h"
 #include "system/system.h"
 
 namespace sense {
@@ -72,7 +73,8 @@ void BoardService::TempSampleCallback() {
 }
 
 void BoardService::ScheduleTempSample() {
-  worker_->RunOnce(
+  worker_->RunOnceLabeled(
+      PW_TOKENIZE_STRING("board temperature sample"),
       [this]() { temp_sample_timer_.InvokeAfter(temp_sample_interval_); });
 }
 
@@ -0,0 +1,165 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/buttons/gesture.h"
+
+#include <bit>
+#include <limits>
+
+#include "pw_assert/check.h"
+
+using pw::chrono::SystemClock;
+
+namespace sense {
+
+void GestureRecognizer::Press(size_t button, SystemClock::time_point time) {
+  PW_CHECK_UINT_LT(button, kNumButtons);
+  ButtonState& state = buttons_[button];
+
+  // A press after the multi-click window starts a new click.
+  if (state.clicks > 0 && time - state.release_time >= kMultiClickWindow) {
+    FlushClicks(button);
+  }
+  state.pressed = true;
+  state.consumed = false;
+  state.press_time = time;
+
+  // Buttons from different presses may be added out of order, so the window
+  // extends both ways from the start of the chord.
+  if (chord_ != 0 &&
+      (time >= chord_deadline() || time + kChordWindow <= chord_start_)) {
+    FlushChord();
+  }
+  if (chord_ == 0 || time < chord_start_) {
+    chord_start_ = time;
+  }
+  chord_ |= Bit(button);
+  if (std::popcount(chord_) < 2) {
+    return;
+  }
+
+  // Any clicks made before the chord end there, except for a release during
+  // the chord itself.
+  for (size_t i = 0; i < kNumButtons; ++i) {
+    ButtonState& member = buttons_[i];
+    if ((chord_ & Bit(i)) == 0) {
+      continue;
+    }
+    if (!member.pressed && member.clicks > 0 &&
+        member.release_time >= chord_start_) {
+      --member.clicks;
+    }
+    FlushClicks(i);
+    member.consumed = true;
+  }
+}
+
+void GestureRecognizer::Release(size_t button, SystemClock::time_point time) {
+  PW_CHECK_UINT_LT(button, kNumButtons);
+  ButtonState& state = buttons_[button];
+  if (!state.pressed) {
+    return;
+  }
+  state.pressed = false;
+
+  // Catch up on a long-press that `Advance` was not called in time for.
+  if (!state.consumed && time - state.press_time >= kLongPressTime) {
+    FlushLongPress(button);
+  }
+  if (state.consumed) {
+    return;
+  }
+  if (state.clicks < std::numeric_limits<uint8_t>::max()) {
+    ++state.clicks;
+  }
+  state.release_time = time;
+}
+
+void GestureRecognizer::Advance(SystemClock::time_point now) {
+  if (chord_ != 0 && now >= chord_deadline()) {
+    FlushChord();
+  }
+  for (size_t i = 0; i < kNumButtons; ++i) {
+    ButtonState& state = buttons_[i];
+    if (state.pressed) {
+      if (!state.consumed && now - state.press_time >= kLongPressTime) {
+        FlushLongPress(i);
+      }
+    } else if (state.clicks > 0 &&
+               now - state.release_time >= kMultiClickWindow) {
+      FlushClicks(i);
+    }
+  }
+}
+
+std::optional<SystemClock::time_point> GestureRecognizer::next_deadline()
+    const {
+  std::optional<SystemClock::time_point> deadline;
+  auto update = [&deadline](SystemClock::time_point time) {
+    if (!deadline.has_value() || time < *deadline) {
+      deadline = time;
+    }
+  };
+  // A single button only needs the chord window to tell whether later presses
+  // join it, which `Press` checks from their times.
+  if (std::popcount(chord_) > 1) {
+    update(chord_deadline());
+  }
+  for (const ButtonState& state : buttons_) {
+    if (state.pressed) {
+      if (!state.consumed) {
+        update(state.press_time + kLongPressTime);
+      }
+    } else if (state.clicks > 0) {
+      update(state.release_time + kMultiClickWindow);
+    }
+  }
+  return deadline;
+}
+
+void GestureRecognizer::FlushClicks(size_t button) {
+  ButtonState& state = buttons_[button];
+  if (state.clicks == 0) {
+    return;
+  }
+  handler_(ButtonGesture{
+      .kind = ButtonGesture::kClick,
+      .buttons = Bit(button),
+      .clicks = state.clicks,
+  });
+  state.clicks = 0;
+}
+
+void GestureRecognizer::FlushLongPress(size_t button) {
+  FlushClicks(button);
+  handler_(ButtonGesture{
+      .kind = ButtonGesture::kLongPress,
+      .buttons = Bit(button),
+      .clicks = 0,
+  });
+  buttons_[button].consumed = true;
+}
+
+void GestureRecognizer::FlushChord() {
+  if (std::popcount(chord_) > 1) {
+    handler_(ButtonGesture{
+        .kind = ButtonGesture::kChord,
+        .buttons = chord_,
+        .clicks = 0,
+    });
+  }
+  chord_ = 0;
+}
+
+}  // namespace sense
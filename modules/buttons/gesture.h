@@ -0,0 +1,120 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "modules/pubsub/pubsub_events.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_function/function.h"
+
+namespace sense {
+
+/// Recognizes clicks, long-presses and chords from debounced button presses
+/// and releases.
+///
+/// Every decision is made from the times at which presses and releases
+/// happened, and not from when they are added, so gestures are recognized the
+/// same way however late `Press`, `Release` and `Advance` are called.
+///
+/// * A click is a press and release of a single button. Further presses that
+///   start within `kMultiClickWindow` of the last release add to its count,
+///   and the click is recognized once the window has passed.
+/// * A long-press is a single button held for `kLongPressTime`. It is
+///   recognized while the button is still held, and its release is not a
+///   click.
+/// * A chord is several buttons pressed within `kChordWindow` of each other.
+///   It is recognized once the window has passed, and its buttons do not make
+///   clicks or long-presses until they are pressed again.
+///
+/// This class is NOT thread safe.
+class GestureRecognizer {
+ public:
+  using Handler = pw::Function<void(const ButtonGesture&)>;
+
+  static constexpr size_t kNumButtons = 4;
+
+  static constexpr pw::chrono::SystemClock::duration kMultiClickWindow =
+      std::chrono::milliseconds(300);
+  static constexpr pw::chrono::SystemClock::duration kLongPressTime =
+      std::chrono::milliseconds(800);
+  static constexpr pw::chrono::SystemClock::duration kChordWindow =
+      std::chrono::milliseconds(80);
+
+  /// Creates a recognizer that passes each gesture to `handler`.
+  explicit GestureRecognizer(Handler&& handler)
+      : handler_(std::move(handler)) {}
+
+  /// Adds a press of a button at the given time.
+  ///
+  /// Presses and releases of each button must be added in order.
+  void Press(size_t button, pw::chrono::SystemClock::time_point time);
+
+  /// Adds a release of a button at the given time.
+  void Release(size_t button, pw::chrono::SystemClock::time_point time);
+
+  /// Recognizes any gestures that were complete at `now`.
+  ///
+  /// Every press and release before `now` must have been added already.
+  void Advance(pw::chrono::SystemClock::time_point now);
+
+  /// Returns when `Advance` should next be called, if a gesture is in progress.
+  std::optional<pw::chrono::SystemClock::time_point> next_deadline() const;
+
+ private:
+  struct ButtonState {
+    bool pressed = false;
+
+    /// Whether the current press is already part of another gesture, and its
+    /// release should not count as a click.
+    bool consumed = false;
+
+    /// Clicks made so far, while waiting to see if there are more.
+    uint8_t clicks = 0;
+
+    pw::chrono::SystemClock::time_point press_time;
+    pw::chrono::SystemClock::time_point release_time;
+  };
+
+  static constexpr uint8_t Bit(size_t button) {
+    return static_cast<uint8_t>(1u << button);
+  }
+
+  /// Passes on the clicks a button has made so far, if any.
+  void FlushClicks(size_t button);
+
+  /// Passes on a long-press of a button, after any clicks before it.
+  void FlushLongPress(size_t button);
+
+  /// Passes on the pending chord, if it has more than one button.
+  void FlushChord();
+
+  pw::chrono::SystemClock::time_point chord_deadline() const {
+    return chord_start_ + kChordWindow;
+  }
+
+  Handler handler_;
+  std::array<ButtonState, kNumButtons> buttons_;
+
+  /// Buttons pressed within `kChordWindow` of `chord_start_`.
+  uint8_t chord_ = 0;
+  pw::chrono::SystemClock::time_point chord_start_;
+};
+
+}  // namespace sense
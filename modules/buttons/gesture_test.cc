@@ -0,0 +1,166 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/buttons/gesture.h"
+
+#include "pw_containers/vector.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using ::pw::chrono::SystemClock;
+using namespace std::literals::chrono_literals;
+
+constexpr size_t kA = 0;
+constexpr size_t kB = 1;
+constexpr size_t kX = 2;
+
+// Test fixtures.
+
+class GestureRecognizerTest : public ::testing::Test {
+ protected:
+  GestureRecognizerTest()
+      : recognizer_([this](const ButtonGesture& gesture) {
+          gestures_.push_back(gesture);
+        }) {}
+
+  /// Returns an arbitrary start time plus `offset`, since the recognizer does
+  /// not sample the clock.
+  SystemClock::time_point At(SystemClock::duration offset) {
+    return start_ + offset;
+  }
+
+  void ExpectGesture(size_t index,
+                     ButtonGesture::Kind kind,
+                     uint8_t buttons,
+                     uint8_t clicks = 0) {
+    ASSERT_LT(index, gestures_.size());
+    EXPECT_EQ(gestures_[index].kind, kind);
+    EXPECT_EQ(gestures_[index].buttons, buttons);
+    EXPECT_EQ(gestures_[index].clicks, clicks);
+  }
+
+  SystemClock::time_point start_ = SystemClock::now();
+  pw::Vector<ButtonGesture, 8> gestures_;
+  GestureRecognizer recognizer_;
+};
+
+// Unit tests.
+
+TEST_F(GestureRecognizerTest, ClickAfterMultiClickWindow) {
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Release(kA, At(100ms));
+  EXPECT_EQ(recognizer_.next_deadline(),
+            At(100ms) + GestureRecognizer::kMultiClickWindow);
+
+  recognizer_.Advance(At(100ms) + GestureRecognizer::kMultiClickWindow - 1ms);
+  EXPECT_TRUE(gestures_.empty());
+
+  recognizer_.Advance(At(100ms) + GestureRecognizer::kMultiClickWindow);
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kClick, ButtonGesture::kA, 1);
+  EXPECT_FALSE(recognizer_.next_deadline().has_value());
+}
+
+TEST_F(GestureRecognizerTest, DoubleClick) {
+  recognizer_.Press(kB, At(0ms));
+  recognizer_.Release(kB, At(80ms));
+  recognizer_.Press(kB, At(200ms));
+  recognizer_.Release(kB, At(280ms));
+  recognizer_.Advance(At(280ms) + GestureRecognizer::kMultiClickWindow);
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kClick, ButtonGesture::kB, 2);
+}
+
+TEST_F(GestureRecognizerTest, LatePressStartsNewClick) {
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Release(kA, At(50ms));
+
+  // `Advance` was not called before the next press, but the gap between them
+  // still ends the first click.
+  recognizer_.Press(kA, At(50ms) + GestureRecognizer::kMultiClickWindow);
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kClick, ButtonGesture::kA, 1);
+}
+
+TEST_F(GestureRecognizerTest, LongPressWhileHeld) {
+  recognizer_.Press(kX, At(0ms));
+  EXPECT_EQ(recognizer_.next_deadline(),
+            At(GestureRecognizer::kLongPressTime));
+  recognizer_.Advance(At(GestureRecognizer::kLongPressTime));
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kLongPress, ButtonGesture::kX);
+
+  // Releasing the button is not a click.
+  recognizer_.Release(kX, At(2s));
+  recognizer_.Advance(At(5s));
+  EXPECT_EQ(gestures_.size(), 1u);
+}
+
+TEST_F(GestureRecognizerTest, LongPressRecognizedOnLateRelease) {
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Release(kA, At(GestureRecognizer::kLongPressTime + 1ms));
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kLongPress, ButtonGesture::kA);
+  EXPECT_FALSE(recognizer_.next_deadline().has_value());
+}
+
+TEST_F(GestureRecognizerTest, ClickThenLongPress) {
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Release(kA, At(50ms));
+  recognizer_.Press(kA, At(150ms));
+  recognizer_.Advance(At(150ms) + GestureRecognizer::kLongPressTime);
+  ASSERT_EQ(gestures_.size(), 2u);
+  ExpectGesture(0, ButtonGesture::kClick, ButtonGesture::kA, 1);
+  ExpectGesture(1, ButtonGesture::kLongPress, ButtonGesture::kA);
+}
+
+TEST_F(GestureRecognizerTest, Chord) {
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Press(kB, At(30ms));
+  recognizer_.Advance(At(GestureRecognizer::kChordWindow - 1ms));
+  EXPECT_TRUE(gestures_.empty());
+  recognizer_.Advance(At(GestureRecognizer::kChordWindow));
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kChord, ButtonGesture::kA | ButtonGesture::kB);
+
+  // Holding and releasing chord buttons makes no other gestures.
+  recognizer_.Release(kA, At(2s));
+  recognizer_.Release(kB, At(2s));
+  recognizer_.Advance(At(5s));
+  EXPECT_EQ(gestures_.size(), 1u);
+}
+
+TEST_F(GestureRecognizerTest, ChordAddedOutOfOrder) {
+  recognizer_.Press(kX, At(50ms));
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Advance(At(GestureRecognizer::kChordWindow));
+  ASSERT_EQ(gestures_.size(), 1u);
+  ExpectGesture(0, ButtonGesture::kChord, ButtonGesture::kA | ButtonGesture::kX);
+}
+
+TEST_F(GestureRecognizerTest, PressesOutsideChordWindowAreSeparate) {
+  recognizer_.Press(kA, At(0ms));
+  recognizer_.Release(kA, At(50ms));
+  recognizer_.Press(kB, At(GestureRecognizer::kChordWindow));
+  recognizer_.Release(kB, At(150ms));
+  recognizer_.Advance(At(1s));
+  ASSERT_EQ(gestures_.size(), 2u);
+  ExpectGesture(0, ButtonGesture::kClick, ButtonGesture::kA, 1);
+  ExpectGesture(1, ButtonGesture::kClick, ButtonGesture::kB, 1);
+}
+
+}  // namespace
+}  // namespace sense
@@ -14,12 +14,18 @@
 #include "modules/buttons/manager.h"
 #define PW_LOG_MODULE_NAME "BUTTONS"
 
+#include <mutex>
+#include <optional>
+
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
 #include "pw_status/try.h"
+#include "pw_tokenizer/tokenize.h"
 
 using pw::chrono::SystemClock;
 using pw::digital_io::DigitalIn;
+using pw::digital_io::DigitalInInterrupt;
+using pw::digital_io::InterruptTrigger;
 using pw::digital_io::State;
 
 namespace sense {
@@ -54,6 +60,23 @@ pw::Result<EdgeDetector::StateChange> Button::Sample(
   return edge_detector_.UpdateState(deboucned_state);
 }
 
+EdgeDetector::StateChange Button::AddEdge(SystemClock::time_point time,
+                                          State state) {
+  auto state_change = Settle(time);
+  last_edge_ = state;
+  debouncer_.UpdateState(time, state);
+  settle_deadline_ = time + Debouncer::kDebounceInterval;
+  settling_ = true;
+  return state_change;
+}
+
+EdgeDetector::StateChange Button::Settle(SystemClock::time_point now) {
+  if (now >= settle_deadline_) {
+    settling_ = false;
+  }
+  return edge_detector_.UpdateState(debouncer_.UpdateState(now, last_edge_));
+}
+
 ButtonManager::ButtonManager(pw::digital_io::DigitalIn& button_a,
                 pw::digital_io::DigitalIn& button_b,
                 pw::digital_io::DigitalIn& button_x,
@@ -63,47 +86,256 @@ ButtonManager::ButtonManager(pw::digital_io::DigitalIn& button_a,
                   Button(button_x),
                   Button(button_y),
                 }
-    , timer_(pw::bind_member<&ButtonManager::SampleCallback>(this)), active_(false) {}
+    , clock_(pw::chrono::VirtualSystemClock::RealClock())
+    , timer_(pw::bind_member<&ButtonManager::SampleCallback>(this)), active_(false),
+      gestures_(pw::bind_member<&ButtonManager::PublishGesture>(this)) {}
+
+ButtonManager::ButtonManager(DigitalInInterrupt& button_a,
+                             DigitalInInterrupt& button_b,
+                             DigitalInInterrupt& button_x,
+                             DigitalInInterrupt& button_y,
+                             pw::chrono::VirtualSystemClock& clock)
+    : buttons_{
+          Button(button_a),
+          Button(button_b),
+          Button(button_x),
+          Button(button_y),
+      },
+      clock_(clock),
+      timer_([this](SystemClock::time_point now) {
+        if (const pw::Status status = ScheduleProcessEdges(now);
+            !status.ok()) {
+          // Edges and settle deadlines are lost if they are not processed,
+          // so try again next interval.
+          PW_LOG_ERROR("Unable to schedule button edge processing: %s",
+                       status.str());
+          wheel_->InvokeAfter(timer_, kSampleInterval);
+        }
+      }),
+      active_(false),
+      gestures_(pw::bind_member<&ButtonManager::PublishGesture>(this)) {}
 
 ButtonManager::~ButtonManager() {}
 
-void ButtonManager::Init(PubSub& pub_sub, Worker& worker) {
+void ButtonManager::Init(PubSub& pub_sub,
+                         Worker& worker,
+                         TimerWheel& wheel) {
   pub_sub_ = &pub_sub;
   worker_ = &worker;
+  wheel_ = &wheel;
 
-  // Start the periodic sampling callbacks.
+  if (interrupt_mode()) {
+    for (size_t i = 0; i < kNumButtons; ++i) {
+      PW_CHECK_OK(buttons_[i].interrupt()->SetInterruptHandler(
+          InterruptTrigger::kBothEdges,
+          [this, i](State state) { OnEdge(i, state); }));
+    }
+  }
+
+  // Start the periodic sampling callbacks or the edge interrupts.
   Start();
 }
 
+void ButtonManager::Start() {
+  if (active_) {
+    return;
+  }
+  active_ = true;
+  if (!interrupt_mode()) {
+    wheel_->InvokeAfter(timer_, kSampleInterval);
+    return;
+  }
+
+  // Treat the current state of each button as an edge, so that buttons held
+  // while interrupts were disabled are debounced as if they were polled.
+  for (size_t i = 0; i < kNumButtons; ++i) {
+    DigitalInInterrupt& io = *buttons_[i].interrupt();
+    PW_CHECK_OK(io.EnableInterruptHandler());
+    if (auto state = io.GetState(); state.ok()) {
+      OnEdge(i, *state);
+    }
+  }
+}
+
+void ButtonManager::Stop() {
+  if (interrupt_mode()) {
+    for (auto& button : buttons_) {
+      PW_CHECK_OK(button.interrupt()->DisableInterruptHandler());
+    }
+  }
+  wheel_->Cancel(timer_);
+  active_ = false;
+}
+
 void ButtonManager::SampleCallback(SystemClock::time_point now) {
   PW_CHECK_NOTNULL(worker_);
-  worker_->RunOnce([this, now]() {
-    if (const auto status = SampleButtons(now); !status.ok()) {
-      PW_LOG_ERROR("Failed to sample buttons: %s", status.str());
-    }
-    // Start the periodic sampling callbacks.
-    timer_.InvokeAfter(kSampleInterval);
-  });
+  // Sample before the next sample is due, so that the sampling period stays
+  // steady while other work is queued.
+  const pw::Status status = worker_->RunOnceBefore(
+      now + kSampleInterval,
+      PW_TOKENIZE_STRING("buttons sample"),
+      [this, now]() {
+        if (const auto sample_status = SampleButtons(now);
+            !sample_status.ok()) {
+          PW_LOG_ERROR("Failed to sample buttons: %s", sample_status.str());
+        }
+        // Start the periodic sampling callbacks.
+        wheel_->InvokeAfter(timer_, kSampleInterval);
+      });
+  if (!status.ok()) {
+    // Sampling stops if it is not rescheduled, so try again next interval.
+    PW_LOG_ERROR("Unable to schedule button sampling: %s", status.str());
+    wheel_->InvokeAfter(timer_, kSampleInterval);
+  }
+}
+
+pw::Status ButtonManager::SampleButtons(SystemClock::time_point now) {
+  for (size_t i = 0; i < kNumButtons; ++i) {
+    PW_TRY_ASSIGN(auto state_change, buttons_[i].Sample(now));
+    PublishChange(i, state_change);
+  }
+  AdvanceGestures(now);
+  return pw::OkStatus();
 }
 
 template <typename ButtonEvent>
-pw::Status ButtonManager::SampleButton(Button& button,
-                                       SystemClock::time_point now) {
-  PW_TRY_ASSIGN(auto state_change, button.Sample(now));
+void ButtonManager::PublishChange(EdgeDetector::StateChange state_change) {
+  if constexpr (!kPublishRawEvents) {
+    return;
+  }
   if (state_change == EdgeDetector::StateChange::kActivate) {
     std::ignore = pub_sub_->Publish(ButtonEvent(true));
   } else if (state_change == EdgeDetector::StateChange::kDeactivate) {
     std::ignore = pub_sub_->Publish(ButtonEvent(false));
   }
-  return pw::OkStatus();
 }
 
-pw::Status ButtonManager::SampleButtons(SystemClock::time_point now) {
-  PW_TRY(SampleButton<sense::ButtonA>(buttons_[0], now));
-  PW_TRY(SampleButton<sense::ButtonB>(buttons_[1], now));
-  PW_TRY(SampleButton<sense::ButtonX>(buttons_[2], now));
-  PW_TRY(SampleButton<sense::ButtonY>(buttons_[3], now));
-  return pw::OkStatus();
+void ButtonManager::PublishChange(size_t index,
+                                  EdgeDetector::StateChange state_change) {
+  switch (index) {
+    case 0:
+      PublishChange<sense::ButtonA>(state_change);
+      break;
+    case 1:
+      PublishChange<sense::ButtonB>(state_change);
+      break;
+    case 2:
+      PublishChange<sense::ButtonX>(state_change);
+      break;
+    case 3:
+      PublishChange<sense::ButtonY>(state_change);
+      break;
+  }
+
+  // Gestures are timed from when the debounced state started, not from when
+  // it was detected.
+  auto time = buttons_[index].input_changed_at();
+  if (state_change == EdgeDetector::StateChange::kActivate) {
+    gestures_.Press(index, time);
+  } else if (state_change == EdgeDetector::StateChange::kDeactivate) {
+    gestures_.Release(index, time);
+  }
+}
+
+void ButtonManager::AdvanceGestures(SystemClock::time_point now) {
+  auto until = now;
+  for (const Button& button : buttons_) {
+    if (!button.debounced() && button.input_changed_at() < until) {
+      until = button.input_changed_at();
+    }
+  }
+  gestures_.Advance(until);
+}
+
+void ButtonManager::PublishGesture(const ButtonGesture& gesture) {
+  if (kPublishRawEvents && gesture.kind == ButtonGesture::kClick &&
+      gesture.clicks == 1) {
+    return;
+  }
+  std::ignore = pub_sub_->Publish(gesture);
+}
+
+pw::Status ButtonManager::ScheduleProcessEdges(SystemClock::time_point now) {
+  return worker_->RunOnceBefore(now + kSampleInterval,
+                                PW_TOKENIZE_STRING("buttons process edges"),
+                                [this]() { ProcessEdges(); });
+}
+
+void ButtonManager::OnEdge(size_t index, State state) {
+  auto now = clock_.now();
+  {
+    std::lock_guard lock(edges_lock_);
+    auto& edges = edges_[index];
+    if (edges.full()) {
+      edges.pop_front();
+    }
+    edges.push_back({.time = now, .state = state});
+    if (edges_scheduled_) {
+      return;
+    }
+    edges_scheduled_ = true;
+  }
+
+  // This runs in the interrupt handler, so a failure is not logged here. The
+  // edges stay queued until the next edge schedules them, or the timer fires
+  // for a pending deadline. The timer retries until processing is scheduled.
+  if (!ScheduleProcessEdges(now).ok()) {
+    std::lock_guard lock(edges_lock_);
+    edges_scheduled_ = false;
+  }
+}
+
+void ButtonManager::ProcessEdges() {
+  {
+    std::lock_guard lock(edges_lock_);
+    edges_scheduled_ = false;
+  }
+  for (size_t i = 0; i < kNumButtons; ++i) {
+    while (true) {
+      Edge edge;
+      {
+        std::lock_guard lock(edges_lock_);
+        if (edges_[i].empty()) {
+          break;
+        }
+        edge = edges_[i].front();
+        edges_[i].pop_front();
+      }
+      PublishChange(i, buttons_[i].AddEdge(edge.time, edge.state));
+    }
+  }
+
+  // Settle any buttons whose last edge has been stable for long enough, and
+  // wait for the rest. Once every button has settled and no gesture is in
+  // progress, nothing runs until the next edge.
+  auto now = clock_.now();
+  std::optional<SystemClock::time_point> next_deadline;
+  for (size_t i = 0; i < kNumButtons; ++i) {
+    Button& button = buttons_[i];
+    if (!button.settling()) {
+      continue;
+    }
+    if (now >= button.settle_deadline()) {
+      PublishChange(i, button.Settle(now));
+    } else if (!next_deadline.has_value() ||
+               button.settle_deadline() < *next_deadline) {
+      next_deadline = button.settle_deadline();
+    }
+  }
+
+  // A gesture deadline that has already passed is waiting on a button that is
+  // still settling, which wakes the timer sooner.
+  AdvanceGestures(now);
+  if (auto deadline = gestures_.next_deadline();
+      deadline.has_value() && *deadline > now &&
+      (!next_deadline.has_value() || *deadline < *next_deadline)) {
+    next_deadline = deadline;
+  }
+  if (next_deadline.has_value()) {
+    wheel_->InvokeAt(timer_, *next_deadline);
+  } else {
+    wheel_->Cancel(timer_);
+  }
 }
 
 }  // namespace sense
@@ -13,19 +13,29 @@
 // the License.
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 
+#include "modules/buttons/gesture.h"
 #include "modules/pubsub/pubsub_events.h"
+#include "modules/timer_wheel/timer_wheel.h"
 #include "modules/worker/worker.h"
 #include "pw_assert/check.h"
 #include "pw_chrono/system_clock.h"
-#include "pw_chrono/system_timer.h"
+#include "pw_containers/inline_deque.h"
 #include "pw_digital_io/digital_io.h"
 #include "pw_function/function.h"
 #include "pw_status/status.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/lock_annotations.h"
 
+/// Set to 0 to publish only button gestures, and not every press and release.
+#ifndef SENSE_BUTTONS_PUBLISH_RAW_EVENTS
+#define SENSE_BUTTONS_PUBLISH_RAW_EVENTS 1
+#endif  // SENSE_BUTTONS_PUBLISH_RAW_EVENTS
+
 namespace sense {
 class Debouncer final {
  public:
@@ -37,6 +47,14 @@ class Debouncer final {
   pw::digital_io::State UpdateState(pw::chrono::SystemClock::time_point now,
                                     pw::digital_io::State state);
 
+  /// Returns when the input last changed.
+  pw::chrono::SystemClock::time_point last_update() const {
+    return last_update_;
+  }
+
+  /// Returns whether the output has caught up with the input.
+  bool settled() const { return last_input_ == output_; }
+
  private:
   pw::chrono::SystemClock::time_point last_update_ =
       pw::chrono::SystemClock::time_point::min();
@@ -67,54 +85,160 @@ class Button {
     PW_CHECK_OK(io_.Enable());
   };
 
+  Button(pw::digital_io::DigitalInInterrupt& io)
+      : io_(io.as<pw::digital_io::DigitalIn>()), interrupt_(&io) {
+    PW_CHECK_OK(io_.Enable());
+  };
+
   pw::Result<EdgeDetector::StateChange> Sample(
       pw::chrono::SystemClock::time_point now);
 
+  /// Returns when the input last changed. Right after a state change is
+  /// returned, this is when the new state started.
+  pw::chrono::SystemClock::time_point input_changed_at() const {
+    return debouncer_.last_update();
+  }
+
+  /// Returns whether the last input change has been debounced.
+  bool debounced() const { return debouncer_.settled(); }
+
+  /// Returns the input's interrupt interface, or null if it must be polled.
+  pw::digital_io::DigitalInInterrupt* interrupt() { return interrupt_; }
+
+  /// Debounces an edge captured at the given time.
+  ///
+  /// The state before the edge is sampled first, as a polling loop would have
+  /// seen it just before the edge, so a state that was held for long enough is
+  /// never lost to a late call to `Settle`.
+  EdgeDetector::StateChange AddEdge(pw::chrono::SystemClock::time_point time,
+                                    pw::digital_io::State state);
+
+  /// Samples the state of the last edge.
+  EdgeDetector::StateChange Settle(pw::chrono::SystemClock::time_point now);
+
+  /// Returns whether the last edge may not have been debounced yet.
+  bool settling() const { return settling_; }
+
+  /// Returns when the last edge will have been stable for the debounce
+  /// interval.
+  pw::chrono::SystemClock::time_point settle_deadline() const {
+    return settle_deadline_;
+  }
+
  private:
   pw::digital_io::DigitalIn& io_;
+  pw::digital_io::DigitalInInterrupt* interrupt_ = nullptr;
   Debouncer debouncer_ = Debouncer(pw::digital_io::State::kInactive);
   EdgeDetector edge_detector_ = EdgeDetector(pw::digital_io::State::kInactive);
+
+  // Used when edges are captured by interrupts.
+  pw::digital_io::State last_edge_ = pw::digital_io::State::kInactive;
+  pw::chrono::SystemClock::time_point settle_deadline_;
+  bool settling_ = false;
 };
 
-/// DOCME
+/// Publishes debounced button presses and releases.
+///
+/// Buttons are either polled every `kSampleInterval`, or, if constructed with
+/// inputs that support interrupts, sampled only when their edge interrupts
+/// fire. In interrupt mode, edges are timestamped in the interrupt handler and
+/// debounced on the worker, and the timer only runs until the last edge has
+/// been stable for `Debouncer::kDebounceInterval`. There are no wakeups at all
+/// while the buttons are idle.
+///
+/// Debounced presses and releases also feed a `GestureRecognizer`, with the
+/// times at which they happened, and recognized gestures are published as
+/// `ButtonGesture` events. Building with `SENSE_BUTTONS_PUBLISH_RAW_EVENTS=0`
+/// publishes only the gestures. Single clicks are only published in that case,
+/// since otherwise they repeat the raw press and release.
 class ButtonManager final {
  public:
+  static constexpr bool kPublishRawEvents = SENSE_BUTTONS_PUBLISH_RAW_EVENTS;
+
   constexpr static pw::chrono::SystemClock::duration kSampleInterval =
       std::chrono::milliseconds(10);
 
+  /// Maximum number of edges per button that are kept until the worker runs.
+  /// Older edges are dropped first.
+  static constexpr size_t kMaxPendingEdges = 8;
+
   ButtonManager(pw::digital_io::DigitalIn& button_a,
                 pw::digital_io::DigitalIn& button_b,
                 pw::digital_io::DigitalIn& button_x,
                 pw::digital_io::DigitalIn& button_y);
+
+  /// Edges and their settle deadlines are timed by `clock`, which tests may
+  /// replace to inject edges at explicit times. The timer still runs on the
+  /// system clock, so `clock` must not lag behind it while edges settle.
+  ButtonManager(pw::digital_io::DigitalInInterrupt& button_a,
+                pw::digital_io::DigitalInInterrupt& button_b,
+                pw::digital_io::DigitalInInterrupt& button_x,
+                pw::digital_io::DigitalInInterrupt& button_y,
+                pw::chrono::VirtualSystemClock& clock =
+                    pw::chrono::VirtualSystemClock::RealClock());
   ~ButtonManager();
 
-  void Init(PubSub& pub_sub, Worker& worker);
+  /// Samples the buttons on `worker`, timed by a timer on `wheel`, and
+  /// publishes their events to `pub_sub`.
+  void Init(PubSub& pub_sub, Worker& worker, TimerWheel& wheel);
 
-  void Start() {
-    if (!active_) {
-      timer_.InvokeAfter(kSampleInterval);
-    }
-    active_ = true;
-  }
+  void Start();
 
-  void Stop() {
-    timer_.Cancel();
-    active_ = false;
-  }
+  void Stop();
 
  private:
-  Button buttons_[4];
+  static constexpr size_t kNumButtons = 4;
+
+  struct Edge {
+    pw::chrono::SystemClock::time_point time;
+    pw::digital_io::State state;
+  };
+
+  Button buttons_[kNumButtons];
+
+  bool interrupt_mode() { return buttons_[0].interrupt() != nullptr; }
 
   pw::Status ScheduleSampleCallback();
   void SampleCallback(pw::chrono::SystemClock::time_point);
 
-  template <typename ButtonEvent>
-  pw::Status SampleButton(Button& button, pw::chrono::SystemClock::time_point);
   pw::Status SampleButtons(pw::chrono::SystemClock::time_point);
 
+  /// Publishes the event for a change in the state of a button, and passes it
+  /// on to the gesture recognizer.
+  template <typename ButtonEvent>
+  void PublishChange(EdgeDetector::StateChange state_change);
+  void PublishChange(size_t index, EdgeDetector::StateChange state_change);
+
+  /// Recognizes gestures up to `now`, or up to the earliest input change that
+  /// has not been debounced yet, since it may still become a press or release.
+  void AdvanceGestures(pw::chrono::SystemClock::time_point now);
+
+  void PublishGesture(const ButtonGesture& gesture);
+
+  /// Schedules `ProcessEdges` on the worker, to run before the next sample
+  /// would have been due.
+  pw::Status ScheduleProcessEdges(pw::chrono::SystemClock::time_point now);
+
+  /// Records an edge, and schedules it to be processed unless that is already
+  /// scheduled. Called from the edge interrupt handlers.
+  void OnEdge(size_t index, pw::digital_io::State state)
+      PW_LOCKS_EXCLUDED(edges_lock_);
+
+  /// Debounces recorded edges on the worker, and schedules the next settle
+  /// deadline, if any.
+  void ProcessEdges() PW_LOCKS_EXCLUDED(edges_lock_);
+
+  pw::chrono::VirtualSystemClock& clock_;
   PubSub* pub_sub_ = nullptr;
   Worker* worker_ = nullptr;
-  pw::chrono::SystemTimer timer_;
+  TimerWheel* wheel_ = nullptr;
+  WheelTimer timer_;
   bool active_;
+  GestureRecognizer gestures_;
+
+  pw::sync::InterruptSpinLock edges_lock_;
+  std::array<pw::InlineDeque<Edge, kMaxPendingEdges>, kNumButtons> edges_
+      PW_GUARDED_BY(edges_lock_);
+  bool edges_scheduled_ PW_GUARDED_BY(edges_lock_) = false;
 };
 }  // namespace sense
@@ -14,11 +14,17 @@
 
 #include "modules/buttons/manager.h"
 
+#include <atomic>
+#include <cstdint>
+
+#include "modules/buttons/virtual_input.h"
 #include "modules/worker/test_worker.h"
+#include "pw_chrono/simulated_system_clock.h"
 #include "pw_digital_io/digital_io.h"
 #include "pw_status/status.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/timed_thread_notification.h"
+#include "pw_thread/sleep.h"
 #include "pw_unit_test/framework.h"
 
 using ::pw::chrono::SystemClock;
@@ -68,6 +74,37 @@ class TestDigitalInOut : public DigitalInOut {
   int settle_iterations_ PW_GUARDED_BY(lock_) = 0;
 };
 
+/// Forwards work to another worker, but rejects deadline work on request.
+class RejectingWorker final : public Worker {
+ public:
+  explicit RejectingWorker(Worker& worker) : worker_(worker) {}
+
+  void RunOnce(pw::Function<void()>&& work) override {
+    worker_.RunOnce(std::move(work));
+  }
+
+  pw::Status TryRunOnce(pw::Function<void()>&& work) override {
+    return worker_.TryRunOnce(std::move(work));
+  }
+
+  pw::Status RunOnceBefore(SystemClock::time_point deadline,
+                           uint32_t label,
+                           pw::Function<void()>&& work) override {
+    if (rejects_.load() > 0) {
+      --rejects_;
+      return pw::Status::ResourceExhausted();
+    }
+    return worker_.RunOnceBefore(deadline, label, std::move(work));
+  }
+
+  /// Rejects the next `count` pieces of deadline work.
+  void Reject(int count) { rejects_ = count; }
+
+ private:
+  Worker& worker_;
+  std::atomic<int> rejects_ = 0;
+};
+
 // A test harness for writing tests that use pubsub.
 class ManagerTest : public ::testing::Test {
  public:
@@ -84,6 +121,39 @@ class ManagerTest : public ::testing::Test {
     ASSERT_EQ(pw::OkStatus(), io_y_.SetState(State::kInactive));
   }
 
+  /// Subscribes to button presses and releases, ignoring gestures.
+  void SubscribeToButtonEvents(PubSub& pubsub) {
+    ASSERT_TRUE(pubsub.Subscribe([this](Event event) {
+      if (std::holds_alternative<ButtonGesture>(event)) {
+        return;
+      }
+      last_event_ = event;
+      events_processed_ += 1;
+      notification_.release();
+    }));
+  }
+
+  /// Subscribes to gestures, ignoring button presses and releases.
+  void SubscribeToGestures(PubSub& pubsub) {
+    ASSERT_TRUE(pubsub.Subscribe([this](Event event) {
+      if (std::holds_alternative<ButtonGesture>(event)) {
+        last_gesture_ = std::get<ButtonGesture>(event);
+        notification_.release();
+      }
+    }));
+  }
+
+  /// Expects that the next gesture is of the given kind and buttons.
+  void ExpectGesture(ButtonGesture::Kind kind,
+                     uint8_t buttons,
+                     uint8_t clicks = 0) {
+    ASSERT_TRUE(notification_.try_acquire_for(kMaxWaitOnFailedTest));
+    ASSERT_TRUE(last_gesture_.has_value());
+    EXPECT_EQ(last_gesture_->kind, kind);
+    EXPECT_EQ(last_gesture_->buttons, buttons);
+    EXPECT_EQ(last_gesture_->clicks, clicks);
+  }
+
   /// Expects that a button was pressed.
   /// If `false`, the test must abort.
   template <typename Event>
@@ -110,9 +180,11 @@ class ManagerTest : public ::testing::Test {
     return true;
   }
 
-  pw::InlineDeque<Event, 4> event_queue_;
+  sense::PackedEventQueueBuffer<Event, PubSub::EventQueue::CapacityFor(4)>
+      event_queue_;
   std::array<typename PubSub::Subscriber, 4> subscribers_buffer_;
   std::optional<Event> last_event_;
+  std::optional<ButtonGesture> last_gesture_;
   int events_processed_ = 0;
   pw::sync::TimedThreadNotification notification_;
 
@@ -120,6 +192,13 @@ class ManagerTest : public ::testing::Test {
   TestDigitalInOut io_b_;
   TestDigitalInOut io_x_;
   TestDigitalInOut io_y_;
+
+  VirtualInput irq_a_{State::kInactive};
+  VirtualInput irq_b_{State::kInactive};
+  VirtualInput irq_x_{State::kInactive};
+  VirtualInput irq_y_{State::kInactive};
+
+  TimerWheel wheel_;
 };
 
 TEST(DebounceTest, SingleEdgePropagatesAfterDelay) {
@@ -260,13 +339,9 @@ TEST_F(ManagerTest, AllButtonsTurnOnAndOffEvents) {
   sense::TestWorker<> worker;
   PubSub pubsub(worker, event_queue_, subscribers_buffer_);
   ButtonManager manager(io_a_, io_b_, io_x_, io_y_);
-  manager.Init(pubsub, worker);
+  manager.Init(pubsub, worker, wheel_);
 
-  ASSERT_TRUE(pubsub.Subscribe([this](Event event) {
-    last_event_ = event;
-    events_processed_ += 1;
-    notification_.release();
-  }));
+  SubscribeToButtonEvents(pubsub);
 
   ASSERT_EQ(pw::OkStatus(), io_a_.SetState(State::kActive));
   ASSERT_TRUE(AssertPressed<sense::ButtonA>());
@@ -298,14 +373,10 @@ TEST_F(ManagerTest, AllButtonsTurnOnAndOffEvents) {
 TEST_F(ManagerTest, DebouncingWorksOnNoisyIo) {
   sense::TestWorker<> worker;
   PubSub pubsub(worker, event_queue_, subscribers_buffer_);
-  ASSERT_TRUE(pubsub.Subscribe([this](Event event) {
-    last_event_ = event;
-    events_processed_ += 1;
-    notification_.release();
-  }));
+  SubscribeToButtonEvents(pubsub);
 
   ButtonManager manager(io_a_, io_b_, io_x_, io_y_);
-  manager.Init(pubsub, worker);
+  manager.Init(pubsub, worker, wheel_);
 
   // Set line active with 10 noisy transition and assert that we only
   // receive one event.
@@ -321,4 +392,152 @@ TEST_F(ManagerTest, DebouncingWorksOnNoisyIo) {
 
   worker.Stop();
 }
+
+TEST_F(ManagerTest, InterruptModeAllButtonsTurnOnAndOffEvents) {
+  sense::TestWorker<> worker;
+  PubSub pubsub(worker, event_queue_, subscribers_buffer_);
+  ButtonManager manager(irq_a_, irq_b_, irq_x_, irq_y_);
+  manager.Init(pubsub, worker, wheel_);
+
+  SubscribeToButtonEvents(pubsub);
+
+  irq_a_.InjectEdge(State::kActive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonA>());
+
+  irq_b_.InjectEdge(State::kActive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonB>());
+
+  irq_x_.InjectEdge(State::kActive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonX>());
+
+  irq_y_.InjectEdge(State::kActive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonY>());
+
+  irq_a_.InjectEdge(State::kInactive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonA>(false));
+
+  irq_b_.InjectEdge(State::kInactive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonB>(false));
+
+  irq_x_.InjectEdge(State::kInactive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonX>(false));
+
+  irq_y_.InjectEdge(State::kInactive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonY>(false));
+
+  manager.Stop();
+  worker.Stop();
+}
+
+TEST_F(ManagerTest, InterruptModeDebouncesBouncingEdges) {
+  sense::TestWorker<> worker;
+  PubSub pubsub(worker, event_queue_, subscribers_buffer_);
+  SubscribeToButtonEvents(pubsub);
+
+  ButtonManager manager(irq_a_, irq_b_, irq_x_, irq_y_);
+  manager.Init(pubsub, worker, wheel_);
+
+  // Bounce more times than edges are kept for, and assert that only one event
+  // is received once the line settles.
+  for (size_t i = 0; i < ButtonManager::kMaxPendingEdges * 2; ++i) {
+    irq_a_.InjectEdge(i % 2 == 0 ? State::kActive : State::kInactive);
+  }
+  irq_a_.InjectEdge(State::kActive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonA>());
+  EXPECT_EQ(events_processed_, 1);
+
+  // Edges that do not last for the debounce interval are ignored.
+  irq_a_.InjectEdge(State::kInactive);
+  irq_a_.InjectEdge(State::kActive);
+  EXPECT_FALSE(notification_.try_acquire_for(Debouncer::kDebounceInterval * 3));
+  EXPECT_EQ(events_processed_, 1);
+
+  manager.Stop();
+  worker.Stop();
+}
+
+TEST_F(ManagerTest, InterruptModeSchedulesEdgesAfterRejectedWork) {
+  sense::TestWorker<> worker;
+  RejectingWorker rejecting_worker(worker);
+  PubSub pubsub(worker, event_queue_, subscribers_buffer_);
+  SubscribeToButtonEvents(pubsub);
+
+  ButtonManager manager(irq_a_, irq_b_, irq_x_, irq_y_);
+  manager.Init(pubsub, rejecting_worker, wheel_);
+
+  // Let the initial states settle, so that the timer is idle.
+  pw::this_thread::sleep_for(Debouncer::kDebounceInterval * 3);
+
+  // The press is kept while its processing cannot be scheduled, and is
+  // processed once the next edge schedules it.
+  rejecting_worker.Reject(1);
+  irq_a_.InjectEdge(State::kActive);
+  EXPECT_FALSE(notification_.try_acquire_for(Debouncer::kDebounceInterval * 3));
+  EXPECT_EQ(events_processed_, 0);
+
+  irq_b_.InjectEdge(State::kActive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonA>());
+  ASSERT_TRUE(AssertPressed<sense::ButtonB>());
+
+  // While a deadline is pending, the timer retries until processing the
+  // release is scheduled.
+  rejecting_worker.Reject(3);
+  irq_a_.InjectEdge(State::kInactive);
+  ASSERT_TRUE(AssertPressed<sense::ButtonA>(false));
+  EXPECT_EQ(events_processed_, 3);
+
+  manager.Stop();
+  worker.Stop();
+}
+
+TEST_F(ManagerTest, InterruptModePublishesGestures) {
+  sense::TestWorker<> worker;
+  PubSub pubsub(worker, event_queue_, subscribers_buffer_);
+  SubscribeToGestures(pubsub);
+
+  // Edges are injected at explicit times. The clock only moves ahead of the
+  // system clock, which runs the timer, so deadlines have passed when it fires.
+  const SystemClock::time_point start = SystemClock::now();
+  pw::chrono::SimulatedSystemClock clock(start);
+  auto inject_at = [&clock, start](VirtualInput& input,
+                                   State state,
+                                   SystemClock::duration offset) {
+    clock.SetTime(start + offset);
+    input.InjectEdge(state);
+  };
+
+  ButtonManager manager(irq_a_, irq_b_, irq_x_, irq_y_, clock);
+  manager.Init(pubsub, worker, wheel_);
+
+  // Double-click A.
+  inject_at(irq_a_, State::kActive, 0ms);
+  inject_at(irq_a_, State::kInactive, 50ms);
+  inject_at(irq_a_, State::kActive, 100ms);
+  inject_at(irq_a_, State::kInactive, 150ms);
+  clock.SetTime(start + 150ms + GestureRecognizer::kMultiClickWindow);
+  ExpectGesture(ButtonGesture::kClick, ButtonGesture::kA, 2);
+
+  // Hold B.
+  inject_at(irq_b_, State::kActive, 500ms);
+  clock.SetTime(start + 500ms + GestureRecognizer::kLongPressTime);
+  ExpectGesture(ButtonGesture::kLongPress, ButtonGesture::kB);
+  inject_at(irq_b_, State::kInactive, 1350ms);
+
+  // Press X and Y together.
+  inject_at(irq_x_, State::kActive, 1400ms);
+  inject_at(irq_y_, State::kActive, 1420ms);
+  clock.SetTime(start + 1400ms + GestureRecognizer::kChordWindow);
+  ExpectGesture(ButtonGesture::kChord, ButtonGesture::kX | ButtonGesture::kY);
+  inject_at(irq_x_, State::kInactive, 1600ms);
+  inject_at(irq_y_, State::kInactive, 1600ms);
+
+  // Releasing the chord makes no more gestures.
+  clock.SetTime(start + 1600ms + GestureRecognizer::kMultiClickWindow * 2);
+  EXPECT_FALSE(
+      notification_.try_acquire_for(GestureRecognizer::kMultiClickWindow * 2));
+
+  manager.Stop();
+  worker.Stop();
+}
+
 }  // namespace sense
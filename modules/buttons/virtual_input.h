@@ -0,0 +1,88 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <mutex>
+#include <utility>
+
+#include "pw_digital_io/digital_io.h"
+#include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// A digital input with no hardware behind it, for hosts and tests.
+///
+/// Its state only changes when an edge is injected, which also runs the
+/// interrupt handler as a GPIO edge interrupt would.
+class VirtualInput : public pw::digital_io::DigitalInInterrupt {
+ public:
+  using State = ::pw::digital_io::State;
+
+  explicit VirtualInput(State state) : state_(state) {}
+
+  /// Sets the input's state, and runs the interrupt handler if it is enabled
+  /// and the state change matches its trigger.
+  void InjectEdge(State state) PW_LOCKS_EXCLUDED(lock_) {
+    std::lock_guard lock(lock_);
+    if (state == state_) {
+      return;
+    }
+    state_ = state;
+    if (!handler_enabled_ || handler_ == nullptr) {
+      return;
+    }
+    bool activating = state == State::kActive;
+    if (trigger_ == pw::digital_io::InterruptTrigger::kBothEdges ||
+        (activating &&
+         trigger_ == pw::digital_io::InterruptTrigger::kActivatingEdge) ||
+        (!activating &&
+         trigger_ == pw::digital_io::InterruptTrigger::kDeactivatingEdge)) {
+      handler_(state);
+    }
+  }
+
+ private:
+  pw::Status DoEnable(bool) override { return pw::OkStatus(); }
+
+  pw::Result<State> DoGetState() override {
+    std::lock_guard lock(lock_);
+    return state_;
+  }
+
+  pw::Status DoSetInterruptHandler(
+      pw::digital_io::InterruptTrigger trigger,
+      pw::digital_io::InterruptHandler&& handler) override {
+    std::lock_guard lock(lock_);
+    trigger_ = trigger;
+    handler_ = std::move(handler);
+    return pw::OkStatus();
+  }
+
+  pw::Status DoEnableInterruptHandler(bool enable) override {
+    std::lock_guard lock(lock_);
+    handler_enabled_ = enable;
+    return pw::OkStatus();
+  }
+
+  pw::sync::InterruptSpinLock lock_;
+  State state_ PW_GUARDED_BY(lock_);
+  pw::digital_io::InterruptTrigger trigger_ PW_GUARDED_BY(lock_) =
+      pw::digital_io::InterruptTrigger::kBothEdges;
+  pw::digital_io::InterruptHandler handler_ PW_GUARDED_BY(lock_);
+  bool handler_enabled_ PW_GUARDED_BY(lock_) = false;
+};
+
+}  // namespace sense
@@ -0,0 +1,589 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "modules/pubsub/pubsub.h"
+#include "pw_assert/assert.h"
+#include "pw_bytes/span.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_ring_buffer/prefixed_entry_ring_buffer.h"
+#include "pw_status/status.h"
+#include "pw_status/status_with_size.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+#include "pw_thread/yield.h"
+#include "pw_varint/varint.h"
+
+namespace sense {
+
+/// Writes the fields of an event with explicit encodings, so that logs do not
+/// depend on the layout of event structs, which differs between the 32-bit
+/// device and 64-bit hosts.
+class EventFieldWriter {
+ public:
+  explicit EventFieldWriter(pw::ByteSpan out) : out_(out) {}
+
+  /// Writes an unsigned integer, enumerator or bool as a varint.
+  void WriteUint(uint64_t value) {
+    size_t written = pw::varint::Encode(value, out_.subspan(size_));
+    ok_ = ok_ && written != 0;
+    size_ += written;
+  }
+
+  /// Writes a float as 4 little-endian bytes.
+  void WriteFloat(float value) {
+    if (out_.size() - size_ < sizeof(value)) {
+      ok_ = false;
+      return;
+    }
+    auto bits = std::bit_cast<uint32_t>(value);
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+      out_[size_++] = static_cast<std::byte>(bits >> (8 * i));
+    }
+  }
+
+  /// Returns the number of bytes written.
+  size_t size() const { return size_; }
+
+  /// Returns false if a field did not fit.
+  bool ok() const { return ok_; }
+
+ private:
+  pw::ByteSpan out_;
+  size_t size_ = 0;
+  bool ok_ = true;
+};
+
+/// Reads fields written by an `EventFieldWriter`. Reads after an error return
+/// zero, so that events can be built from the results before checking `done`.
+class EventFieldReader {
+ public:
+  explicit EventFieldReader(pw::ConstByteSpan in) : in_(in) {}
+
+  /// Reads a varint, which must be no larger than `max`.
+  uint64_t ReadUint(uint64_t max = UINT64_MAX) {
+    uint64_t value = 0;
+    size_t read = ok_ ? pw::varint::Decode(in_.subspan(offset_), &value) : 0;
+    if (read == 0 || value > max) {
+      ok_ = false;
+      return 0;
+    }
+    offset_ += read;
+    return value;
+  }
+
+  bool ReadBool() { return ReadUint(1) != 0; }
+
+  float ReadFloat() {
+    if (!ok_ || in_.size() - offset_ < sizeof(uint32_t)) {
+      ok_ = false;
+      return 0.f;
+    }
+    uint32_t bits = 0;
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+      bits |= static_cast<uint32_t>(in_[offset_++]) << (8 * i);
+    }
+    return std::bit_cast<float>(bits);
+  }
+
+  /// Returns whether every field was valid, and all bytes were read.
+  bool done() const { return ok_ && offset_ == in_.size(); }
+
+ private:
+  pw::ConstByteSpan in_;
+  size_t offset_ = 0;
+  bool ok_ = true;
+};
+
+/// Returns the size of a varint of at most `max`.
+constexpr size_t MaxVarintSize(uint64_t max) {
+  size_t size = 1;
+  while (max >= 0x80) {
+    max >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+/// Encodes the fields of an event type in a log. Each logged type specializes
+/// this with:
+///
+///   static constexpr size_t kMaxSize;  // Largest encoding, in bytes.
+///   static void Encode(EventFieldWriter& writer, const T& event);
+///   static T Decode(EventFieldReader& reader);
+///
+/// See modules/event_log/sense_events.h for the Sense events.
+template <typename T>
+struct EventFields {
+  static_assert(sizeof(T) == 0, "Events to be logged must have EventFields");
+};
+
+namespace internal {
+
+/// Layout of an exported event log:
+///
+///   magic        4 bytes, "SEVL"
+///   version      1 byte
+///   event types  1 byte, the number of alternatives in the `Event` variant
+///   period       2 varints, the numerator and denominator of a clock tick
+///   records      0 or more of:
+///                  varint  clock ticks since recording started
+///                  varint  size of the payload
+///                  payload variant index (1 byte) + encoded event fields
+inline constexpr std::array<std::byte, 4> kEventLogMagic = {
+    std::byte{'S'}, std::byte{'E'}, std::byte{'V'}, std::byte{'L'}};
+inline constexpr std::byte kEventLogVersion{2};
+
+template <typename T>
+struct EventLogTraits {
+  static_assert(sizeof(T) == 0, "Events to be logged must be a std::variant");
+};
+
+template <typename... Types>
+struct EventLogTraits<std::variant<Types...>> {
+  using Event = std::variant<Types...>;
+
+  static constexpr size_t kNumTypes = sizeof...(Types);
+  static_assert(kNumTypes <= UINT8_MAX, "Too many event types to log");
+
+  /// Largest encoded event: the variant index plus the largest fields.
+  static constexpr size_t kMaxPayloadSize =
+      1 + std::max({EventFields<Types>::kMaxSize...});
+
+  /// Writes the variant index and fields of an event into `payload`, and
+  /// returns the number of bytes written.
+  static size_t Encode(const Event& event,
+                       std::array<std::byte, kMaxPayloadSize>& payload) {
+    payload[0] = static_cast<std::byte>(event.index());
+    EventFieldWriter writer(pw::ByteSpan(payload).subspan(1));
+    std::visit(
+        [&writer](const auto& value) {
+          EventFields<std::decay_t<decltype(value)>>::Encode(writer, value);
+        },
+        event);
+    PW_ASSERT(writer.ok());
+    return 1 + writer.size();
+  }
+
+  /// Recreates an event from a payload written by `Encode`.
+  static std::optional<Event> Decode(pw::ConstByteSpan payload) {
+    if (payload.empty()) {
+      return std::nullopt;
+    }
+    auto index = static_cast<size_t>(payload[0]);
+    if (index >= kNumTypes) {
+      return std::nullopt;
+    }
+    return kDecoders[index](payload.subspan(1));
+  }
+
+ private:
+  using Decoder = std::optional<Event> (*)(pw::ConstByteSpan);
+
+  template <size_t kIndex>
+  static std::optional<Event> DecodeAs(pw::ConstByteSpan bytes) {
+    using T = std::variant_alternative_t<kIndex, Event>;
+    EventFieldReader reader(bytes);
+    T value = EventFields<T>::Decode(reader);
+    if (!reader.done()) {
+      return std::nullopt;
+    }
+    return Event(std::in_place_index<kIndex>, value);
+  }
+
+  template <size_t... kIndices>
+  static constexpr std::array<Decoder, kNumTypes> MakeDecoders(
+      std::index_sequence<kIndices...>) {
+    return {&DecodeAs<kIndices>...};
+  }
+
+  static constexpr std::array<Decoder, kNumTypes> kDecoders =
+      MakeDecoders(std::make_index_sequence<kNumTypes>());
+};
+
+}  // namespace internal
+
+/// Records every event published on a `GenericPubSub` into a compact binary
+/// ring log.
+///
+/// Each record holds the time it was delivered, as 64-bit clock ticks since
+/// recording started, the index of its variant alternative, and the fields of
+/// the event, encoded by its `EventFields`. Records are written into a
+/// caller-provided buffer without formatting or logging; when the buffer is
+/// full, the oldest records are overwritten.
+///
+/// Events are recorded in the order subscribers see them, which is the order
+/// needed to reproduce the behavior of other subscribers with a
+/// `GenericEventReplayer`.
+template <typename EventType>
+class GenericEventRecorder {
+ public:
+  using Event = EventType;
+  using Clock = ::pw::chrono::SystemClock;
+  using Traits = internal::EventLogTraits<Event>;
+
+  explicit GenericEventRecorder(pw::ByteSpan buffer)
+      : ring_(/*user_preamble=*/false) {
+    PW_ASSERT(ring_.SetBuffer(buffer).ok());
+  }
+
+  ~GenericEventRecorder() { Stop(); }
+
+  GenericEventRecorder(const GenericEventRecorder&) = delete;
+  GenericEventRecorder& operator=(const GenericEventRecorder&) = delete;
+
+  /// Clears the log and begins recording every event published on `pubsub`.
+  ///
+  /// @returns  FAILED_PRECONDITION if already recording, or RESOURCE_EXHAUSTED
+  ///           if the pubsub has no room for another subscriber.
+  pw::Status Start(GenericPubSub<Event>& pubsub) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Stops recording. Recorded events are kept until the next `Start`.
+  void Stop() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Appends an event to the log.
+  void Record(const Event& event) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of records currently held.
+  size_t size() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of records overwritten since recording started.
+  size_t dropped() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of bytes `Export` would currently write.
+  size_t ExportSize() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Writes the log, oldest record first, in a format that can be read back
+  /// by `GenericEventReplayer`.
+  ///
+  /// @returns  The number of bytes written, or RESOURCE_EXHAUSTED if `out` is
+  ///           too small.
+  pw::StatusWithSize Export(pw::ByteSpan out) PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  using SubscribeToken = typename GenericPubSub<Event>::SubscribeToken;
+
+  /// Largest ring entry: the varint timestamp followed by the payload.
+  static constexpr size_t kMaxEntrySize =
+      pw::varint::kMaxVarint64SizeBytes + Traits::kMaxPayloadSize;
+
+  /// Splits a ring entry into its timestamp and payload.
+  static std::pair<uint64_t, pw::ConstByteSpan> SplitEntry(
+      pw::ConstByteSpan entry);
+
+  /// Returns the number of bytes `Export` writes for a ring entry.
+  static size_t ExportedEntrySize(pw::ConstByteSpan entry);
+
+  /// Returns the size of the export header.
+  static size_t HeaderSize();
+
+  /// Writes the export header into `out`, which must be at least
+  /// `HeaderSize()` bytes long.
+  static size_t WriteHeader(pw::ByteSpan out);
+
+  GenericPubSub<Event>* pubsub_ = nullptr;
+  std::optional<SubscribeToken> token_;
+
+  mutable pw::sync::Mutex lock_;
+  pw::ring_buffer::PrefixedEntryRingBuffer ring_ PW_GUARDED_BY(lock_);
+  Clock::time_point start_ PW_GUARDED_BY(lock_);
+  size_t dropped_ PW_GUARDED_BY(lock_) = 0;
+};
+
+/// Reads back a log written by `GenericEventRecorder::Export`.
+///
+/// The replayer can be used to step through records, or to publish them all
+/// into a fresh `GenericPubSub` as fast as it will accept them. Subscribers of
+/// that pubsub then see the same sequence of events as on the device that
+/// recorded them.
+template <typename EventType>
+class GenericEventReplayer {
+ public:
+  using Event = EventType;
+  using Clock = ::pw::chrono::SystemClock;
+  using Traits = internal::EventLogTraits<Event>;
+
+  /// Predicate used to select which events to replay.
+  using Filter = bool (*)(const Event&);
+
+  struct Record {
+    /// Time since recording started, in clock ticks of the recording device.
+    uint64_t ticks;
+    Event event;
+  };
+
+  explicit GenericEventReplayer(pw::ConstByteSpan log) : log_(log) {}
+
+  /// Checks the log header, and positions the replayer at the first record.
+  ///
+  /// @returns  DATA_LOSS if the header is malformed, or FAILED_PRECONDITION if
+  ///           the log was recorded with a different set of events.
+  pw::Status Open();
+
+  /// Numerator and denominator of a clock tick on the recording device, in
+  /// seconds. Valid after a successful `Open`.
+  uint32_t period_numerator() const { return period_numerator_; }
+  uint32_t period_denominator() const { return period_denominator_; }
+
+  /// Decodes the next record.
+  ///
+  /// @returns  The record, `std::nullopt` at the end of the log or if the
+  ///           remaining bytes are malformed. Use `status` to tell these apart.
+  std::optional<Record> Next();
+
+  /// Returns DATA_LOSS if a malformed record was found, or OK otherwise.
+  pw::Status status() const { return status_; }
+
+  /// Publishes every remaining record accepted by `filter` to `pubsub`, in
+  /// order. If the pubsub's queue is full, this yields until there is room.
+  ///
+  /// This must not be called from the worker that delivers `pubsub` events.
+  ///
+  /// @returns  The number of events published, and DATA_LOSS if a malformed
+  ///           record ended the replay early.
+  pw::StatusWithSize Replay(GenericPubSub<Event>& pubsub,
+                            Filter filter = nullptr);
+
+ private:
+  /// Decodes a varint from the unread part of the log.
+  std::optional<uint64_t> ReadVarint();
+
+  pw::ConstByteSpan log_;
+  size_t offset_ = 0;
+  uint32_t period_numerator_ = 0;
+  uint32_t period_denominator_ = 0;
+  pw::Status status_;
+};
+
+// Template method implementations.
+
+template <typename EventType>
+pw::Status GenericEventRecorder<EventType>::Start(
+    GenericPubSub<Event>& pubsub) {
+  if (token_.has_value()) {
+    return pw::Status::FailedPrecondition();
+  }
+  {
+    std::lock_guard lock(lock_);
+    ring_.Clear();
+    start_ = Clock::now();
+    dropped_ = 0;
+  }
+  token_ = pubsub.Subscribe([this](Event event) { Record(event); });
+  if (!token_.has_value()) {
+    return pw::Status::ResourceExhausted();
+  }
+  pubsub_ = &pubsub;
+  return pw::OkStatus();
+}
+
+template <typename EventType>
+void GenericEventRecorder<EventType>::Stop() {
+  if (token_.has_value()) {
+    pubsub_->Unsubscribe(*token_);
+    token_.reset();
+    pubsub_ = nullptr;
+  }
+}
+
+template <typename EventType>
+void GenericEventRecorder<EventType>::Record(const Event& event) {
+  std::array<std::byte, Traits::kMaxPayloadSize> payload;
+  size_t payload_size = Traits::Encode(event, payload);
+
+  std::lock_guard lock(lock_);
+  std::array<std::byte, kMaxEntrySize> entry;
+  auto ticks = static_cast<uint64_t>((Clock::now() - start_).count());
+  size_t size = pw::varint::Encode(ticks, entry);
+  std::memcpy(&entry[size], payload.data(), payload_size);
+  size += payload_size;
+
+  size_t before = ring_.EntryCount();
+  if (!ring_.PushBack(pw::span(entry.data(), size)).ok()) {
+    ++dropped_;
+    return;
+  }
+  dropped_ += before + 1 - ring_.EntryCount();
+}
+
+template <typename EventType>
+size_t GenericEventRecorder<EventType>::size() const {
+  std::lock_guard lock(lock_);
+  return ring_.EntryCount();
+}
+
+template <typename EventType>
+size_t GenericEventRecorder<EventType>::dropped() const {
+  std::lock_guard lock(lock_);
+  return dropped_;
+}
+
+template <typename EventType>
+size_t GenericEventRecorder<EventType>::HeaderSize() {
+  return internal::kEventLogMagic.size() + 2 +
+         pw::varint::EncodedSize(Clock::period::num) +
+         pw::varint::EncodedSize(Clock::period::den);
+}
+
+template <typename EventType>
+size_t GenericEventRecorder<EventType>::WriteHeader(pw::ByteSpan out) {
+  size_t offset = 0;
+  for (std::byte b : internal::kEventLogMagic) {
+    out[offset++] = b;
+  }
+  out[offset++] = internal::kEventLogVersion;
+  out[offset++] = static_cast<std::byte>(Traits::kNumTypes);
+  offset += pw::varint::Encode(Clock::period::num, out.subspan(offset));
+  offset += pw::varint::Encode(Clock::period::den, out.subspan(offset));
+  return offset;
+}
+
+template <typename EventType>
+std::pair<uint64_t, pw::ConstByteSpan>
+GenericEventRecorder<EventType>::SplitEntry(pw::ConstByteSpan entry) {
+  uint64_t ticks = 0;
+  size_t read = pw::varint::Decode(entry, &ticks);
+  PW_ASSERT(read != 0);
+  return {ticks, entry.subspan(read)};
+}
+
+template <typename EventType>
+size_t GenericEventRecorder<EventType>::ExportedEntrySize(
+    pw::ConstByteSpan entry) {
+  auto [ticks, payload] = SplitEntry(entry);
+  return pw::varint::EncodedSize(ticks) +
+         pw::varint::EncodedSize(payload.size()) + payload.size();
+}
+
+template <typename EventType>
+size_t GenericEventRecorder<EventType>::ExportSize() {
+  std::lock_guard lock(lock_);
+  size_t size = HeaderSize();
+  for (const auto& entry : ring_) {
+    size += ExportedEntrySize(entry.buffer);
+  }
+  return size;
+}
+
+template <typename EventType>
+pw::StatusWithSize GenericEventRecorder<EventType>::Export(
+    pw::ByteSpan out) {
+  std::lock_guard lock(lock_);
+  if (out.size() < HeaderSize()) {
+    return pw::StatusWithSize::ResourceExhausted();
+  }
+  size_t offset = WriteHeader(out);
+  for (const auto& entry : ring_) {
+    if (out.size() - offset < ExportedEntrySize(entry.buffer)) {
+      return pw::StatusWithSize::ResourceExhausted(offset);
+    }
+    auto [ticks, payload] = SplitEntry(entry.buffer);
+    offset += pw::varint::Encode(ticks, out.subspan(offset));
+    offset += pw::varint::Encode(payload.size(), out.subspan(offset));
+    std::memcpy(&out[offset], payload.data(), payload.size());
+    offset += payload.size();
+  }
+  return pw::StatusWithSize(offset);
+}
+
+template <typename EventType>
+std::optional<uint64_t> GenericEventReplayer<EventType>::ReadVarint() {
+  uint64_t value;
+  size_t read = pw::varint::Decode(log_.subspan(offset_), &value);
+  if (read == 0) {
+    return std::nullopt;
+  }
+  offset_ += read;
+  return value;
+}
+
+template <typename EventType>
+pw::Status GenericEventReplayer<EventType>::Open() {
+  offset_ = 0;
+  constexpr size_t kFixedSize = internal::kEventLogMagic.size() + 2;
+  if (log_.size() < kFixedSize) {
+    return status_ = pw::Status::DataLoss();
+  }
+  for (std::byte b : internal::kEventLogMagic) {
+    if (log_[offset_++] != b) {
+      return status_ = pw::Status::DataLoss();
+    }
+  }
+  if (log_[offset_++] != internal::kEventLogVersion) {
+    return status_ = pw::Status::DataLoss();
+  }
+  if (static_cast<size_t>(log_[offset_++]) != Traits::kNumTypes) {
+    return status_ = pw::Status::FailedPrecondition();
+  }
+  std::optional<uint64_t> num = ReadVarint();
+  std::optional<uint64_t> den = ReadVarint();
+  if (!num.has_value() || !den.has_value() || *den == 0) {
+    return status_ = pw::Status::DataLoss();
+  }
+  period_numerator_ = static_cast<uint32_t>(*num);
+  period_denominator_ = static_cast<uint32_t>(*den);
+  return status_ = pw::OkStatus();
+}
+
+template <typename EventType>
+std::optional<typename GenericEventReplayer<EventType>::Record>
+GenericEventReplayer<EventType>::Next() {
+  if (!status_.ok() || offset_ == log_.size()) {
+    return std::nullopt;
+  }
+  std::optional<uint64_t> ticks = ReadVarint();
+  std::optional<uint64_t> size = ReadVarint();
+  if (!ticks.has_value() || !size.has_value() ||
+      *size > log_.size() - offset_) {
+    status_ = pw::Status::DataLoss();
+    return std::nullopt;
+  }
+  std::optional<Event> event = Traits::Decode(log_.subspan(offset_, *size));
+  if (!event.has_value()) {
+    status_ = pw::Status::DataLoss();
+    return std::nullopt;
+  }
+  offset_ += *size;
+  return Record{.ticks = *ticks, .event = *event};
+}
+
+template <typename EventType>
+pw::StatusWithSize GenericEventReplayer<EventType>::Replay(
+    GenericPubSub<Event>& pubsub, Filter filter) {
+  size_t published = 0;
+  while (std::optional<Record> record = Next()) {
+    if (filter != nullptr && !filter(record->event)) {
+      continue;
+    }
+    while (!pubsub.Publish(record->event)) {
+      pw::this_thread::yield();
+    }
+    ++published;
+  }
+  return pw::StatusWithSize(status_, published);
+}
+
+}  // namespace sense
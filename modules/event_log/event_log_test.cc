@@ -0,0 +1,313 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/event_log/event_log.h"
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <variant>
+
+#include "modules/event_log/sense_events.h"
+#include "modules/pubsub/pubsub.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/worker/test_worker.h"
+#include "pw_bytes/array.h"
+#include "pw_containers/vector.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_thread/yield.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using EventRecorder = GenericEventRecorder<Event>;
+using EventReplayer = GenericEventReplayer<Event>;
+
+// Test fixtures.
+
+const std::array<Event, 6> kEvents = {
+    ButtonA(true),
+    AirQuality{.score = 812},
+    TimerExpired{.token = 0x1234},
+    ButtonA(false),
+    MorseCodeValue{.turn_on = true, .message_finished = false},
+    StateManagerControl(StateManagerControl::kSilenceAlarms),
+};
+
+/// Returns whether two events are of the same type and have the same values.
+bool SameEvent(const Event& lhs, const Event& rhs) {
+  if (lhs.index() != rhs.index()) {
+    return false;
+  }
+  switch (static_cast<EventType>(lhs.index())) {
+    case kButtonA:
+      return std::get<ButtonA>(lhs).pressed() ==
+             std::get<ButtonA>(rhs).pressed();
+    case kAirQuality:
+      return std::get<AirQuality>(lhs).score == std::get<AirQuality>(rhs).score;
+    case kTimerExpired:
+      return std::get<TimerExpired>(lhs).token ==
+             std::get<TimerExpired>(rhs).token;
+    case kMorseCodeValue:
+      return std::get<MorseCodeValue>(lhs).turn_on ==
+                 std::get<MorseCodeValue>(rhs).turn_on &&
+             std::get<MorseCodeValue>(lhs).message_finished ==
+                 std::get<MorseCodeValue>(rhs).message_finished;
+    case kAmbientLightSample:
+      return std::get<AmbientLightSample>(lhs).sample_lux ==
+             std::get<AmbientLightSample>(rhs).sample_lux;
+    case kStateManagerControl:
+      return std::get<StateManagerControl>(lhs).action ==
+             std::get<StateManagerControl>(rhs).action;
+    default:
+      return false;
+  }
+}
+
+class EventLogTest : public ::testing::Test {
+ protected:
+  EventLogTest() : pubsub_(worker_), replay_(worker_), recorder_(ring_) {}
+
+  void TearDown() override { worker_.Stop(); }
+
+  /// Subscribes to `pubsub` and releases `notification_` after `count` events.
+  void CollectEvents(PubSub& pubsub, size_t count) {
+    expected_ = count;
+    ASSERT_TRUE(pubsub
+                    .Subscribe([this](Event event) {
+                      std::lock_guard lock(lock_);
+                      collected_.push_back(event);
+                      if (collected_.size() == expected_) {
+                        notification_.release();
+                      }
+                    })
+                    .has_value());
+  }
+
+  std::array<std::byte, 256> ring_{};
+  std::array<std::byte, 256> log_{};
+  TestWorker<> worker_;
+  GenericPubSubBuffer<Event, 4, 4> pubsub_;
+  GenericPubSubBuffer<Event, 4, 4> replay_;
+  EventRecorder recorder_;
+
+  pw::sync::InterruptSpinLock lock_;
+  pw::Vector<Event, 16> collected_ PW_GUARDED_BY(lock_);
+  size_t expected_ = 0;
+  pw::sync::ThreadNotification notification_;
+};
+
+// Unit tests.
+
+TEST_F(EventLogTest, RecordAndReplay) {
+  ASSERT_TRUE(recorder_.Start(pubsub_).ok());
+  CollectEvents(pubsub_, kEvents.size());
+  for (const Event& event : kEvents) {
+    while (!pubsub_.Publish(event)) {
+      pw::this_thread::yield();
+    }
+  }
+  notification_.acquire();
+  recorder_.Stop();
+  EXPECT_EQ(recorder_.size(), kEvents.size());
+  EXPECT_EQ(recorder_.dropped(), 0u);
+
+  auto exported = recorder_.Export(log_);
+  ASSERT_TRUE(exported.ok());
+  EXPECT_EQ(exported.size(), recorder_.ExportSize());
+
+  {
+    std::lock_guard lock(lock_);
+    collected_.clear();
+  }
+  CollectEvents(replay_, kEvents.size());
+  EventReplayer replayer(pw::ConstByteSpan(log_.data(), exported.size()));
+  ASSERT_TRUE(replayer.Open().ok());
+  auto replayed = replayer.Replay(replay_);
+  EXPECT_TRUE(replayed.ok());
+  EXPECT_EQ(replayed.size(), kEvents.size());
+  notification_.acquire();
+
+  std::lock_guard lock(lock_);
+  ASSERT_EQ(collected_.size(), kEvents.size());
+  for (size_t i = 0; i < kEvents.size(); ++i) {
+    EXPECT_TRUE(SameEvent(collected_[i], kEvents[i]));
+  }
+}
+
+TEST_F(EventLogTest, TimestampsIncrease) {
+  for (const Event& event : kEvents) {
+    recorder_.Record(event);
+  }
+  auto exported = recorder_.Export(log_);
+  ASSERT_TRUE(exported.ok());
+
+  EventReplayer replayer(pw::ConstByteSpan(log_.data(), exported.size()));
+  ASSERT_TRUE(replayer.Open().ok());
+  EXPECT_EQ(replayer.period_numerator(),
+            static_cast<uint32_t>(EventRecorder::Clock::period::num));
+  EXPECT_EQ(replayer.period_denominator(),
+            static_cast<uint32_t>(EventRecorder::Clock::period::den));
+  uint64_t last = 0;
+  size_t count = 0;
+  while (auto record = replayer.Next()) {
+    EXPECT_GE(record->ticks, last);
+    EXPECT_TRUE(SameEvent(record->event, kEvents[count]));
+    last = record->ticks;
+    ++count;
+  }
+  EXPECT_TRUE(replayer.status().ok());
+  EXPECT_EQ(count, kEvents.size());
+}
+
+TEST_F(EventLogTest, OverwritesOldest) {
+  constexpr size_t kNumRecords = 100;
+  for (size_t i = 0; i < kNumRecords; ++i) {
+    recorder_.Record(TimerExpired{.token = static_cast<uint32_t>(i)});
+  }
+  EXPECT_LT(recorder_.size(), kNumRecords);
+  EXPECT_EQ(recorder_.size() + recorder_.dropped(), kNumRecords);
+
+  std::array<std::byte, 1024> log;
+  auto exported = recorder_.Export(log);
+  ASSERT_TRUE(exported.ok());
+  EventReplayer replayer(pw::ConstByteSpan(log.data(), exported.size()));
+  ASSERT_TRUE(replayer.Open().ok());
+
+  // The newest records are kept, in order.
+  uint32_t token = static_cast<uint32_t>(recorder_.dropped());
+  while (auto record = replayer.Next()) {
+    EXPECT_EQ(std::get<TimerExpired>(record->event).token, token++);
+  }
+  EXPECT_EQ(token, kNumRecords);
+}
+
+TEST_F(EventLogTest, ReplayFilter) {
+  for (const Event& event : kEvents) {
+    recorder_.Record(event);
+  }
+  auto exported = recorder_.Export(log_);
+  ASSERT_TRUE(exported.ok());
+
+  CollectEvents(replay_, 2);
+  EventReplayer replayer(pw::ConstByteSpan(log_.data(), exported.size()));
+  ASSERT_TRUE(replayer.Open().ok());
+  auto replayed = replayer.Replay(replay_, [](const Event& event) {
+    return std::holds_alternative<ButtonA>(event);
+  });
+  EXPECT_TRUE(replayed.ok());
+  EXPECT_EQ(replayed.size(), 2u);
+  notification_.acquire();
+
+  std::lock_guard lock(lock_);
+  ASSERT_EQ(collected_.size(), 2u);
+  EXPECT_TRUE(SameEvent(collected_[0], kEvents[0]));
+  EXPECT_TRUE(SameEvent(collected_[1], kEvents[3]));
+}
+
+TEST_F(EventLogTest, ExportTooSmall) {
+  for (const Event& event : kEvents) {
+    recorder_.Record(event);
+  }
+  std::array<std::byte, 16> log;
+  EXPECT_EQ(recorder_.Export(log).status(), pw::Status::ResourceExhausted());
+}
+
+TEST_F(EventLogTest, BadHeader) {
+  auto exported = recorder_.Export(log_);
+  ASSERT_TRUE(exported.ok());
+
+  log_[0] = std::byte{'X'};
+  EventReplayer bad_magic(pw::ConstByteSpan(log_.data(), exported.size()));
+  EXPECT_EQ(bad_magic.Open(), pw::Status::DataLoss());
+
+  log_[0] = std::byte{'S'};
+  log_[5] = std::byte{0xff};
+  EventReplayer bad_types(pw::ConstByteSpan(log_.data(), exported.size()));
+  EXPECT_EQ(bad_types.Open(), pw::Status::FailedPrecondition());
+}
+
+TEST_F(EventLogTest, TruncatedRecord) {
+  recorder_.Record(kEvents[0]);
+  recorder_.Record(kEvents[1]);
+  auto exported = recorder_.Export(log_);
+  ASSERT_TRUE(exported.ok());
+
+  EventReplayer replayer(pw::ConstByteSpan(log_.data(), exported.size() - 1));
+  ASSERT_TRUE(replayer.Open().ok());
+  EXPECT_TRUE(replayer.Next().has_value());
+  EXPECT_FALSE(replayer.Next().has_value());
+  EXPECT_EQ(replayer.status(), pw::Status::DataLoss());
+}
+
+TEST_F(EventLogTest, DecodesDeviceLog) {
+  // A log in the layout exported by the device, whose clock ticks at 1 kHz.
+  // It is spelled out byte by byte, so that a change to the encoding, or a
+  // dependence on the struct layout of the host, fails this test.
+  constexpr auto kDeviceLog = pw::bytes::Array<
+      // Header: magic, version, event types, and a 1/1000 s period.
+      'S', 'E', 'V', 'L', 0x02, 0x0f, 0x01, 0xe8, 0x07,
+      // 5 ms: ButtonA pressed.
+      0x05, 0x02, 0x00, 0x01,
+      // 1200 ms: AirQuality of 812.
+      0xb0, 0x09, 0x03, 0x09, 0xac, 0x06,
+      // 5000000000 ms, past 32 bits: TimerExpired with token 0x1234.
+      0x80, 0xe4, 0x97, 0xd0, 0x12, 0x03, 0x05, 0xb4, 0x24,
+      // 5000000250 ms: AmbientLightSample of 250.5 lux.
+      0xfa, 0xe5, 0x97, 0xd0, 0x12, 0x05, 0x08, 0x00, 0x80, 0x7a, 0x43,
+      // 5000000250 ms: StateManagerControl to silence alarms.
+      0xfa, 0xe5, 0x97, 0xd0, 0x12, 0x02, 0x0d, 0x02>();
+
+  const struct {
+    uint64_t ticks;
+    Event event;
+  } kExpected[] = {
+      {5, ButtonA(true)},
+      {1200, AirQuality{.score = 812}},
+      {5000000000, TimerExpired{.token = 0x1234}},
+      {5000000250, AmbientLightSample{.sample_lux = 250.5f}},
+      {5000000250, StateManagerControl(StateManagerControl::kSilenceAlarms)},
+  };
+
+  EventReplayer replayer(kDeviceLog);
+  ASSERT_TRUE(replayer.Open().ok());
+  EXPECT_EQ(replayer.period_numerator(), 1u);
+  EXPECT_EQ(replayer.period_denominator(), 1000u);
+  for (const auto& expected : kExpected) {
+    std::optional<EventReplayer::Record> record = replayer.Next();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->ticks, expected.ticks);
+    EXPECT_TRUE(SameEvent(record->event, expected.event));
+  }
+  EXPECT_FALSE(replayer.Next().has_value());
+  EXPECT_TRUE(replayer.status().ok());
+}
+
+TEST_F(EventLogTest, RejectsOutOfRangeField) {
+  // A StateManagerControl with an action past the last one.
+  constexpr auto kLog = pw::bytes::Array<
+      'S', 'E', 'V', 'L', 0x02, 0x0f, 0x01, 0xe8, 0x07,
+      0x00, 0x02, 0x0d, 0x07>();
+  EventReplayer replayer(kLog);
+  ASSERT_TRUE(replayer.Open().ok());
+  EXPECT_FALSE(replayer.Next().has_value());
+  EXPECT_EQ(replayer.status(), pw::Status::DataLoss());
+}
+
+}  // namespace
+}  // namespace sense
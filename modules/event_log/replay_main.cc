@@ -0,0 +1,115 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Replays an event log captured from a device into a `StateManager` on the
+// host, and logs each state that it broadcasts.
+
+#include <fstream>
+#include <iterator>
+#include <variant>
+#include <vector>
+
+#include "modules/event_log/event_log.h"
+#include "modules/event_log/sense_events.h"
+#include "modules/led/compositor.h"
+#include "modules/led/polychrome_led_fake.h"
+#include "modules/pubsub/pubsub.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/state_manager/state_manager.h"
+#include "modules/worker/work_queue_worker.h"
+#include "pw_bytes/span.h"
+#include "pw_log/log.h"
+#include "pw_status/status.h"
+#include "pw_status/status_with_size.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_thread_stl/options.h"
+
+namespace sense {
+namespace {
+
+using EventReplayer = GenericEventReplayer<Event>;
+
+/// Leaves out the events that the state manager publishes itself, which it
+/// publishes again during the replay.
+bool IsStateManagerInput(const Event& event) {
+  return !std::holds_alternative<TimerRequest>(event) &&
+         !std::holds_alternative<MorseEncodeRequest>(event) &&
+         !std::holds_alternative<SenseState>(event);
+}
+
+/// Waits for the worker to run the work queued so far.
+void Sync(Worker& worker) {
+  pw::sync::ThreadNotification done;
+  worker.RunOnce([&done]() { done.release(); });
+  done.acquire();
+}
+
+int Replay(const char* path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    PW_LOG_ERROR("Unable to open %s", path);
+    return 1;
+  }
+  const std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+
+  static WorkQueueWorker<32> worker;
+  static constexpr pw::thread::stl::Options kWorkerOptions;
+  worker.Start(kWorkerOptions);
+  static GenericPubSubBuffer<Event, 16, 4> pubsub(worker);
+  static PolychromeLedFake led;
+  static LedCompositor compositor(led,
+                                  AmbientLightAdjustedLed::kDefaultBrightness);
+  static StateManager state_manager(pubsub, compositor);
+
+  if (!pubsub.SubscribeTo<SenseState>([](SenseState state) {
+        PW_LOG_INFO("State: air quality %u, threshold %u, alarm %s",
+                    state.air_quality,
+                    state.alarm_threshold,
+                    state.alarm ? "on" : "off");
+      })) {
+    PW_LOG_ERROR("Unable to subscribe to state changes");
+    return 1;
+  }
+
+  EventReplayer replayer(pw::as_bytes(pw::span(data)));
+  if (pw::Status status = replayer.Open(); !status.ok()) {
+    PW_LOG_ERROR("Unable to read %s: %s", path, status.str());
+    return 1;
+  }
+  pw::StatusWithSize replayed = replayer.Replay(pubsub, IsStateManagerInput);
+
+  // Let the state manager handle the last events, and the subscriber the
+  // states that they lead to.
+  Sync(worker);
+  Sync(worker);
+
+  PW_LOG_INFO("Replayed %zu events", replayed.size());
+  if (!replayed.ok()) {
+    PW_LOG_ERROR("Log ended early: %s", replayed.status().str());
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace sense
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    PW_LOG_ERROR("Usage: %s EVENT_LOG", argv[0]);
+    return 1;
+  }
+  return sense::Replay(argv[1]);
+}
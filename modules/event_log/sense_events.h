@@ -0,0 +1,206 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "modules/event_log/event_log.h"
+#include "modules/pubsub/pubsub_events.h"
+
+namespace sense {
+
+// Encodings of the Sense events in an event log. Changing an encoding requires
+// a new `internal::kEventLogVersion`.
+
+template <typename T>
+  requires std::is_base_of_v<ButtonStateChange, T>
+struct EventFields<T> {
+  static constexpr size_t kMaxSize = 1;
+  static void Encode(EventFieldWriter& writer, const T& event) {
+    writer.WriteUint(event.pressed());
+  }
+  static T Decode(EventFieldReader& reader) { return T(reader.ReadBool()); }
+};
+
+template <>
+struct EventFields<TimerRequest> {
+  static constexpr size_t kMaxSize = MaxVarintSize(UINT32_MAX) +
+                                     2 * MaxVarintSize(UINT16_MAX) + 2;
+  static void Encode(EventFieldWriter& writer, const TimerRequest& event) {
+    writer.WriteUint(event.token);
+    writer.WriteUint(event.timeout_s);
+    writer.WriteUint(event.timeout_ms);
+    writer.WriteUint(event.periodic);
+    writer.WriteUint(event.cancel);
+  }
+  static TimerRequest Decode(EventFieldReader& reader) {
+    return TimerRequest{
+        .token = static_cast<uint32_t>(reader.ReadUint(UINT32_MAX)),
+        .timeout_s = static_cast<uint16_t>(reader.ReadUint(UINT16_MAX)),
+        .timeout_ms = static_cast<uint16_t>(reader.ReadUint(UINT16_MAX)),
+        .periodic = reader.ReadBool(),
+        .cancel = reader.ReadBool(),
+    };
+  }
+};
+
+template <>
+struct EventFields<TimerExpired> {
+  static constexpr size_t kMaxSize = MaxVarintSize(UINT32_MAX);
+  static void Encode(EventFieldWriter& writer, const TimerExpired& event) {
+    writer.WriteUint(event.token);
+  }
+  static TimerExpired Decode(EventFieldReader& reader) {
+    return TimerExpired{
+        .token = static_cast<uint32_t>(reader.ReadUint(UINT32_MAX)),
+    };
+  }
+};
+
+template <>
+struct EventFields<ProximityStateChange> {
+  static constexpr size_t kMaxSize = 1;
+  static void Encode(EventFieldWriter& writer,
+                     const ProximityStateChange& event) {
+    writer.WriteUint(event.proximity);
+  }
+  static ProximityStateChange Decode(EventFieldReader& reader) {
+    return ProximityStateChange{.proximity = reader.ReadBool()};
+  }
+};
+
+template <>
+struct EventFields<ProximitySample> {
+  static constexpr size_t kMaxSize = MaxVarintSize(UINT16_MAX);
+  static void Encode(EventFieldWriter& writer, const ProximitySample& event) {
+    writer.WriteUint(event.sample);
+  }
+  static ProximitySample Decode(EventFieldReader& reader) {
+    return ProximitySample{
+        .sample = static_cast<uint16_t>(reader.ReadUint(UINT16_MAX)),
+    };
+  }
+};
+
+template <>
+struct EventFields<AmbientLightSample> {
+  static constexpr size_t kMaxSize = sizeof(float);
+  static void Encode(EventFieldWriter& writer,
+                     const AmbientLightSample& event) {
+    writer.WriteFloat(event.sample_lux);
+  }
+  static AmbientLightSample Decode(EventFieldReader& reader) {
+    return AmbientLightSample{.sample_lux = reader.ReadFloat()};
+  }
+};
+
+template <>
+struct EventFields<AirQuality> {
+  static constexpr size_t kMaxSize = MaxVarintSize(UINT16_MAX);
+  static void Encode(EventFieldWriter& writer, const AirQuality& event) {
+    writer.WriteUint(event.score);
+  }
+  static AirQuality Decode(EventFieldReader& reader) {
+    return AirQuality{
+        .score = static_cast<uint16_t>(reader.ReadUint(UINT16_MAX)),
+    };
+  }
+};
+
+/// Only the repeat count is logged. The message is in a payload, which is
+/// released on the device, so replayed requests have an empty payload.
+template <>
+struct EventFields<MorseEncodeRequest> {
+  static constexpr size_t kMaxSize = MaxVarintSize(UINT32_MAX);
+  static void Encode(EventFieldWriter& writer,
+                     const MorseEncodeRequest& event) {
+    writer.WriteUint(event.repeat);
+  }
+  static MorseEncodeRequest Decode(EventFieldReader& reader) {
+    return MorseEncodeRequest{
+        .payload = PayloadRef(),
+        .repeat = static_cast<uint32_t>(reader.ReadUint(UINT32_MAX)),
+    };
+  }
+};
+
+template <>
+struct EventFields<MorseCodeValue> {
+  static constexpr size_t kMaxSize = 2;
+  static void Encode(EventFieldWriter& writer, const MorseCodeValue& event) {
+    writer.WriteUint(event.turn_on);
+    writer.WriteUint(event.message_finished);
+  }
+  static MorseCodeValue Decode(EventFieldReader& reader) {
+    return MorseCodeValue{
+        .turn_on = reader.ReadBool(),
+        .message_finished = reader.ReadBool(),
+    };
+  }
+};
+
+/// The description points into the device's flash, so it is not logged, and
+/// replayed states have an empty description.
+template <>
+struct EventFields<SenseState> {
+  static constexpr size_t kMaxSize = 1 + 2 * MaxVarintSize(UINT16_MAX);
+  static void Encode(EventFieldWriter& writer, const SenseState& event) {
+    writer.WriteUint(event.alarm);
+    writer.WriteUint(event.alarm_threshold);
+    writer.WriteUint(event.air_quality);
+  }
+  static SenseState Decode(EventFieldReader& reader) {
+    return SenseState{
+        .alarm = reader.ReadBool(),
+        .alarm_threshold = static_cast<uint16_t>(reader.ReadUint(UINT16_MAX)),
+        .air_quality = static_cast<uint16_t>(reader.ReadUint(UINT16_MAX)),
+        .air_quality_description = "",
+    };
+  }
+};
+
+template <>
+struct EventFields<StateManagerControl> {
+  static constexpr size_t kMaxSize = 1;
+  static void Encode(EventFieldWriter& writer,
+                     const StateManagerControl& event) {
+    writer.WriteUint(event.action);
+  }
+  static StateManagerControl Decode(EventFieldReader& reader) {
+    return StateManagerControl(static_cast<StateManagerControl::Action>(
+        reader.ReadUint(StateManagerControl::kSilenceAlarms)));
+  }
+};
+
+template <>
+struct EventFields<ButtonGesture> {
+  static constexpr size_t kMaxSize = 1 + 2 * MaxVarintSize(UINT8_MAX);
+  static void Encode(EventFieldWriter& writer, const ButtonGesture& event) {
+    writer.WriteUint(event.kind);
+    writer.WriteUint(event.buttons);
+    writer.WriteUint(event.clicks);
+  }
+  static ButtonGesture Decode(EventFieldReader& reader) {
+    return ButtonGesture{
+        .kind = static_cast<ButtonGesture::Kind>(
+            reader.ReadUint(ButtonGesture::kChord)),
+        .buttons = static_cast<uint8_t>(reader.ReadUint(UINT8_MAX)),
+        .clicks = static_cast<uint8_t>(reader.ReadUint(UINT8_MAX)),
+    };
+  }
+};
+
+}  // namespace sense
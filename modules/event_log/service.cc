@@ -0,0 +1,58 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/event_log/service.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace sense {
+
+pw::Status EventLogService::Start(const pw_protobuf_Empty&,
+                                  pw_protobuf_Empty&) {
+  return recorder_.Start(pubsub_);
+}
+
+pw::Status EventLogService::Stop(const pw_protobuf_Empty&,
+                                 pw_protobuf_Empty&) {
+  recorder_.Stop();
+  return pw::OkStatus();
+}
+
+pw::Status EventLogService::Read(const event_log_ReadRequest& request,
+                                 event_log_ReadResponse& response) {
+  std::lock_guard lock(lock_);
+  if (request.offset == 0) {
+    pw::StatusWithSize result = recorder_.Export(snapshot_);
+    if (!result.ok()) {
+      snapshot_size_ = 0;
+      return result.status();
+    }
+    snapshot_size_ = result.size();
+  }
+  if (request.offset > snapshot_size_) {
+    return pw::Status::OutOfRange();
+  }
+
+  response.total_size = static_cast<uint32_t>(snapshot_size_);
+  response.dropped = static_cast<uint32_t>(recorder_.dropped());
+  size_t size = std::min(snapshot_size_ - request.offset,
+                         sizeof(response.data.bytes));
+  std::memcpy(response.data.bytes, snapshot_.data() + request.offset, size);
+  response.data.size = static_cast<pb_size_t>(size);
+  return pw::OkStatus();
+}
+
+}  // namespace sense
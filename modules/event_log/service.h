@@ -0,0 +1,60 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include "modules/event_log/event_log.h"
+#include "modules/event_log/event_log.rpc.pb.h"
+#include "modules/event_log/sense_events.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "pw_bytes/span.h"
+#include "pw_status/status.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+
+namespace sense {
+
+using EventRecorder = GenericEventRecorder<Event>;
+using EventReplayer = GenericEventReplayer<Event>;
+
+/// Lets a host start and stop an `EventRecorder`, and read back its log.
+class EventLogService final
+    : public ::event_log::pw_rpc::nanopb::EventLog::Service<EventLogService> {
+ public:
+  /// Creates a service for the given recorder.
+  ///
+  /// Logs are exported to `snapshot` before being read, so that a log can be
+  /// read in several parts while recording continues. It should be a few bytes
+  /// larger than the recorder's buffer.
+  EventLogService(EventRecorder& recorder,
+                  PubSub& pubsub,
+                  pw::ByteSpan snapshot)
+      : recorder_(recorder), pubsub_(pubsub), snapshot_(snapshot) {}
+
+  pw::Status Start(const pw_protobuf_Empty&, pw_protobuf_Empty&);
+
+  pw::Status Stop(const pw_protobuf_Empty&, pw_protobuf_Empty&);
+
+  pw::Status Read(const event_log_ReadRequest& request,
+                  event_log_ReadResponse& response) PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  EventRecorder& recorder_;
+  PubSub& pubsub_;
+
+  pw::sync::Mutex lock_;
+  pw::ByteSpan snapshot_ PW_GUARDED_BY(lock_);
+  size_t snapshot_size_ PW_GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace sense
@@ -14,20 +14,23 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
 #include "modules/pubsub/pubsub.h"
 #include "modules/pubsub/pubsub_events.h"
+#include "modules/timer_wheel/timer_wheel.h"
 #include "pw_assert/assert.h"
 #include "pw_chrono/system_clock.h"
-#include "pw_chrono/system_timer.h"
 #include "pw_containers/vector.h"
 #include "pw_function/function.h"
 #include "pw_log/log.h"
+#include "pw_status/status.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/lock_annotations.h"
 #include "pw_tokenizer/nested_tokenization.h"
+#include "pw_trace/trace.h"
 
 namespace sense {
 
@@ -37,6 +40,8 @@ namespace sense {
 /// while another request for the same token is pending, the previous request is
 /// replaced by the new one.
 ///
+/// All timers share a single `TimerWheel`, and thus a single system timer.
+///
 /// @tparam   kCapacity   The total number of timers that can be added to this
 ///                       object. Timers cannot be removed once added.
 template <size_t kCapacity>
@@ -50,27 +55,34 @@ class EventTimers {
   /// `TimerExpired` event when the timer fires.
   class EventTimer {
    public:
-    constexpr EventTimer(PubSub& pubsub, Token token)
+    EventTimer(PubSub& pubsub, TimerWheel& wheel, Token token)
         : pubsub_(pubsub),
+          wheel_(wheel),
           token_(token),
           timer_(pw::bind_member<&EventTimer::OnExpiration>(this)) {}
 
     Token token() const { return token_; }
 
-    /// Schedules the callback to publish the `TimerExpired` event.
-    void Schedule(Clock::time_point expiry);
+    /// Schedules the callback to publish the `TimerExpired` event, either once
+    /// or repeatedly.
+    void Schedule(Clock::duration timeout, bool periodic);
+
+    /// Cancels any pending `TimerExpired` event.
+    void Cancel() { wheel_.Cancel(timer_); }
 
    private:
     /// Callback that publishes the `TimerExpired` event.
     void OnExpiration(Clock::time_point);
 
     PubSub& pubsub_;
+    TimerWheel& wheel_;
     const Token token_;
-    pw::chrono::SystemTimer timer_;
+    WheelTimer timer_;
   };
 
  public:
-  explicit EventTimers(PubSub& pubsub) : pubsub_(pubsub) {
+  EventTimers(PubSub& pubsub, TimerWheel& wheel)
+      : pubsub_(pubsub), wheel_(wheel) {
     PW_ASSERT(pubsub.SubscribeTo<TimerRequest>(
         pw::bind_member<&EventTimers::OnTimerRequest>(this)));
   }
@@ -79,15 +91,22 @@ class EventTimers {
   ///
   /// This does NOT schedule a timed event. Timed events are schduled by
   /// handling `TimerRequests`.
+  pw::Status AddEventTimer(Token token) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Cancels the pending timed event for the given token, if any.
   ///
-  /// @param  pubsub  Used to publish `TimerExpired` events.
-  pw::Status AddEventTimer(Token token);
+  /// @returns  NOT_FOUND if no timer was added for the token.
+  pw::Status CancelEventTimer(Token token) PW_LOCKS_EXCLUDED(lock_);
 
-  /// Handles a `TimerRequest` by scheduling a timed event.
+  /// Handles a `TimerRequest` by scheduling or cancelling a timed event.
   void OnTimerRequest(TimerRequest request) PW_LOCKS_EXCLUDED(lock_);
 
  private:
+  /// Returns the timer for the given token, or null if there is none.
+  EventTimer* FindLocked(Token token) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   PubSub& pubsub_;
+  TimerWheel& wheel_;
   pw::sync::InterruptSpinLock lock_;
   pw::Vector<EventTimer, kCapacity> timers_ PW_GUARDED_BY(lock_);
 };
@@ -97,40 +116,79 @@ class EventTimers {
 template <size_t kCapacity>
 pw::Status EventTimers<kCapacity>::AddEventTimer(Token token) {
   std::lock_guard lock(lock_);
-  for (auto& timer : timers_) {
-    if (timer.token() == token) {
-      PW_LOG_WARN("Timer already exists: " PW_TOKEN_FMT(), token);
-      return pw::Status::AlreadyExists();
-    }
+  if (FindLocked(token) != nullptr) {
+    PW_LOG_WARN("Timer already exists: " PW_TOKEN_FMT(), token);
+    return pw::Status::AlreadyExists();
   }
-  timers_.emplace_back(pubsub_, token);
+  timers_.emplace_back(pubsub_, wheel_, token);
+  return pw::OkStatus();
+}
+
+template <size_t kCapacity>
+pw::Status EventTimers<kCapacity>::CancelEventTimer(Token token) {
+  std::lock_guard lock(lock_);
+  EventTimer* timer = FindLocked(token);
+  if (timer == nullptr) {
+    return pw::Status::NotFound();
+  }
+  timer->Cancel();
   return pw::OkStatus();
 }
 
 template <size_t kCapacity>
 void EventTimers<kCapacity>::OnTimerRequest(TimerRequest request) {
-  PW_LOG_INFO("Adding timed event: " PW_TOKEN_FMT() " after %u seconds",
+  if (request.cancel) {
+    PW_LOG_INFO("Cancelling timed event: " PW_TOKEN_FMT(), request.token);
+    if (!CancelEventTimer(request.token).ok()) {
+      PW_LOG_WARN("No timer found for timed event: " PW_TOKEN_FMT(),
+                  request.token);
+    }
+    return;
+  }
+  PW_LOG_INFO("Adding %s timed event: " PW_TOKEN_FMT() " after %u.%03u seconds",
+              request.periodic ? "periodic" : "one-shot",
               request.token,
-              request.timeout_s);
-  auto expiry = pw::chrono::SystemClock::TimePointAfterAtLeast(
-      std::chrono::seconds(request.timeout_s));
+              request.timeout_s,
+              request.timeout_ms);
+  auto timeout = std::chrono::seconds(request.timeout_s) +
+                 std::chrono::milliseconds(request.timeout_ms);
   std::lock_guard lock(lock_);
+  EventTimer* timer = FindLocked(request.token);
+  if (timer == nullptr) {
+    PW_LOG_WARN("No timer found for timed event: " PW_TOKEN_FMT(),
+                request.token);
+    return;
+  }
+  timer->Schedule(Clock::for_at_least(timeout), request.periodic);
+}
+
+template <size_t kCapacity>
+typename EventTimers<kCapacity>::EventTimer* EventTimers<kCapacity>::FindLocked(
+    Token token) {
+  // Tokens are added once at startup and the capacity is small, so a linear
+  // scan is cheaper than maintaining an index.
   for (auto& timer : timers_) {
-    if (timer.token() == request.token) {
-      timer.Schedule(expiry);
-      return;
+    if (timer.token() == token) {
+      return &timer;
     }
   }
-  PW_LOG_WARN("No timer found for timed event: " PW_TOKEN_FMT(), request.token);
+  return nullptr;
 }
 
 template <size_t kCapacity>
-void EventTimers<kCapacity>::EventTimer::Schedule(Clock::time_point expiry) {
-  timer_.InvokeAt(expiry);
+void EventTimers<kCapacity>::EventTimer::Schedule(Clock::duration timeout,
+                                                  bool periodic) {
+  PW_TRACE_INSTANT("Schedule", "EventTimers", token_);
+  if (periodic) {
+    wheel_.InvokeEvery(timer_, timeout);
+  } else {
+    wheel_.InvokeAfter(timer_, timeout);
+  }
 }
 
 template <size_t kCapacity>
 void EventTimers<kCapacity>::EventTimer::OnExpiration(Clock::time_point) {
+  PW_TRACE_INSTANT("Expire", "EventTimers", token_);
   PW_LOG_INFO("Timed event triggered: " PW_TOKEN_FMT(), token_);
   PW_ASSERT(pubsub_.Publish(TimerExpired{.token = token_}));
 }
@@ -0,0 +1,238 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sense {
+
+// Filter stages for cleaning up sensor samples. Each stage takes one sample at
+// a time and returns the filtered sample. Stages are combined into a
+// `FilterPipeline`, which calls them in order with no virtual calls or heap
+// allocation, so the whole pipeline can be inlined.
+//
+// A stage has a `Sample` type, an `Update(Sample)` method that returns a
+// `Sample`, and a `Reset()` method that clears its history. Stages are
+// instantiated with either floating point samples, or integer samples which are
+// treated as fixed point values.
+//
+// None of the stages are thread safe.
+
+/// Returns the median of the last `kSize` samples, which removes spikes that
+/// last less than `kSize / 2` samples. Until `kSize` samples have been added,
+/// returns the median of the samples so far, or the lower of the two middle
+/// samples.
+///
+/// @tparam   kSize   Number of samples in the window. Must be odd.
+template <typename T, size_t kSize>
+class MedianFilter {
+ public:
+  static_assert(kSize % 2 == 1, "The median window must have an odd size");
+
+  using Sample = T;
+
+  constexpr T Update(T sample) {
+    window_[next_] = sample;
+    next_ = (next_ + 1) % kSize;
+    if (count_ < kSize) {
+      ++count_;
+    }
+
+    // Insertion sort is fastest for the small windows used for sensors.
+    std::array<T, kSize> sorted = window_;
+    for (size_t i = 1; i < count_; ++i) {
+      T value = sorted[i];
+      size_t j = i;
+      for (; j > 0 && value < sorted[j - 1]; --j) {
+        sorted[j] = sorted[j - 1];
+      }
+      sorted[j] = value;
+    }
+    return sorted[(count_ - 1) / 2];
+  }
+
+  constexpr void Reset() {
+    next_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  std::array<T, kSize> window_ = {};
+  size_t next_ = 0;
+  size_t count_ = 0;
+};
+
+/// Smooths samples with an exponential moving average. Each sample moves the
+/// output by `1 / 2^kDecayShift` of its distance from the output. The first
+/// sample is returned as is.
+///
+/// Integer samples are averaged in fixed point with `kFractionBits` fractional
+/// bits, so that the output converges on a steady input rather than getting
+/// stuck below it, and rounded to the nearest integer.
+///
+/// @tparam   kDecayShift   Base-2 logarithm of the decay factor.
+template <typename T, uint32_t kDecayShift>
+class EmaFilter {
+ public:
+  static_assert(std::is_floating_point_v<T> ||
+                    (std::is_integral_v<T> && sizeof(T) <= sizeof(uint16_t)),
+                "Integer samples must fit in fixed point with 8 bits of "
+                "fraction in an int32_t");
+  static_assert(kDecayShift < 16, "The decay factor is too large");
+
+  using Sample = T;
+
+  static constexpr uint32_t kFractionBits = 8;
+
+  constexpr T Update(T sample) {
+    if constexpr (std::is_floating_point_v<T>) {
+      constexpr T kAlpha = T(1) / T(1u << kDecayShift);
+      average_ = primed_ ? average_ + (sample - average_) * kAlpha : sample;
+      primed_ = true;
+      return average_;
+    } else {
+      const int32_t scaled = static_cast<int32_t>(sample) << kFractionBits;
+      average_ = primed_ ? average_ + ((scaled - average_) >> kDecayShift)
+                         : scaled;
+      primed_ = true;
+      return static_cast<T>((average_ + (1 << (kFractionBits - 1))) >>
+                            kFractionBits);
+    }
+  }
+
+  constexpr void Reset() { primed_ = false; }
+
+ private:
+  std::conditional_t<std::is_floating_point_v<T>, T, int32_t> average_ = 0;
+  bool primed_ = false;
+};
+
+/// Holds its output until a sample differs from it by more than `band`, which
+/// suppresses small changes, e.g. quantization noise.
+template <typename T>
+class DeadbandFilter {
+ public:
+  using Sample = T;
+
+  explicit constexpr DeadbandFilter(T band) : band_(band) {}
+
+  constexpr T Update(T sample) {
+    const T distance = sample > output_ ? sample - output_ : output_ - sample;
+    if (!primed_ || distance > band_) {
+      output_ = sample;
+      primed_ = true;
+    }
+    return output_;
+  }
+
+  constexpr void Reset() { primed_ = false; }
+
+ private:
+  T band_;
+  T output_ = 0;
+  bool primed_ = false;
+};
+
+/// Converts samples to one of two levels with hysteresis. The output switches
+/// to `high_output` when a sample is at or above `high_threshold`, and to
+/// `low_output` when a sample is at or below `low_threshold`. It starts low.
+///
+/// `HysteresisEdgeDetector` works the same way, but reports the edges instead.
+template <typename T>
+class HysteresisFilter {
+ public:
+  using Sample = T;
+
+  constexpr HysteresisFilter(T low_threshold,
+                             T high_threshold,
+                             T low_output = T(0),
+                             T high_output = T(1))
+      : low_threshold_(low_threshold),
+        high_threshold_(high_threshold),
+        low_output_(low_output),
+        high_output_(high_output) {}
+
+  constexpr T Update(T sample) {
+    if (sample <= low_threshold_) {
+      high_ = false;
+    } else if (sample >= high_threshold_) {
+      high_ = true;
+    }
+    return high_ ? high_output_ : low_output_;
+  }
+
+  constexpr void Reset() { high_ = false; }
+
+ private:
+  T low_threshold_;
+  T high_threshold_;
+  T low_output_;
+  T high_output_;
+  bool high_ = false;
+};
+
+/// Passes each sample through a series of filter stages, in order.
+///
+/// @code{.cpp}
+///   FilterPipeline proximity(MedianFilter<uint16_t, 3>(),
+///                            DeadbandFilter<uint16_t>(32));
+///   uint16_t clean = proximity.Update(raw);
+/// @endcode
+template <typename... Stages>
+class FilterPipeline {
+ public:
+  static_assert(sizeof...(Stages) > 0, "A pipeline needs at least one stage");
+
+  using Sample =
+      typename std::tuple_element_t<0, std::tuple<Stages...>>::Sample;
+
+  static_assert((std::is_same_v<typename Stages::Sample, Sample> && ...),
+                "All stages must take the same type of sample");
+
+  constexpr FilterPipeline() = default;
+
+  explicit constexpr FilterPipeline(Stages... stages)
+      : stages_(std::move(stages)...) {}
+
+  /// Filters a sample through every stage and returns the result.
+  constexpr Sample Update(Sample sample) {
+    std::apply(
+        [&sample](Stages&... stages) {
+          ((sample = stages.Update(sample)), ...);
+        },
+        stages_);
+    return sample;
+  }
+
+  /// Clears the history of every stage.
+  constexpr void Reset() {
+    std::apply([](Stages&... stages) { (stages.Reset(), ...); }, stages_);
+  }
+
+  /// Returns a stage, e.g. to adjust its parameters.
+  template <size_t kIndex>
+  constexpr auto& stage() {
+    return std::get<kIndex>(stages_);
+  }
+
+ private:
+  std::tuple<Stages...> stages_;
+};
+
+}  // namespace sense
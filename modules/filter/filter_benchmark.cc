@@ -0,0 +1,106 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Measures the cost of each filter stage, and of the pipelines used by the
+// sampling loop, for fixed point and floating point samples.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/filter/filter.h"
+#include "pw_perf_test/perf_test.h"
+
+namespace sense {
+namespace {
+
+// Noisy proximity-like samples with occasional spikes.
+constexpr std::array<uint16_t, 16> kSamples = {
+    1000, 1012, 996,  1004, 8000, 1010, 990, 1001,
+    1020, 1018, 1024, 60,   1030, 1027, 1033, 1029,
+};
+
+template <typename Filter>
+void FilterSamples(pw::perf_test::State& state, Filter filter) {
+  using Sample = typename Filter::Sample;
+  Sample sum = 0;
+  while (state.KeepRunning()) {
+    for (uint16_t sample : kSamples) {
+      sum += filter.Update(static_cast<Sample>(sample));
+    }
+  }
+  // Keep the work from being optimized away.
+  volatile Sample sink = sum;
+  static_cast<void>(sink);
+}
+
+void MedianFixed(pw::perf_test::State& state) {
+  FilterSamples(state, MedianFilter<uint16_t, 5>());
+}
+
+void MedianFloat(pw::perf_test::State& state) {
+  FilterSamples(state, MedianFilter<float, 5>());
+}
+
+void EmaFixed(pw::perf_test::State& state) {
+  FilterSamples(state, EmaFilter<uint16_t, 2>());
+}
+
+void EmaFloat(pw::perf_test::State& state) {
+  FilterSamples(state, EmaFilter<float, 2>());
+}
+
+void DeadbandFixed(pw::perf_test::State& state) {
+  FilterSamples(state, DeadbandFilter<uint16_t>(16));
+}
+
+void DeadbandFloat(pw::perf_test::State& state) {
+  FilterSamples(state, DeadbandFilter<float>(16.f));
+}
+
+void HysteresisFixed(pw::perf_test::State& state) {
+  FilterSamples(state, HysteresisFilter<uint16_t>(512, 1024));
+}
+
+void HysteresisFloat(pw::perf_test::State& state) {
+  FilterSamples(state, HysteresisFilter<float>(512.f, 1024.f));
+}
+
+void PipelineFixed(pw::perf_test::State& state) {
+  FilterSamples(state,
+                FilterPipeline(MedianFilter<uint16_t, 3>(),
+                               EmaFilter<uint16_t, 2>(),
+                               DeadbandFilter<uint16_t>(16)));
+}
+
+void PipelineFloat(pw::perf_test::State& state) {
+  FilterSamples(state,
+                FilterPipeline(MedianFilter<float, 3>(),
+                               EmaFilter<float, 2>(),
+                               DeadbandFilter<float>(16.f)));
+}
+
+PW_PERF_TEST(MedianFilterFixed, MedianFixed);
+PW_PERF_TEST(MedianFilterFloat, MedianFloat);
+PW_PERF_TEST(EmaFilterFixed, EmaFixed);
+PW_PERF_TEST(EmaFilterFloat, EmaFloat);
+PW_PERF_TEST(DeadbandFilterFixed, DeadbandFixed);
+PW_PERF_TEST(DeadbandFilterFloat, DeadbandFloat);
+PW_PERF_TEST(HysteresisFilterFixed, HysteresisFixed);
+PW_PERF_TEST(HysteresisFilterFloat, HysteresisFloat);
+PW_PERF_TEST(FilterPipelineFixed, PipelineFixed);
+PW_PERF_TEST(FilterPipelineFloat, PipelineFloat);
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,114 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/filter/filter.h"
+
+#include <array>
+#include <cstdint>
+
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+TEST(MedianFilterTest, RemovesSpikes) {
+  MedianFilter<uint16_t, 3> filter;
+  EXPECT_EQ(filter.Update(100), 100u);
+  EXPECT_EQ(filter.Update(102), 100u);
+  EXPECT_EQ(filter.Update(5000), 102u);
+  EXPECT_EQ(filter.Update(101), 102u);
+  EXPECT_EQ(filter.Update(99), 101u);
+}
+
+TEST(MedianFilterTest, Float) {
+  MedianFilter<float, 5> filter;
+  for (float sample : {1.f, -40.f, 2.f, 3.f, 90.f}) {
+    filter.Update(sample);
+  }
+  EXPECT_EQ(filter.Update(2.5f), 2.5f);
+}
+
+TEST(EmaFilterTest, FixedPointMatchesIntegerSteps) {
+  EmaFilter<uint16_t, 2> filter;
+  EXPECT_EQ(filter.Update(800), 800u);
+  EXPECT_EQ(filter.Update(400), 700u);
+  EXPECT_EQ(filter.Update(400), 625u);
+}
+
+TEST(EmaFilterTest, FixedPointConvergesOnSteadyInput) {
+  // Truncating integer averages stop short of the input when the step is
+  // smaller than the decay factor.
+  EmaFilter<uint16_t, 2> filter;
+  filter.Update(800);
+  uint16_t output = 0;
+  for (int i = 0; i < 40; ++i) {
+    output = filter.Update(803);
+  }
+  EXPECT_EQ(output, 803u);
+}
+
+TEST(EmaFilterTest, Float) {
+  EmaFilter<float, 1> filter;
+  EXPECT_EQ(filter.Update(10.f), 10.f);
+  EXPECT_EQ(filter.Update(20.f), 15.f);
+  filter.Reset();
+  EXPECT_EQ(filter.Update(4.f), 4.f);
+}
+
+TEST(DeadbandFilterTest, HoldsSmallChanges) {
+  DeadbandFilter<uint16_t> filter(10);
+  EXPECT_EQ(filter.Update(500), 500u);
+  EXPECT_EQ(filter.Update(510), 500u);
+  EXPECT_EQ(filter.Update(490), 500u);
+  EXPECT_EQ(filter.Update(489), 489u);
+  EXPECT_EQ(filter.Update(520), 520u);
+}
+
+TEST(HysteresisFilterTest, SwitchesAtThresholds) {
+  HysteresisFilter<float> filter(10.f, 20.f);
+  EXPECT_EQ(filter.Update(15.f), 0.f);
+  EXPECT_EQ(filter.Update(20.f), 1.f);
+  EXPECT_EQ(filter.Update(11.f), 1.f);
+  EXPECT_EQ(filter.Update(10.f), 0.f);
+  EXPECT_EQ(filter.Update(19.f), 0.f);
+}
+
+TEST(FilterPipelineTest, AppliesStagesInOrder) {
+  FilterPipeline pipeline(MedianFilter<uint16_t, 3>(),
+                          DeadbandFilter<uint16_t>(8));
+  constexpr std::array<uint16_t, 6> kSamples = {
+      1000, 1004, 9000, 1002, 1020, 1021};
+  constexpr std::array<uint16_t, 6> kExpected = {
+      1000, 1000, 1000, 1000, 1020, 1020};
+  for (size_t i = 0; i < kSamples.size(); ++i) {
+    EXPECT_EQ(pipeline.Update(kSamples[i]), kExpected[i]);
+  }
+
+  pipeline.Reset();
+  EXPECT_EQ(pipeline.Update(42), 42u);
+}
+
+TEST(FilterPipelineTest, IsConstexpr) {
+  constexpr float kOutput = [] {
+    FilterPipeline pipeline(EmaFilter<float, 1>(),
+                            HysteresisFilter<float>(2.f, 4.f));
+    pipeline.Update(0.f);
+    pipeline.Update(8.f);
+    return pipeline.Update(8.f);
+  }();
+  EXPECT_EQ(kOutput, 1.f);
+}
+
+}  // namespace
+}  // namespace sense
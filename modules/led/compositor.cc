@@ -0,0 +1,162 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/led/compositor.h"
+
+#include "modules/lerp/lerp.h"
+#include "pw_tokenizer/tokenize.h"
+
+namespace sense {
+namespace {
+
+constexpr uint16_t kOpaque = 0xff;
+
+/// Interpolates each byte of two packed values separately.
+uint32_t LerpBytes(uint32_t a, uint32_t b, uint16_t num, uint16_t den) {
+  uint32_t result = 0;
+  for (uint32_t shift = 0; shift < 32; shift += 8) {
+    auto a_byte = static_cast<uint8_t>(a >> shift);
+    auto b_byte = static_cast<uint8_t>(b >> shift);
+    result |= uint32_t{Lerp(a_byte, b_byte, num, den)} << shift;
+  }
+  return result;
+}
+
+}  // namespace
+
+// LedKeyframes methods.
+
+uint32_t LedKeyframes::value() const {
+  return done() ? to_ : LerpBytes(from_, to_, frame_, frames_);
+}
+
+void LedKeyframes::MoveTo(uint32_t target, uint16_t frames) {
+  if (target == to_) {
+    return;
+  }
+  from_ = value();
+  to_ = target;
+  frame_ = 0;
+  frames_ = frames;
+}
+
+// LedCompositor methods.
+
+LedCompositor::LedCompositor(PolychromeLed& led, uint8_t brightness)
+    : led_(led),
+      timer_([this](pw::chrono::SystemClock::time_point) {
+        worker_->RunOnceLabeled(PW_TOKENIZE_STRING("led compositor frame"),
+                                [this]() { OnFrame(); });
+      }),
+      brightness_(brightness),
+      led_brightness_(brightness) {
+  led_.SetColor(led_color_);
+  led_.SetBrightness(led_brightness_);
+  led_.Enable();
+  led_.TurnOn();
+}
+
+void LedCompositor::Init(Worker& worker, TimerWheel& wheel) {
+  worker_ = &worker;
+  wheel_ = &wheel;
+  ScheduleFrames();
+}
+
+void LedCompositor::SetBase(uint32_t color_hex, uint16_t frames) {
+  base_.MoveTo(color_hex, frames);
+  ScheduleFrames();
+}
+
+void LedCompositor::SetOverlay(uint32_t color_hex, uint16_t frames) {
+  if (opacity_.value() == 0) {
+    // Nothing is showing, so start the fade in with the new color.
+    overlay_.MoveTo(color_hex, 0);
+  } else {
+    overlay_.MoveTo(color_hex, frames);
+  }
+  opacity_.MoveTo(kOpaque, frames);
+  ScheduleFrames();
+}
+
+void LedCompositor::ClearOverlay(uint16_t frames) {
+  opacity_.MoveTo(0, frames);
+  ScheduleFrames();
+}
+
+void LedCompositor::SetMask(bool turn_on) {
+  mask_ = turn_on;
+  Render();
+}
+
+void LedCompositor::SetBrightness(uint8_t level, uint16_t frames) {
+  brightness_.MoveTo(level, frames);
+  ScheduleFrames();
+}
+
+void LedCompositor::Tick() {
+  base_.Step();
+  overlay_.Step();
+  opacity_.Step();
+  brightness_.Step();
+  Render();
+}
+
+uint32_t LedCompositor::color() const {
+  auto opacity = static_cast<uint16_t>(opacity_.value());
+  return LerpBytes(base_.value(), overlay_.value(), opacity, kOpaque);
+}
+
+void LedCompositor::Render() {
+  // Turn off first and on last. While the LED is off, color and brightness
+  // changes are only stored, and turning it on writes them all at once.
+  if (!mask_ && led_on_) {
+    led_.TurnOff();
+    led_on_ = false;
+  }
+  const uint8_t level = brightness();
+  const uint32_t color_hex = color();
+  if (level != led_brightness_ || color_hex != led_color_) {
+    led_.SetColorAndBrightness(color_hex, level);
+    led_brightness_ = level;
+    led_color_ = color_hex;
+  }
+  if (mask_ && !led_on_) {
+    led_.TurnOn();
+    led_on_ = true;
+  }
+}
+
+void LedCompositor::ScheduleFrames() {
+  if (worker_ == nullptr || frames_scheduled_ || !fading()) {
+    return;
+  }
+  frames_scheduled_ = true;
+  deadline_ = pw::chrono::SystemClock::TimePointAfterAtLeast(kFramePeriod);
+  wheel_->InvokeAt(timer_, deadline_);
+}
+
+void LedCompositor::OnFrame() {
+  Tick();
+  if (!fading()) {
+    frames_scheduled_ = false;
+    return;
+  }
+
+  // Schedule from the previous deadline, so that the frame rate does not drift
+  // with worker latency.
+  deadline_ += kFramePeriod;
+  wheel_->InvokeAt(timer_, deadline_);
+}
+
+}  // namespace sense
@@ -0,0 +1,167 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "modules/led/polychrome_led.h"
+#include "modules/timer_wheel/timer_wheel.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+
+namespace sense {
+
+/// A value that moves from one keyframe to the next over a number of frames.
+///
+/// Values are packed like `PolychromeLed` colors, and each byte is
+/// interpolated separately.
+class LedKeyframes {
+ public:
+  constexpr explicit LedKeyframes(uint32_t value) : from_(value), to_(value) {}
+
+  /// Returns the value for the current frame.
+  uint32_t value() const;
+
+  /// Returns the value of the last keyframe.
+  uint32_t target() const { return to_; }
+
+  /// Returns whether the last keyframe has been reached.
+  bool done() const { return frame_ >= frames_; }
+
+  /// Starts moving from the current value to `target`, reaching it after the
+  /// given number of frames. Does nothing if already moving to `target`, so
+  /// that repeated updates do not restart the fade.
+  void MoveTo(uint32_t target, uint16_t frames);
+
+  /// Advances by one frame.
+  void Step() {
+    if (!done()) {
+      ++frame_;
+    }
+  }
+
+ private:
+  uint32_t from_;
+  uint32_t to_;
+  uint16_t frame_ = 0;
+  uint16_t frames_ = 0;
+};
+
+/// Renders the output of a `PolychromeLed` from several layers.
+///
+/// From bottom to top, the layers are:
+///
+/// * A base color.
+/// * An overlay color, which is blended over the base color by its opacity.
+/// * An on/off mask, e.g. for Morse code.
+/// * A brightness scale.
+///
+/// Changes to the colors, the overlay opacity and the brightness cross-fade
+/// from the current output over a number of frames, and retargeting during a
+/// fade continues from wherever the fade has reached. Mask changes are applied
+/// immediately, so Morse code edges keep the encoder's timing.
+///
+/// Each frame composes the layers and writes to the LED only the outputs whose
+/// levels have changed since the last frame.
+///
+/// This class is NOT thread safe. All methods must be called from the worker
+/// passed to `Init`, if any.
+class LedCompositor {
+ public:
+  static constexpr uint32_t kFrameRateHz = 50;
+  static constexpr pw::chrono::SystemClock::duration kFramePeriod =
+      pw::chrono::SystemClock::for_at_least(
+          std::chrono::milliseconds(1000 / kFrameRateHz));
+
+  /// Fade lengths, in frames.
+  static constexpr uint16_t kColorFadeFrames = 25;
+  static constexpr uint16_t kOverlayFadeFrames = 10;
+  static constexpr uint16_t kBrightnessFadeFrames = 50;
+
+  /// Enables the LED and turns it on, with the given brightness and no color.
+  LedCompositor(PolychromeLed& led, uint8_t brightness);
+
+  LedCompositor(const LedCompositor&) = delete;
+  LedCompositor& operator=(const LedCompositor&) = delete;
+
+  /// Renders frames at `kFrameRateHz` on the given worker while fading, timed
+  /// by a timer on `wheel`.
+  ///
+  /// Without a worker, frames are only rendered by calling `Tick`.
+  void Init(Worker& worker, TimerWheel& wheel);
+
+  /// Fades the base layer to a color.
+  void SetBase(uint32_t color_hex, uint16_t frames = kColorFadeFrames);
+
+  /// Fades in an overlay of the given color. If an overlay is already shown,
+  /// fades it to the new color.
+  void SetOverlay(uint32_t color_hex, uint16_t frames = kOverlayFadeFrames);
+
+  /// Fades out the overlay, revealing the base layer.
+  void ClearOverlay(uint16_t frames = kOverlayFadeFrames);
+
+  /// Turns the LED on or off immediately, without interrupting any fades.
+  void SetMask(bool turn_on);
+
+  /// Fades to a brightness level.
+  void SetBrightness(uint8_t level, uint16_t frames = kBrightnessFadeFrames);
+
+  /// Advances every layer by one frame, and writes any changes to the LED.
+  void Tick();
+
+  /// Returns whether any layer is still fading.
+  bool fading() const {
+    return !base_.done() || !overlay_.done() || !opacity_.done() ||
+           !brightness_.done();
+  }
+
+  /// Returns the color of the current frame, before brightness is applied.
+  uint32_t color() const;
+
+  /// Returns the brightness of the current frame.
+  uint8_t brightness() const {
+    return static_cast<uint8_t>(brightness_.value());
+  }
+
+ private:
+  /// Writes any changes in the current frame to the LED.
+  void Render();
+
+  /// Starts the frame timer, if a worker is set and it is not already running.
+  void ScheduleFrames();
+
+  /// Called on the worker for each frame while the frame timer is running.
+  void OnFrame();
+
+  PolychromeLed& led_;
+  Worker* worker_ = nullptr;
+  TimerWheel* wheel_ = nullptr;
+  WheelTimer timer_;
+  pw::chrono::SystemClock::time_point deadline_;
+  bool frames_scheduled_ = false;
+
+  LedKeyframes base_{0};
+  LedKeyframes overlay_{0};
+  LedKeyframes opacity_{0};
+  LedKeyframes brightness_;
+  bool mask_ = true;
+
+  // Last output written to the LED.
+  uint32_t led_color_ = 0;
+  uint8_t led_brightness_;
+  bool led_on_ = true;
+};
+
+}  // namespace sense
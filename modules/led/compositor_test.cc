@@ -0,0 +1,229 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/led/compositor.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/led/polychrome_led.h"
+#include "modules/pwm/animator.h"
+#include "modules/pwm/digital_out.h"
+#include "modules/timer_wheel/timer_wheel.h"
+#include "modules/worker/test_worker.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_thread/sleep.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr uint8_t kBrightness = 0xff;
+
+/// PWM output that counts how many times its level is set.
+class CountingDigitalOut : public PwmDigitalOut {
+ public:
+  uint16_t level() const { return level_; }
+  size_t writes() const { return writes_; }
+
+ private:
+  void DoEnable() override {}
+  void DoDisable() override {}
+  void DoSetLevel(uint16_t level) override {
+    level_ = level;
+    ++writes_;
+  }
+
+  uint16_t level_ = 0;
+  size_t writes_ = 0;
+};
+
+// Test fixtures.
+
+class LedCompositorTest : public ::testing::Test {
+ protected:
+  LedCompositorTest()
+      : animator_(1000),
+        led_(red_, green_, blue_, animator_),
+        reference_(ref_red_, ref_green_, ref_blue_, animator_),
+        compositor_(led_, kBrightness) {
+    reference_.Enable();
+    reference_.TurnOn();
+  }
+
+  void Tick(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      compositor_.Tick();
+    }
+  }
+
+  /// Sets the reference LED directly, and checks that the LED matches it.
+  void ExpectLevels(uint32_t color, uint8_t brightness) {
+    reference_.SetColor(color);
+    reference_.SetBrightness(brightness);
+    EXPECT_EQ(red_.level(), ref_red_.level());
+    EXPECT_EQ(green_.level(), ref_green_.level());
+    EXPECT_EQ(blue_.level(), ref_blue_.level());
+  }
+
+  CountingDigitalOut red_;
+  CountingDigitalOut green_;
+  CountingDigitalOut blue_;
+  CountingDigitalOut ref_red_;
+  CountingDigitalOut ref_green_;
+  CountingDigitalOut ref_blue_;
+  PwmAnimator animator_;
+  PolychromeLed led_;
+  PolychromeLed reference_;
+  TimerWheel wheel_;
+  LedCompositor compositor_;
+};
+
+// Unit tests.
+
+TEST_F(LedCompositorTest, BaseFadesOverFrames) {
+  compositor_.SetBase(0xff0000, 4);
+  EXPECT_EQ(compositor_.color(), 0u);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x3f0000u);
+  ExpectLevels(0x3f0000, kBrightness);
+  Tick(3);
+  EXPECT_EQ(compositor_.color(), 0xff0000u);
+  ExpectLevels(0xff0000, kBrightness);
+  EXPECT_FALSE(compositor_.fading());
+}
+
+TEST_F(LedCompositorTest, RetargetContinuesFromCurrentColor) {
+  compositor_.SetBase(0xff0000, 4);
+  Tick(2);
+  EXPECT_EQ(compositor_.color(), 0x7f0000u);
+
+  // The new fade starts where the old one had reached.
+  compositor_.SetBase(0x0000ff, 2);
+  EXPECT_EQ(compositor_.color(), 0x7f0000u);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x40007fu);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x0000ffu);
+}
+
+TEST_F(LedCompositorTest, SameTargetDoesNotRestartFade) {
+  compositor_.SetBase(0x00ff00, 4);
+  Tick(3);
+  compositor_.SetBase(0x00ff00, 4);
+  Tick(1);
+  EXPECT_FALSE(compositor_.fading());
+  EXPECT_EQ(compositor_.color(), 0x00ff00u);
+}
+
+TEST_F(LedCompositorTest, OverlayBlendsOverBase) {
+  compositor_.SetBase(0x00ff00, 0);
+  compositor_.SetOverlay(0xff0000, 2);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x7f8000u);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0xff0000u);
+  ExpectLevels(0xff0000, kBrightness);
+
+  // Changing the overlay color fades between overlay colors.
+  compositor_.SetOverlay(0x0000ff, 2);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x80007fu);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x0000ffu);
+
+  // Base changes are hidden by the overlay until it is cleared.
+  compositor_.SetBase(0xffffff, 0);
+  Tick(1);
+  EXPECT_EQ(compositor_.color(), 0x0000ffu);
+  compositor_.ClearOverlay(2);
+  Tick(2);
+  EXPECT_EQ(compositor_.color(), 0xffffffu);
+  ExpectLevels(0xffffff, kBrightness);
+}
+
+TEST_F(LedCompositorTest, MaskAppliesImmediately) {
+  compositor_.SetBase(0xffffff, 0);
+  Tick(1);
+  compositor_.SetMask(false);
+  EXPECT_EQ(red_.level(), 0u);
+  EXPECT_EQ(green_.level(), 0u);
+  EXPECT_EQ(blue_.level(), 0u);
+
+  // Fades continue while masked, and are shown when unmasked.
+  compositor_.SetBase(0x00ff00, 2);
+  Tick(2);
+  EXPECT_EQ(green_.level(), 0u);
+  compositor_.SetMask(true);
+  ExpectLevels(0x00ff00, kBrightness);
+}
+
+TEST_F(LedCompositorTest, BrightnessFades) {
+  compositor_.SetBase(0xffffff, 0);
+  compositor_.SetBrightness(0x7f, 2);
+  Tick(1);
+  EXPECT_EQ(compositor_.brightness(), 0xbfu);
+  ExpectLevels(0xffffff, 0xbf);
+  Tick(1);
+  ExpectLevels(0xffffff, 0x7f);
+}
+
+TEST_F(LedCompositorTest, WritesOnlyOnChange) {
+  const size_t red_writes = red_.writes();
+  const size_t green_writes = green_.writes();
+  const size_t blue_writes = blue_.writes();
+  Tick(10);
+  EXPECT_EQ(red_.writes(), red_writes);
+
+  // Changing the color and brightness in the same frame writes each output at
+  // most once, and only the outputs whose levels changed.
+  compositor_.SetBase(0x0000ff, 1);
+  compositor_.SetBrightness(0x7f, 1);
+  Tick(1);
+  ExpectLevels(0x0000ff, 0x7f);
+  EXPECT_EQ(red_.writes(), red_writes);
+  EXPECT_EQ(green_.writes(), green_writes);
+  EXPECT_EQ(blue_.writes(), blue_writes + 1);
+
+  compositor_.SetMask(true);
+  EXPECT_EQ(blue_.writes(), blue_writes + 1);
+}
+
+TEST_F(LedCompositorTest, RendersFramesOnWorker) {
+  TestWorker<> worker;
+  pw::sync::ThreadNotification done;
+  worker.RunOnce([this, &worker, &done]() {
+    compositor_.Init(worker, wheel_);
+    compositor_.SetBase(0xff0000, 5);
+    done.release();
+  });
+  done.acquire();
+  pw::this_thread::sleep_for(LedCompositor::kFramePeriod * 5 + 100ms);
+
+  bool fading = true;
+  worker.RunOnce([this, &fading, &done]() {
+    fading = compositor_.fading();
+    done.release();
+  });
+  done.acquire();
+  worker.Stop();
+  EXPECT_FALSE(fading);
+  ExpectLevels(0xff0000, kBrightness);
+}
+
+}  // namespace
+}  // namespace sense
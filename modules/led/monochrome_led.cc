@@ -14,13 +14,33 @@
 
 #include "modules/led/monochrome_led.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
 #include "pw_assert/check.h"
 
 namespace sense {
+namespace {
+
+/// One cycle of levels for `Pulse`, kept in flash. Brightness fades up over
+/// the first half of the cycle and down over the second, and is squared to
+/// approximate gamma correction.
+constexpr auto kPulseLevels = [] {
+  std::array<uint16_t, 0x200> levels{};
+  for (size_t i = 0; i < levels.size(); ++i) {
+    size_t brightness = std::min<size_t>(i < 0x100 ? i : 0x200 - i, 0xff);
+    levels[i] = static_cast<uint16_t>(brightness * brightness);
+  }
+  return levels;
+}();
+
+}  // namespace
 
 MonochromeLed::MonochromeLed(pw::digital_io::DigitalInOut& sio,
-                             PwmDigitalOut& pwm)
-    : sio_(sio), pwm_(pwm) {}
+                             PwmDigitalOut& pwm,
+                             PwmAnimator& animator)
+    : sio_(sio), pwm_(pwm), animator_(animator) {}
 
 bool MonochromeLed::IsOn() {
   if (GetMode() != Mode::kSio) {
@@ -58,20 +78,7 @@ void MonochromeLed::Toggle() {
 
 void MonochromeLed::Pulse(uint32_t interval_ms) {
   SetMode(Mode::kPwm);
-  pwm_.SetCallback(
-      [this]() {
-        static uint16_t counter = 0;
-        uint16_t brightness = 0;
-        if (counter < 0x100) {
-          brightness = counter;
-        } else {
-          brightness = 0x200 - counter;
-        }
-        pwm_.SetLevel(brightness * brightness);
-        counter = (counter + 1) % 0x200;
-      },
-      0x200,
-      interval_ms);
+  PW_CHECK_OK(animator_.Play(pwm_, kPulseLevels, interval_ms));
 }
 
 void MonochromeLed::SetMode(Mode mode) {
@@ -15,6 +15,7 @@
 
 #include <cstdint>
 
+#include "modules/pwm/animator.h"
 #include "modules/pwm/digital_out.h"
 #include "pw_digital_io/digital_io.h"
 
@@ -26,7 +27,9 @@ class MonochromeLed {
   using Callback = void (*)();
   using State = ::pw::digital_io::State;
 
-  MonochromeLed(pw::digital_io::DigitalInOut& sio, PwmDigitalOut& pwm);
+  MonochromeLed(pw::digital_io::DigitalInOut& sio,
+                PwmDigitalOut& pwm,
+                PwmAnimator& animator);
   ~MonochromeLed() = default;
 
   /// Returns whether the LED is on.
@@ -50,7 +53,9 @@ class MonochromeLed {
 
   /// Fades the LED on and off continuously.
   ///
-  /// This method will automatically swith the LED to PWM mode.
+  /// This method will automatically swith the LED to PWM mode. The cycle is
+  /// played back by the animator until the LED's state or brightness is
+  /// changed.
   ///
   /// @param  interval_ms   The duration of a fade cycle, in milliseconds.
   void Pulse(uint32_t interval_ms);
@@ -68,6 +73,7 @@ class MonochromeLed {
   Mode mode_ = Mode::kPwm;
   pw::digital_io::DigitalInOut& sio_;
   PwmDigitalOut& pwm_;
+  PwmAnimator& animator_;
 };
 
 }  // namespace sense
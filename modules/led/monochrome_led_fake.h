@@ -13,7 +13,11 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "modules/led/monochrome_led.h"
+#include "modules/pwm/animator.h"
 #include "modules/pwm/digital_out_fake.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_digital_io/digital_io_mock.h"
@@ -24,6 +28,9 @@ class MonochromeLedFake : public MonochromeLed {
  public:
   static constexpr size_t kCapacity = 256;
 
+  /// Rate of the animator's ticks, which are only made by calling `Tick`.
+  static constexpr uint32_t kTickHz = 1000;
+
   using Clock = pw::digital_io::DigitalInOutMockImpl::Clock;
   using Event = pw::digital_io::DigitalInOutMockImpl::Event;
   using State = pw::digital_io::DigitalInOutMockImpl::State;
@@ -31,15 +38,25 @@ class MonochromeLedFake : public MonochromeLed {
   MonochromeLedFake() : MonochromeLedFake(Clock::RealClock()) {}
 
   explicit MonochromeLedFake(Clock& clock)
-      : MonochromeLed(led_sio_, led_pwm_), led_sio_(clock) {
+      : MonochromeLed(led_sio_, led_pwm_, animator_),
+        led_sio_(clock),
+        animator_(kTickHz) {
     TurnOff();
   }
 
   pw::InlineDeque<Event>& events() { return led_sio_.events(); }
 
+  /// Advances animations by the given number of ticks.
+  void Tick(size_t count = 1) {
+    for (size_t i = 0; i < count; ++i) {
+      animator_.Tick();
+    }
+  }
+
  private:
   pw::digital_io::DigitalInOutMock<kCapacity> led_sio_;
   PwmDigitalOutFake led_pwm_;
+  PwmAnimator animator_;
 };
 
 }  // namespace sense
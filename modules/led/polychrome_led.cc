@@ -17,10 +17,104 @@
 
 #include "modules/led/polychrome_led.h"
 
+#include <algorithm>
+
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
+#include "pw_span/span.h"
 
 namespace sense {
+namespace {
+
+/// sRGB gamma correction is given by g(x) = ((x/255)^2.2)*255, rounded down.
+// clang-format off
+constexpr std::array<uint8_t, 256> kGammaCorrection = {
+  0,   0,   0,   0,   0,   0,   0,   0,
+  0,   0,   0,   0,   0,   0,   0,   0,
+  0,   0,   0,   0,   0,   0,   1,   1,
+  1,   1,   1,   1,   1,   2,   2,   2,
+  2,   2,   2,   3,   3,   3,   3,   3,
+  4,   4,   4,   4,   5,   5,   5,   5,
+  6,   6,   6,   7,   7,   7,   8,   8,
+  8,   9,   9,   9,   10,  10,  11,  11,
+  11,  12,  12,  13,  13,  13,  14,  14,
+  15,  15,  16,  16,  17,  17,  18,  18,
+  19,  19,  20,  21,  21,  22,  22,  23,
+  23,  24,  25,  25,  26,  27,  27,  28,
+  29,  29,  30,  31,  31,  32,  33,  34,
+  34,  35,  36,  37,  37,  38,  39,  40,
+  40,  41,  42,  43,  44,  45,  46,  46,
+  47,  48,  49,  50,  51,  52,  53,  54,
+  55,  56,  57,  58,  59,  60,  61,  62,
+  63,  64,  65,  66,  67,  68,  69,  70,
+  71,  72,  73,  74,  76,  77,  78,  79,
+  80,  81,  83,  84,  85,  86,  88,  89,
+  90,  91,  93,  94,  95,  96,  98,  99,
+  100, 102, 103, 104, 106, 107, 109, 110,
+  111, 113, 114, 116, 117, 119, 120, 121,
+  123, 124, 126, 128, 129, 131, 132, 134,
+  135, 137, 138, 140, 142, 143, 145, 146,
+  148, 150, 151, 153, 155, 157, 158, 160,
+  162, 163, 165, 167, 169, 170, 172, 174,
+  176, 178, 179, 181, 183, 185, 187, 189,
+  191, 193, 194, 196, 198, 200, 202, 204,
+  206, 208, 210, 212, 214, 216, 218, 220,
+  222, 224, 227, 229, 231, 233, 235, 237,
+  239, 241, 244, 246, 248, 250, 252, 255,
+};
+// clang-format on
+
+/// Gamma corrects the bottom 8 bits of `value` and scales it by `brightness`.
+constexpr uint16_t GammaCorrectLevel(uint32_t value, uint8_t brightness) {
+  return static_cast<uint16_t>(kGammaCorrection[value % 256] * brightness);
+}
+
+/// Returns the brightness of a pulse at `frame`, fading up over the first half
+/// of the cycle and down over the second.
+constexpr uint8_t PulseBrightness(size_t frame) {
+  size_t half = PolychromeLed::kPulseFrames / 2;
+  return static_cast<uint8_t>(
+      std::min<size_t>(frame < half ? frame : 2 * half - frame, 0xff));
+}
+
+/// Returns the red component of a rainbow at `frame`. Green and blue follow
+/// the same curve, two thirds and one third of a cycle ahead, respectively.
+constexpr uint32_t RainbowRed(size_t frame) {
+  if (frame < 0x100) {
+    return 0xff;
+  }
+  if (frame < 0x200) {
+    return 0x1ff - frame;
+  }
+  if (frame < 0x400) {
+    return 0;
+  }
+  if (frame < 0x500) {
+    return frame - 0x400;
+  }
+  return 0xff;
+}
+
+/// One cycle of red levels for `Rainbow`, kept in flash.
+constexpr auto kRainbowLevels = [] {
+  std::array<uint16_t, PolychromeLed::kRainbowFrames> levels{};
+  for (size_t i = 0; i < levels.size(); ++i) {
+    levels[i] = GammaCorrectLevel(RainbowRed(i), 0xff);
+  }
+  return levels;
+}();
+
+/// Writes `level` to `output`, unless it was the last level written. Writing
+/// also stops any animation, so playing outputs are always written.
+void WriteLevel(PwmDigitalOut& output, uint16_t& written, uint16_t level) {
+  if (level == written && !output.is_playing()) {
+    return;
+  }
+  output.SetLevel(level);
+  written = level;
+}
+
+}  // namespace
 
 void PolychromeLed::Enable() {
   state_ = kOff;
@@ -36,6 +130,7 @@ void PolychromeLed::Disable() {
   red_.Disable();
   green_.Disable();
   blue_.Disable();
+  levels_.fill(kUnknownLevel);
 }
 
 void PolychromeLed::TurnOff() {
@@ -57,8 +152,7 @@ void PolychromeLed::TurnOn() {
 }
 
 void PolychromeLed::SetBrightness(uint8_t brightness) {
-  red_.ClearCallback();
-  if (brightness_ == brightness) {
+  if (brightness_ == brightness && !red_.is_playing()) {
     return;
   }
 
@@ -69,8 +163,7 @@ void PolychromeLed::SetBrightness(uint8_t brightness) {
 }
 
 void PolychromeLed::SetColor(uint32_t color_hex) {
-  red_.ClearCallback();
-  if (color_ == color_hex) {
+  if (color_ == color_hex && !red_.is_playing()) {
     return;
   }
 
@@ -80,107 +173,77 @@ void PolychromeLed::SetColor(uint32_t color_hex) {
   }
 }
 
+void PolychromeLed::SetColorAndBrightness(uint32_t color_hex,
+                                          uint8_t brightness) {
+  color_ = color_hex;
+  brightness_ = brightness;
+  if (state_ == kOn) {
+    Update();
+  }
+}
+
 void PolychromeLed::Pulse(uint32_t color_hex, uint32_t interval_ms) {
-  TurnOff();
-  brightness_ = 0;
+  PW_DCHECK_INT_NE(
+      state_, kDisabled, "Cannot pulse the LED until Enable() is called");
+
+  // Playback reads the levels in place, so stop it before rewriting them.
+  animator_.Stop(red_);
+  animator_.Stop(green_);
+  animator_.Stop(blue_);
+
   color_ = color_hex;
-  red_.SetCallback(
-      [this]() {
-        static uint16_t counter = 0;
-        if (counter < 0x100) {
-          brightness_ = counter;
-        } else {
-          brightness_ = 0x200 - counter;
-        }
-        Update();
-        counter = (counter + 1) % 0x200;
-      },
-      0x200,
-      interval_ms);
-  TurnOn();
+  pw::span<uint16_t> levels(pulse_levels_);
+  pw::span<uint16_t> red = levels.subspan(0, kPulseFrames);
+  pw::span<uint16_t> green = levels.subspan(kPulseFrames, kPulseFrames);
+  pw::span<uint16_t> blue = levels.subspan(kPulseFrames * 2, kPulseFrames);
+  for (size_t i = 0; i < kPulseFrames; ++i) {
+    uint8_t brightness = PulseBrightness(i);
+    red[i] = GammaCorrectLevel(color_ >> kRedShift, brightness);
+    green[i] = GammaCorrectLevel(color_ >> kGreenShift, brightness);
+    blue[i] = GammaCorrectLevel(color_ >> kBlueShift, brightness);
+  }
+
+  state_ = kOn;
+  levels_.fill(kUnknownLevel);
+  PW_CHECK_OK(animator_.Play(red_, red, interval_ms));
+  PW_CHECK_OK(animator_.Play(green_, green, interval_ms));
+  PW_CHECK_OK(animator_.Play(blue_, blue, interval_ms));
 }
 
 void PolychromeLed::Rainbow(uint32_t interval_ms) {
-  TurnOff();
+  PW_DCHECK_INT_NE(
+      state_, kDisabled, "Cannot cycle the LED until Enable() is called");
   brightness_ = 0xff;
   color_ = 0xff0000;
-  red_.SetCallback(
-      [this]() {
-        static uint16_t counter = 0;
-        if (counter < 0x100) {
-          color_ = 0xff0000 + (counter << 8);
-        } else if (counter < 0x200) {
-          color_ = 0xffff00 - ((counter - 0x100) << 16);
-        } else if (counter < 0x300) {
-          color_ = 0x00ff00 + (counter - 0x200);
-        } else if (counter < 0x400) {
-          color_ = 0x00ffff - ((counter - 0x300) << 8);
-        } else if (counter < 0x500) {
-          color_ = 0x0000ff + ((counter - 0x400) << 16);
-        } else {
-          color_ = 0xff00ff - (counter - 0x500);
-        }
-        Update();
-        counter = (counter + 1) % 0x600;
-      },
-      0x600,
-      interval_ms);
-  TurnOn();
+  state_ = kOn;
+  levels_.fill(kUnknownLevel);
+  constexpr uint16_t kGreenPhase = kRainbowFrames * 2 / 3;
+  constexpr uint16_t kBluePhase = kRainbowFrames / 3;
+  PW_CHECK_OK(animator_.Play(red_, kRainbowLevels, interval_ms));
+  PW_CHECK_OK(animator_.Play(green_, kRainbowLevels, interval_ms, kGreenPhase));
+  PW_CHECK_OK(animator_.Play(blue_, kRainbowLevels, interval_ms, kBluePhase));
 }
 
 void PolychromeLed::Update() {
   PW_LOG_DEBUG("LED update: rgb=%06x brightness=%hu", color_, brightness_);
-  red_.SetLevel(GammaCorrect(color_ >> kRedShift));
-  green_.SetLevel(GammaCorrect(color_ >> kGreenShift));
-  blue_.SetLevel(GammaCorrect(color_ >> kBlueShift));
+  SetLevels(GammaCorrect(color_ >> kRedShift),
+            GammaCorrect(color_ >> kGreenShift),
+            GammaCorrect(color_ >> kBlueShift));
 }
 
 void PolychromeLed::UpdateZeroBrightness() {
   PW_LOG_DEBUG("LED update: rgb=%06x brightness=0", color_);
-  red_.SetLevel(0);
-  green_.SetLevel(0);
-  blue_.SetLevel(0);
+  SetLevels(0, 0, 0);
+}
+
+void PolychromeLed::SetLevels(uint16_t red, uint16_t green, uint16_t blue) {
+  WriteLevel(red_, levels_[0], red);
+  WriteLevel(green_, levels_[1], green);
+  WriteLevel(blue_, levels_[2], blue);
 }
 
 uint16_t PolychromeLed::GammaCorrect(uint32_t val) const {
-  /// sRGB gamma correction is given by g(x) = ((x/255)^2.2)*255, rounded down.
-  // clang-format off
-  static constexpr std::array<uint8_t, 256> kGammaCorrection = {
-    0,   0,   0,   0,   0,   0,   0,   0,
-    0,   0,   0,   0,   0,   0,   0,   0,
-    0,   0,   0,   0,   0,   0,   1,   1,
-    1,   1,   1,   1,   1,   2,   2,   2,
-    2,   2,   2,   3,   3,   3,   3,   3,
-    4,   4,   4,   4,   5,   5,   5,   5,
-    6,   6,   6,   7,   7,   7,   8,   8,
-    8,   9,   9,   9,   10,  10,  11,  11,
-    11,  12,  12,  13,  13,  13,  14,  14,
-    15,  15,  16,  16,  17,  17,  18,  18,
-    19,  19,  20,  21,  21,  22,  22,  23,
-    23,  24,  25,  25,  26,  27,  27,  28,
-    29,  29,  30,  31,  31,  32,  33,  34,
-    34,  35,  36,  37,  37,  38,  39,  40,
-    40,  41,  42,  43,  44,  45,  46,  46,
-    47,  48,  49,  50,  51,  52,  53,  54,
-    55,  56,  57,  58,  59,  60,  61,  62,
-    63,  64,  65,  66,  67,  68,  69,  70,
-    71,  72,  73,  74,  76,  77,  78,  79,
-    80,  81,  83,  84,  85,  86,  88,  89,
-    90,  91,  93,  94,  95,  96,  98,  99,
-    100, 102, 103, 104, 106, 107, 109, 110,
-    111, 113, 114, 116, 117, 119, 120, 121,
-    123, 124, 126, 128, 129, 131, 132, 134,
-    135, 137, 138, 140, 142, 143, 145, 146,
-    148, 150, 151, 153, 155, 157, 158, 160,
-    162, 163, 165, 167, 169, 170, 172, 174,
-    176, 178, 179, 181, 183, 185, 187, 189,
-    191, 193, 194, 196, 198, 200, 202, 204,
-    206, 208, 210, 212, 214, 216, 218, 220,
-    222, 224, 227, 229, 231, 233, 235, 237,
-    239, 241, 244, 246, 248, 250, 252, 255,
-  };
-  // clang-format on
-  return static_cast<uint16_t>(kGammaCorrection[val % 256]) * brightness_;
+  return GammaCorrectLevel(val, brightness_);
 }
 
 }  // namespace sense
@@ -13,8 +13,11 @@
 // the License.
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
+#include "modules/pwm/animator.h"
 #include "modules/pwm/digital_out.h"
 
 namespace sense {
@@ -28,6 +31,12 @@ class PolychromeLed {
   static constexpr uint32_t kGreenShift = 8;
   static constexpr uint32_t kBlueShift = 0;
 
+  /// Number of levels in one cycle of `Pulse`.
+  static constexpr size_t kPulseFrames = 0x200;
+
+  /// Number of levels in one cycle of `Rainbow`.
+  static constexpr size_t kRainbowFrames = 0x600;
+
   /// Converts separate RGB values to a `uint32_t` ("hex") value.
   static constexpr uint32_t ColorToHex(uint8_t red,
                                        uint8_t green,
@@ -36,8 +45,11 @@ class PolychromeLed {
            uint32_t{blue} << kBlueShift;
   }
 
-  PolychromeLed(PwmDigitalOut& red, PwmDigitalOut& green, PwmDigitalOut& blue)
-      : red_(red), green_(green), blue_(blue) {}
+  PolychromeLed(PwmDigitalOut& red,
+                PwmDigitalOut& green,
+                PwmDigitalOut& blue,
+                PwmAnimator& animator)
+      : red_(red), green_(green), blue_(blue), animator_(animator) {}
 
   ~PolychromeLed() = default;
 
@@ -73,18 +85,34 @@ class PolychromeLed {
   /// Sets the RGB LED using a 24-bit hex color code.
   void SetColor(uint32_t color_hex);
 
+  /// Sets the color and brightness together, so that each output is written
+  /// at most once.
+  void SetColorAndBrightness(uint32_t color_hex, uint8_t brightness);
+
   /// Fades the LED on and off continuously.
   ///
+  /// The cycle is computed once and played back by the animator. It stops when
+  /// the LED is turned off or its color or brightness is changed.
+  ///
   /// @param interval_ms The duration of a fade cycle, in milliseconds.
   void Pulse(uint32_t color_hex, uint32_t interval_ms);
 
   /// Cycles thorugh all the colors.
+  ///
+  /// Like `Pulse`, the cycle is played back by the animator.
   void Rainbow(uint32_t interval_ms);
 
  private:
+  /// Marks levels that may have been changed by something other than
+  /// `SetLevels`, e.g. an animation.
+  static constexpr uint16_t kUnknownLevel = 0xffff;
+
   /// Sets the levels of the red, green, and blue PWM slices.
   void Update();
 
+  /// Writes each level that differs from the one last written to its output.
+  void SetLevels(uint16_t red, uint16_t green, uint16_t blue);
+
   /// Sets the levels of the PWM slices to 0, preserving the prior brightness_.
   void UpdateZeroBrightness();
 
@@ -95,6 +123,16 @@ class PolychromeLed {
   PwmDigitalOut& red_;
   PwmDigitalOut& green_;
   PwmDigitalOut& blue_;
+  PwmAnimator& animator_;
+
+  /// Red, green, and blue levels for `Pulse`, one cycle after another.
+  std::array<uint16_t, kPulseFrames * 3> pulse_levels_{};
+
+  /// Red, green, and blue levels last written by `SetLevels`. Gamma corrected
+  /// levels never reach `kUnknownLevel`.
+  std::array<uint16_t, 3> levels_ = {
+      kUnknownLevel, kUnknownLevel, kUnknownLevel};
+
   uint32_t color_ = 0;
   uint8_t brightness_ = 0;
   enum : uint8_t { kDisabled, kOff, kOn } state_ = kDisabled;
@@ -32,6 +32,12 @@ void PolychromeLedFake::Await() {
   blue_.Await();
 }
 
+void PolychromeLedFake::Tick(size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    animator_.Tick();
+  }
+}
+
 bool PolychromeLedFake::TryAwait() {
   return red_.TryAwait() && green_.TryAwait() && blue_.TryAwait();
 }
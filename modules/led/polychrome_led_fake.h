@@ -13,7 +13,11 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "modules/led/polychrome_led.h"
+#include "modules/pwm/animator.h"
 #include "modules/pwm/digital_out_fake.h"
 #include "pw_chrono/system_clock.h"
 
@@ -22,7 +26,14 @@ namespace sense {
 /// Interface for a simple LED.
 class PolychromeLedFake : public PolychromeLed {
  public:
-  PolychromeLedFake() : PolychromeLed(red_, green_, blue_) {}
+  /// Rate of the animator's ticks, which are only made by calling `Tick`.
+  static constexpr uint32_t kTickHz = 1000;
+
+  PolychromeLedFake()
+      : PolychromeLed(red_, green_, blue_, animator_), animator_(kTickHz) {}
+
+  /// Advances animations by the given number of ticks.
+  void Tick(size_t count = 1);
 
   uint16_t red() const { return red_.level(); }
   uint16_t green() const { return green_.level(); }
@@ -52,6 +63,7 @@ class PolychromeLedFake : public PolychromeLed {
   PwmDigitalOutFake red_;
   PwmDigitalOutFake green_;
   PwmDigitalOutFake blue_;
+  PwmAnimator animator_;
 };
 
 // Template method implementations.
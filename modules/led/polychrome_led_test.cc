@@ -0,0 +1,181 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/led/polychrome_led.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/pwm/animator.h"
+#include "modules/pwm/digital_out_fake.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+// Tick at a rate that makes each tick advance each animation by one frame.
+constexpr uint32_t kTickHz = 1024;
+constexpr uint32_t kPulseIntervalMs = 500;
+constexpr uint32_t kRainbowIntervalMs = 1500;
+constexpr size_t kChunk = PwmDigitalOutFake::kMaxFrames;
+
+/// Returns the color of a rainbow at `counter`, as previously computed from the
+/// PWM interrupt handler on every frame.
+uint32_t RainbowColor(uint32_t counter) {
+  if (counter < 0x100) {
+    return 0xff0000 + (counter << 8);
+  }
+  if (counter < 0x200) {
+    return 0xffff00 - ((counter - 0x100) << 16);
+  }
+  if (counter < 0x300) {
+    return 0x00ff00 + (counter - 0x200);
+  }
+  if (counter < 0x400) {
+    return 0x00ffff - ((counter - 0x300) << 8);
+  }
+  if (counter < 0x500) {
+    return 0x0000ff + ((counter - 0x400) << 16);
+  }
+  return 0xff00ff - (counter - 0x500);
+}
+
+// Test fixtures.
+
+class PolychromeLedTest : public ::testing::Test {
+ protected:
+  PolychromeLedTest()
+      : animator_(kTickHz),
+        led_(red_, green_, blue_, animator_),
+        reference_(ref_red_, ref_green_, ref_blue_, animator_) {
+    led_.Enable();
+    reference_.Enable();
+    reference_.TurnOn();
+  }
+
+  /// Discards recorded frames, then ticks `count` times.
+  void Tick(size_t count) {
+    red_.frames().clear();
+    green_.frames().clear();
+    blue_.frames().clear();
+    for (size_t i = 0; i < count; ++i) {
+      animator_.Tick();
+    }
+  }
+
+  /// Sets the reference LED directly, and checks that the `index`th recorded
+  /// frame of each output matches it.
+  void ExpectFrame(size_t index, uint32_t color, uint8_t brightness) {
+    reference_.SetColor(color);
+    reference_.SetBrightness(brightness);
+    EXPECT_EQ(red_.frames()[index], ref_red_.level());
+    EXPECT_EQ(green_.frames()[index], ref_green_.level());
+    EXPECT_EQ(blue_.frames()[index], ref_blue_.level());
+  }
+
+  /// Sets the reference LED directly, and checks that each output's current
+  /// level matches it.
+  void ExpectLevels(uint32_t color, uint8_t brightness) {
+    reference_.SetColor(color);
+    reference_.SetBrightness(brightness);
+    EXPECT_EQ(red_.level(), ref_red_.level());
+    EXPECT_EQ(green_.level(), ref_green_.level());
+    EXPECT_EQ(blue_.level(), ref_blue_.level());
+  }
+
+  PwmDigitalOutFake red_;
+  PwmDigitalOutFake green_;
+  PwmDigitalOutFake blue_;
+  PwmAnimator animator_;
+  PolychromeLed led_;
+
+  PwmDigitalOutFake ref_red_;
+  PwmDigitalOutFake ref_green_;
+  PwmDigitalOutFake ref_blue_;
+  PolychromeLed reference_;
+};
+
+// Unit tests.
+
+TEST_F(PolychromeLedTest, PulsePlaysOneCycle) {
+  constexpr uint32_t kColor = 0x00ff80;
+  constexpr size_t kFrames = PolychromeLed::kPulseFrames;
+  led_.Pulse(kColor, kPulseIntervalMs);
+  ASSERT_TRUE(red_.is_playing());
+  ASSERT_TRUE(green_.is_playing());
+  ASSERT_TRUE(blue_.is_playing());
+  ExpectFrame(0, kColor, 0);
+
+  for (size_t start = 1; start <= kFrames; start += kChunk) {
+    Tick(kChunk);
+    for (size_t i = 0; i < kChunk; ++i) {
+      size_t frame = (start + i) % kFrames;
+      size_t brightness = frame < 0x100 ? frame : 0x200 - frame;
+      brightness = std::min<size_t>(brightness, 0xff);
+      ExpectFrame(i, kColor, static_cast<uint8_t>(brightness));
+    }
+  }
+}
+
+TEST_F(PolychromeLedTest, RainbowMatchesColorCycle) {
+  constexpr size_t kFrames = PolychromeLed::kRainbowFrames;
+  led_.Rainbow(kRainbowIntervalMs);
+  ASSERT_TRUE(red_.is_playing());
+  ExpectFrame(0, RainbowColor(0), 0xff);
+
+  for (size_t start = 1; start <= kFrames; start += kChunk) {
+    Tick(kChunk);
+    for (size_t i = 0; i < kChunk; ++i) {
+      auto frame = static_cast<uint32_t>((start + i) % kFrames);
+      ExpectFrame(i, RainbowColor(frame), 0xff);
+    }
+  }
+}
+
+TEST_F(PolychromeLedTest, SetColorStopsAnimation) {
+  led_.Rainbow(kRainbowIntervalMs);
+  Tick(10);
+  led_.SetColor(0x102030);
+  EXPECT_FALSE(red_.is_playing());
+  EXPECT_FALSE(green_.is_playing());
+  EXPECT_FALSE(blue_.is_playing());
+
+  // No more frames are emitted.
+  Tick(10);
+  EXPECT_TRUE(red_.frames().empty());
+  ExpectLevels(0x102030, 0xff);
+}
+
+TEST_F(PolychromeLedTest, SetSameColorStopsAnimation) {
+  led_.Rainbow(kRainbowIntervalMs);
+  led_.SetColor(0xff0000);
+  EXPECT_FALSE(red_.is_playing());
+  ExpectLevels(0xff0000, 0xff);
+}
+
+TEST_F(PolychromeLedTest, TurnOffStopsAnimation) {
+  led_.Pulse(0xffffff, kPulseIntervalMs);
+  Tick(0xff);
+  EXPECT_NE(red_.level(), 0u);
+
+  led_.TurnOff();
+  EXPECT_FALSE(red_.is_playing());
+  EXPECT_EQ(red_.level(), 0u);
+  EXPECT_EQ(green_.level(), 0u);
+  EXPECT_EQ(blue_.level(), 0u);
+}
+
+}  // namespace
+}  // namespace sense
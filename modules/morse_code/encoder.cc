@@ -19,11 +19,87 @@
 
 #include <cctype>
 #include <mutex>
+#include <utility>
 
+#include "pw_assert/assert.h"
 #include "pw_function/function.h"
 #include "pw_log/log.h"
+#include "pw_tokenizer/tokenize.h"
+#include "pw_trace/trace.h"
 
 namespace sense {
+namespace {
+
+void TraceToggle(bool on) {
+  if (on) {
+    PW_TRACE_INSTANT("LED on", "Morse");
+  } else {
+    PW_TRACE_INSTANT("LED off", "Morse");
+  }
+}
+
+}  // namespace
+
+pw::Status MorseTimeline::Compile(std::string_view msg) {
+  size_ = 0;
+  bool needs_word_break = false;
+  for (char c : msg) {
+    if (c == '\0') {
+      break;
+    }
+    if (isspace(c)) {
+      needs_word_break = true;
+      continue;
+    }
+    if (needs_word_break) {
+      // Words are separated by 7 dits worth of blanks.
+      // The previous symbol ended with 3 blanks, so add 4 more.
+      if (!Append(false, 4)) {
+        return pw::Status::ResourceExhausted();
+      }
+      needs_word_break = false;
+    }
+    auto it = internal::kEncodings.find(toupper(c));
+    if (it == internal::kEncodings.end()) {
+      it = internal::kEncodings.find('?');
+    }
+    const internal::Encoding& encoding = it->second;
+    for (uint8_t i = 0; i < encoding.num_bits; ++i) {
+      if (!Append(((encoding.bits >> i) & 1) != 0, 1)) {
+        return pw::Status::ResourceExhausted();
+      }
+    }
+  }
+  return pw::OkStatus();
+}
+
+uint8_t MorseTimeline::operator[](size_t index) const {
+  auto packed = static_cast<uint8_t>(buffer_[index / 2]);
+  return index % 2 == 0 ? (packed & 0x0F) : (packed >> 4);
+}
+
+bool MorseTimeline::Append(bool on, uint8_t dits) {
+  // Runs alternate between OFF and ON, starting with OFF.
+  bool last_on = size_ % 2 == 0;
+  size_t index = size_;
+  if (size_ != 0 && last_on == on) {
+    index = size_ - 1;
+    dits += (*this)[index];
+  } else if (index / 2 >= buffer_.size()) {
+    return false;
+  } else {
+    ++size_;
+  }
+  PW_DASSERT(dits <= 0x0F);
+  auto packed = static_cast<uint8_t>(buffer_[index / 2]);
+  if (index % 2 == 0) {
+    packed = (packed & 0xF0) | dits;
+  } else {
+    packed = static_cast<uint8_t>((packed & 0x0F) | (dits << 4));
+  }
+  buffer_[index / 2] = static_cast<std::byte>(packed);
+  return true;
+}
 
 Encoder::Encoder() : timer_(pw::bind_member<&Encoder::ToggleLed>(this)) {}
 
@@ -34,6 +110,14 @@ void Encoder::Init(Worker& worker, OutputFunction&& output) {
   output_ = std::move(output);
 }
 
+void Encoder::UseTimeline(pw::ByteSpan buffer) {
+  const size_t half = buffer.size() / 2;
+  std::lock_guard compile_lock(compile_lock_);
+  spare_timeline_.emplace(buffer.first(half));
+  std::lock_guard lock(lock_);
+  timeline_.emplace(buffer.subspan(half, half));
+}
+
 pw::Status Encoder::Encode(std::string_view msg,
                            uint32_t repeat,
                            uint32_t interval_ms) {
@@ -49,6 +133,14 @@ pw::Status Encoder::Encode(std::string_view msg,
           std::chrono::milliseconds(interval_ms));
 
   timer_.Cancel();
+  std::lock_guard compile_lock(compile_lock_);
+  bool compiled = false;
+  if (spare_timeline_.has_value()) {
+    compiled = spare_timeline_->Compile(msg).ok();
+    if (!compiled) {
+      PW_LOG_WARN("Message does not fit in timeline; using worker");
+    }
+  }
   {
     std::lock_guard lock(lock_);
     is_on_ = false;
@@ -56,9 +148,30 @@ pw::Status Encoder::Encode(std::string_view msg,
     state_.msg_offset_ = 0;
     state_.repeat_ = repeat;
     interval_ = interval;
+    state_.last_run_ = false;
+    playing_timeline_ = compiled;
+    if (compiled) {
+      std::swap(timeline_, spare_timeline_);
+    }
     output_(false, state_);
+
+    if (playing_timeline_) {
+      state_.msg_offset_ = state_.msg_.size();
+      state_.bits_ = 0;
+      state_.num_bits_ = 0;
+      state_.run_ = 0;
+      if (timeline_->empty()) {
+        state_.repeat_ = 0;
+        playing_timeline_ = false;
+        return pw::OkStatus();
+      }
+      deadline_ = pw::chrono::SystemClock::now() + interval_ * (*timeline_)[0];
+      timer_.InvokeAt(deadline_);
+      return pw::OkStatus();
+    }
   }
-  worker_->RunOnce([this]() { ScheduleUpdate(); });
+  worker_->RunOnceLabeled(PW_TOKENIZE_STRING("morse encoder update"),
+                          [this]() { ScheduleUpdate(); });
   return pw::OkStatus();
 }
 
@@ -132,13 +245,58 @@ bool Encoder::EnqueueNextLocked() {
   return state_.num_bits_ != 0;
 }
 
-void Encoder::ToggleLed(pw::chrono::SystemClock::time_point) {
+void Encoder::ToggleLed(pw::chrono::SystemClock::time_point now) {
+  pw::chrono::SystemClock::time_point deadline;
   {
     std::lock_guard lock(lock_);
+    if (playing_timeline_) {
+      PlayTimelineLocked();
+      return;
+    }
     is_on_ = !is_on_;
+    TraceToggle(is_on_);
     output_(is_on_, state_);
+
+    // The next edge is at least one interval away, and the update has to set
+    // the timer before then, so it is due well within that.
+    deadline = now + interval_ / 2;
+  }
+  const pw::Status status =
+      worker_->RunOnceBefore(deadline,
+                             PW_TOKENIZE_STRING("morse encoder update"),
+                             [this]() { ScheduleUpdate(); });
+  if (!status.ok()) {
+    PW_LOG_ERROR("Unable to schedule morse encoder update: %s", status.str());
+  }
+}
+
+void Encoder::PlayTimelineLocked() {
+  const MorseTimeline& timeline = *timeline_;
+  size_t last = timeline.size() - 1;
+
+  ++state_.run_;
+  is_on_ = !is_on_;
+  TraceToggle(is_on_);
+  state_.last_run_ = state_.run_ == last;
+  output_(is_on_, state_);
+
+  uint32_t dits;
+  if (state_.run_ != last) {
+    dits = timeline[state_.run_];
+  } else if (state_.repeat_ > 1) {
+    --state_.repeat_;
+    dits = timeline[last] + MorseTimeline::kRepeatGap;
+    state_.run_ = 0;
+  } else {
+    state_.repeat_ = 0;
+    playing_timeline_ = false;
+    return;
   }
-  worker_->RunOnce([this]() { ScheduleUpdate(); });
+
+  // Schedule relative to the previous deadline, so that late callbacks do not
+  // accumulate into drift.
+  deadline_ += interval_ * dits;
+  timer_.InvokeAt(deadline_);
 }
 
 }  // namespace sense
@@ -15,17 +15,20 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <string_view>
 
 #include "modules/morse_code/morse_code.rpc.pb.h"
 #include "modules/worker/worker.h"
 #include "pw_chrono/system_clock.h"
+#include "pw_bytes/span.h"
 #include "pw_chrono/system_timer.h"
 #include "pw_containers/flat_map.h"
 #include "pw_status/status.h"
 #include "pw_string/string.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
 
 namespace sense {
 namespace internal {
@@ -81,6 +84,54 @@ constexpr pw::containers::FlatMap<char, Encoding, 38> kEncodings({{
 
 }  // namespace internal
 
+/// Run-length encoding of the LED toggles that emit a message in Morse code.
+///
+/// A timeline is a sequence of alternating OFF and ON runs, starting with an
+/// OFF run and ending with the OFF run that follows the last symbol. Each run
+/// is measured in "dits" and stored in 4 bits of a caller-provided buffer.
+class MorseTimeline {
+ public:
+  /// Runs needed per character, for the longest encoding ("?" and "@").
+  static constexpr size_t kMaxRunsPerChar = 12;
+
+  /// OFF time added between repetitions of a message. Together with the OFF
+  /// run that ends the message, this makes a word break.
+  static constexpr uint8_t kRepeatGap = 6;
+
+  /// Returns the buffer size needed for a message of `msg_len` characters.
+  static constexpr size_t BufferSizeFor(size_t msg_len) {
+    return (1 + msg_len * kMaxRunsPerChar + 1) / 2;
+  }
+
+  explicit MorseTimeline(pw::ByteSpan buffer) : buffer_(buffer) {}
+
+  /// Compiles a message into runs, replacing any previous contents.
+  ///
+  /// Characters are handled as by `Encoder::Encode`: whitespace is merged
+  /// into word breaks, a null character ends the message, and characters
+  /// without an encoding are emitted as "?".
+  ///
+  /// @returns  RESOURCE_EXHAUSTED if the buffer is too small.
+  pw::Status Compile(std::string_view msg);
+
+  /// Returns the number of runs.
+  size_t size() const { return size_; }
+
+  /// Returns whether the timeline has no ON runs.
+  bool empty() const { return size_ < 3; }
+
+  /// Returns the length of a run, in dits. Even runs are OFF, odd runs ON.
+  uint8_t operator[](size_t index) const;
+
+ private:
+  /// Appends `dits` to the timeline in the given state, extending the last
+  /// run if it is in the same state.
+  bool Append(bool on, uint8_t dits);
+
+  pw::ByteSpan buffer_;
+  size_t size_ = 0;
+};
+
 class Encoder final {
  public:
   static constexpr size_t kMaxMsgLen = sizeof(morse_code_SendRequest::msg);
@@ -88,6 +139,8 @@ class Encoder final {
   static constexpr pw::chrono::SystemClock::duration kDefaultInterval =
       pw::chrono::SystemClock::for_at_least(
           std::chrono::milliseconds(kDefaultIntervalMs));
+  static constexpr size_t kTimelineBufferSize =
+      2 * MorseTimeline::BufferSizeFor(kMaxMsgLen);
 
   /// State of the encoder. Passed to each `OutputFunction` call.
   class State {
@@ -99,7 +152,7 @@ class Encoder final {
     /// encoder is repeating, this is true at the end of each repeated
     /// message.
     [[nodiscard]] bool message_finished() const {
-      return msg_offset_ == msg_.size() && num_bits_ == 1;
+      return last_run_ || (msg_offset_ == msg_.size() && num_bits_ == 1);
     };
 
    private:
@@ -112,6 +165,10 @@ class Encoder final {
     size_t repeat_ = 1;
     uint32_t bits_ = 0;
     size_t num_bits_ = 0;
+
+    // Used when playing back a timeline.
+    size_t run_ = 0;
+    bool last_run_ = false;
   };
 
   using OutputFunction = pw::Function<void(bool turn_on, const State& status)>;
@@ -125,6 +182,22 @@ class Encoder final {
   /// This method MUST be called before using any other method.
   void Init(Worker& worker, OutputFunction&& output);
 
+  /// Compiles messages into a `MorseTimeline` in the given buffer, and plays
+  /// them back directly from the timer callback.
+  ///
+  /// Without a timeline, the encoder returns to the worker after every LED
+  /// toggle to compute the next one. With a timeline, the worker is not used,
+  /// and each toggle is scheduled relative to the previous deadline rather
+  /// than to when the worker ran.
+  ///
+  /// The buffer is split into two timelines. A message is compiled into the
+  /// one that is not playing, without holding the lock that the timer callback
+  /// takes, and then swapped in. Messages that do not fit in half the buffer
+  /// are played back using the worker. A buffer of `kTimelineBufferSize` bytes
+  /// fits any message.
+  void UseTimeline(pw::ByteSpan buffer)
+      PW_LOCKS_EXCLUDED(compile_lock_, lock_);
+
   /// Queues a sequence of callbacks to emit the given message in Morse code.
   ///
   /// The message is emitted through alternating ON and OFF (true/false) calls
@@ -139,7 +212,8 @@ class Encoder final {
   /// @param  interval_ms   Duration of a "dit" in milliseconds.
   pw::Status Encode(std::string_view request,
                     uint32_t repeat,
-                    uint32_t interval_ms) PW_LOCKS_EXCLUDED(lock_);
+                    uint32_t interval_ms)
+      PW_LOCKS_EXCLUDED(compile_lock_, lock_);
 
   /// Returns whether this instance is currently emitting a message or not.
   bool IsIdle() const PW_LOCKS_EXCLUDED(lock_);
@@ -154,7 +228,10 @@ class Encoder final {
   bool EnqueueNextLocked() PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
   /// Callback for toggling the LED.
-  void ToggleLed(pw::chrono::SystemClock::time_point);
+  void ToggleLed(pw::chrono::SystemClock::time_point now);
+
+  /// Toggles the LED and schedules the next toggle from the timeline.
+  void PlayTimelineLocked() PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
   /// Emits an "off" to all configured outputs.
   void TurnOff();
@@ -163,9 +240,16 @@ class Encoder final {
   pw::chrono::SystemTimer timer_;
   OutputFunction output_;
 
+  // Serializes messages, and guards the timeline they are compiled into.
+  pw::sync::Mutex compile_lock_ PW_ACQUIRED_BEFORE(lock_);
+  std::optional<MorseTimeline> spare_timeline_ PW_GUARDED_BY(compile_lock_);
+
   mutable pw::sync::InterruptSpinLock lock_;
 
   State state_ PW_GUARDED_BY(lock_);
+  std::optional<MorseTimeline> timeline_ PW_GUARDED_BY(lock_);
+  bool playing_timeline_ PW_GUARDED_BY(lock_) = false;
+  pw::chrono::SystemClock::time_point deadline_ PW_GUARDED_BY(lock_);
   pw::chrono::SystemClock::duration interval_ PW_GUARDED_BY(lock_) =
       kDefaultInterval;
   bool is_on_ PW_GUARDED_BY(lock_) = false;
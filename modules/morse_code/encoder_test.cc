@@ -14,13 +14,18 @@
 
 #include "modules/morse_code/encoder.h"
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
 
 #include "modules/led/monochrome_led_fake.h"
 #include "modules/worker/test_worker.h"
 #include "pw_containers/vector.h"
 #include "pw_status/status.h"
+#include "pw_string/string.h"
 #include "pw_sync/timed_thread_notification.h"
 #include "pw_thread/sleep.h"
 #include "pw_thread/thread.h"
@@ -30,6 +35,33 @@ namespace sense {
 
 // Test fixtures.
 
+/// Worker that counts how many times it is asked to run work.
+class CountingWorker : public Worker {
+ public:
+  explicit CountingWorker(Worker& worker) : worker_(worker) {}
+
+  void RunOnce(pw::Function<void()>&& work) override {
+    ++count_;
+    worker_.RunOnce(std::move(work));
+  }
+
+  size_t count() const { return count_.load(); }
+
+ private:
+  Worker& worker_;
+  std::atomic<size_t> count_ = 0;
+};
+
+/// Returns the runs of a timeline as a string of digits.
+template <size_t kSize>
+pw::InlineString<kSize> Runs(const MorseTimeline& timeline) {
+  pw::InlineString<kSize> runs;
+  for (size_t i = 0; i < timeline.size() && i < kSize; ++i) {
+    runs.push_back(static_cast<char>('0' + timeline[i]));
+  }
+  return runs;
+}
+
 class MorseCodeEncoderTest : public ::testing::Test {
  protected:
   using Event = ::sense::MonochromeLedFake::Event;
@@ -166,6 +198,41 @@ class MorseCodeEncoderTest : public ::testing::Test {
 
 // Unit tests.
 
+TEST(MorseTimelineTest, CompileLetters) {
+  std::array<std::byte, 8> buffer;
+  MorseTimeline timeline(buffer);
+  ASSERT_EQ(timeline.Compile("ET"), pw::OkStatus());
+  auto runs = Runs<16>(timeline);
+  EXPECT_EQ(std::string_view(runs), "21331");
+}
+
+TEST(MorseTimelineTest, CompileWordBreak) {
+  std::array<std::byte, 8> buffer;
+  MorseTimeline timeline(buffer);
+  ASSERT_EQ(timeline.Compile("e  \te"), pw::OkStatus());
+  auto runs = Runs<16>(timeline);
+  EXPECT_EQ(std::string_view(runs), "21711");
+}
+
+TEST(MorseTimelineTest, CompileEmpty) {
+  std::array<std::byte, 8> buffer;
+  MorseTimeline timeline(buffer);
+  ASSERT_EQ(timeline.Compile("   "), pw::OkStatus());
+  EXPECT_TRUE(timeline.empty());
+}
+
+TEST(MorseTimelineTest, CompileTooLong) {
+  std::array<std::byte, 2> buffer;
+  MorseTimeline timeline(buffer);
+  EXPECT_EQ(timeline.Compile("SOS"), pw::Status::ResourceExhausted());
+}
+
+TEST(MorseTimelineTest, BufferSizeForLongestMessage) {
+  std::array<std::byte, MorseTimeline::BufferSizeFor(4)> buffer;
+  MorseTimeline timeline(buffer);
+  EXPECT_EQ(timeline.Compile("?@?@"), pw::OkStatus());
+}
+
 TEST_F(MorseCodeEncoderTest, EncodeEmpty) {
   TestWorker<> worker;
   encoder_.Init(worker, LedOutput());
@@ -204,6 +271,73 @@ TEST_F(MorseCodeEncoderTest, EncodeHelloWorld) {
   Expect(".... . .-.. .-.. ---  .-- --- .-. .-.. -..");
 }
 
+TEST_F(MorseCodeEncoderTest, TimelineEncodeOneWord) {
+  TestWorker<> test_worker;
+  CountingWorker worker(test_worker);
+  std::array<std::byte, Encoder::kTimelineBufferSize> timeline;
+  encoder_.Init(worker, LedOutput());
+  encoder_.UseTimeline(timeline);
+  EXPECT_EQ(encoder_.Encode("PARIS", 1, interval_ms_), pw::OkStatus());
+  SleepUntilDone();
+  test_worker.Stop();
+  Expect(".--. .- .-. .. ...");
+  EXPECT_EQ(worker.count(), 0u);
+}
+
+TEST_F(MorseCodeEncoderTest, TimelineEncodeHelloWorld) {
+  TestWorker<> worker;
+  std::array<std::byte, Encoder::kTimelineBufferSize> timeline;
+  encoder_.Init(worker, LedOutput());
+  encoder_.UseTimeline(timeline);
+  EXPECT_EQ(encoder_.Encode("hello world", 1, interval_ms_), pw::OkStatus());
+  SleepUntilDone();
+  worker.Stop();
+  Expect(".... . .-.. .-.. ---  .-- --- .-. .-.. -..");
+}
+
+TEST_F(MorseCodeEncoderTest, TimelineEncodeRepeated) {
+  TestWorker<> worker;
+  std::array<std::byte, Encoder::kTimelineBufferSize> timeline;
+  encoder_.Init(worker, LedOutput());
+  encoder_.UseTimeline(timeline);
+  expected_messages_ = 3;
+  EXPECT_EQ(encoder_.Encode("E", 3, interval_ms_), pw::OkStatus());
+  SleepUntilDone();
+  worker.Stop();
+  Expect(".  .  .");
+}
+
+TEST_F(MorseCodeEncoderTest, TimelineReplacesPlayingMessage) {
+  TestWorker<> test_worker;
+  CountingWorker worker(test_worker);
+  std::array<std::byte, Encoder::kTimelineBufferSize> timeline;
+  encoder_.Init(worker, LedOutput());
+  encoder_.UseTimeline(timeline);
+  EXPECT_EQ(encoder_.Encode("SOS", 0, interval_ms_), pw::OkStatus());
+  pw::this_thread::sleep_for(pw::chrono::SystemClock::for_at_least(
+      std::chrono::milliseconds(interval_ms_ * 3)));
+
+  // The new message is compiled while the first one plays, and then replaces
+  // it.
+  EXPECT_EQ(encoder_.Encode("E", 1, interval_ms_), pw::OkStatus());
+  SleepUntilDone();
+  test_worker.Stop();
+  EXPECT_EQ(worker.count(), 0u);
+}
+
+TEST_F(MorseCodeEncoderTest, TimelineTooSmallUsesWorker) {
+  TestWorker<> test_worker;
+  CountingWorker worker(test_worker);
+  std::array<std::byte, 2> timeline;
+  encoder_.Init(worker, LedOutput());
+  encoder_.UseTimeline(timeline);
+  EXPECT_EQ(encoder_.Encode("PARIS", 1, interval_ms_), pw::OkStatus());
+  SleepUntilDone();
+  test_worker.Stop();
+  Expect(".--. .- .-. .. ...");
+  EXPECT_GT(worker.count(), 0u);
+}
+
 // TODO(b/352327457): Without simulated time, this test is too slow to run every
 // case on device.
 #if defined(AM_MORSE_CODE_ENCODER_TEST_FULL) && AM_MORSE_CODE_ENCODER_TEST_FULL
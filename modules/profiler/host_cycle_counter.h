@@ -0,0 +1,54 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "modules/profiler/profiler.h"
+
+namespace sense {
+
+/// Reads the host CPU's cycle counter.
+///
+/// Arm hosts read the virtual counter. Other hosts, including x86, fall back
+/// to a nanosecond clock, since the x86 time stamp counter's frequency is not
+/// reported, and without it lateness cannot be recorded.
+class HostCycleCounter final : public CycleCounter {
+ public:
+  uint32_t Read() override {
+#if defined(__aarch64__)
+    uint64_t count;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(count));
+    return static_cast<uint32_t>(count);
+#else
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+  }
+
+  uint32_t frequency_hz() const override {
+#if defined(__aarch64__)
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return static_cast<uint32_t>(frequency);
+#else
+    return 1'000'000'000;
+#endif
+  }
+};
+
+}  // namespace sense
@@ -0,0 +1,78 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/profiler/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+namespace sense {
+
+void Profiler::Record(Kind kind, uint32_t label, uint32_t cycles) {
+  std::lock_guard lock(lock_);
+  auto entry = std::find_if(
+      entries_.begin(), entries_.end(), [kind, label](const Entry& e) {
+        return e.label == label && e.kind == kind;
+      });
+  if (entry == entries_.end()) {
+    if (entries_.full()) {
+      ++dropped_;
+      return;
+    }
+    entries_.push_back({.label = label,
+                        .kind = kind,
+                        .calls = 0,
+                        .total_cycles = 0,
+                        .max_cycles = 0});
+    entry = entries_.end() - 1;
+  }
+  ++entry->calls;
+  entry->total_cycles += cycles;
+  entry->max_cycles = std::max(entry->max_cycles, cycles);
+}
+
+size_t Profiler::Report(pw::span<Entry> entries) {
+  // Copy the table out, so that recording is not held up while it is sorted.
+  std::array<Entry, kMaxEntries> copy;
+  size_t size;
+  {
+    std::lock_guard lock(lock_);
+    size = entries_.size();
+    std::copy(entries_.begin(), entries_.end(), copy.begin());
+  }
+
+  auto sorted = std::partial_sort_copy(
+      copy.begin(),
+      copy.begin() + size,
+      entries.begin(),
+      entries.end(),
+      [](const Entry& a, const Entry& b) {
+        return a.total_cycles > b.total_cycles;
+      });
+  return static_cast<size_t>(sorted - entries.begin());
+}
+
+void Profiler::Reset() {
+  std::lock_guard lock(lock_);
+  entries_.clear();
+  dropped_ = 0;
+}
+
+uint32_t Profiler::dropped() const {
+  std::lock_guard lock(lock_);
+  return dropped_;
+}
+
+}  // namespace sense
@@ -0,0 +1,126 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pw_containers/vector.h"
+#include "pw_span/span.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// A free-running counter that the profiler times calls with.
+class CycleCounter {
+ public:
+  virtual ~CycleCounter() = default;
+
+  /// Returns the current count. The count wraps around, so calls longer than
+  /// a full wrap are not measured correctly.
+  virtual uint32_t Read() = 0;
+
+  /// Returns the number of counts per second, or 0 if it is not known.
+  virtual uint32_t frequency_hz() const = 0;
+};
+
+/// Records how many times each labeled call site has run, and for how long.
+///
+/// Call sites are labeled with tokenized strings, e.g.
+/// `PW_TOKENIZE_STRING("sample buttons")`, which are detokenized on the host.
+/// Unlabeled call sites are all recorded under `kUnlabeled`.
+///
+/// Recording is interrupt safe, and takes a short linear search of the table
+/// of call sites.
+class Profiler {
+ public:
+  enum Kind : uint8_t {
+    /// Work passed to a `Worker`.
+    kWork,
+    /// A pubsub subscriber callback.
+    kSubscriber,
+    /// Work that started after its deadline. The cycles are how late it
+    /// started, rather than how long it ran.
+    kLateness,
+  };
+
+  struct Entry {
+    uint32_t label;
+    Kind kind;
+    uint32_t calls;
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+  };
+
+  static constexpr uint32_t kUnlabeled = 0;
+
+  /// Maximum number of call sites recorded. Calls from further call sites are
+  /// only counted by `dropped`.
+  static constexpr size_t kMaxEntries = 32;
+
+  /// Times a call from construction until destruction.
+  class Measurement {
+   public:
+    /// Starts timing a call. Does nothing if `profiler` is null.
+    Measurement(Profiler* profiler, Kind kind, uint32_t label)
+        : profiler_(profiler),
+          kind_(kind),
+          label_(label),
+          start_(profiler != nullptr ? profiler->counter_.Read() : 0) {}
+
+    ~Measurement() {
+      if (profiler_ != nullptr) {
+        profiler_->Record(kind_, label_, profiler_->counter_.Read() - start_);
+      }
+    }
+
+    Measurement(const Measurement&) = delete;
+    Measurement& operator=(const Measurement&) = delete;
+
+   private:
+    Profiler* profiler_;
+    Kind kind_;
+    uint32_t label_;
+    uint32_t start_;
+  };
+
+  explicit Profiler(CycleCounter& counter) : counter_(counter) {}
+
+  /// Adds a call that took the given number of cycles.
+  void Record(Kind kind, uint32_t label, uint32_t cycles)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Copies the call sites that have used the most time into `entries`, in
+  /// descending order of total time, and returns how many were copied.
+  size_t Report(pw::span<Entry> entries) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Clears all recorded calls.
+  void Reset() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns how many calls were not recorded because the table was full.
+  uint32_t dropped() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of cycles per second, or 0 if it is not known.
+  uint32_t frequency_hz() const { return counter_.frequency_hz(); }
+
+ private:
+  CycleCounter& counter_;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  pw::Vector<Entry, kMaxEntries> entries_ PW_GUARDED_BY(lock_);
+  uint32_t dropped_ PW_GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace sense
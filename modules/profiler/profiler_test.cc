@@ -0,0 +1,160 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/profiler/profiler.h"
+
+#include <array>
+#include <cstdint>
+
+#include "modules/pubsub/pubsub.h"
+#include "modules/worker/deadline_worker.h"
+#include "modules/worker/test_worker.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+constexpr uint32_t kLabelA = 0x1234;
+constexpr uint32_t kLabelB = 0x5678;
+
+class FakeCycleCounter final : public CycleCounter {
+ public:
+  uint32_t Read() override { return now; }
+  uint32_t frequency_hz() const override { return 1000; }
+
+  uint32_t now = 0;
+};
+
+class ProfilerTest : public ::testing::Test {
+ protected:
+  ProfilerTest() : profiler_(counter_) {}
+
+  FakeCycleCounter counter_;
+  Profiler profiler_;
+};
+
+TEST_F(ProfilerTest, RecordAccumulatesPerCallSite) {
+  profiler_.Record(Profiler::kWork, kLabelA, 10);
+  profiler_.Record(Profiler::kWork, kLabelA, 30);
+  profiler_.Record(Profiler::kSubscriber, kLabelA, 5);
+
+  std::array<Profiler::Entry, 4> entries;
+  ASSERT_EQ(profiler_.Report(entries), 2u);
+  EXPECT_EQ(entries[0].label, kLabelA);
+  EXPECT_EQ(entries[0].kind, Profiler::kWork);
+  EXPECT_EQ(entries[0].calls, 2u);
+  EXPECT_EQ(entries[0].total_cycles, 40u);
+  EXPECT_EQ(entries[0].max_cycles, 30u);
+  EXPECT_EQ(entries[1].kind, Profiler::kSubscriber);
+  EXPECT_EQ(entries[1].calls, 1u);
+  EXPECT_EQ(entries[1].total_cycles, 5u);
+  EXPECT_EQ(profiler_.frequency_hz(), 1000u);
+}
+
+TEST_F(ProfilerTest, ReportIsSortedByTotalTime) {
+  profiler_.Record(Profiler::kWork, kLabelA, 10);
+  profiler_.Record(Profiler::kWork, kLabelB, 25);
+  profiler_.Record(Profiler::kWork, Profiler::kUnlabeled, 20);
+
+  std::array<Profiler::Entry, 2> entries;
+  ASSERT_EQ(profiler_.Report(entries), 2u);
+  EXPECT_EQ(entries[0].label, kLabelB);
+  EXPECT_EQ(entries[1].label, Profiler::kUnlabeled);
+}
+
+TEST_F(ProfilerTest, FullTableCountsDroppedCalls) {
+  for (uint32_t label = 1; label <= Profiler::kMaxEntries + 2; ++label) {
+    profiler_.Record(Profiler::kWork, label, 1);
+  }
+  EXPECT_EQ(profiler_.dropped(), 2u);
+
+  profiler_.Reset();
+  std::array<Profiler::Entry, 1> entries;
+  EXPECT_EQ(profiler_.Report(entries), 0u);
+  EXPECT_EQ(profiler_.dropped(), 0u);
+}
+
+TEST_F(ProfilerTest, MeasurementTimesScope) {
+  counter_.now = 0xfffffff0;
+  {
+    Profiler::Measurement measurement(&profiler_, Profiler::kWork, kLabelA);
+    counter_.now = 0x10;
+  }
+  {
+    Profiler::Measurement measurement(nullptr, Profiler::kWork, kLabelB);
+  }
+
+  std::array<Profiler::Entry, 2> entries;
+  ASSERT_EQ(profiler_.Report(entries), 1u);
+  EXPECT_EQ(entries[0].label, kLabelA);
+  EXPECT_EQ(entries[0].total_cycles, 0x20u);
+}
+
+TEST_F(ProfilerTest, DeadlineWorkerRecordsLabeledWork) {
+  TestWorker<> test_worker;
+  DeadlineWorker worker(test_worker, &profiler_);
+  pw::sync::ThreadNotification notification;
+  int order = 0;
+  int first = 0;
+  int second = 0;
+
+  worker.RunOnceLabeled(kLabelA, [&]() {
+    first = ++order;
+    counter_.now += 7;
+  });
+  worker.RunOnce([&]() {
+    second = ++order;
+    counter_.now += 3;
+  });
+  worker.RunOnceLabeled(kLabelB, [&]() { notification.release(); });
+  notification.acquire();
+  test_worker.Stop();
+
+  EXPECT_EQ(first, 1);
+  EXPECT_EQ(second, 2);
+  std::array<Profiler::Entry, 4> entries;
+  ASSERT_EQ(profiler_.Report(entries), 3u);
+  EXPECT_EQ(entries[0].label, kLabelA);
+  EXPECT_EQ(entries[0].total_cycles, 7u);
+  EXPECT_EQ(entries[1].label, Profiler::kUnlabeled);
+  EXPECT_EQ(entries[1].total_cycles, 3u);
+  EXPECT_EQ(entries[2].label, kLabelB);
+}
+
+TEST_F(ProfilerTest, PubSubRecordsLabeledSubscribers) {
+  TestWorker<> worker;
+  GenericPubSubBuffer<int, 2, 2> pubsub(worker, &profiler_);
+  pw::sync::ThreadNotification notification;
+
+  auto timed = pubsub.Subscribe(
+      [this](int value) { counter_.now += static_cast<uint32_t>(value); },
+      kLabelA);
+  ASSERT_TRUE(timed.has_value());
+  auto notifier = pubsub.Subscribe([&](int) { notification.release(); });
+  ASSERT_TRUE(notifier.has_value());
+  ASSERT_TRUE(pubsub.Publish(4));
+  notification.acquire();
+  worker.Stop();
+
+  std::array<Profiler::Entry, 4> entries;
+  ASSERT_EQ(profiler_.Report(entries), 2u);
+  EXPECT_EQ(entries[0].label, kLabelA);
+  EXPECT_EQ(entries[0].kind, Profiler::kSubscriber);
+  EXPECT_EQ(entries[0].calls, 1u);
+  EXPECT_EQ(entries[0].total_cycles, 4u);
+}
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,64 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/profiler/service.h"
+
+#include <array>
+
+namespace sense {
+namespace {
+
+profiler_Entry_Kind KindToProto(Profiler::Kind kind) {
+  switch (kind) {
+    case Profiler::kWork:
+      return profiler_Entry_Kind_WORK;
+    case Profiler::kSubscriber:
+      return profiler_Entry_Kind_SUBSCRIBER;
+    case Profiler::kLateness:
+      return profiler_Entry_Kind_LATENESS;
+  }
+  return profiler_Entry_Kind_WORK;
+}
+
+}  // namespace
+
+pw::Status ProfilerService::GetReport(const pw_protobuf_Empty&,
+                                      profiler_Report& response) {
+  std::array<Profiler::Entry, sizeof(response.entries) /
+                                  sizeof(response.entries[0])>
+      entries;
+  size_t count = profiler_.Report(entries);
+  for (size_t i = 0; i < count; ++i) {
+    const Profiler::Entry& entry = entries[i];
+    response.entries[i] = {
+        .label = entry.label,
+        .kind = KindToProto(entry.kind),
+        .calls = entry.calls,
+        .total_cycles = entry.total_cycles,
+        .max_cycles = entry.max_cycles,
+    };
+  }
+  response.entries_count = static_cast<pb_size_t>(count);
+  response.cycles_per_second = profiler_.frequency_hz();
+  response.dropped = profiler_.dropped();
+  return pw::OkStatus();
+}
+
+pw::Status ProfilerService::Reset(const pw_protobuf_Empty&,
+                                  pw_protobuf_Empty&) {
+  profiler_.Reset();
+  return pw::OkStatus();
+}
+
+}  // namespace sense
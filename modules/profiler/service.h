@@ -0,0 +1,36 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include "modules/profiler/profiler.h"
+#include "modules/profiler/profiler.rpc.pb.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+/// Lets a host read and reset a `Profiler`.
+class ProfilerService final
+    : public ::profiler::pw_rpc::nanopb::Profiler::Service<ProfilerService> {
+ public:
+  explicit ProfilerService(Profiler& profiler) : profiler_(profiler) {}
+
+  pw::Status GetReport(const pw_protobuf_Empty&, profiler_Report& response);
+
+  pw::Status Reset(const pw_protobuf_Empty&, pw_protobuf_Empty&);
+
+ private:
+  Profiler& profiler_;
+};
+
+}  // namespace sense
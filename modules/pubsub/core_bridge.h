@@ -0,0 +1,181 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/pubsub/packed_event_queue.h"
+#include "modules/pubsub/pubsub.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_span/span.h"
+#include "pw_status/status.h"
+#include "pw_tokenizer/tokenize.h"
+
+namespace sense {
+
+/// Label of the work that publishes events passed through a core bridge.
+inline constexpr uint32_t kCoreBridgeLabel =
+    PW_TOKENIZE_STRING("core bridge drain");
+
+/// Passes events from a thread on one core to a pubsub whose worker runs on
+/// another, without taking a lock that both cores contend for.
+///
+/// Events are copied into a single-producer, single-consumer ring, and
+/// published to the pubsub from its worker. Publishing from the producer is
+/// wait-free; the pubsub's worker is only woken when the ring goes from empty
+/// to not empty. If the pubsub's queue is full, the events wait in the ring
+/// until the pubsub reports that it has room, and new events are dropped once
+/// the ring is full. The bridge is the only publisher to the pubsub that may
+/// wait for room.
+///
+/// If the worker cannot queue a drain, the producer tries again each time it
+/// publishes, until one is queued.
+///
+/// Only one thread may publish through a bridge. Storage is provided by
+/// `GenericCoreBridgeBuffer`.
+template <typename EventType>
+class GenericCoreBridge {
+ public:
+  using Event = EventType;
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                "Core bridges require lock-free atomics");
+
+  GenericCoreBridge(const GenericCoreBridge&) = delete;
+  GenericCoreBridge& operator=(const GenericCoreBridge&) = delete;
+
+  /// Queues an event to be published on the pubsub's worker. Returns false,
+  /// and does not queue the event, if the bridge is full. Like
+  /// `GenericPubSub::Publish`, the publisher still holds the payload of an
+  /// event that was not queued.
+  [[nodiscard]] bool Publish(const Event& event) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == capacity()) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+      Wake();
+      return false;
+    }
+    Packing::Pack(event, Slot(tail));
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+
+    // If the worker has already taken every earlier event, it may have
+    // stopped draining before it saw this one, so wake it. Otherwise, it sees
+    // this event before it stops. Both sides store, then load the other's
+    // index with sequential consistency, so at least one of them sees the
+    // other's store.
+    if (head_.load(std::memory_order_seq_cst) == tail) {
+      wake_pending_ = true;
+    }
+    Wake();
+    return true;
+  }
+
+  /// Number of events that fit in the bridge.
+  size_t capacity() const { return slots_.size() / kSlotSize; }
+
+  /// Number of events that were dropped because the bridge was full.
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ protected:
+  /// Size of each event in the ring.
+  static constexpr size_t kSlotSize =
+      internal::EventPacking<Event>::kMaxPackedSize;
+
+  constexpr GenericCoreBridge(GenericPubSub<Event>& pubsub,
+                              Worker& worker,
+                              pw::span<std::byte> slots)
+      : pubsub_(&pubsub), worker_(&worker), slots_(slots) {}
+
+ private:
+  using Packing = internal::EventPacking<Event>;
+
+  /// How soon a drain should start after it is queued.
+  static constexpr pw::chrono::SystemClock::duration kDrainDeadline =
+      std::chrono::milliseconds(10);
+
+  std::byte* Slot(uint32_t index) {
+    return &slots_[(index % capacity()) * kSlotSize];
+  }
+
+  /// Queues a drain on the worker, or returns an error if it is full.
+  pw::Status ScheduleDrain() {
+    return worker_->RunOnceBefore(
+        pw::chrono::SystemClock::now() + kDrainDeadline,
+        kCoreBridgeLabel,
+        [this]() { Drain(); });
+  }
+
+  /// Queues a drain if the producer found the worker idle, and none has been
+  /// queued since. Only called by the producer.
+  void Wake() {
+    if (wake_pending_ && ScheduleDrain().ok()) {
+      wake_pending_ = false;
+    }
+  }
+
+  /// Publishes events until the ring is empty, or the pubsub's queue is full.
+  /// In that case, the pubsub runs it again once it has notified its
+  /// subscribers of an event, rather than it being queued again, so that it
+  /// never runs ahead of the work that makes room.
+  void Drain() {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    while (head != tail_.load(std::memory_order_seq_cst)) {
+      if (!pubsub_->PublishOrWaitForRoom(Packing::Unpack(Slot(head)),
+                                         [this]() { Drain(); })) {
+        return;
+      }
+      head_.store(++head, std::memory_order_seq_cst);
+    }
+  }
+
+  GenericPubSub<Event>* pubsub_;
+  Worker* worker_;
+  pw::span<std::byte> slots_;
+
+  // The indices count events, and wrap around together. Only the producer
+  // writes `tail_` and `dropped_`, and only the worker writes `head_`, so no
+  // read-modify-write operations are needed. The RP2040's Cortex-M0+ cores do
+  // not have them.
+  std::atomic<uint32_t> head_ = 0;
+  std::atomic<uint32_t> tail_ = 0;
+  std::atomic<uint32_t> dropped_ = 0;
+
+  // Only used by the producer.
+  bool wake_pending_ = false;
+};
+
+/// A core bridge that fits `kCapacity` events.
+template <typename Event, size_t kCapacity>
+class GenericCoreBridgeBuffer : public GenericCoreBridge<Event> {
+ public:
+  // The indices wrap around at a power of two, so the capacity must divide it.
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two");
+
+  constexpr GenericCoreBridgeBuffer(GenericPubSub<Event>& pubsub,
+                                    Worker& worker)
+      : GenericCoreBridge<Event>(pubsub, worker, slots_) {}
+
+ private:
+  std::array<std::byte, kCapacity * GenericCoreBridge<Event>::kSlotSize>
+      slots_;
+};
+
+}  // namespace sense
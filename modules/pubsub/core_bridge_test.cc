@@ -0,0 +1,237 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/pubsub/core_bridge.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "modules/pubsub/pubsub.h"
+#include "modules/worker/deadline_worker.h"
+#include "modules/worker/test_worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_log/log.h"
+#include "pw_status/status.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_thread/test_thread_context.h"
+#include "pw_thread/thread.h"
+#include "pw_thread/yield.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+using pw::chrono::SystemClock;
+
+struct Sample {
+  uint32_t sequence;
+};
+
+/// Forwards work to another worker, but rejects deadline work on request, and
+/// counts the deadline work it forwards.
+class RejectingWorker final : public sense::Worker {
+ public:
+  explicit RejectingWorker(sense::Worker& worker) : worker_(worker) {}
+
+  void RunOnce(pw::Function<void()>&& work) override {
+    worker_.RunOnce(std::move(work));
+  }
+
+  pw::Status RunOnceBefore(SystemClock::time_point deadline,
+                           uint32_t label,
+                           pw::Function<void()>&& work) override {
+    if (rejects_.load() > 0) {
+      --rejects_;
+      return pw::Status::ResourceExhausted();
+    }
+    ++deadline_work_;
+    return worker_.RunOnceBefore(deadline, label, std::move(work));
+  }
+
+  /// Rejects the next `count` pieces of deadline work.
+  void Reject(int count) { rejects_ = count; }
+
+  int deadline_work() const { return deadline_work_.load(); }
+
+ private:
+  sense::Worker& worker_;
+  std::atomic<int> rejects_ = 0;
+  std::atomic<int> deadline_work_ = 0;
+};
+
+class CoreBridgeTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kMaxEvents = 4;
+  static constexpr size_t kBridgeCapacity = 8;
+  using PubSub = sense::GenericPubSubBuffer<Sample, kMaxEvents, 2>;
+  using Bridge = sense::GenericCoreBridgeBuffer<Sample, kBridgeCapacity>;
+
+  CoreBridgeTest()
+      : rejecting_worker_(worker_),
+        pubsub_(worker_),
+        bridge_(pubsub_, rejecting_worker_) {}
+
+  void TearDown() override { worker_.Stop(); }
+
+  /// Subscribes, and releases the notification once `count` samples have
+  /// been received.
+  void ExpectSamples(uint32_t count) { ExpectSamples(pubsub_, count); }
+
+  void ExpectSamples(PubSub& pubsub, uint32_t count) {
+    expected_ = count;
+    ASSERT_TRUE(pubsub.Subscribe([this](Sample sample) {
+      if (sample.sequence != received_) {
+        out_of_order_ = true;
+      }
+      if (++received_ == expected_) {
+        notification_.release();
+      }
+    }));
+  }
+
+  sense::TestWorker<> worker_;
+  RejectingWorker rejecting_worker_;
+  PubSub pubsub_;
+  Bridge bridge_;
+
+  pw::sync::ThreadNotification notification_;
+  uint32_t expected_ = 0;
+  uint32_t received_ = 0;
+  bool out_of_order_ = false;
+};
+
+TEST_F(CoreBridgeTest, PublishesEventsInOrder) {
+  ExpectSamples(3);
+  EXPECT_TRUE(bridge_.Publish(Sample{0}));
+  EXPECT_TRUE(bridge_.Publish(Sample{1}));
+  EXPECT_TRUE(bridge_.Publish(Sample{2}));
+
+  notification_.acquire();
+  EXPECT_EQ(received_, 3u);
+  EXPECT_FALSE(out_of_order_);
+  EXPECT_EQ(bridge_.dropped(), 0u);
+}
+
+TEST_F(CoreBridgeTest, DropsEventsWhenFull) {
+  ExpectSamples(kBridgeCapacity);
+
+  // Block the worker, so that nothing is taken from the bridge.
+  pw::sync::ThreadNotification pause;
+  worker_.RunOnce([&pause]() { pause.acquire(); });
+  for (uint32_t i = 0; i < kBridgeCapacity; ++i) {
+    EXPECT_TRUE(bridge_.Publish(Sample{i}));
+  }
+  EXPECT_FALSE(bridge_.Publish(Sample{kBridgeCapacity}));
+  EXPECT_EQ(bridge_.dropped(), 1u);
+  pause.release();
+
+  notification_.acquire();
+  EXPECT_EQ(received_, kBridgeCapacity);
+  EXPECT_FALSE(out_of_order_);
+}
+
+TEST_F(CoreBridgeTest, WaitsForRoomInPubSub) {
+  // The bridge holds more events than the pubsub's queue, so some have to
+  // wait for the subscriber to be notified.
+  static_assert(kBridgeCapacity > kMaxEvents);
+  ExpectSamples(kBridgeCapacity);
+
+  pw::sync::ThreadNotification pause;
+  worker_.RunOnce([&pause]() { pause.acquire(); });
+  for (uint32_t i = 0; i < kBridgeCapacity; ++i) {
+    EXPECT_TRUE(bridge_.Publish(Sample{i}));
+  }
+  pause.release();
+
+  notification_.acquire();
+  EXPECT_EQ(received_, kBridgeCapacity);
+  EXPECT_FALSE(out_of_order_);
+}
+
+TEST_F(CoreBridgeTest, RetriesRejectedWake) {
+  ExpectSamples(2);
+
+  // The first event cannot wake the worker, so the second one does.
+  rejecting_worker_.Reject(1);
+  EXPECT_TRUE(bridge_.Publish(Sample{0}));
+  EXPECT_TRUE(bridge_.Publish(Sample{1}));
+
+  notification_.acquire();
+  EXPECT_EQ(received_, 2u);
+  EXPECT_FALSE(out_of_order_);
+}
+
+TEST_F(CoreBridgeTest, WaitsForRoomWithoutRequeueing) {
+  static_assert(kBridgeCapacity > kMaxEvents);
+
+  // The pubsub's notifications are due later than the bridge's drain on a
+  // deadline worker, so a drain that queued itself again whenever the pubsub
+  // was full would run ahead of the work that makes room.
+  sense::DeadlineWorker deadline_worker(worker_);
+  RejectingWorker bridge_worker(deadline_worker);
+  PubSub pubsub(deadline_worker);
+  Bridge bridge(pubsub, bridge_worker);
+  ExpectSamples(pubsub, kBridgeCapacity);
+
+  pw::sync::ThreadNotification pause;
+  worker_.RunOnce([&pause]() { pause.acquire(); });
+  for (uint32_t i = 0; i < kBridgeCapacity; ++i) {
+    EXPECT_TRUE(bridge.Publish(Sample{i}));
+  }
+  pause.release();
+
+  notification_.acquire();
+  EXPECT_EQ(received_, kBridgeCapacity);
+  EXPECT_FALSE(out_of_order_);
+  EXPECT_EQ(bridge.dropped(), 0u);
+  // Only the first event queued a drain. The pubsub ran the others.
+  EXPECT_EQ(bridge_worker.deadline_work(), 1);
+
+  // Let the deadline worker finish before it is destroyed.
+  pw::sync::ThreadNotification done;
+  deadline_worker.RunOnce([&done]() { done.release(); });
+  done.acquire();
+}
+
+TEST_F(CoreBridgeTest, PublishesFromAnotherThread) {
+  // Stands in for the other core. On host, this also serves as a benchmark of
+  // the bridge under contention.
+  constexpr uint32_t kSamples = 1000;
+  ExpectSamples(kSamples);
+
+  const SystemClock::time_point start = SystemClock::now();
+  pw::thread::test::TestThreadContext context;
+  pw::thread::Thread producer(context.options(), [this]() {
+    for (uint32_t i = 0; i < kSamples; ++i) {
+      while (!bridge_.Publish(Sample{i})) {
+        pw::this_thread::yield();
+      }
+    }
+  });
+
+  notification_.acquire();
+  producer.join();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      SystemClock::now() - start);
+  PW_LOG_INFO("Passed %u samples through the bridge in %u us, full %u times",
+              static_cast<unsigned>(kSamples),
+              static_cast<unsigned>(elapsed.count()),
+              static_cast<unsigned>(bridge_.dropped()));
+
+  EXPECT_EQ(received_, kSamples);
+  EXPECT_FALSE(out_of_order_);
+}
+
+}  // namespace
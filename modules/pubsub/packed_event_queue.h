@@ -0,0 +1,250 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <variant>
+
+#include "pw_span/span.h"
+
+namespace sense {
+namespace internal {
+
+/// Copies trivially copyable events to and from bytes.
+///
+/// Plain events are stored as their own bytes.
+template <typename Event>
+struct EventPacking {
+  static_assert(std::is_trivially_copyable_v<Event>);
+
+  static constexpr size_t kMaxPackedSize = sizeof(Event);
+
+  static constexpr size_t PackedSize(const Event&) { return sizeof(Event); }
+
+  /// Returns the size of the packed event that starts with `first_byte`.
+  static constexpr size_t PackedSize(std::byte) { return sizeof(Event); }
+
+  /// Plain events are all of the same kind.
+  static constexpr size_t Kind(const Event&) { return 0; }
+  static constexpr size_t Kind(std::byte) { return 0; }
+
+  static void Pack(const Event& event, std::byte* out) {
+    std::memcpy(out, &event, sizeof(Event));
+  }
+
+  static Event Unpack(const std::byte* in) {
+    std::array<std::byte, sizeof(Event)> bytes;
+    std::memcpy(bytes.data(), in, sizeof(Event));
+    return std::bit_cast<Event>(bytes);
+  }
+};
+
+/// `std::variant` events are stored as a one byte index of the alternative,
+/// followed by only that alternative's bytes.
+template <typename... Types>
+struct EventPacking<std::variant<Types...>> {
+  using Event = std::variant<Types...>;
+
+  static_assert(sizeof...(Types) <= 256,
+                "The alternative's index must fit in one byte");
+  static_assert((std::is_trivially_copyable_v<Types> && ...));
+
+  static constexpr size_t kMaxPackedSize = 1 + std::max({sizeof(Types)...});
+
+  static constexpr size_t PackedSize(const Event& event) {
+    return 1 + kSizes[event.index()];
+  }
+
+  static constexpr size_t PackedSize(std::byte index) {
+    return 1 + kSizes[static_cast<size_t>(index)];
+  }
+
+  /// Events of the same alternative are of the same kind.
+  static constexpr size_t Kind(const Event& event) { return event.index(); }
+  static constexpr size_t Kind(std::byte index) {
+    return static_cast<size_t>(index);
+  }
+
+  static void Pack(const Event& event, std::byte* out) {
+    out[0] = static_cast<std::byte>(event.index());
+    std::visit(
+        [out](const auto& value) {
+          std::memcpy(out + 1, &value, sizeof(value));
+        },
+        event);
+  }
+
+  static Event Unpack(const std::byte* in) {
+    return kUnpackers[static_cast<size_t>(in[0])](in + 1);
+  }
+
+ private:
+  template <typename T>
+  static Event UnpackAs(const std::byte* in) {
+    std::array<std::byte, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), in, sizeof(T));
+    return Event(std::in_place_type<T>, std::bit_cast<T>(bytes));
+  }
+
+  static constexpr std::array<size_t, sizeof...(Types)> kSizes = {
+      sizeof(Types)...};
+
+  static constexpr std::array<Event (*)(const std::byte*), sizeof...(Types)>
+      kUnpackers = {&UnpackAs<Types>...};
+};
+
+}  // namespace internal
+
+/// A FIFO queue of events that only uses as many bytes as each event needs.
+///
+/// A `std::variant` is as large as its largest alternative, but most events
+/// are much smaller. Each queued variant takes one byte for the index of its
+/// alternative plus that alternative's size, and is rebuilt when popped, so
+/// a queue holds several times more small events than an equally sized queue
+/// of variants. Other events are queued at their own size.
+///
+/// Like `pw::InlineDeque`, the storage is provided by
+/// `PackedEventQueueBuffer`, and this class can be used without knowing its
+/// capacity. It is not thread safe.
+template <typename Event>
+class PackedEventQueue {
+ public:
+  /// Largest number of bytes one event takes in the queue.
+  static constexpr size_t kMaxEntrySize =
+      internal::EventPacking<Event>::kMaxPackedSize;
+
+  /// Returns the capacity in bytes that fits `max_events` of even the largest
+  /// events.
+  static constexpr size_t CapacityFor(size_t max_events) {
+    return max_events * kMaxEntrySize;
+  }
+
+  PackedEventQueue(const PackedEventQueue&) = delete;
+  PackedEventQueue& operator=(const PackedEventQueue&) = delete;
+
+  /// Adds an event to the back of the queue. Returns false, and does not add
+  /// the event, if it does not fit.
+  [[nodiscard]] bool Push(const Event& event) {
+    const size_t entry_size = Packing::PackedSize(event);
+    if (entry_size > buffer_.size() - size_bytes_) {
+      return false;
+    }
+    std::array<std::byte, kMaxEntrySize> entry;
+    Packing::Pack(event, entry.data());
+    Write((head_ + size_bytes_) % buffer_.size(), entry.data(), entry_size);
+    size_bytes_ += entry_size;
+    ++size_;
+    return true;
+  }
+
+  /// Removes and returns the event at the front of the queue, or
+  /// `std::nullopt` if the queue is empty.
+  std::optional<Event> Pop() {
+    if (empty()) {
+      return std::nullopt;
+    }
+    const size_t entry_size = Packing::PackedSize(buffer_[head_]);
+    std::array<std::byte, kMaxEntrySize> entry;
+    Read(head_, entry.data(), entry_size);
+    head_ = (head_ + entry_size) % buffer_.size();
+    size_bytes_ -= entry_size;
+    --size_;
+    return Packing::Unpack(entry.data());
+  }
+
+  /// Overwrites the oldest queued event of the same kind as `event`, i.e. the
+  /// same `std::variant` alternative, in place. Returns the event that was
+  /// overwritten, or `std::nullopt` if none were of the same kind.
+  std::optional<Event> Replace(const Event& event) {
+    const size_t kind = Packing::Kind(event);
+    size_t offset = head_;
+    for (size_t i = 0; i < size_; ++i) {
+      const size_t entry_size = Packing::PackedSize(buffer_[offset]);
+      if (Packing::Kind(buffer_[offset]) == kind) {
+        std::array<std::byte, kMaxEntrySize> entry;
+        Read(offset, entry.data(), entry_size);
+        const Event replaced = Packing::Unpack(entry.data());
+        Packing::Pack(event, entry.data());
+        Write(offset, entry.data(), entry_size);
+        return replaced;
+      }
+      offset = (offset + entry_size) % buffer_.size();
+    }
+    return std::nullopt;
+  }
+
+  void Clear() {
+    head_ = 0;
+    size_bytes_ = 0;
+    size_ = 0;
+  }
+
+  bool empty() const { return size_ == 0; }
+
+  /// Number of events in the queue.
+  size_t size() const { return size_; }
+
+  /// Number of bytes used by the events in the queue.
+  size_t size_bytes() const { return size_bytes_; }
+
+  size_t capacity_bytes() const { return buffer_.size(); }
+
+ protected:
+  explicit constexpr PackedEventQueue(pw::span<std::byte> buffer)
+      : buffer_(buffer) {}
+
+ private:
+  using Packing = internal::EventPacking<Event>;
+
+  /// Copies bytes into the ring, wrapping around its end.
+  void Write(size_t offset, const std::byte* data, size_t size) {
+    const size_t first = std::min(size, buffer_.size() - offset);
+    std::memcpy(&buffer_[offset], data, first);
+    std::memcpy(buffer_.data(), data + first, size - first);
+  }
+
+  /// Copies bytes out of the ring, wrapping around its end.
+  void Read(size_t offset, std::byte* data, size_t size) const {
+    const size_t first = std::min(size, buffer_.size() - offset);
+    std::memcpy(data, &buffer_[offset], first);
+    std::memcpy(data + first, buffer_.data(), size - first);
+  }
+
+  pw::span<std::byte> buffer_;
+  size_t head_ = 0;
+  size_t size_bytes_ = 0;
+  size_t size_ = 0;
+};
+
+/// A `PackedEventQueue` with `kCapacityBytes` bytes of storage.
+template <typename Event, size_t kCapacityBytes>
+class PackedEventQueueBuffer : public PackedEventQueue<Event> {
+ public:
+  static_assert(kCapacityBytes >= PackedEventQueue<Event>::kMaxEntrySize,
+                "The queue must fit at least one of the largest events");
+
+  constexpr PackedEventQueueBuffer() : PackedEventQueue<Event>(buffer_) {}
+
+ private:
+  std::array<std::byte, kCapacityBytes> buffer_;
+};
+
+}  // namespace sense
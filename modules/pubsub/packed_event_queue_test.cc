@@ -0,0 +1,154 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/pubsub/packed_event_queue.h"
+
+#include "modules/pubsub/pubsub_events.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using EventQueue = PackedEventQueue<Event>;
+
+static_assert(EventQueue::kMaxEntrySize <= sizeof(Event),
+              "A packed event must not be larger than the variant");
+
+TEST(PackedEventQueueTest, PopsEventsInOrder) {
+  PackedEventQueueBuffer<Event, EventQueue::CapacityFor(4)> queue;
+  constexpr const char* kDescription = "Good";
+  PayloadPoolBuffer<8, 1> payloads;
+  std::optional<PayloadRef> message = payloads.Allocate("SOS");
+  ASSERT_TRUE(message.has_value());
+
+  ASSERT_TRUE(queue.Push(ButtonA(true)));
+  ASSERT_TRUE(queue.Push(AirQuality{.score = 768}));
+  ASSERT_TRUE(queue.Push(SenseState{.alarm = true,
+                                    .alarm_threshold = 512,
+                                    .air_quality = 600,
+                                    .air_quality_description = kDescription}));
+  ASSERT_TRUE(
+      queue.Push(MorseEncodeRequest{.payload = *message, .repeat = 2}));
+  EXPECT_EQ(queue.size(), 4u);
+
+  std::optional<Event> event = queue.Pop();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(std::holds_alternative<ButtonA>(*event));
+  EXPECT_TRUE(std::get<ButtonA>(*event).pressed());
+
+  event = queue.Pop();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(std::holds_alternative<AirQuality>(*event));
+  EXPECT_EQ(std::get<AirQuality>(*event).score, 768u);
+
+  event = queue.Pop();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(std::holds_alternative<SenseState>(*event));
+  const auto& state = std::get<SenseState>(*event);
+  EXPECT_TRUE(state.alarm);
+  EXPECT_EQ(state.alarm_threshold, 512u);
+  EXPECT_EQ(state.air_quality, 600u);
+  EXPECT_EQ(state.air_quality_description, kDescription);
+
+  event = queue.Pop();
+  ASSERT_TRUE(event.has_value());
+  ASSERT_TRUE(std::holds_alternative<MorseEncodeRequest>(*event));
+  EXPECT_EQ(std::get<MorseEncodeRequest>(*event).message(), "SOS");
+  EXPECT_EQ(std::get<MorseEncodeRequest>(*event).repeat, 2u);
+
+  EXPECT_FALSE(queue.Pop().has_value());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.size_bytes(), 0u);
+}
+
+TEST(PackedEventQueueTest, SmallEventsTakeLessSpace) {
+  PackedEventQueueBuffer<Event, EventQueue::CapacityFor(4)> queue;
+
+  size_t pushed = 0;
+  while (queue.Push(ProximitySample{.sample = static_cast<uint16_t>(pushed)})) {
+    ++pushed;
+  }
+  EXPECT_EQ(pushed, queue.capacity_bytes() / (1 + sizeof(ProximitySample)));
+  EXPECT_GE(pushed, 3 * 4u);
+
+  for (size_t i = 0; i < pushed; ++i) {
+    std::optional<Event> event = queue.Pop();
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(std::get<ProximitySample>(*event).sample, i);
+  }
+}
+
+TEST(PackedEventQueueTest, RejectsEventThatDoesNotFit) {
+  PackedEventQueueBuffer<Event, EventQueue::CapacityFor(1)> queue;
+
+  ASSERT_TRUE(queue.Push(ButtonB(true)));
+  EXPECT_FALSE(queue.Push(MorseEncodeRequest{}));
+  EXPECT_EQ(queue.size(), 1u);
+
+  ASSERT_TRUE(queue.Pop().has_value());
+  EXPECT_TRUE(queue.Push(MorseEncodeRequest{}));
+}
+
+TEST(PackedEventQueueTest, EventsWrapAroundTheEnd) {
+  PackedEventQueueBuffer<Event, EventQueue::CapacityFor(2)> queue;
+
+  // The events take an odd number of bytes, so that they often straddle the
+  // end of the buffer.
+  for (uint16_t i = 0; i < 100; ++i) {
+    ASSERT_TRUE(queue.Push(ButtonX(i % 2 == 0)));
+    ASSERT_TRUE(queue.Push(TimerRequest{.token = i, .timeout_s = i}));
+    ASSERT_TRUE(queue.Pop().has_value());
+
+    std::optional<Event> event = queue.Pop();
+    ASSERT_TRUE(event.has_value());
+    ASSERT_TRUE(std::holds_alternative<TimerRequest>(*event));
+    EXPECT_EQ(std::get<TimerRequest>(*event).token, i);
+    EXPECT_EQ(std::get<TimerRequest>(*event).timeout_s, i);
+  }
+}
+
+TEST(PackedEventQueueTest, ReplaceOverwritesOldestOfSameKind) {
+  PackedEventQueueBuffer<Event, EventQueue::CapacityFor(4)> queue;
+  ASSERT_TRUE(queue.Push(AirQuality{.score = 1}));
+  ASSERT_TRUE(queue.Push(ButtonA(true)));
+  ASSERT_TRUE(queue.Push(AirQuality{.score = 2}));
+
+  std::optional<Event> replaced = queue.Replace(AirQuality{.score = 3});
+  ASSERT_TRUE(replaced.has_value());
+  EXPECT_EQ(std::get<AirQuality>(*replaced).score, 1u);
+  EXPECT_FALSE(queue.Replace(ButtonB(true)).has_value());
+  EXPECT_EQ(queue.size(), 3u);
+
+  EXPECT_EQ(std::get<AirQuality>(*queue.Pop()).score, 3u);
+  EXPECT_TRUE(std::holds_alternative<ButtonA>(*queue.Pop()));
+  EXPECT_EQ(std::get<AirQuality>(*queue.Pop()).score, 2u);
+}
+
+TEST(PackedEventQueueTest, PlainEventsHaveNoIndex) {
+  struct Reading {
+    uint32_t value;
+  };
+  PackedEventQueueBuffer<Reading, PackedEventQueue<Reading>::CapacityFor(2)>
+      queue;
+  static_assert(PackedEventQueue<Reading>::kMaxEntrySize == sizeof(Reading));
+
+  ASSERT_TRUE(queue.Push({.value = 1}));
+  ASSERT_TRUE(queue.Push({.value = 2}));
+  EXPECT_FALSE(queue.Push({.value = 3}));
+  EXPECT_EQ(queue.Pop()->value, 1u);
+  EXPECT_EQ(queue.Pop()->value, 2u);
+}
+
+}  // namespace
+}  // namespace sense
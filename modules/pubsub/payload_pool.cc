@@ -0,0 +1,118 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/pubsub/payload_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "pw_assert/check.h"
+
+namespace sense {
+
+pw::ByteSpan PayloadRef::data() const {
+  return pool_ != nullptr ? pool_->Data(*this) : pw::ByteSpan();
+}
+
+bool PayloadRef::Retain() const {
+  return pool_ != nullptr && pool_->Retain(*this);
+}
+
+void PayloadRef::Release() const {
+  if (pool_ != nullptr) {
+    pool_->Release(*this);
+  }
+}
+
+std::optional<PayloadRef> PayloadPool::Allocate(size_t size) {
+  if (size > block_size_) {
+    return std::nullopt;
+  }
+  std::lock_guard lock(lock_);
+  auto block = std::find_if(blocks_.begin(), blocks_.end(), [](Block& b) {
+    return b.references == 0;
+  });
+  if (block == blocks_.end()) {
+    ++exhausted_;
+    return std::nullopt;
+  }
+  block->references = 1;
+  return PayloadRef(this,
+                    static_cast<uint8_t>(block - blocks_.begin()),
+                    block->generation,
+                    static_cast<uint16_t>(size));
+}
+
+std::optional<PayloadRef> PayloadPool::Allocate(pw::ConstByteSpan data) {
+  std::optional<PayloadRef> ref = Allocate(data.size());
+  if (ref.has_value()) {
+    std::memcpy(ref->data().data(), data.data(), data.size());
+  }
+  return ref;
+}
+
+size_t PayloadPool::available() const {
+  std::lock_guard lock(lock_);
+  return static_cast<size_t>(
+      std::count_if(blocks_.begin(), blocks_.end(), [](const Block& b) {
+        return b.references == 0;
+      }));
+}
+
+uint32_t PayloadPool::exhausted() const {
+  std::lock_guard lock(lock_);
+  return exhausted_;
+}
+
+PayloadPool::Block* PayloadPool::Find(const PayloadRef& ref) {
+  Block& block = blocks_[ref.block_];
+  if (block.references == 0 || block.generation != ref.generation_) {
+    return nullptr;
+  }
+  return &block;
+}
+
+pw::ByteSpan PayloadPool::Data(const PayloadRef& ref) {
+  std::lock_guard lock(lock_);
+  if (Find(ref) == nullptr) {
+    return pw::ByteSpan();
+  }
+  return storage_.subspan(ref.block_ * block_size_, ref.size_);
+}
+
+bool PayloadPool::Retain(const PayloadRef& ref) {
+  std::lock_guard lock(lock_);
+  Block* block = Find(ref);
+  if (block == nullptr) {
+    return false;
+  }
+  PW_CHECK_UINT_LT(block->references, UINT8_MAX, "Too many payload references");
+  ++block->references;
+  return true;
+}
+
+void PayloadPool::Release(const PayloadRef& ref) {
+  std::lock_guard lock(lock_);
+  Block* block = Find(ref);
+  if (block == nullptr) {
+    return;
+  }
+  if (--block->references == 0) {
+    // Make outstanding references to this block stale.
+    ++block->generation;
+  }
+}
+
+}  // namespace sense
@@ -0,0 +1,189 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include "pw_bytes/span.h"
+#include "pw_span/span.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+class PayloadPool;
+
+/// A counted reference to a block of a `PayloadPool`.
+///
+/// References are small and trivially copyable, so that events can carry
+/// them through a pubsub. Copying a reference does not count it; each holder
+/// that keeps the payload beyond the call it was given in must `Retain` it,
+/// and `Release` it when done. The block returns to the pool when its last
+/// reference is released.
+///
+/// A reference that outlives its block, e.g. one that was released too many
+/// times or replayed from an event log, is stale: it has no data, and
+/// retaining or releasing it does nothing.
+class PayloadRef {
+ public:
+  constexpr PayloadRef() = default;
+
+  /// Returns the payload's bytes, or an empty span if the reference is stale
+  /// or empty. The bytes are valid while the caller holds a reference.
+  pw::ByteSpan data() const;
+
+  /// Returns the payload as a string.
+  std::string_view as_string() const {
+    pw::ByteSpan bytes = data();
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+  }
+
+  /// Adds a reference to the payload. Returns false if the reference is stale.
+  bool Retain() const;
+
+  /// Removes a reference to the payload.
+  void Release() const;
+
+ private:
+  friend class PayloadPool;
+
+  constexpr PayloadRef(PayloadPool* pool,
+                       uint8_t block,
+                       uint8_t generation,
+                       uint16_t size)
+      : pool_(pool), block_(block), generation_(generation), size_(size) {}
+
+  PayloadPool* pool_ = nullptr;
+  uint8_t block_ = 0;
+  uint8_t generation_ = 0;
+  uint16_t size_ = 0;
+};
+
+/// Fixed-size blocks for payloads that are too large or too variable to be
+/// copied inside events, such as strings and batches of samples.
+///
+/// A publisher allocates a block, fills it, and publishes an event that
+/// carries the `PayloadRef` in a member named `payload`. The pubsub holds the
+/// publisher's reference until every subscriber has seen the event, and then
+/// releases it. If the event could not be published, the publisher must
+/// release the reference itself.
+///
+/// Allocating and releasing blocks is interrupt safe.
+class PayloadPool {
+ public:
+  PayloadPool(const PayloadPool&) = delete;
+  PayloadPool& operator=(const PayloadPool&) = delete;
+
+  /// Allocates a block for `size` bytes, with one reference held by the
+  /// caller. Returns `std::nullopt` if the payload is larger than a block or
+  /// no blocks are free.
+  std::optional<PayloadRef> Allocate(size_t size) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Allocates a block and copies `data` into it.
+  std::optional<PayloadRef> Allocate(pw::ConstByteSpan data);
+
+  /// Allocates a block and copies `string` into it.
+  std::optional<PayloadRef> Allocate(std::string_view string) {
+    return Allocate(pw::as_bytes(pw::span(string)));
+  }
+
+  size_t block_size() const { return block_size_; }
+
+  size_t block_count() const { return blocks_.size(); }
+
+  /// Number of blocks that are not in use.
+  size_t available() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Number of allocations that failed because no blocks were free.
+  uint32_t exhausted() const PW_LOCKS_EXCLUDED(lock_);
+
+ protected:
+  struct Block {
+    uint8_t generation = 0;
+    uint8_t references = 0;
+  };
+
+  /// Creates a pool that divides `storage` into one block per `Block`.
+  constexpr PayloadPool(pw::ByteSpan storage, pw::span<Block> blocks)
+      : storage_(storage),
+        block_size_(storage.size() / blocks.size()),
+        blocks_(blocks) {}
+
+ private:
+  friend class PayloadRef;
+
+  /// Returns the block that a reference points to, or null if it is stale.
+  Block* Find(const PayloadRef& ref) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  pw::ByteSpan Data(const PayloadRef& ref) PW_LOCKS_EXCLUDED(lock_);
+  bool Retain(const PayloadRef& ref) PW_LOCKS_EXCLUDED(lock_);
+  void Release(const PayloadRef& ref) PW_LOCKS_EXCLUDED(lock_);
+
+  const pw::ByteSpan storage_;
+  const size_t block_size_;
+
+  // The blocks' reference counts and generations are guarded by `lock_`.
+  const pw::span<Block> blocks_;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  uint32_t exhausted_ PW_GUARDED_BY(lock_) = 0;
+};
+
+namespace internal {
+
+template <typename T>
+struct IsVariant : std::false_type {};
+
+template <typename... Types>
+struct IsVariant<std::variant<Types...>> : std::true_type {};
+
+}  // namespace internal
+
+/// Calls `function` with the `PayloadRef` that an event carries in a member
+/// named `payload`, if it has one. For `std::variant` events, the alternative
+/// that the event holds is checked.
+template <typename Event, typename Function>
+void VisitPayload(Event& event, Function&& function) {
+  if constexpr (internal::IsVariant<std::remove_const_t<Event>>::value) {
+    std::visit([&function](auto& value) { VisitPayload(value, function); },
+               event);
+  } else if constexpr (requires { event.payload; }) {
+    if constexpr (std::is_same_v<std::remove_cvref_t<decltype(event.payload)>,
+                                 PayloadRef>) {
+      function(event.payload);
+    }
+  }
+}
+
+/// A `PayloadPool` with `kBlockCount` blocks of `kBlockSize` bytes.
+template <size_t kBlockSize, size_t kBlockCount>
+class PayloadPoolBuffer : public PayloadPool {
+ public:
+  static_assert(kBlockSize > 0 && kBlockSize <= UINT16_MAX);
+  static_assert(kBlockCount > 0 && kBlockCount <= UINT8_MAX + 1);
+
+  constexpr PayloadPoolBuffer() : PayloadPool(storage_, blocks_) {}
+
+ private:
+  std::array<std::byte, kBlockSize * kBlockCount> storage_;
+  std::array<Block, kBlockCount> blocks_;
+};
+
+}  // namespace sense
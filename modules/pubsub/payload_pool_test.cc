@@ -0,0 +1,103 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/pubsub/payload_pool.h"
+
+#include <type_traits>
+
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+static_assert(std::is_trivially_copyable_v<PayloadRef>);
+
+TEST(PayloadPoolTest, AllocateCopiesData) {
+  PayloadPoolBuffer<16, 2> pool;
+  EXPECT_EQ(pool.block_size(), 16u);
+  EXPECT_EQ(pool.block_count(), 2u);
+
+  std::optional<PayloadRef> ref = pool.Allocate("SOS");
+  ASSERT_TRUE(ref.has_value());
+  EXPECT_EQ(ref->as_string(), "SOS");
+  EXPECT_EQ(ref->data().size(), 3u);
+  EXPECT_EQ(pool.available(), 1u);
+
+  ref->Release();
+  EXPECT_EQ(pool.available(), 2u);
+}
+
+TEST(PayloadPoolTest, AllocateFailsWhenTooLarge) {
+  PayloadPoolBuffer<4, 2> pool;
+  EXPECT_FALSE(pool.Allocate("TOO LONG").has_value());
+  EXPECT_TRUE(pool.Allocate("FITS").has_value());
+}
+
+TEST(PayloadPoolTest, AllocateFailsWhenExhausted) {
+  PayloadPoolBuffer<8, 2> pool;
+  std::optional<PayloadRef> first = pool.Allocate(size_t{8});
+  std::optional<PayloadRef> second = pool.Allocate(size_t{8});
+  ASSERT_TRUE(first.has_value());
+  ASSERT_TRUE(second.has_value());
+  EXPECT_EQ(pool.available(), 0u);
+
+  EXPECT_FALSE(pool.Allocate(size_t{1}).has_value());
+  EXPECT_EQ(pool.exhausted(), 1u);
+
+  second->Release();
+  EXPECT_TRUE(pool.Allocate(size_t{1}).has_value());
+}
+
+TEST(PayloadPoolTest, BlockIsFreedByLastRelease) {
+  PayloadPoolBuffer<8, 1> pool;
+  std::optional<PayloadRef> ref = pool.Allocate("ABC");
+  ASSERT_TRUE(ref.has_value());
+
+  PayloadRef copy = *ref;
+  ASSERT_TRUE(copy.Retain());
+  ref->Release();
+  EXPECT_EQ(pool.available(), 0u);
+  EXPECT_EQ(copy.as_string(), "ABC");
+
+  copy.Release();
+  EXPECT_EQ(pool.available(), 1u);
+}
+
+TEST(PayloadPoolTest, ReleasedReferenceIsStale) {
+  PayloadPoolBuffer<8, 1> pool;
+  std::optional<PayloadRef> stale = pool.Allocate("OLD");
+  ASSERT_TRUE(stale.has_value());
+  stale->Release();
+
+  // The block is reused, but the old reference does not see the new payload.
+  std::optional<PayloadRef> current = pool.Allocate("NEW");
+  ASSERT_TRUE(current.has_value());
+  EXPECT_TRUE(stale->data().empty());
+  EXPECT_FALSE(stale->Retain());
+
+  // Releasing the stale reference again does not free the new payload.
+  stale->Release();
+  EXPECT_EQ(pool.available(), 0u);
+  EXPECT_EQ(current->as_string(), "NEW");
+}
+
+TEST(PayloadPoolTest, EmptyReferenceHasNoData) {
+  PayloadRef ref;
+  EXPECT_TRUE(ref.data().empty());
+  EXPECT_FALSE(ref.Retain());
+  ref.Release();
+}
+
+}  // namespace
+}  // namespace sense
@@ -19,30 +19,299 @@
 #include <type_traits>
 #include <variant>
 
+#include "modules/profiler/profiler.h"
+#include "modules/pubsub/packed_event_queue.h"
+#include "modules/pubsub/payload_pool.h"
+#include "modules/pubsub/retained_events.h"
 #include "modules/worker/worker.h"
-#include "pw_containers/inline_deque.h"
+#include "pw_assert/check.h"
 #include "pw_function/function.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/lock_annotations.h"
+#include "pw_tokenizer/tokenize.h"
+#include "pw_trace/trace.h"
 
 namespace sense {
 
+/// Label of the work that passes each event to the subscribers.
+inline constexpr uint32_t kPubSubNotifyLabel =
+    PW_TOKENIZE_STRING("pubsub notify subscribers");
+
+/// Label of the work that passes events from a mailbox to its subscriber.
+inline constexpr uint32_t kPubSubMailboxLabel =
+    PW_TOKENIZE_STRING("pubsub mailbox");
+
+/// Label of the work that passes retained events to a new subscriber.
+inline constexpr uint32_t kPubSubRetainedLabel =
+    PW_TOKENIZE_STRING("pubsub send retained");
+
+/// What a mailbox does with an event when it is full.
+enum class MailboxOverflow {
+  /// Drops the oldest events until the new one fits.
+  kDropOldest,
+  /// Drops the new event.
+  kDropNewest,
+  /// Replaces the oldest event of the same kind, i.e. the same `std::variant`
+  /// alternative, in place with the new one, so that only the latest value of
+  /// each kind waits for the subscriber. Events without one of the same kind
+  /// are queued, dropping the oldest events if needed.
+  kConflate,
+};
+
+template <typename EventType>
+class GenericPubSub;
+
+/// A bounded queue of events for one subscriber, which is delivered on that
+/// subscriber's own worker.
+///
+/// A subscriber with a mailbox only costs the pubsub's worker the time to
+/// queue each event, so a slow subscriber, e.g. one that writes to a
+/// congested RPC stream, does not delay the others. When the mailbox is full,
+/// its overflow policy decides which events are lost. Payloads of queued
+/// events are retained until they are delivered or dropped.
+///
+/// Storage is provided by `GenericMailboxBuffer`.
+template <typename EventType>
+class GenericMailbox {
+ public:
+  using Event = EventType;
+  using Callback = pw::Function<void(Event)>;
+
+  GenericMailbox(const GenericMailbox&) = delete;
+  GenericMailbox& operator=(const GenericMailbox&) = delete;
+
+  MailboxOverflow overflow() const { return overflow_; }
+
+  /// Number of events waiting to be delivered.
+  size_t size() const PW_LOCKS_EXCLUDED(lock_) {
+    std::lock_guard lock(lock_);
+    return queue_.size();
+  }
+
+  /// Number of events that were dropped or conflated.
+  uint32_t dropped() const PW_LOCKS_EXCLUDED(lock_) {
+    std::lock_guard lock(lock_);
+    return dropped_;
+  }
+
+ protected:
+  constexpr GenericMailbox(PackedEventQueue<Event>& queue,
+                           MailboxOverflow overflow)
+      : overflow_(overflow), queue_(queue) {}
+
+ private:
+  friend class GenericPubSub<Event>;
+
+  /// Predicate for events that the subscriber wants.
+  using Filter = bool (*)(const Event&);
+
+  /// Starts delivering events to `callback` on `worker`. Returns false if the
+  /// mailbox already has a subscriber.
+  bool Attach(Worker& worker,
+              Callback&& callback,
+              Filter filter,
+              uint32_t label,
+              Profiler* profiler) PW_LOCKS_EXCLUDED(lock_) {
+    std::lock_guard lock(lock_);
+    if (worker_ != nullptr) {
+      return false;
+    }
+    worker_ = &worker;
+    callback_ = std::move(callback);
+    filter_ = filter;
+    label_ = label;
+    profiler_ = profiler;
+    return true;
+  }
+
+  /// Stops delivering events, and drops any that are waiting.
+  ///
+  /// A callback that is running meanwhile is not waited for. It is destroyed
+  /// on its worker once it returns, so the mailbox can be detached from any
+  /// thread, including from the callback itself.
+  void Detach() PW_LOCKS_EXCLUDED(lock_) {
+    Callback callback;
+    {
+      std::lock_guard lock(lock_);
+      while (std::optional<Event> event = queue_.Pop()) {
+        Release(*event);
+      }
+      worker_ = nullptr;
+      callback = std::move(callback_);
+      callback_ = nullptr;
+      filter_ = nullptr;
+      ++generation_;
+    }
+  }
+
+  /// Queues an event, and schedules its delivery. Called from the pubsub's
+  /// worker.
+  void Deliver(const Event& event) PW_LOCKS_EXCLUDED(lock_) {
+    Filter filter;
+    {
+      std::lock_guard lock(lock_);
+      if (worker_ == nullptr) {
+        return;
+      }
+      filter = filter_;
+    }
+    if (filter != nullptr && !filter(event)) {
+      return;
+    }
+    VisitPayload(event, [](const PayloadRef& payload) { payload.Retain(); });
+
+    Worker* schedule_on = nullptr;
+    {
+      std::lock_guard lock(lock_);
+      if (!QueueLocked(event)) {
+        ++dropped_;
+        Release(event);
+      }
+      if (!scheduled_ && worker_ != nullptr) {
+        scheduled_ = true;
+        schedule_on = worker_;
+      }
+    }
+    if (schedule_on != nullptr) {
+      schedule_on->RunOnceLabeled(kPubSubMailboxLabel, [this]() { Drain(); });
+    }
+  }
+
+  /// Queues an event according to the overflow policy. Returns false if the
+  /// new event was dropped.
+  bool QueueLocked(const Event& event) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    if (overflow_ == MailboxOverflow::kConflate) {
+      if (std::optional<Event> replaced = queue_.Replace(event)) {
+        ++dropped_;
+        Release(*replaced);
+        return true;
+      }
+    }
+    while (!queue_.Push(event)) {
+      if (overflow_ == MailboxOverflow::kDropNewest) {
+        return false;
+      }
+      std::optional<Event> oldest = queue_.Pop();
+      ++dropped_;
+      Release(*oldest);
+    }
+    return true;
+  }
+
+  /// Delivers the oldest event, and reschedules itself until the mailbox is
+  /// empty. Each event is delivered by a separate piece of work, so that other
+  /// work on the same worker can run in between.
+  ///
+  /// The callback is taken out of the mailbox while it runs, and only put back
+  /// if the mailbox was not detached meanwhile.
+  void Drain() PW_LOCKS_EXCLUDED(lock_) {
+    std::optional<Event> event;
+    Callback callback;
+    uint32_t label;
+    Profiler* profiler;
+    uint32_t generation;
+    {
+      std::lock_guard lock(lock_);
+      event = queue_.Pop();
+      if (!event.has_value()) {
+        scheduled_ = false;
+        return;
+      }
+      callback = std::move(callback_);
+      callback_ = nullptr;
+      label = label_;
+      profiler = profiler_;
+      generation = generation_;
+    }
+    if (callback != nullptr) {
+      PW_TRACE_SCOPE("Subscriber", "PubSub", label);
+      Profiler::Measurement measurement(profiler, Profiler::kSubscriber, label);
+      callback(*event);
+    }
+    Release(*event);
+
+    Worker* schedule_on = nullptr;
+    {
+      std::lock_guard lock(lock_);
+      if (generation == generation_) {
+        callback_ = std::move(callback);
+      }
+      if (queue_.empty() || worker_ == nullptr) {
+        scheduled_ = false;
+      } else {
+        schedule_on = worker_;
+      }
+    }
+    if (schedule_on != nullptr) {
+      schedule_on->RunOnceLabeled(kPubSubMailboxLabel, [this]() { Drain(); });
+    }
+  }
+
+  static void Release(const Event& event) {
+    VisitPayload(event, [](const PayloadRef& payload) { payload.Release(); });
+  }
+
+  const MailboxOverflow overflow_;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  Callback callback_ PW_GUARDED_BY(lock_);
+  Filter filter_ PW_GUARDED_BY(lock_) = nullptr;
+  uint32_t label_ PW_GUARDED_BY(lock_) = Profiler::kUnlabeled;
+  Profiler* profiler_ PW_GUARDED_BY(lock_) = nullptr;
+  /// Counts detaches, so that a callback taken by `Drain` before a detach is
+  /// not put back after it.
+  uint32_t generation_ PW_GUARDED_BY(lock_) = 0;
+  Worker* worker_ PW_GUARDED_BY(lock_) = nullptr;
+  PackedEventQueue<Event>& queue_ PW_GUARDED_BY(lock_);
+  bool scheduled_ PW_GUARDED_BY(lock_) = false;
+  uint32_t dropped_ PW_GUARDED_BY(lock_) = 0;
+};
+
+/// A mailbox that always fits `kMaxEvents`, and fits more when events are
+/// smaller than the largest kind of event.
+template <typename Event, size_t kMaxEvents>
+class GenericMailboxBuffer : public GenericMailbox<Event> {
+ public:
+  explicit constexpr GenericMailboxBuffer(MailboxOverflow overflow)
+      : GenericMailbox<Event>(queue_, overflow) {}
+
+ private:
+  PackedEventQueueBuffer<Event,
+                         PackedEventQueue<Event>::CapacityFor(kMaxEvents)>
+      queue_;
+};
+
 template <typename EventType>
 class GenericPubSub {
  public:
   using Event = EventType;
   using SubscribeCallback = pw::Function<void(Event)>;
   using SubscribeToken = size_t;
+  using EventQueue = PackedEventQueue<Event>;
+  using Mailbox = GenericMailbox<Event>;
+
+  template <size_t kMaxEvents>
+  using MailboxBuffer = GenericMailboxBuffer<Event, kMaxEvents>;
 
   struct Subscriber {
     SubscribeToken token = kUnassignedSubscribeToken;
     SubscribeCallback callback = nullptr;
+    uint32_t label = Profiler::kUnlabeled;
+    /// Mailbox that events are passed through, if any.
+    Mailbox* mailbox = nullptr;
   };
 
+  /// Creates a pubsub that notifies subscribers on `worker`. If a profiler is
+  /// given, each subscriber callback is timed under its label. If a payload
+  /// pool is given, publishers can allocate payloads for events from it.
   GenericPubSub(Worker& worker,
-                pw::InlineDeque<Event>& event_queue,
-                pw::span<Subscriber> subscribers)
+                EventQueue& event_queue,
+                pw::span<Subscriber> subscribers,
+                Profiler* profiler = nullptr,
+                PayloadPool* payloads = nullptr)
       : worker_(&worker),
+        profiler_(profiler),
+        payloads_(payloads),
         event_queue_(&event_queue),
         subscribers_(subscribers),
         subscriber_count_(0),
@@ -51,6 +320,10 @@ class GenericPubSub {
 
   /// Attempts to push an event to the event queue, returning whether it was
   /// successfully published. This is both thread safe and interrupt safe.
+  ///
+  /// If the event carries a `PayloadRef` in a member named `payload`, the
+  /// publisher's reference is released once every subscriber has seen the
+  /// event. If the event was not published, the publisher still holds it.
   [[nodiscard]] bool PublishFromInterrupt(Event event) {
     if (event_lock_.try_lock()) {
       bool result = PublishLocked(event);
@@ -69,6 +342,21 @@ class GenericPubSub {
     return PublishLocked(event);
   }
 
+  /// Like `Publish`, but if the event queue is full, `on_room` is run on the
+  /// pubsub's worker once an event has been taken from the queue, so that the
+  /// publisher can try again without polling. Only one publisher may wait for
+  /// room at a time.
+  [[nodiscard]] bool PublishOrWaitForRoom(Event event,
+                                          pw::Function<void()>&& on_room) {
+    std::lock_guard lock(event_lock_);
+    if (PublishLocked(event)) {
+      return true;
+    }
+    PW_CHECK(room_waiter_ == nullptr, "Only one publisher may wait for room");
+    room_waiter_ = std::move(on_room);
+    return false;
+  }
+
   /// Registers a callback to be run when events are received.
   /// If registration was successful, returns a token which can be used to
   /// unsubscribe.
@@ -76,8 +364,11 @@ class GenericPubSub {
   /// All subscribed callbacks are invoked from the context of the work queue
   /// provided to the constructor. Callbacks should avoid long blocking
   /// operations to not starve other callbacks or work queue tasks.
+  ///
+  /// The optional label is a tokenized string that names the subscriber in
+  /// profiles.
   [[nodiscard]] std::optional<SubscribeToken> Subscribe(
-      SubscribeCallback&& callback) {
+      SubscribeCallback&& callback, uint32_t label = Profiler::kUnlabeled) {
     std::lock_guard lock(subscribers_lock_);
 
     auto subscriber =
@@ -93,6 +384,7 @@ class GenericPubSub {
     *subscriber = {
         .token = token,
         .callback = std::move(callback),
+        .label = label,
     };
     subscriber_count_++;
     return token;
@@ -103,36 +395,111 @@ class GenericPubSub {
   /// This is currently equivalent to checking std::holds_alternative before
   /// invoking the callback, buy may be optimized later.
   template <typename VariantType, typename Function>
-  [[nodiscard]] std::optional<SubscribeToken> SubscribeTo(Function&& function) {
+  [[nodiscard]] std::optional<SubscribeToken> SubscribeTo(
+      Function&& function, uint32_t label = Profiler::kUnlabeled) {
     static_assert(
         IsVariant<Event>(),
         "SubscribeTo may only be called when the event type is a std::variant");
-    return Subscribe([f = std::forward<Function>(function)](Event event) {
-      if (std::holds_alternative<VariantType>(event)) {
-        f(std::get<VariantType>(event));
-      }
-    });
+    return Subscribe(
+        [f = std::forward<Function>(function)](Event event) {
+          if (std::holds_alternative<VariantType>(event)) {
+            f(std::get<VariantType>(event));
+          }
+        },
+        label);
+  }
+
+  /// Registers a callback that receives events through a mailbox, and runs on
+  /// `worker` instead of the pubsub's worker. A mailbox can only have one
+  /// subscriber at a time.
+  ///
+  /// Use a mailbox for subscribers that may be slow, so that they do not delay
+  /// the others, and give them their own worker to isolate them completely.
+  [[nodiscard]] std::optional<SubscribeToken> Subscribe(
+      SubscribeCallback&& callback,
+      Mailbox& mailbox,
+      Worker& worker,
+      uint32_t label = Profiler::kUnlabeled) {
+    return SubscribeThrough(
+        mailbox, worker, std::move(callback), /*filter=*/nullptr, label);
+  }
+
+  /// Subscribes to only events of one type through a mailbox. Other events
+  /// are not queued in the mailbox.
+  template <typename VariantType, typename Function>
+  [[nodiscard]] std::optional<SubscribeToken> SubscribeTo(
+      Function&& function,
+      Mailbox& mailbox,
+      Worker& worker,
+      uint32_t label = Profiler::kUnlabeled) {
+    static_assert(
+        IsVariant<Event>(),
+        "SubscribeTo may only be called when the event type is a std::variant");
+    return SubscribeThrough(
+        mailbox,
+        worker,
+        [f = std::forward<Function>(function)](Event event) {
+          f(std::get<VariantType>(event));
+        },
+        [](const Event& event) {
+          return std::holds_alternative<VariantType>(event);
+        },
+        label);
   }
 
   /// Unregisters a previously registered subscriber.
   bool Unsubscribe(SubscribeToken token) {
     std::lock_guard lock(subscribers_lock_);
 
-    auto subscriber = std::find_if(
-        subscribers_.begin(), subscribers_.end(), [token](auto& s) {
-          return s.token == token;
-        });
-    if (subscriber == subscribers_.end()) {
+    Subscriber* subscriber = FindLocked(token);
+    if (subscriber == nullptr) {
       return false;
     }
 
     subscriber->token = kUnassignedSubscribeToken;
     subscriber->callback = nullptr;
+    subscriber->label = Profiler::kUnlabeled;
+    if (subscriber->mailbox != nullptr) {
+      subscriber->mailbox->Detach();
+      subscriber->mailbox = nullptr;
+    }
 
     subscriber_count_--;
     return true;
   }
 
+  /// Returns the latest event of type `T` that was passed to subscribers, if
+  /// any. Only events selected with `kRetainedEvent` are kept.
+  template <typename T>
+  std::optional<T> Retained() const PW_LOCKS_EXCLUDED(event_lock_) {
+    std::lock_guard lock(event_lock_);
+    return retained_.template Get<T>();
+  }
+
+  /// Sends the latest retained event of each type to a subscriber, so that a
+  /// subscriber that joins late, or an RPC client that opens a stream, does
+  /// not have to wait for the next change. Returns false if there is no such
+  /// subscriber.
+  ///
+  /// The events are passed on the pubsub's worker, like other events, so they
+  /// are never passed after a newer event of the same type. If the subscriber
+  /// unsubscribes before then, nothing is sent.
+  bool SendRetained(SubscribeToken token) PW_LOCKS_EXCLUDED(subscribers_lock_) {
+    {
+      std::lock_guard lock(subscribers_lock_);
+      if (FindLocked(token) == nullptr) {
+        return false;
+      }
+    }
+    worker_->RunOnceLabeled(kPubSubRetainedLabel,
+                            [this, token]() { NotifyRetained(token); });
+    return true;
+  }
+
+  /// Returns the pool that publishers allocate event payloads from, or null
+  /// if this pubsub has none.
+  PayloadPool* payloads() const { return payloads_; }
+
   constexpr size_t max_subscribers() const PW_NO_LOCK_SAFETY_ANALYSIS {
     return subscribers_.size();
   }
@@ -167,6 +534,45 @@ class GenericPubSub {
 
   static constexpr SubscribeToken kUnassignedSubscribeToken = SubscribeToken(0);
 
+  std::optional<SubscribeToken> SubscribeThrough(
+      Mailbox& mailbox,
+      Worker& worker,
+      SubscribeCallback&& callback,
+      typename Mailbox::Filter filter,
+      uint32_t label) {
+    std::lock_guard lock(subscribers_lock_);
+
+    auto subscriber =
+        std::find_if(subscribers_.begin(), subscribers_.end(), [](auto& s) {
+          return s.token == kUnassignedSubscribeToken;
+        });
+    if (subscriber == subscribers_.end() ||
+        !mailbox.Attach(
+            worker, std::move(callback), filter, label, profiler_)) {
+      return std::nullopt;
+    }
+
+    SubscribeToken token = GenerateToken();
+
+    *subscriber = {
+        .token = token,
+        .callback = nullptr,
+        .label = label,
+        .mailbox = &mailbox,
+    };
+    subscriber_count_++;
+    return token;
+  }
+
+  Subscriber* FindLocked(SubscribeToken token)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(subscribers_lock_) {
+    auto subscriber = std::find_if(
+        subscribers_.begin(), subscribers_.end(), [token](auto& s) {
+          return s.token == token;
+        });
+    return subscriber != subscribers_.end() ? &*subscriber : nullptr;
+  }
+
   SubscribeToken GenerateToken()
       PW_EXCLUSIVE_LOCKS_REQUIRED(subscribers_lock_) {
     size_t token = next_token_++;
@@ -177,29 +583,37 @@ class GenericPubSub {
   }
 
   bool PublishLocked(Event event) PW_EXCLUSIVE_LOCKS_REQUIRED(event_lock_) {
-    if (event_queue_->full()) {
+    if (!event_queue_->Push(event)) {
       return false;
     }
 
-    event_queue_->push_back(event);
-    worker_->RunOnce([this]() { NotifySubscribers(); });
+    // Events are delivered in the order they are published, so the trace of
+    // each event can be matched by counting.
+    PW_TRACE_START("Event", "PubSub", ++published_);
+    worker_->RunOnceLabeled(kPubSubNotifyLabel,
+                            [this]() { NotifySubscribers(); });
     return true;
   }
 
   void NotifySubscribers() {
     event_lock_.lock();
 
-    if (event_queue_->empty()) {
+    // Copy the event out of the queue so that the lock does not have to be held
+    // while running subscriber callbacks.
+    std::optional<Event> popped = event_queue_->Pop();
+    if (!popped.has_value()) {
       event_lock_.unlock();
       return;
     }
-
-    // Copy the event out of the queue so that the lock does not have to be held
-    // while running subscriber callbacks.
-    Event event = event_queue_->front();
-    event_queue_->pop_front();
+    const Event& event = *popped;
+    uint32_t trace_id = ++dispatched_;
+    retained_.Update(event);
+    pw::Function<void()> room_waiter = std::move(room_waiter_);
+    room_waiter_ = nullptr;
     event_lock_.unlock();
 
+    PW_TRACE_END("Event", "PubSub", trace_id);
+    PW_TRACE_SCOPE("Dispatch", "PubSub", trace_id);
     for (size_t i = 0; i < max_subscribers(); ++i) {
       subscribers_lock_.lock();
       if (subscribers_[i].token == kUnassignedSubscribeToken) {
@@ -212,14 +626,55 @@ class GenericPubSub {
       Subscriber& subscriber = subscribers_[i];
       subscribers_lock_.unlock();
 
-      subscriber.callback(event);
+      Notify(subscriber, event);
+    }
+    VisitPayload(event, [](const PayloadRef& payload) { payload.Release(); });
+
+    if (room_waiter != nullptr) {
+      room_waiter();
     }
   }
 
+  void NotifyRetained(SubscribeToken token) {
+    // Copy the retained events so that the lock does not have to be held while
+    // running the subscriber's callback.
+    event_lock_.lock();
+    const RetainedEvents<Event> retained = retained_;
+    event_lock_.unlock();
+
+    subscribers_lock_.lock();
+    Subscriber* subscriber = FindLocked(token);
+    subscribers_lock_.unlock();
+    if (subscriber == nullptr) {
+      return;
+    }
+    retained.ForEach(
+        [this, subscriber](const Event& event) { Notify(*subscriber, event); });
+  }
+
+  void Notify(Subscriber& subscriber, const Event& event) {
+    if (subscriber.mailbox != nullptr) {
+      subscriber.mailbox->Deliver(event);
+      return;
+    }
+
+    PW_TRACE_SCOPE("Subscriber", "PubSub", subscriber.label);
+    Profiler::Measurement measurement(
+        profiler_, Profiler::kSubscriber, subscriber.label);
+    subscriber.callback(event);
+  }
+
   Worker* worker_;
+  Profiler* profiler_;
+  PayloadPool* payloads_;
 
-  pw::sync::InterruptSpinLock event_lock_;
-  pw::InlineDeque<Event>* event_queue_ PW_GUARDED_BY(event_lock_);
+  mutable pw::sync::InterruptSpinLock event_lock_;
+  EventQueue* event_queue_ PW_GUARDED_BY(event_lock_);
+  RetainedEvents<Event> retained_ PW_GUARDED_BY(event_lock_);
+  uint32_t published_ PW_GUARDED_BY(event_lock_) = 0;
+  uint32_t dispatched_ PW_GUARDED_BY(event_lock_) = 0;
+  // Run once there is room in the event queue.
+  pw::Function<void()> room_waiter_ PW_GUARDED_BY(event_lock_);
 
   pw::sync::InterruptSpinLock subscribers_lock_;
   pw::span<Subscriber> subscribers_ PW_GUARDED_BY(subscribers_lock_);
@@ -227,19 +682,30 @@ class GenericPubSub {
   size_t next_token_ PW_GUARDED_BY(subscribers_lock_);
 };
 
-template <typename Event, size_t kMaxEvents, size_t kMaxSubscribers>
+/// A pubsub with storage for its subscribers, events, and event payloads. The
+/// event queue always fits `kMaxEvents`, and fits more when events are
+/// smaller than the largest kind of event.
+template <typename Event,
+          size_t kMaxEvents,
+          size_t kMaxSubscribers,
+          size_t kPayloadBlockSize = 32,
+          size_t kPayloadBlocks = 4>
 class GenericPubSubBuffer : public GenericPubSub<Event> {
  public:
   using Subscriber = typename GenericPubSub<Event>::Subscriber;
   using SubscribeCallback = typename GenericPubSub<Event>::SubscribeCallback;
   using SubscribeToken = typename GenericPubSub<Event>::SubscribeToken;
 
-  constexpr GenericPubSubBuffer(Worker& worker)
-      : GenericPubSub<Event>(worker, event_queue_, subscribers_) {}
+  constexpr GenericPubSubBuffer(Worker& worker, Profiler* profiler = nullptr)
+      : GenericPubSub<Event>(
+            worker, event_queue_, subscribers_, profiler, &payloads_) {}
 
  private:
-  pw::InlineDeque<Event, kMaxEvents> event_queue_;
+  PackedEventQueueBuffer<Event,
+                         PackedEventQueue<Event>::CapacityFor(kMaxEvents)>
+      event_queue_;
   std::array<Subscriber, kMaxSubscribers> subscribers_;
+  PayloadPoolBuffer<kPayloadBlockSize, kPayloadBlocks> payloads_;
 };
 
 }  // namespace sense
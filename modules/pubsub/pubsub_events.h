@@ -15,6 +15,7 @@
 
 #include <variant>
 
+#include "modules/pubsub/core_bridge.h"
 #include "modules/pubsub/pubsub.h"
 #include "pw_preprocessor/arguments.h"
 
@@ -50,6 +51,34 @@ class ButtonY : public ButtonStateChange {
   using ButtonStateChange::ButtonStateChange;
 };
 
+/// Gesture recognized from debounced button presses and releases.
+struct ButtonGesture {
+  enum Kind : uint8_t {
+    /// One or more short presses of a single button.
+    kClick,
+    /// A single button held down.
+    kLongPress,
+    /// Several buttons pressed together.
+    kChord,
+  };
+
+  /// Bits in `buttons` for each button.
+  static constexpr uint8_t kA = 1u << 0;
+  static constexpr uint8_t kB = 1u << 1;
+  static constexpr uint8_t kX = 1u << 2;
+  static constexpr uint8_t kY = 1u << 3;
+  static constexpr uint8_t kAllButtons = kA | kB | kX | kY;
+
+  Kind kind;
+
+  /// Which buttons made the gesture.
+  uint8_t buttons;
+
+  /// Number of presses of a click, e.g. 2 for a double-click. Zero for other
+  /// gestures.
+  uint8_t clicks;
+};
+
 /// Proximity sensor state change.
 struct ProximityStateChange {
   bool proximity;
@@ -94,15 +123,22 @@ class LedValue {
 struct TimerRequest {
   uint32_t token;
   uint16_t timeout_s;
+  uint16_t timeout_ms = 0;
+  bool periodic = false;
+  bool cancel = false;
 };
 
 struct TimerExpired {
   uint32_t token;
 };
 
+/// Request to encode a message in Morse code. The message is carried in a
+/// payload, which subscribers must retain to use after their callback.
 struct MorseEncodeRequest {
-  std::string_view message;
+  PayloadRef payload;
   uint32_t repeat;
+
+  std::string_view message() const { return payload.as_string(); }
 };
 
 struct MorseCodeValue {
@@ -142,7 +178,8 @@ using Event = std::variant<ButtonA,
                            MorseEncodeRequest,
                            MorseCodeValue,
                            SenseState,
-                           StateManagerControl>;
+                           StateManagerControl,
+                           ButtonGesture>;
 
 // Index versions of Event variants, to support finding the event
 enum EventType : size_t {
@@ -160,13 +197,28 @@ enum EventType : size_t {
   kMorseCodeValue,
   kSenseState,
   kStateManagerControl,
-  kLastEventType = kStateManagerControl,
+  kButtonGesture,
+  kLastEventType = kButtonGesture,
 };
 
 static_assert(kLastEventType + 1 == std::variant_size_v<Event>,
               "The EventTypes enum must match the Event variant");
 
+// The latest sensor readings and state are retained by the pubsub, so that
+// subscribers and RPC clients that join late start with current values.
+template <>
+inline constexpr bool kRetainedEvent<ProximityStateChange> = true;
+template <>
+inline constexpr bool kRetainedEvent<AmbientLightSample> = true;
+template <>
+inline constexpr bool kRetainedEvent<AirQuality> = true;
+template <>
+inline constexpr bool kRetainedEvent<SenseState> = true;
+
 // PubSub using Sense events.
 using PubSub = GenericPubSub<Event>;
 
+// Bridge for publishing Sense events from another core.
+using CoreBridge = GenericCoreBridge<Event>;
+
 }  // namespace sense
@@ -100,4 +100,56 @@ TEST_F(PubSubEventsTest, SubscribeTo) {
   EXPECT_EQ(total_score_, 1024u);
 }
 
+// Only the selected alternatives take space in the retained events.
+static_assert(sense::RetainedEvents<sense::Event>::kSlots == 4);
+
+TEST_F(PubSubEventsTest, RetainsLatestEventOfSelectedTypes) {
+  EXPECT_FALSE(pubsub_.Retained<sense::AirQuality>().has_value());
+
+  ASSERT_TRUE(pubsub_.SubscribeTo<sense::ProximityStateChange>(
+      [this](sense::ProximityStateChange) { notification_.release(); }));
+  ASSERT_TRUE(pubsub_.Publish(sense::AirQuality{.score = 128u}));
+  ASSERT_TRUE(pubsub_.Publish(sense::ButtonA(true)));
+  ASSERT_TRUE(pubsub_.Publish(sense::AirQuality{.score = 256u}));
+  ASSERT_TRUE(pubsub_.Publish(sense::ProximityStateChange{.proximity = true}));
+  notification_.acquire();
+
+  std::optional<sense::AirQuality> air_quality =
+      pubsub_.Retained<sense::AirQuality>();
+  ASSERT_TRUE(air_quality.has_value());
+  EXPECT_EQ(air_quality->score, 256u);
+  std::optional<sense::ProximityStateChange> proximity =
+      pubsub_.Retained<sense::ProximityStateChange>();
+  ASSERT_TRUE(proximity.has_value());
+  EXPECT_TRUE(proximity->proximity);
+  EXPECT_FALSE(pubsub_.Retained<sense::SenseState>().has_value());
+}
+
+TEST_F(PubSubEventsTest, SendRetainedToLateSubscriber) {
+  ASSERT_TRUE(pubsub_.SubscribeTo<sense::AirQuality>(
+      [this](sense::AirQuality) { notification_.release(); }));
+  ASSERT_TRUE(pubsub_.Publish(sense::ButtonA(true)));
+  ASSERT_TRUE(pubsub_.Publish(sense::AirQuality{.score = 512u}));
+  notification_.acquire();
+
+  std::optional<sense::PubSub::SubscribeToken> token =
+      pubsub_.Subscribe([this](sense::Event event) {
+        if (std::holds_alternative<sense::AirQuality>(event)) {
+          total_score_ += std::get<sense::AirQuality>(event).score;
+        } else {
+          FAIL() << "Only retained events are sent";
+        }
+        ++events_processed_;
+        notification_.release();
+      });
+  ASSERT_TRUE(token.has_value());
+  ASSERT_TRUE(pubsub_.SendRetained(*token));
+  notification_.acquire();
+  EXPECT_EQ(events_processed_, 1u);
+  EXPECT_EQ(total_score_, 512u);
+
+  EXPECT_TRUE(pubsub_.Unsubscribe(*token));
+  EXPECT_FALSE(pubsub_.SendRetained(*token));
+}
+
 }  // namespace
@@ -160,6 +160,28 @@ TEST_F(PubSubTest, Publish_MultipleEvents_QueueFull) {
   EXPECT_EQ(response.BlockAndGetValue(), 46u);
 }
 
+TEST_F(PubSubTest, PublishOrWaitForRoom_QueueFull) {
+  EchoResponse& response = responses_[0];
+
+  pw::sync::ThreadNotification pause;
+  worker_.RunOnce([&pause]() { pause.acquire(); });
+
+  ASSERT_TRUE(pubsub_.Subscribe([&response](EchoRequest request) {
+    response.AddValueAndUnblock(request.value);
+  }));
+  response.SetNotifyAfter(5);
+  for (uint32_t value = 10; value < 14; ++value) {
+    ASSERT_TRUE(pubsub_.PublishOrWaitForRoom({.value = value}, nullptr));
+  }
+
+  // The fifth event is published again once the first has been delivered.
+  EXPECT_FALSE(pubsub_.PublishOrWaitForRoom({.value = 14}, [this]() {
+    EXPECT_TRUE(pubsub_.Publish({.value = 14}));
+  }));
+  pause.release();
+  EXPECT_EQ(response.BlockAndGetValue(), 60u);
+}
+
 TEST_F(PubSubTest, Subscribe_Full) {
   for (auto& response : responses_) {
     ASSERT_TRUE(pubsub_.Subscribe([&response](EchoRequest request) {
@@ -215,4 +237,184 @@ TEST_F(PubSubTest, Subscribe_Unsubscribe) {
   EXPECT_FALSE(pubsub_.Unsubscribe(tokens[1]));
 }
 
+class PubSubMailboxTest : public PubSubTest {
+ protected:
+  using Mailbox = PubSub::Mailbox;
+  template <size_t kMaxEvents>
+  using MailboxBuffer = PubSub::MailboxBuffer<kMaxEvents>;
+
+  /// Publishes 1, 2, 3 and 4 while the mailbox's worker is blocked, and waits
+  /// until they have been delivered to the mailbox.
+  void PublishWhileBlocked(Mailbox& mailbox) {
+    EchoResponse& mailbox_response = responses_[0];
+    EchoResponse& direct_response = responses_[1];
+    ASSERT_TRUE(pubsub_.Subscribe(
+        [&mailbox_response](EchoRequest request) {
+          mailbox_response.AddValueAndUnblock(request.value);
+        },
+        mailbox,
+        mailbox_worker_));
+
+    // Subscribers are notified in order, so once this subscriber has seen all
+    // of the events, so has the mailbox.
+    ASSERT_TRUE(pubsub_.Subscribe([&direct_response](EchoRequest request) {
+      direct_response.AddValueAndUnblock(request.value);
+    }));
+    direct_response.SetNotifyAfter(4);
+
+    mailbox_worker_.RunOnce([this]() { pause_.acquire(); });
+    for (uint32_t value = 1; value <= 4; ++value) {
+      ASSERT_TRUE(pubsub_.Publish({.value = value}));
+    }
+    EXPECT_EQ(direct_response.BlockAndGetValue(), 10u);
+  }
+
+  void TearDown() override {
+    mailbox_worker_.Stop();
+    PubSubTest::TearDown();
+  }
+
+  sense::TestWorker<> mailbox_worker_;
+  pw::sync::ThreadNotification pause_;
+
+  // Mailboxes must outlive the work that drains them, which is stopped in
+  // `TearDown`.
+  MailboxBuffer<4> large_mailbox_{sense::MailboxOverflow::kDropOldest};
+  MailboxBuffer<2> drop_oldest_{sense::MailboxOverflow::kDropOldest};
+  MailboxBuffer<2> drop_newest_{sense::MailboxOverflow::kDropNewest};
+  MailboxBuffer<2> conflate_{sense::MailboxOverflow::kConflate};
+};
+
+TEST_F(PubSubMailboxTest, SlowSubscriberDoesNotDelayOthers) {
+  Mailbox& mailbox = large_mailbox_;
+  PublishWhileBlocked(mailbox);
+
+  // The direct subscriber saw every event while the mailbox's subscriber was
+  // blocked.
+  EXPECT_EQ(mailbox.size(), 4u);
+  EXPECT_FALSE(responses_[0].TryGetValue().has_value());
+
+  responses_[0].SetNotifyAfter(4);
+  pause_.release();
+  EXPECT_EQ(responses_[0].BlockAndGetValue(), 10u);
+  EXPECT_EQ(mailbox.dropped(), 0u);
+}
+
+TEST_F(PubSubMailboxTest, DropOldest) {
+  Mailbox& mailbox = drop_oldest_;
+  PublishWhileBlocked(mailbox);
+  EXPECT_EQ(mailbox.dropped(), 2u);
+
+  responses_[0].SetNotifyAfter(2);
+  pause_.release();
+  EXPECT_EQ(responses_[0].BlockAndGetValue(), 3u + 4u);
+}
+
+TEST_F(PubSubMailboxTest, DropNewest) {
+  Mailbox& mailbox = drop_newest_;
+  PublishWhileBlocked(mailbox);
+  EXPECT_EQ(mailbox.dropped(), 2u);
+
+  responses_[0].SetNotifyAfter(2);
+  pause_.release();
+  EXPECT_EQ(responses_[0].BlockAndGetValue(), 1u + 2u);
+}
+
+TEST_F(PubSubMailboxTest, Conflate) {
+  Mailbox& mailbox = conflate_;
+  PublishWhileBlocked(mailbox);
+  EXPECT_EQ(mailbox.size(), 1u);
+  EXPECT_EQ(mailbox.dropped(), 3u);
+
+  responses_[0].SetNotifyAfter(1);
+  pause_.release();
+  EXPECT_EQ(responses_[0].BlockAndGetValue(), 4u);
+}
+
+TEST_F(PubSubMailboxTest, MailboxHasOneSubscriber) {
+  Mailbox& mailbox = drop_oldest_;
+  auto token = pubsub_.Subscribe([](EchoRequest) {}, mailbox, mailbox_worker_);
+  ASSERT_TRUE(token.has_value());
+  EXPECT_FALSE(
+      pubsub_.Subscribe([](EchoRequest) {}, mailbox, mailbox_worker_));
+
+  EXPECT_TRUE(pubsub_.Unsubscribe(*token));
+  EXPECT_TRUE(
+      pubsub_.Subscribe([](EchoRequest) {}, mailbox, mailbox_worker_));
+}
+
+TEST_F(PubSubMailboxTest, UnsubscribeWhileDelivering) {
+  Mailbox& mailbox = large_mailbox_;
+  struct {
+    pw::sync::ThreadNotification running;
+    size_t calls = 0;
+  } old_subscriber;
+  auto token = pubsub_.Subscribe(
+      [this, &old_subscriber](EchoRequest) {
+        ++old_subscriber.calls;
+        old_subscriber.running.release();
+        pause_.acquire();
+      },
+      mailbox,
+      mailbox_worker_);
+  ASSERT_TRUE(token.has_value());
+
+  ASSERT_TRUE(pubsub_.Publish({.value = 1}));
+  old_subscriber.running.acquire();
+
+  // The running callback is not destroyed, and is not put back once it
+  // returns, so events only reach the new subscriber.
+  EXPECT_TRUE(pubsub_.Unsubscribe(*token));
+  EchoResponse& response = responses_[0];
+  ASSERT_TRUE(pubsub_.Subscribe(
+      [&response](EchoRequest request) {
+        response.AddValueAndUnblock(request.value);
+      },
+      mailbox,
+      mailbox_worker_));
+  pause_.release();
+
+  ASSERT_TRUE(pubsub_.Publish({.value = 2}));
+  EXPECT_EQ(response.BlockAndGetValue(), 2u);
+  EXPECT_EQ(old_subscriber.calls, 1u);
+}
+
+struct TextRequest {
+  sense::PayloadRef payload;
+};
+
+TEST(PubSubPayloadTest, PayloadIsReleasedAfterDelivery) {
+  sense::TestWorker<> worker;
+  sense::GenericPubSubBuffer<TextRequest, 2, 2> pubsub(worker);
+  sense::PayloadPool& payloads = *pubsub.payloads();
+
+  // One subscriber keeps the payload, and the other only reads it.
+  pw::sync::ThreadNotification delivered;
+  std::optional<sense::PayloadRef> kept;
+  ASSERT_TRUE(pubsub.Subscribe([&kept](TextRequest request) {
+    EXPECT_TRUE(request.payload.Retain());
+    kept = request.payload;
+  }));
+  ASSERT_TRUE(pubsub.Subscribe([&delivered](TextRequest request) {
+    EXPECT_EQ(request.payload.as_string(), "hello");
+    delivered.release();
+  }));
+
+  std::optional<sense::PayloadRef> payload = payloads.Allocate("hello");
+  ASSERT_TRUE(payload.has_value());
+  ASSERT_TRUE(pubsub.Publish({.payload = *payload}));
+  delivered.acquire();
+
+  // Wait for the pubsub to release its reference after the last subscriber.
+  worker.RunOnce([&delivered]() { delivered.release(); });
+  delivered.acquire();
+  EXPECT_EQ(payloads.available(), payloads.block_count() - 1);
+
+  ASSERT_TRUE(kept.has_value());
+  EXPECT_EQ(kept->as_string(), "hello");
+  kept->Release();
+  EXPECT_EQ(payloads.available(), payloads.block_count());
+  worker.Stop();
+}
+
 }  // namespace
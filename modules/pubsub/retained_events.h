@@ -0,0 +1,146 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <variant>
+
+namespace sense {
+
+/// Whether a pubsub retains the latest event of a type, so that subscribers
+/// that join late can catch up. Specialize as true for a plain event type, or
+/// for an alternative of a `std::variant` event.
+///
+/// Events that carry a payload cannot be retained, since retaining them would
+/// keep their payload blocks from being freed.
+template <typename T>
+inline constexpr bool kRetainedEvent = false;
+
+namespace internal {
+
+template <typename T>
+constexpr bool CanRetain() {
+  if constexpr (requires(const T& value) { value.payload; }) {
+    return !kRetainedEvent<T>;
+  }
+  return true;
+}
+
+}  // namespace internal
+
+/// The latest event of each retained type. It is not thread safe.
+///
+/// Plain events have a single slot if they are retained.
+template <typename Event>
+class RetainedEvents {
+ public:
+  static_assert(internal::CanRetain<Event>(),
+                "Events with payloads cannot be retained");
+
+  static constexpr size_t kSlots = kRetainedEvent<Event> ? 1 : 0;
+
+  void Update(const Event& event) {
+    if constexpr (kRetainedEvent<Event>) {
+      latest_ = event;
+    }
+  }
+
+  /// Returns the latest event of type `T`, if one has been seen.
+  template <typename T>
+  std::optional<T> Get() const {
+    static_assert(std::is_same_v<T, Event> && kRetainedEvent<T>,
+                  "Only retained events can be read back");
+    return latest_;
+  }
+
+  /// Calls `function` with each retained event.
+  template <typename Function>
+  void ForEach(Function&& function) const {
+    if (latest_.has_value()) {
+      function(*latest_);
+    }
+  }
+
+ private:
+  std::optional<Event> latest_;
+};
+
+/// `std::variant` events have one slot for each retained alternative, so only
+/// the selected alternatives take space.
+template <typename... Types>
+class RetainedEvents<std::variant<Types...>> {
+ public:
+  using Event = std::variant<Types...>;
+
+  static_assert((internal::CanRetain<Types>() && ...),
+                "Events with payloads cannot be retained");
+
+  static constexpr size_t kSlots = (size_t{kRetainedEvent<Types>} + ...);
+
+  void Update(const Event& event) {
+    const size_t slot = kSlotOf[event.index()];
+    if (slot != kNoSlot) {
+      latest_[slot] = event;
+    }
+  }
+
+  /// Returns the latest event of type `T`, if one has been seen.
+  template <typename T>
+  std::optional<T> Get() const {
+    static_assert(kRetainedEvent<T>, "Only retained events can be read back");
+    const std::optional<Event>& latest = latest_[kSlotOf[IndexOf<T>()]];
+    if (!latest.has_value()) {
+      return std::nullopt;
+    }
+    return std::get<T>(*latest);
+  }
+
+  /// Calls `function` with each retained event, in the order of the variant's
+  /// alternatives.
+  template <typename Function>
+  void ForEach(Function&& function) const {
+    for (const std::optional<Event>& latest : latest_) {
+      if (latest.has_value()) {
+        function(*latest);
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kNoSlot = std::numeric_limits<size_t>::max();
+
+  template <typename T>
+  static constexpr size_t IndexOf() {
+    size_t index = 0;
+    static_cast<void>(((std::is_same_v<T, Types> ? false : (++index, true)) &&
+                       ...));
+    return index;
+  }
+
+  static constexpr std::array<size_t, sizeof...(Types)> kSlotOf = [] {
+    std::array<size_t, sizeof...(Types)> slots{};
+    size_t index = 0;
+    size_t slot = 0;
+    ((slots[index++] = kRetainedEvent<Types> ? slot++ : kNoSlot), ...);
+    return slots;
+  }();
+
+  std::array<std::optional<Event>, kSlots> latest_;
+};
+
+}  // namespace sense
@@ -19,6 +19,7 @@
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
 #include "pw_string/util.h"
+#include "pw_tokenizer/tokenize.h"
 
 namespace sense {
 namespace {
@@ -43,6 +44,9 @@ pubsub_Event EventToProto(const Event& event) {
     auto& timer_request = std::get<TimerRequest>(event);
     proto.type.timer_request.token = timer_request.token;
     proto.type.timer_request.timeout_s = timer_request.timeout_s;
+    proto.type.timer_request.timeout_ms = timer_request.timeout_ms;
+    proto.type.timer_request.periodic = timer_request.periodic;
+    proto.type.timer_request.cancel = timer_request.cancel;
   } else if (std::holds_alternative<TimerExpired>(event)) {
     proto.which_type = pubsub_Event_timer_expired_tag;
     auto& timer_expired = std::get<TimerExpired>(event);
@@ -64,7 +68,7 @@ pubsub_Event EventToProto(const Event& event) {
     proto.which_type = pubsub_Event_morse_encode_request_tag;
     const auto& morse = std::get<MorseEncodeRequest>(event);
     auto& msg = proto.type.morse_encode_request.msg;
-    msg[morse.message.copy(proto.type.morse_encode_request.msg,
+    msg[morse.message().copy(proto.type.morse_encode_request.msg,
                            sizeof(msg) - 1)] = '\0';
     proto.type.morse_encode_request.repeat = morse.repeat;
   } else if (std::holds_alternative<MorseCodeValue>(event)) {
@@ -103,6 +107,22 @@ pubsub_Event EventToProto(const Event& event) {
             pubsub_StateManagerControl_Action_SILENCE_ALARMS;
         break;
     }
+  } else if (std::holds_alternative<ButtonGesture>(event)) {
+    proto.which_type = pubsub_Event_button_gesture_tag;
+    const auto& gesture = std::get<ButtonGesture>(event);
+    switch (gesture.kind) {
+      case ButtonGesture::kClick:
+        proto.type.button_gesture.kind = pubsub_ButtonGesture_Kind_CLICK;
+        break;
+      case ButtonGesture::kLongPress:
+        proto.type.button_gesture.kind = pubsub_ButtonGesture_Kind_LONG_PRESS;
+        break;
+      case ButtonGesture::kChord:
+        proto.type.button_gesture.kind = pubsub_ButtonGesture_Kind_CHORD;
+        break;
+    }
+    proto.type.button_gesture.buttons = gesture.buttons;
+    proto.type.button_gesture.clicks = gesture.clicks;
   } else {
     PW_LOG_WARN("Unimplemented pubsub service event");
   }
@@ -124,6 +144,10 @@ pw::Result<Event> ProtoToEvent(const pubsub_Event& proto) {
           .token = proto.type.timer_request.token,
           .timeout_s =
               static_cast<uint16_t>(proto.type.timer_request.timeout_s),
+          .timeout_ms =
+              static_cast<uint16_t>(proto.type.timer_request.timeout_ms),
+          .periodic = proto.type.timer_request.periodic,
+          .cancel = proto.type.timer_request.cancel,
       };
     case pubsub_Event_timer_expired_tag:
       return TimerExpired{
@@ -160,9 +184,34 @@ pw::Result<Event> ProtoToEvent(const pubsub_Event& proto) {
           action = StateManagerControl::kSilenceAlarms;
           break;
         case pubsub_StateManagerControl_Action_UNKNOWN:
+        default:
           return pw::Status::InvalidArgument();
       }
       return StateManagerControl(action);
+    case pubsub_Event_button_gesture_tag: {
+      ButtonGesture::Kind kind;
+      switch (proto.type.button_gesture.kind) {
+        case pubsub_ButtonGesture_Kind_CLICK:
+          kind = ButtonGesture::kClick;
+          break;
+        case pubsub_ButtonGesture_Kind_LONG_PRESS:
+          kind = ButtonGesture::kLongPress;
+          break;
+        case pubsub_ButtonGesture_Kind_CHORD:
+          kind = ButtonGesture::kChord;
+          break;
+        case pubsub_ButtonGesture_Kind_UNKNOWN:
+        default:
+          return pw::Status::InvalidArgument();
+      }
+      // Bits for buttons that do not exist are dropped.
+      return ButtonGesture{
+          .kind = kind,
+          .buttons = static_cast<uint8_t>(proto.type.button_gesture.buttons &
+                                          ButtonGesture::kAllButtons),
+          .clicks = static_cast<uint8_t>(proto.type.button_gesture.clicks),
+      };
+    }
     default:
       return pw::Status::Unimplemented();
   }
@@ -170,13 +219,19 @@ pw::Result<Event> ProtoToEvent(const pubsub_Event& proto) {
 
 }  // namespace
 
-void PubSubService::Init(PubSub& pubsub) {
+void PubSubService::Init(PubSub& pubsub, Worker& stream_worker) {
   pubsub_ = &pubsub;
 
-  PW_CHECK(pubsub_->Subscribe([this](Event event) {
-    // Writing to an unopened stream is okay here, so we IgnoreError.
-    stream_.Write(EventToProto(event)).IgnoreError();
-  }));
+  std::optional<PubSub::SubscribeToken> token = pubsub_->Subscribe(
+      [this](Event event) {
+        // Writing to an unopened stream is okay here, so we IgnoreError.
+        stream_.Write(EventToProto(event)).IgnoreError();
+      },
+      mailbox_,
+      stream_worker,
+      PW_TOKENIZE_STRING("pubsub service stream"));
+  PW_CHECK(token.has_value());
+  token_ = *token;
 }
 
 pw::Status PubSubService::Publish(const pubsub_Event& request,
@@ -200,6 +255,12 @@ void PubSubService::Subscribe(const pw_protobuf_Empty&,
   PW_LOG_INFO("Streaming pubsub events over RPC channel %u",
               writer.channel_id());
   stream_ = std::move(writer);
+
+  // Start the new stream with the latest sensor readings and state, rather
+  // than leaving the client to wait for them to change.
+  if (pubsub_ != nullptr) {
+    pubsub_->SendRetained(token_);
+  }
 }
 
 }  // namespace sense
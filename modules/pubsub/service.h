@@ -15,19 +15,31 @@
 
 #include "modules/pubsub/pubsub_events.h"
 #include "modules/pubsub/pubsub_pb/pubsub.rpc.pb.h"
+#include "modules/worker/worker.h"
 
 namespace sense {
 
 class PubSubService final
     : public ::pubsub::pw_rpc::nanopb::PubSub::Service<PubSubService> {
  public:
-  void Init(PubSub& pubsub);
+  /// Maximum number of events waiting to be streamed. Older events are
+  /// dropped when the stream falls behind.
+  static constexpr size_t kMaxStreamedEvents = 8;
+
+  /// Streams events from `pubsub` on `stream_worker`, so that a congested
+  /// transport only delays this service's subscriber.
+  void Init(PubSub& pubsub, Worker& stream_worker);
 
   pw::Status Publish(const pubsub_Event& request, pw_protobuf_Empty&);
+
+  /// Opens a stream of events, which starts with the latest retained events.
   void Subscribe(const pw_protobuf_Empty&, ServerWriter<pubsub_Event>& writer);
 
  private:
   PubSub* pubsub_ = nullptr;
+  PubSub::SubscribeToken token_ = 0;
+  PubSub::MailboxBuffer<kMaxStreamedEvents> mailbox_{
+      MailboxOverflow::kDropOldest};
   ServerWriter<pubsub_Event> stream_;
 };
 
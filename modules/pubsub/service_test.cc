@@ -14,6 +14,8 @@
 
 #include "modules/pubsub/service.h"
 
+#include <optional>
+
 #include "modules/pubsub/pubsub_events.h"
 #include "modules/worker/test_worker.h"
 #include "pw_rpc/nanopb/test_method_context.h"
@@ -47,7 +49,7 @@ class PubSubServiceTest : public ::testing::Test {
 
 TEST_F(PubSubServiceTest, Subscribe) {
   PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
-  ctx.service().Init(pubsub_);
+  ctx.service().Init(pubsub_, worker_);
   ctx.call({});
 
   pw::rpc::test::WaitForPackets(ctx.output(), 3, [this] {
@@ -65,9 +67,28 @@ TEST_F(PubSubServiceTest, Subscribe) {
   EXPECT_EQ(ctx.responses()[2].type.button_y_pressed, true);
 }
 
+TEST_F(PubSubServiceTest, SubscribeStartsWithRetainedEvents) {
+  ASSERT_TRUE(pubsub_.Subscribe([this](sense::Event) {
+    notification_.release();
+  }));
+  EXPECT_TRUE(pubsub_.Publish(sense::AirQuality{.score = 512u}));
+  EXPECT_TRUE(pubsub_.Publish(sense::ButtonA(true)));
+  notification_.acquire();
+  notification_.acquire();
+
+  // Only retained events are sent when the stream opens.
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
+  ctx.service().Init(pubsub_, worker_);
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [&ctx] { ctx.call({}); });
+
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  ASSERT_EQ(ctx.responses()[0].which_type, pubsub_Event_air_quality_tag);
+  EXPECT_EQ(ctx.responses()[0].type.air_quality, 512u);
+}
+
 TEST_F(PubSubServiceTest, Publish) {
   PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Publish) ctx;
-  ctx.service().Init(pubsub_);
+  ctx.service().Init(pubsub_, worker_);
 
   ASSERT_TRUE(pubsub_.Subscribe([this](sense::Event event) {
     events_processed_++;
@@ -126,4 +147,38 @@ TEST_F(PubSubServiceTest, Publish) {
   EXPECT_EQ(button_presses_, 2u);
 }
 
+TEST_F(PubSubServiceTest, PublishGesture) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Publish) ctx;
+  ctx.service().Init(pubsub_, worker_);
+
+  std::optional<sense::ButtonGesture> gesture;
+  ASSERT_TRUE(pubsub_.Subscribe([this, &gesture](sense::Event event) {
+    events_processed_++;
+    if (std::holds_alternative<sense::ButtonGesture>(event)) {
+      gesture = std::get<sense::ButtonGesture>(event);
+    }
+    notification_.release();
+  }));
+
+  pubsub_Event proto = {.which_type = pubsub_Event_button_gesture_tag};
+  proto.type.button_gesture.kind = pubsub_ButtonGesture_Kind_CHORD;
+
+  // Bits above the four buttons are dropped.
+  proto.type.button_gesture.buttons = 0xf5;
+  EXPECT_EQ(ctx.call(proto), pw::OkStatus());
+  notification_.acquire();
+  ASSERT_TRUE(gesture.has_value());
+  EXPECT_EQ(gesture->kind, sense::ButtonGesture::kChord);
+  EXPECT_EQ(gesture->buttons,
+            sense::ButtonGesture::kA | sense::ButtonGesture::kX);
+
+  // Unknown kinds, including any added to the proto later, are rejected.
+  proto.type.button_gesture.kind = pubsub_ButtonGesture_Kind_UNKNOWN;
+  EXPECT_EQ(ctx.call(proto), pw::Status::InvalidArgument());
+  proto.type.button_gesture.kind = static_cast<pubsub_ButtonGesture_Kind>(
+      pubsub_ButtonGesture_Kind_CHORD + 1);
+  EXPECT_EQ(ctx.call(proto), pw::Status::InvalidArgument());
+  EXPECT_EQ(events_processed_, 1u);
+}
+
 }  // namespace
@@ -0,0 +1,146 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/pwm/animator.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+#include "pw_assert/check.h"
+
+namespace sense {
+
+PwmAnimator::~PwmAnimator() {
+  std::lock_guard lock(lock_);
+  for (Animation& animation : animations_) {
+    if (animation.output != nullptr) {
+      animation.output->animator_ = nullptr;
+    }
+  }
+}
+
+pw::Status PwmAnimator::Play(PwmDigitalOut& output,
+                             pw::span<const uint16_t> levels,
+                             uint32_t interval_ms,
+                             uint16_t phase) {
+  PW_CHECK(!levels.empty(), "Cannot play an empty animation!");
+  PW_CHECK_UINT_LE(levels.size(), std::numeric_limits<uint16_t>::max());
+  PW_CHECK_UINT_LT(phase, levels.size());
+  Animation animation;
+  animation.levels = levels;
+  animation.frames = static_cast<uint16_t>(levels.size());
+  animation.frame = phase;
+  return Start(output, std::move(animation), interval_ms);
+}
+
+pw::Status PwmAnimator::Generate(PwmDigitalOut& output,
+                                 Generator&& generator,
+                                 uint16_t frames,
+                                 uint32_t interval_ms) {
+  PW_CHECK(generator, "Cannot set an empty generator!");
+  PW_CHECK_UINT_GT(frames, 0);
+  Animation animation;
+  animation.generator = std::move(generator);
+  animation.frames = frames;
+  return Start(output, std::move(animation), interval_ms);
+}
+
+void PwmAnimator::set_activity_callback(ActivityCallback&& callback) {
+  std::lock_guard lock(lock_);
+  activity_callback_ = std::move(callback);
+  if (activity_callback_ != nullptr) {
+    activity_callback_(num_playing_ != 0);
+  }
+}
+
+void PwmAnimator::Stop(PwmDigitalOut& output) {
+  std::lock_guard lock(lock_);
+  if (Animation* animation = Find(&output); animation != nullptr) {
+    *animation = Animation();
+    if (--num_playing_ == 0 && activity_callback_ != nullptr) {
+      activity_callback_(false);
+    }
+  }
+  if (output.animator_ == this) {
+    output.animator_ = nullptr;
+  }
+}
+
+void PwmAnimator::Tick() {
+  std::lock_guard lock(lock_);
+  for (Animation& animation : animations_) {
+    if (animation.output == nullptr) {
+      continue;
+    }
+    animation.accumulator += animation.frames;
+    if (animation.accumulator < animation.ticks_per_cycle) {
+      continue;
+    }
+    uint32_t steps = animation.accumulator / animation.ticks_per_cycle;
+    animation.accumulator -= steps * animation.ticks_per_cycle;
+    animation.frame =
+        static_cast<uint16_t>((animation.frame + steps) % animation.frames);
+    animation.output->EmitLevel(LevelOf(animation));
+  }
+}
+
+pw::Status PwmAnimator::Start(PwmDigitalOut& output,
+                              Animation&& animation,
+                              uint32_t interval_ms) {
+  // Leave room in the accumulator for one more tick's worth of frames.
+  constexpr uint64_t kMaxTicksPerCycle = std::numeric_limits<uint32_t>::max() -
+                                         std::numeric_limits<uint16_t>::max();
+  uint64_t ticks_per_cycle = uint64_t{tick_hz_} * interval_ms / 1000;
+  animation.ticks_per_cycle = static_cast<uint32_t>(
+      std::clamp<uint64_t>(ticks_per_cycle, 1, kMaxTicksPerCycle));
+  animation.output = &output;
+
+  std::lock_guard lock(lock_);
+  PW_CHECK(output.animator_ == nullptr || output.animator_ == this,
+           "An output may only be animated by one animator");
+  Animation* slot = Find(&output);
+  if (slot == nullptr) {
+    slot = Find(nullptr);
+    if (slot == nullptr) {
+      return pw::Status::ResourceExhausted();
+    }
+    if (num_playing_++ == 0 && activity_callback_ != nullptr) {
+      activity_callback_(true);
+    }
+  }
+  *slot = std::move(animation);
+  output.animator_ = this;
+  output.EmitLevel(LevelOf(*slot));
+  return pw::OkStatus();
+}
+
+PwmAnimator::Animation* PwmAnimator::Find(const PwmDigitalOut* output) {
+  for (Animation& animation : animations_) {
+    if (animation.output == output) {
+      return &animation;
+    }
+  }
+  return nullptr;
+}
+
+uint16_t PwmAnimator::LevelOf(Animation& animation) {
+  if (animation.levels.empty()) {
+    return animation.generator(animation.frame);
+  }
+  return animation.levels[animation.frame];
+}
+
+}  // namespace sense
@@ -0,0 +1,143 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/pwm/digital_out.h"
+#include "pw_function/function.h"
+#include "pw_span/span.h"
+#include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// Animates any number of PWM outputs from a single periodic tick.
+///
+/// Each animation cycles through a number of frames, emitting one level per
+/// frame to its output. Levels either come from a precomputed table, or are
+/// computed by a generator function. Each animation has its own fractional
+/// rate divider, so that outputs with different frame counts and intervals
+/// can play at the same time from one interrupt or timer, with no drift.
+///
+/// An output may only ever be animated by one animator. That animator is the
+/// only one that records itself in the output, and it does so under its lock.
+///
+/// `Tick` is interrupt safe. All other methods are thread safe.
+class PwmAnimator {
+ public:
+  /// Returns the level for a frame of an animation.
+  ///
+  /// Generators are called from `Tick` with the animator locked, and so must
+  /// be interrupt safe, and must not start or stop animations.
+  using Generator = pw::Function<uint16_t(uint16_t frame)>;
+
+  /// Called with true when the first animation starts, and with false when
+  /// the last one stops.
+  ///
+  /// Activity callbacks are called with the animator locked, and so must be
+  /// interrupt safe, and must not start or stop animations.
+  using ActivityCallback = pw::Function<void(bool active)>;
+
+  static constexpr size_t kMaxAnimations = 8;
+
+  /// @param  tick_hz   Rate at which `Tick` is called, in ticks per second.
+  explicit PwmAnimator(uint32_t tick_hz) : tick_hz_(tick_hz) {}
+
+  ~PwmAnimator();
+
+  uint32_t tick_hz() const { return tick_hz_; }
+
+  /// Sets a function to call when animations start and stop, e.g. to stop
+  /// the source of ticks while nothing is playing. It is called immediately
+  /// with whether any animation is playing.
+  void set_activity_callback(ActivityCallback&& callback)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Plays a cycle of precomputed levels on an output repeatedly.
+  ///
+  /// The levels are read in place, and so must remain valid until the
+  /// animation is stopped. Any animation already playing on the output is
+  /// replaced. The output must not have been animated by another animator.
+  ///
+  /// @param  output        Output to emit levels to.
+  /// @param  levels        One cycle of levels.
+  /// @param  interval_ms   The duration of each cycle, in milliseconds.
+  /// @param  phase         Index of the first level to emit.
+  ///
+  /// @returns @rst
+  ///
+  /// .. pw-status-codes::
+  ///
+  ///    OK: The animation has started, and its first level has been emitted.
+  ///
+  ///    RESOURCE_EXHAUSTED: `kMaxAnimations` animations are already playing.
+  ///
+  /// @endrst
+  pw::Status Play(PwmDigitalOut& output,
+                  pw::span<const uint16_t> levels,
+                  uint32_t interval_ms,
+                  uint16_t phase = 0);
+
+  /// Like `Play`, but calls `generator` to compute the level for each of
+  /// `frames` frames as they are emitted.
+  pw::Status Generate(PwmDigitalOut& output,
+                      Generator&& generator,
+                      uint16_t frames,
+                      uint32_t interval_ms);
+
+  /// Stops any animation playing on an output. The output keeps the last level
+  /// emitted.
+  void Stop(PwmDigitalOut& output);
+
+  /// Advances every animation by one tick, emitting new levels for those that
+  /// reach a new frame.
+  void Tick();
+
+ private:
+  struct Animation {
+    PwmDigitalOut* output = nullptr;
+    pw::span<const uint16_t> levels;
+    Generator generator;
+    uint16_t frames = 0;
+    uint16_t frame = 0;
+
+    // Fractional rate divider: each tick adds `frames` to `accumulator`, and
+    // each whole `ticks_per_cycle` in it advances the animation by one frame.
+    uint32_t ticks_per_cycle = 0;
+    uint32_t accumulator = 0;
+  };
+
+  /// Adds or replaces the animation for `output`, and emits its first level.
+  pw::Status Start(PwmDigitalOut& output,
+                   Animation&& animation,
+                   uint32_t interval_ms) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the animation for an output, or a free slot if `output` is null.
+  Animation* Find(const PwmDigitalOut* output)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  static uint16_t LevelOf(Animation& animation);
+
+  const uint32_t tick_hz_;
+  pw::sync::InterruptSpinLock lock_;
+  std::array<Animation, kMaxAnimations> animations_ PW_GUARDED_BY(lock_);
+  size_t num_playing_ PW_GUARDED_BY(lock_) = 0;
+  ActivityCallback activity_callback_ PW_GUARDED_BY(lock_);
+};
+
+}  // namespace sense
@@ -0,0 +1,180 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/pwm/animator.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/pwm/digital_out_fake.h"
+#include "pw_containers/vector.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+constexpr std::array<uint16_t, 4> kLevels = {10, 20, 30, 40};
+
+// Test fixtures.
+
+class PwmAnimatorTest : public ::testing::Test {
+ protected:
+  static constexpr uint32_t kTickHz = 1000;
+
+  PwmAnimatorTest() : animator_(kTickHz) {}
+
+  void Tick(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      animator_.Tick();
+    }
+  }
+
+  PwmDigitalOutFake output1_;
+  PwmDigitalOutFake output2_;
+  PwmAnimator animator_;
+};
+
+// Unit tests.
+
+TEST_F(PwmAnimatorTest, PlayEmitsFirstLevel) {
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 100, 2), pw::OkStatus());
+  EXPECT_TRUE(output1_.is_playing());
+  ASSERT_EQ(output1_.frames().size(), 1u);
+  EXPECT_EQ(output1_.level(), 30u);
+}
+
+TEST_F(PwmAnimatorTest, ActivityCallbackFollowsFirstAndLastAnimation) {
+  pw::Vector<bool, 8> calls;
+  animator_.set_activity_callback(
+      [&calls](bool active) { calls.push_back(active); });
+  ASSERT_EQ(calls.size(), 1u);
+  EXPECT_FALSE(calls[0]);
+
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 100), pw::OkStatus());
+  ASSERT_EQ(animator_.Play(output2_, kLevels, 100), pw::OkStatus());
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 50), pw::OkStatus());
+  ASSERT_EQ(calls.size(), 2u);
+  EXPECT_TRUE(calls[1]);
+
+  output1_.SetLevel(0);
+  EXPECT_EQ(calls.size(), 2u);
+  output2_.SetLevel(0);
+  ASSERT_EQ(calls.size(), 3u);
+  EXPECT_FALSE(calls[2]);
+  output2_.SetLevel(0);
+  EXPECT_EQ(calls.size(), 3u);
+}
+
+TEST_F(PwmAnimatorTest, SlowAnimationDividesTicks) {
+  // 4 frames in 100 ms at 1 kHz is one frame every 25 ticks.
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 100), pw::OkStatus());
+  Tick(24);
+  EXPECT_EQ(output1_.frames().size(), 1u);
+  Tick(1);
+  EXPECT_EQ(output1_.frames().size(), 2u);
+  EXPECT_EQ(output1_.level(), 20u);
+  Tick(75);
+  ASSERT_EQ(output1_.frames().size(), 5u);
+  EXPECT_EQ(output1_.frames()[3], 40u);
+  EXPECT_EQ(output1_.frames()[4], 10u);
+}
+
+TEST_F(PwmAnimatorTest, FractionalRateDoesNotDrift) {
+  // 4 frames in 7 ms is not a whole number of ticks per frame, but each cycle
+  // still takes exactly 7 ticks.
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 7), pw::OkStatus());
+  Tick(7 * 10);
+  EXPECT_EQ(output1_.frames().size(), 1u + 4 * 10);
+  EXPECT_EQ(output1_.level(), 10u);
+}
+
+TEST_F(PwmAnimatorTest, FastAnimationSkipsFrames) {
+  // 4 frames in 2 ms is two frames per tick.
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 2), pw::OkStatus());
+  Tick(3);
+  ASSERT_EQ(output1_.frames().size(), 4u);
+  EXPECT_EQ(output1_.frames()[1], 30u);
+  EXPECT_EQ(output1_.frames()[2], 10u);
+  EXPECT_EQ(output1_.frames()[3], 30u);
+}
+
+TEST_F(PwmAnimatorTest, GenerateComputesLevels) {
+  ASSERT_EQ(animator_.Generate(
+                output1_,
+                [](uint16_t frame) { return static_cast<uint16_t>(frame * 2); },
+                100,
+                100),
+            pw::OkStatus());
+  Tick(10);
+  ASSERT_EQ(output1_.frames().size(), 11u);
+  for (uint16_t i = 0; i < 11; ++i) {
+    EXPECT_EQ(output1_.frames()[i], i * 2);
+  }
+}
+
+TEST_F(PwmAnimatorTest, OutputsAnimateIndependently) {
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 4), pw::OkStatus());
+  ASSERT_EQ(animator_.Play(output2_, kLevels, 8, 1), pw::OkStatus());
+  Tick(8);
+  EXPECT_EQ(output1_.frames().size(), 9u);
+  EXPECT_EQ(output2_.frames().size(), 5u);
+  EXPECT_EQ(output1_.level(), 10u);
+  EXPECT_EQ(output2_.level(), 20u);
+}
+
+TEST_F(PwmAnimatorTest, PlayReplacesAnimation) {
+  constexpr std::array<uint16_t, 2> kOther = {1, 2};
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 4), pw::OkStatus());
+  ASSERT_EQ(animator_.Play(output1_, kOther, 2), pw::OkStatus());
+  Tick(1);
+  EXPECT_EQ(output1_.level(), 2u);
+}
+
+TEST_F(PwmAnimatorTest, SetLevelStopsAnimation) {
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 4), pw::OkStatus());
+  ASSERT_EQ(animator_.Play(output2_, kLevels, 4), pw::OkStatus());
+  output1_.SetLevel(500);
+  EXPECT_FALSE(output1_.is_playing());
+  EXPECT_TRUE(output2_.is_playing());
+  Tick(4);
+  EXPECT_EQ(output1_.level(), 500u);
+  EXPECT_EQ(output2_.frames().size(), 5u);
+}
+
+TEST_F(PwmAnimatorTest, DisableStopsAnimation) {
+  output1_.Enable();
+  ASSERT_EQ(animator_.Play(output1_, kLevels, 4), pw::OkStatus());
+  output1_.Disable();
+  EXPECT_FALSE(output1_.is_playing());
+  Tick(4);
+  EXPECT_EQ(output1_.frames().size(), 1u);
+}
+
+TEST_F(PwmAnimatorTest, TooManyAnimations) {
+  std::array<PwmDigitalOutFake, PwmAnimator::kMaxAnimations + 1> outputs;
+  for (size_t i = 0; i < PwmAnimator::kMaxAnimations; ++i) {
+    EXPECT_EQ(animator_.Play(outputs[i], kLevels, 4), pw::OkStatus());
+  }
+  EXPECT_EQ(animator_.Play(outputs.back(), kLevels, 4),
+            pw::Status::ResourceExhausted());
+  EXPECT_FALSE(outputs.back().is_playing());
+
+  // Freeing a slot makes room.
+  animator_.Stop(outputs.front());
+  EXPECT_EQ(animator_.Play(outputs.back(), kLevels, 4), pw::OkStatus());
+}
+
+}  // namespace
+}  // namespace sense
@@ -15,68 +15,62 @@
 
 #include <cstdint>
 
-#include "pw_chrono/system_clock.h"
-#include "pw_function/function.h"
-
 namespace sense {
 
+class PwmAnimator;
+
 /// This class represents an output being driven by the PWM block.
+///
+/// Outputs may be animated using a `PwmAnimator`, but only ever by one.
 class PwmDigitalOut {
  public:
-  using Callback = ::pw::Function<void()>;
-
-  virtual ~PwmDigitalOut() = default;
+  virtual ~PwmDigitalOut() { StopAnimation(); }
 
   /// Sets the output to be driven by the PWM block.
   void Enable() { DoEnable(); }
 
   /// Resets the output to a default configuration.
-  void Disable() { DoDisable(); }
-
-  /// Sets the output level of the output.
   ///
-  /// 0 is off, std::limits::max<uint16_t> is full on.
-  void SetLevel(uint16_t level) { DoSetLevel(level); }
+  /// Stops any animation that is playing.
+  void Disable() {
+    StopAnimation();
+    DoDisable();
+  }
 
-  /// Sets a callback to invoke periodically. Only one callback may be set at a
-  /// time across all `PwmDigitalOut` instances.
-  ///
-  /// The behavior of the callback may vary cyclically, i.e. fading an LED on
-  /// and off. The callback is invoked a number of times in each interval of
-  /// time.
+  /// Sets the output level of the output.
   ///
-  /// @param  callback      Function to invoke repeatedly.
-  /// @param  per_interval  Number of time the function should be invoked per
-  ///                       elaped interval.
-  /// @param  interval_ms   The dureation of each interval, in milliseconds.
-  void SetCallback(Callback&& callback,
-                   uint16_t per_interval,
-                   uint32_t interval_ms);
+  /// 0 is off, std::limits::max<uint16_t> is full on. Stops any animation that
+  /// is playing.
+  void SetLevel(uint16_t level) {
+    StopAnimation();
+    DoSetLevel(level);
+  }
 
-  /// Discards the previously set callback, if any.
-  void ClearCallback();
+  /// Returns whether an animation is playing.
+  bool is_playing() const { return animator_ != nullptr; }
 
  protected:
   PwmDigitalOut() = default;
 
-  // Invokes the callback, which MUST be set!
-  void InvokeCallback() const { callback_(); }
+ private:
+  friend class PwmAnimator;
 
-  void ClearCallbackFunction() { callback_ = nullptr; }
+  void StopAnimation();
+
+  /// Sets the level for a frame of an animation, possibly from an interrupt.
+  void EmitLevel(uint16_t level) { DoEmitLevel(level); }
 
- private:
   virtual void DoEnable() = 0;
 
   virtual void DoDisable() = 0;
 
   virtual void DoSetLevel(uint16_t level) = 0;
 
-  virtual void DoSetCallback(uint16_t per_interval,
-                             pw::chrono::SystemClock::duration interval) = 0;
-
-  virtual void DoClearCallback() = 0;
+  /// Like `DoSetLevel`, but called from `PwmAnimator::Tick`. Must be interrupt
+  /// safe.
+  virtual void DoEmitLevel(uint16_t level) { DoSetLevel(level); }
 
-  Callback callback_;
+  PwmAnimator* animator_ = nullptr;
 };
 
 }  // namespace sense
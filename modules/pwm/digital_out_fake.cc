@@ -62,9 +62,12 @@ void PwmDigitalOutFake::DoSetLevel(uint16_t level) {
   }
 }
 
-void PwmDigitalOutFake::DoSetCallback(uint16_t,
-                                      pw::chrono::SystemClock::duration) {}
-
-void PwmDigitalOutFake::DoClearCallback() {}
+void PwmDigitalOutFake::DoEmitLevel(uint16_t level) {
+  level_ = level;
+  if (frames_.full()) {
+    frames_.pop_front();
+  }
+  frames_.push_back(level);
+}
 
 }  // namespace sense
@@ -13,8 +13,12 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "modules/pwm/digital_out.h"
 #include "pw_chrono/system_clock.h"
+#include "pw_containers/inline_deque.h"
 #include "pw_sync/thread_notification.h"
 #include "pw_sync/timed_thread_notification.h"
 
@@ -28,11 +32,18 @@ class PwmDigitalOutFake : public PwmDigitalOut {
  public:
   using Notification = ::pw::sync::ThreadNotification;
 
+  static constexpr size_t kMaxFrames = 256;
+
   PwmDigitalOutFake() = default;
 
   bool enabled() const { return enabled_; }
   uint16_t level() const { return level_; }
 
+  /// Returns the most recent levels emitted by animations, oldest first.
+  ///
+  /// Up to `kMaxFrames` levels are kept.
+  pw::InlineDeque<uint16_t>& frames() { return frames_; }
+
   /// Enables or disables "synchronous mode".
   ///
   /// When enabled, each call to `SetLevel` will block until another thread
@@ -55,17 +66,14 @@ class PwmDigitalOutFake : public PwmDigitalOut {
 
   void DoSetLevel(uint16_t level) override;
 
-  void DoSetCallback(uint16_t per_interval,
-                     pw::chrono::SystemClock::duration interval) override;
-
-  void DoClearCallback() override;
+  void DoEmitLevel(uint16_t level) override;
 
   bool enabled_ = false;
   uint16_t level_ = 0;
   bool sync_ = false;
   pw::sync::TimedThreadNotification notify_;
   pw::sync::ThreadNotification ack_;
-  ;
+  pw::InlineDeque<uint16_t, kMaxFrames> frames_;
 };
 
 }  // namespace sense
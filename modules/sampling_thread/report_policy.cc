@@ -0,0 +1,73 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/report_policy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace sense {
+
+bool ReportOnChange::ShouldReport(float value,
+                                  pw::chrono::SystemClock::time_point now) {
+  std::lock_guard lock(lock_);
+  bool report = !has_report_;
+  if (!report) {
+    const auto elapsed = now - last_time_;
+    const float deadband =
+        std::max(policy_.absolute_deadband,
+                 policy_.relative_deadband * std::fabs(last_value_));
+    const bool changed = std::fabs(value - last_value_) > deadband;
+    const bool silent_too_long = policy_.max_silence.count() > 0 &&
+                                 elapsed >= policy_.max_silence;
+    report = silent_too_long || (changed && elapsed >= policy_.min_interval);
+  }
+
+  if (!report) {
+    ++suppressed_;
+  }
+  return report;
+}
+
+void ReportOnChange::MarkReported(float value,
+                                  pw::chrono::SystemClock::time_point now) {
+  std::lock_guard lock(lock_);
+  ++reported_;
+  has_report_ = true;
+  last_value_ = value;
+  last_time_ = now;
+}
+
+ReportPolicy ReportOnChange::policy() const {
+  std::lock_guard lock(lock_);
+  return policy_;
+}
+
+void ReportOnChange::set_policy(const ReportPolicy& policy) {
+  std::lock_guard lock(lock_);
+  policy_ = policy;
+}
+
+uint32_t ReportOnChange::reported() const {
+  std::lock_guard lock(lock_);
+  return reported_;
+}
+
+uint32_t ReportOnChange::suppressed() const {
+  std::lock_guard lock(lock_);
+  return suppressed_;
+}
+
+}  // namespace sense
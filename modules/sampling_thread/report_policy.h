@@ -0,0 +1,88 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// When a sensor channel's samples are worth publishing.
+///
+/// A sample is reported if it differs from the last reported sample by more
+/// than the larger of the two deadbands, and at least `min_interval` has
+/// passed since the last report. With both deadbands at zero, any change is
+/// reported. A sample is always reported once `max_silence` has passed, so
+/// subscribers still hear from a steady sensor.
+struct ReportPolicy {
+  /// Largest change that is not reported, in the channel's units.
+  float absolute_deadband = 0.f;
+
+  /// Largest change that is not reported, as a fraction of the last report.
+  float relative_deadband = 0.f;
+
+  /// Minimum time between reports. Zero reports every change.
+  pw::chrono::SystemClock::duration min_interval{0};
+
+  /// Maximum time between reports. Zero never reports unchanged samples.
+  pw::chrono::SystemClock::duration max_silence{0};
+};
+
+/// Decides whether to publish each sample of a sensor channel, according to a
+/// `ReportPolicy`, and counts the samples it suppresses.
+///
+/// A sample that should be reported is only compared against once it is marked
+/// as reported, so a sample that fails to publish is not lost, and the next
+/// sample is checked against the last one subscribers actually received.
+///
+/// The policy can be changed from another thread while samples are checked.
+class ReportOnChange {
+ public:
+  explicit ReportOnChange(const ReportPolicy& policy) : policy_(policy) {}
+
+  /// Returns whether `value`, sampled at `now`, should be published.
+  bool ShouldReport(float value, pw::chrono::SystemClock::time_point now)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Records that `value`, sampled at `now`, was published, which makes it the
+  /// last reported value.
+  void MarkReported(float value, pw::chrono::SystemClock::time_point now)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  ReportPolicy policy() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Replaces the policy. The next sample is compared against the last report
+  /// using the new policy.
+  void set_policy(const ReportPolicy& policy) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Number of samples reported.
+  uint32_t reported() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Number of samples suppressed.
+  uint32_t suppressed() const PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  mutable pw::sync::InterruptSpinLock lock_;
+  ReportPolicy policy_ PW_GUARDED_BY(lock_);
+  bool has_report_ PW_GUARDED_BY(lock_) = false;
+  float last_value_ PW_GUARDED_BY(lock_) = 0.f;
+  pw::chrono::SystemClock::time_point last_time_ PW_GUARDED_BY(lock_);
+  uint32_t reported_ PW_GUARDED_BY(lock_) = 0;
+  uint32_t suppressed_ PW_GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace sense
@@ -0,0 +1,110 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/report_policy.h"
+
+#include <chrono>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using namespace std::chrono_literals;
+using pw::chrono::SystemClock;
+
+constexpr SystemClock::time_point kStart{};
+
+/// Checks a sample as the sampling thread does, and marks it as reported if it
+/// should be, as if it was published.
+bool Sample(ReportOnChange& gate, float value, SystemClock::time_point time) {
+  if (!gate.ShouldReport(value, time)) {
+    return false;
+  }
+  gate.MarkReported(value, time);
+  return true;
+}
+
+TEST(ReportOnChangeTest, ReportsFirstSampleAndChanges) {
+  ReportOnChange gate({});
+  EXPECT_TRUE(Sample(gate, 10.f, kStart));
+  EXPECT_FALSE(Sample(gate, 10.f, kStart + 250ms));
+  EXPECT_TRUE(Sample(gate, 11.f, kStart + 500ms));
+  EXPECT_EQ(gate.reported(), 2u);
+  EXPECT_EQ(gate.suppressed(), 1u);
+}
+
+TEST(ReportOnChangeTest, AbsoluteDeadband) {
+  ReportOnChange gate({.absolute_deadband = 5.f});
+  EXPECT_TRUE(Sample(gate, 100.f, kStart));
+  EXPECT_FALSE(Sample(gate, 104.f, kStart + 1s));
+  EXPECT_FALSE(Sample(gate, 95.f, kStart + 2s));
+  EXPECT_TRUE(Sample(gate, 106.f, kStart + 3s));
+
+  // Changes are measured from the last report.
+  EXPECT_FALSE(Sample(gate, 102.f, kStart + 4s));
+}
+
+TEST(ReportOnChangeTest, RelativeDeadband) {
+  ReportOnChange gate({.relative_deadband = 0.1f});
+  EXPECT_TRUE(Sample(gate, 1000.f, kStart));
+  EXPECT_FALSE(Sample(gate, 1090.f, kStart + 1s));
+  EXPECT_TRUE(Sample(gate, 1110.f, kStart + 2s));
+  EXPECT_TRUE(Sample(gate, 50.f, kStart + 3s));
+  EXPECT_FALSE(Sample(gate, 54.f, kStart + 4s));
+}
+
+TEST(ReportOnChangeTest, MinInterval) {
+  ReportOnChange gate({.min_interval = SystemClock::for_at_least(1s)});
+  EXPECT_TRUE(Sample(gate, 1.f, kStart));
+  EXPECT_FALSE(Sample(gate, 2.f, kStart + 500ms));
+  EXPECT_TRUE(Sample(gate, 3.f, kStart + 1s));
+}
+
+TEST(ReportOnChangeTest, MaxSilenceHeartbeat) {
+  ReportOnChange gate({.max_silence = SystemClock::for_at_least(1s)});
+  EXPECT_TRUE(Sample(gate, 7.f, kStart));
+  EXPECT_FALSE(Sample(gate, 7.f, kStart + 500ms));
+  EXPECT_TRUE(Sample(gate, 7.f, kStart + 1s));
+  EXPECT_FALSE(Sample(gate, 7.f, kStart + 1500ms));
+}
+
+TEST(ReportOnChangeTest, PolicyCanChange) {
+  ReportOnChange gate({.absolute_deadband = 100.f});
+  EXPECT_TRUE(Sample(gate, 0.f, kStart));
+  EXPECT_FALSE(Sample(gate, 50.f, kStart + 1s));
+
+  gate.set_policy({.absolute_deadband = 10.f});
+  EXPECT_EQ(gate.policy().absolute_deadband, 10.f);
+  EXPECT_TRUE(Sample(gate, 50.f, kStart + 2s));
+}
+
+TEST(ReportOnChangeTest, UnpublishedSampleIsReportedAgain) {
+  ReportOnChange gate({.absolute_deadband = 5.f});
+  EXPECT_TRUE(Sample(gate, 100.f, kStart));
+
+  // The change fails to publish, so it is still compared to the first report.
+  EXPECT_TRUE(gate.ShouldReport(110.f, kStart + 1s));
+  EXPECT_TRUE(gate.ShouldReport(110.f, kStart + 2s));
+  EXPECT_EQ(gate.reported(), 1u);
+
+  gate.MarkReported(110.f, kStart + 2s);
+  EXPECT_FALSE(Sample(gate, 110.f, kStart + 3s));
+  EXPECT_EQ(gate.reported(), 2u);
+  EXPECT_EQ(gate.suppressed(), 1u);
+}
+
+}  // namespace
+}  // namespace sense
@@ -15,7 +15,9 @@
 #include "modules/sampling_thread/sampling_thread.h"
 
 #include <chrono>
+#include <cstdint>
 
+#include "modules/filter/filter.h"
 #include "pw_assert/check.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_log/log.h"
@@ -30,14 +32,26 @@ using pw::chrono::SystemClock;
 
 constexpr SystemClock::duration kPeriod = std::chrono::milliseconds(250);
 
-void ReadProximity() {
+// Proximity samples occasionally spike for a single sample, and jitter by a
+// few counts when nothing is moving.
+using ProximityFilter =
+    FilterPipeline<MedianFilter<uint16_t, 3>, DeadbandFilter<uint16_t>>;
+constexpr uint16_t kProximityDeadband = 32;
+
+void ReadProximity(ProximityFilter& filter) {
   pw::Result<uint16_t> sample = system::ProximitySensor().ReadSample();
   if (!sample.ok()) {
     PW_LOG_WARN("Failed to read proximity sensor sample: %s",
                 sample.status().str());
     return;
   }
-  std::ignore = system::PubSub().Publish(ProximitySample{*sample});
+  const uint16_t filtered = filter.Update(*sample);
+  const SystemClock::time_point now = SystemClock::now();
+  ReportOnChange& report = GetSamplingReports().proximity;
+  if (report.ShouldReport(filtered, now) &&
+      system::SamplingBridge().Publish(ProximitySample{filtered})) {
+    report.MarkReported(filtered, now);
+  }
 }
 
 void ReadAmbientLight() {
@@ -47,7 +61,12 @@ void ReadAmbientLight() {
                 sample.status().str());
     return;
   }
-  std::ignore = system::PubSub().Publish(AmbientLightSample{*sample});
+  const SystemClock::time_point now = SystemClock::now();
+  ReportOnChange& report = GetSamplingReports().ambient_light;
+  if (report.ShouldReport(*sample, now) &&
+      system::SamplingBridge().Publish(AmbientLightSample{*sample})) {
+    report.MarkReported(*sample, now);
+  }
 }
 
 void ReadAirSensor() {
@@ -60,7 +79,12 @@ void ReadAirSensor() {
     return;
   }
 
-  std::ignore = system::PubSub().Publish(AirQuality{*score});
+  const SystemClock::time_point now = SystemClock::now();
+  ReportOnChange& report = GetSamplingReports().air_quality;
+  if (report.ShouldReport(*score, now) &&
+      system::SamplingBridge().Publish(AirQuality{*score})) {
+    report.MarkReported(*score, now);
+  }
 }
 
 [[nodiscard]] bool LogInit(const char* type, pw::Status init_result) {
@@ -72,6 +96,27 @@ void ReadAirSensor() {
 
 }  // namespace
 
+SamplingReports& GetSamplingReports() {
+  using namespace std::chrono_literals;
+  static SamplingReports reports{
+      // Brightness only needs to follow noticeable changes in light.
+      .ambient_light = ReportOnChange({
+          .relative_deadband = 0.05f,
+          .max_silence = SystemClock::for_at_least(10s),
+      }),
+      // Proximity samples are already held by a deadband filter.
+      .proximity = ReportOnChange({
+          .max_silence = SystemClock::for_at_least(10s),
+      }),
+      // Air quality is smoothed by its subscribers, which need steady samples
+      // to converge.
+      .air_quality = ReportOnChange({
+          .max_silence = SystemClock::for_at_least(1s),
+      }),
+  };
+  return reports;
+}
+
 // Reads sensor samples in a loop and publishes PubSub events for them.
 void SamplingLoop() {
   const bool ambient_light_enabled =
@@ -80,6 +125,9 @@ void SamplingLoop() {
       LogInit("Proximity", system::ProximitySensor().Enable());
   const bool air_enabled = LogInit("Air", system::AirSensor().Init());
 
+  ProximityFilter proximity_filter{
+      MedianFilter<uint16_t, 3>{}, DeadbandFilter<uint16_t>{kProximityDeadband}};
+
   SystemClock::time_point deadline = SystemClock::now();
 
   while (true) {
@@ -90,7 +138,7 @@ void SamplingLoop() {
       ReadAmbientLight();
     }
     if (prox_enabled) {
-      ReadProximity();
+      ReadProximity(proximity_filter);
     }
     if (air_enabled) {
       ReadAirSensor();
@@ -11,9 +11,25 @@
 // WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
 // License for the specific language governing permissions and limitations under
 // the License.
+#pragma once
+
+#include "modules/sampling_thread/report_policy.h"
+
 namespace sense {
 
-// Reads sensor samples in a loop and publishes PubSub events for them.
+/// Report-on-change gates for the sensor channels that `SamplingLoop`
+/// publishes. Samples that a gate suppresses are not published.
+struct SamplingReports {
+  ReportOnChange ambient_light;
+  ReportOnChange proximity;
+  ReportOnChange air_quality;
+};
+
+/// Returns the sampling loop's report-on-change gates.
+SamplingReports& GetSamplingReports();
+
+// Reads sensor samples in a loop and publishes PubSub events for them through
+// the sampling core bridge.
 [[noreturn]] void SamplingLoop();
 
 }  // namespace sense
@@ -0,0 +1,93 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/service.h"
+
+#include <chrono>
+
+#include "pw_chrono/system_clock.h"
+
+namespace sense {
+namespace {
+
+using pw::chrono::SystemClock;
+
+sampling_Policy ToProto(const ReportPolicy& policy) {
+  return {
+      .absolute_deadband = policy.absolute_deadband,
+      .relative_deadband = policy.relative_deadband,
+      .min_interval_ms = static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              policy.min_interval)
+              .count()),
+      .max_silence_ms = static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              policy.max_silence)
+              .count()),
+  };
+}
+
+ReportPolicy FromProto(const sampling_Policy& policy) {
+  return {
+      .absolute_deadband = policy.absolute_deadband,
+      .relative_deadband = policy.relative_deadband,
+      .min_interval = SystemClock::for_at_least(
+          std::chrono::milliseconds(policy.min_interval_ms)),
+      .max_silence = SystemClock::for_at_least(
+          std::chrono::milliseconds(policy.max_silence_ms)),
+  };
+}
+
+}  // namespace
+
+ReportOnChange* SamplingService::Channel(sampling_Channel channel) {
+  switch (channel) {
+    case sampling_Channel_AMBIENT_LIGHT:
+      return &reports_.ambient_light;
+    case sampling_Channel_PROXIMITY:
+      return &reports_.proximity;
+    case sampling_Channel_AIR_QUALITY:
+      return &reports_.air_quality;
+  }
+  return nullptr;
+}
+
+pw::Status SamplingService::GetReportStats(const pw_protobuf_Empty&,
+                                           sampling_ReportStats& response) {
+  for (sampling_Channel channel : {sampling_Channel_AMBIENT_LIGHT,
+                                   sampling_Channel_PROXIMITY,
+                                   sampling_Channel_AIR_QUALITY}) {
+    ReportOnChange& gate = *Channel(channel);
+    response.channels[response.channels_count++] = {
+        .channel = channel,
+        .has_policy = true,
+        .policy = ToProto(gate.policy()),
+        .reported = gate.reported(),
+        .suppressed = gate.suppressed(),
+    };
+  }
+  return pw::OkStatus();
+}
+
+pw::Status SamplingService::SetReportPolicy(
+    const sampling_SetReportPolicyRequest& request, pw_protobuf_Empty&) {
+  ReportOnChange* gate = Channel(request.channel);
+  if (gate == nullptr) {
+    return pw::Status::InvalidArgument();
+  }
+  gate->set_policy(FromProto(request.policy));
+  return pw::OkStatus();
+}
+
+}  // namespace sense
@@ -0,0 +1,41 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include "modules/sampling_thread/report_policy.h"
+#include "modules/sampling_thread/sampling.rpc.pb.h"
+#include "modules/sampling_thread/sampling_thread.h"
+
+namespace sense {
+
+/// Reports and changes when the sampling loop publishes each sensor channel.
+class SamplingService final
+    : public ::sampling::pw_rpc::nanopb::Sampling::Service<SamplingService> {
+ public:
+  explicit SamplingService(SamplingReports& reports) : reports_(reports) {}
+
+  pw::Status GetReportStats(const pw_protobuf_Empty&,
+                            sampling_ReportStats& response);
+
+  pw::Status SetReportPolicy(const sampling_SetReportPolicyRequest& request,
+                             pw_protobuf_Empty&);
+
+ private:
+  /// Returns the channel's report-on-change gate, or null if not recognized.
+  ReportOnChange* Channel(sampling_Channel channel);
+
+  SamplingReports& reports_;
+};
+
+}  // namespace sense
@@ -0,0 +1,294 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "pw_assert/assert.h"
+#include "pw_string/string_builder.h"
+
+namespace sense {
+
+/// Named predicate used to choose between transitions for the same state and
+/// input.
+template <typename Context>
+struct Guard {
+  bool (*check)(const Context&) = nullptr;
+  const char* name = nullptr;
+};
+
+/// Named side effect of entering a state, leaving a state, or taking a
+/// transition.
+template <typename Context>
+struct Action {
+  void (*run)(Context&) = nullptr;
+  const char* name = nullptr;
+};
+
+/// Describes one state of a state machine.
+template <typename Context>
+struct StateInfo {
+  const char* name = nullptr;
+  Action<Context> on_entry = {};
+  Action<Context> on_exit = {};
+};
+
+/// One row of a transition table.
+///
+/// A row without a `from` state applies to every state that does not have rows
+/// of its own for the same input. A row without a `to` state is an internal
+/// transition: its action runs, but the state is neither exited nor entered.
+///
+/// Rows for the same state and input are tried in order, and the first one
+/// whose guard passes is taken. An unguarded row always passes, and so must be
+/// the last of its group.
+template <typename Context, typename State, typename Input>
+struct Transition {
+  std::optional<State> from = std::nullopt;
+  Input input;
+  Guard<Context> guard = {};
+  Action<Context> action = {};
+  std::optional<State> to = std::nullopt;
+};
+
+/// A state machine defined by a table of states × inputs → action/next state.
+///
+/// The table is validated and flattened at compile time into a dense array of
+/// cells indexed by state and input. Handling an input is a table lookup
+/// followed by at most a few guard checks and direct calls through function
+/// pointers; there is no virtual dispatch.
+///
+/// `State` and `Input` must be enumerations whose values count up from 0.
+///
+/// Use `MakeTransitionTable` to create tables.
+template <typename Context,
+          typename State,
+          typename Input,
+          size_t kNumStates,
+          size_t kNumInputs,
+          size_t kNumRows>
+class TransitionTable {
+ public:
+  using Row = Transition<Context, State, Input>;
+
+  consteval TransitionTable(const StateInfo<Context> (&states)[kNumStates],
+                            const char* const (&inputs)[kNumInputs],
+                            const Row (&rows)[kNumRows]) {
+    for (size_t i = 0; i < kNumStates; ++i) {
+      PW_ASSERT(states[i].name != nullptr);
+      PW_ASSERT(IsNamed(states[i].on_entry) && IsNamed(states[i].on_exit));
+      states_[i] = states[i];
+    }
+    for (size_t i = 0; i < kNumInputs; ++i) {
+      PW_ASSERT(inputs[i] != nullptr);
+      inputs_[i] = inputs[i];
+    }
+    for (size_t i = 0; i < kNumRows; ++i) {
+      const Row& row = rows[i];
+      PW_ASSERT(!row.from.has_value() || Index(*row.from) < kNumStates);
+      PW_ASSERT(Index(row.input) < kNumInputs);
+      PW_ASSERT(!row.to.has_value() || Index(*row.to) < kNumStates);
+      PW_ASSERT(row.guard.check == nullptr || row.guard.name != nullptr);
+      PW_ASSERT(IsNamed(row.action));
+      rows_[i] = row;
+    }
+
+    // Flatten the rows into cells, letting state specific rows replace the
+    // rows that apply to any state.
+    size_t num_entries = 0;
+    for (size_t s = 0; s < kNumStates; ++s) {
+      for (size_t i = 0; i < kNumInputs; ++i) {
+        bool specific = false;
+        for (const Row& row : rows_) {
+          if (row.from.has_value() && Index(*row.from) == s &&
+              Index(row.input) == i) {
+            specific = true;
+          }
+        }
+        Cell& cell = cells_[s][i];
+        cell.first = static_cast<uint8_t>(num_entries);
+        bool unguarded = false;
+        for (size_t r = 0; r < kNumRows; ++r) {
+          const Row& row = rows_[r];
+          if (Index(row.input) != i || row.from.has_value() != specific ||
+              (specific && Index(*row.from) != s)) {
+            continue;
+          }
+          // Rows after an unguarded row can never be taken.
+          PW_ASSERT(!unguarded);
+          unguarded = row.guard.check == nullptr;
+          entries_[num_entries++] = Entry{
+              .guard = row.guard.check,
+              .action = row.action.run,
+              .to = row.to.has_value() ? static_cast<uint8_t>(Index(*row.to))
+                                       : kInternal,
+              .row = static_cast<uint8_t>(r),
+          };
+          ++cell.count;
+        }
+      }
+    }
+  }
+
+  static constexpr size_t num_states() { return kNumStates; }
+  static constexpr size_t num_inputs() { return kNumInputs; }
+
+  /// Returns the name of a state.
+  constexpr const char* name(State state) const {
+    return states_[Index(state)].name;
+  }
+
+  /// Returns the name of an input.
+  constexpr const char* name(Input input) const {
+    return inputs_[Index(input)];
+  }
+
+  /// Handles an input by taking the matching transition, if any.
+  ///
+  /// For transitions to a new state, the old state's exit action, the
+  /// transition's action, and the new state's entry action are run, in that
+  /// order. `state` is updated before the entry action runs.
+  ///
+  /// @returns  True if a state was exited and entered. This includes
+  ///           transitions from a state to itself.
+  bool Dispatch(Context& context, State& state, Input input) const {
+    const Cell& cell = cells_[Index(state)][Index(input)];
+    const Entry* entry = &entries_[cell.first];
+    const Entry* end = entry + cell.count;
+    while (entry != end && entry->guard != nullptr && !entry->guard(context)) {
+      ++entry;
+    }
+    if (entry == end) {
+      return false;
+    }
+    if (entry->to == kInternal) {
+      Run(entry->action, context);
+      return false;
+    }
+    Run(states_[Index(state)].on_exit.run, context);
+    Run(entry->action, context);
+    state = static_cast<State>(entry->to);
+    Run(states_[entry->to].on_entry.run, context);
+    return true;
+  }
+
+  /// Writes the state machine as a Graphviz DOT graph.
+  ///
+  /// Internal transitions are drawn as dashed loops.
+  void DumpDot(pw::StringBuilder& sb) const {
+    sb << "digraph {\n";
+    for (const StateInfo<Context>& info : states_) {
+      sb.Format("  \"%s\";\n", info.name);
+    }
+    for (size_t s = 0; s < kNumStates; ++s) {
+      for (size_t i = 0; i < kNumInputs; ++i) {
+        const Cell& cell = cells_[s][i];
+        for (size_t c = 0; c < cell.count; ++c) {
+          const Row& row = rows_[entries_[cell.first + c].row];
+          if (!row.to.has_value() && row.action.run == nullptr) {
+            continue;
+          }
+          size_t to = row.to.has_value() ? Index(*row.to) : s;
+          sb.Format("  \"%s\" -> \"%s\" [label=\"%s",
+                    states_[s].name,
+                    states_[to].name,
+                    inputs_[i]);
+          if (row.guard.check != nullptr) {
+            sb.Format(" [%s]", row.guard.name);
+          }
+          if (row.action.run != nullptr) {
+            sb.Format(" / %s", row.action.name);
+          }
+          sb << (row.to.has_value() ? "\"];\n" : "\", style=dashed];\n");
+        }
+      }
+    }
+    sb << "}\n";
+  }
+
+ private:
+  struct Cell {
+    uint8_t first = 0;
+    uint8_t count = 0;
+  };
+
+  /// A row, as flattened into a cell. Only what is needed for dispatch is
+  /// kept here; names are looked up from the original row.
+  struct Entry {
+    bool (*guard)(const Context&) = nullptr;
+    void (*action)(Context&) = nullptr;
+    uint8_t to = 0;
+    uint8_t row = 0;
+  };
+
+  static constexpr uint8_t kInternal = UINT8_MAX;
+  static constexpr size_t kMaxEntries = kNumRows * kNumStates;
+  static_assert(kMaxEntries <= UINT8_MAX, "Transition table is too large");
+  static_assert(kNumStates < kInternal, "Too many states");
+
+  template <typename T>
+  static constexpr size_t Index(T value) {
+    return static_cast<size_t>(value);
+  }
+
+  static constexpr bool IsNamed(const Action<Context>& action) {
+    return action.run == nullptr || action.name != nullptr;
+  }
+
+  static void Run(void (*action)(Context&), Context& context) {
+    if (action != nullptr) {
+      action(context);
+    }
+  }
+
+  std::array<StateInfo<Context>, kNumStates> states_{};
+  std::array<const char*, kNumInputs> inputs_{};
+  std::array<Row, kNumRows> rows_{};
+  std::array<std::array<Cell, kNumInputs>, kNumStates> cells_{};
+  std::array<Entry, kMaxEntries> entries_{};
+};
+
+/// Creates a validated `TransitionTable` at compile time.
+///
+/// Example:
+///
+/// @code{.cpp}
+///   static constexpr auto kTable = MakeTransitionTable<Door, State, Input>(
+///       {{.name = "Closed"}, {.name = "Open", .on_entry = kLightOn}},
+///       {"Push", "Pull"},
+///       {{.from = State::kClosed, .input = Input::kPull, .to = State::kOpen},
+///        {.from = State::kOpen, .input = Input::kPush, .to = State::kClosed}});
+/// @endcode
+template <typename Context,
+          typename State,
+          typename Input,
+          size_t kNumStates,
+          size_t kNumInputs,
+          size_t kNumRows>
+consteval auto MakeTransitionTable(
+    const StateInfo<Context> (&states)[kNumStates],
+    const char* const (&inputs)[kNumInputs],
+    const Transition<Context, State, Input> (&rows)[kNumRows]) {
+  return TransitionTable<Context,
+                         State,
+                         Input,
+                         kNumStates,
+                         kNumInputs,
+                         kNumRows>(states, inputs, rows);
+}
+
+}  // namespace sense
@@ -0,0 +1,279 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+// Compares the cost of handling events with a `TransitionTable` against the
+// virtual `State` classes in a `CommonBaseUnion` that `StateManager` used
+// previously. Both machines have the same shape: a default mode, a mode that
+// handles buttons itself and ignores LED updates, and a mode that reacts to
+// Morse code edges.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/state_machine/transition_table.h"
+#include "modules/state_manager/common_base_union.h"
+#include "pw_perf_test/perf_test.h"
+
+namespace sense {
+namespace {
+
+const std::array<Event, 8> kEvents = {
+    ButtonA(true),
+    AirQuality{.score = 512},
+    ButtonA(true),
+    ButtonB(true),
+    ButtonY(true),
+    MorseCodeValue{.turn_on = true, .message_finished = false},
+    MorseCodeValue{.turn_on = false, .message_finished = true},
+    ButtonX(true),
+};
+
+/// Shared counters that stand in for the effects of real actions.
+struct Counters {
+  uint32_t threshold = 0;
+  uint32_t led = 0;
+  uint32_t transitions = 0;
+};
+
+// Virtual dispatch.
+
+class VirtualMachine {
+ public:
+  VirtualMachine() : state_(*this) {}
+
+  void Update(const Event& event) {
+    switch (static_cast<EventType>(event.index())) {
+      case kButtonA:
+        state_.get().ButtonAPressed();
+        break;
+      case kButtonB:
+        state_.get().ButtonBPressed();
+        break;
+      case kButtonX:
+        state_.get().ButtonXPressed();
+        break;
+      case kButtonY:
+        state_.get().ButtonYPressed();
+        break;
+      case kAirQuality:
+        state_.get().OnLedValue(std::get<AirQuality>(event).score);
+        break;
+      case kMorseCodeValue:
+        state_.get().OnMorseCodeValue(std::get<MorseCodeValue>(event));
+        break;
+      default:
+        break;
+    }
+  }
+
+  const Counters& counters() const { return counters_; }
+
+ private:
+  class State {
+   public:
+    explicit State(VirtualMachine& machine) : machine_(machine) {
+      ++machine_.counters_.transitions;
+    }
+    virtual ~State() = default;
+    virtual void ButtonAPressed() { machine_.SetState<ThresholdMode>(); }
+    virtual void ButtonBPressed() { machine_.SetState<ThresholdMode>(); }
+    virtual void ButtonXPressed() { machine_.SetState<MonitorMode>(); }
+    virtual void ButtonYPressed() { machine_.SetState<ReadoutMode>(); }
+    virtual void OnLedValue(uint16_t) { ++machine_.counters_.led; }
+    virtual void OnMorseCodeValue(const MorseCodeValue&) {}
+
+   protected:
+    VirtualMachine& machine_;
+  };
+
+  class MonitorMode final : public State {
+   public:
+    using State::State;
+  };
+
+  class ThresholdMode final : public State {
+   public:
+    using State::State;
+    void ButtonAPressed() override { ++machine_.counters_.threshold; }
+    void ButtonBPressed() override { --machine_.counters_.threshold; }
+    void OnLedValue(uint16_t) override {}
+  };
+
+  class ReadoutMode final : public State {
+   public:
+    using State::State;
+    void OnLedValue(uint16_t) override {}
+    void OnMorseCodeValue(const MorseCodeValue& value) override {
+      if (value.message_finished) {
+        machine_.SetState<MonitorMode>();
+      } else {
+        ++machine_.counters_.led;
+      }
+    }
+  };
+
+  template <typename StateType>
+  void SetState() {
+    state_.emplace<StateType>(*this);
+  }
+
+  Counters counters_;
+  CommonBaseUnion<State, MonitorMode, ThresholdMode, ReadoutMode> state_;
+};
+
+// Transition table.
+
+class TableMachine {
+ public:
+  void Update(const Event& event) {
+    switch (static_cast<EventType>(event.index())) {
+      case kButtonA:
+        Dispatch(Input::kButtonA);
+        break;
+      case kButtonB:
+        Dispatch(Input::kButtonB);
+        break;
+      case kButtonX:
+        Dispatch(Input::kButtonX);
+        break;
+      case kButtonY:
+        Dispatch(Input::kButtonY);
+        break;
+      case kAirQuality:
+        Dispatch(Input::kLedValue);
+        break;
+      case kMorseCodeValue:
+        morse_code_value_ = std::get<MorseCodeValue>(event);
+        Dispatch(Input::kMorseCodeValue);
+        break;
+      default:
+        break;
+    }
+  }
+
+  const Counters& counters() const { return counters_; }
+
+ private:
+  enum class Mode : uint8_t { kMonitor, kThreshold, kReadout };
+  enum class Input : uint8_t {
+    kButtonA,
+    kButtonB,
+    kButtonX,
+    kButtonY,
+    kLedValue,
+    kMorseCodeValue,
+  };
+
+  struct Machine;
+
+  void Dispatch(Input input);
+
+  Counters counters_;
+  Mode mode_ = Mode::kMonitor;
+  MorseCodeValue morse_code_value_ = {};
+};
+
+struct TableMachine::Machine {
+  using Action = ::sense::Action<TableMachine>;
+  using Guard = ::sense::Guard<TableMachine>;
+
+  static constexpr Guard kFinished = {
+      [](const TableMachine& m) {
+        return m.morse_code_value_.message_finished;
+      },
+      "finished",
+  };
+  static constexpr Action kEnter = {
+      [](TableMachine& m) { ++m.counters_.transitions; },
+      "Enter",
+  };
+  static constexpr Action kIncrement = {
+      [](TableMachine& m) { ++m.counters_.threshold; },
+      "Increment",
+  };
+  static constexpr Action kDecrement = {
+      [](TableMachine& m) { --m.counters_.threshold; },
+      "Decrement",
+  };
+  static constexpr Action kLed = {
+      [](TableMachine& m) { ++m.counters_.led; },
+      "Led",
+  };
+
+  static constexpr auto kTable = MakeTransitionTable<TableMachine, Mode, Input>(
+      {
+          {.name = "Monitor", .on_entry = kEnter},
+          {.name = "Threshold", .on_entry = kEnter},
+          {.name = "Readout", .on_entry = kEnter},
+      },
+      {"ButtonA", "ButtonB", "ButtonX", "ButtonY", "LedValue", "MorseCode"},
+      {
+          {.input = Input::kButtonA, .to = Mode::kThreshold},
+          {.input = Input::kButtonB, .to = Mode::kThreshold},
+          {.input = Input::kButtonX, .to = Mode::kMonitor},
+          {.input = Input::kButtonY, .to = Mode::kReadout},
+          {.input = Input::kLedValue, .action = kLed},
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kButtonA,
+              .action = kIncrement,
+          },
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kButtonB,
+              .action = kDecrement,
+          },
+          {.from = Mode::kThreshold, .input = Input::kLedValue},
+          {.from = Mode::kReadout, .input = Input::kLedValue},
+          {
+              .from = Mode::kReadout,
+              .input = Input::kMorseCodeValue,
+              .guard = kFinished,
+              .to = Mode::kMonitor,
+          },
+          {
+              .from = Mode::kReadout,
+              .input = Input::kMorseCodeValue,
+              .action = kLed,
+          },
+      });
+};
+
+void TableMachine::Dispatch(Input input) {
+  Machine::kTable.Dispatch(*this, mode_, input);
+}
+
+// Benchmarks.
+
+template <typename MachineType>
+void HandleEvents(pw::perf_test::State& state) {
+  MachineType machine;
+  while (state.KeepRunning()) {
+    for (const Event& event : kEvents) {
+      machine.Update(event);
+    }
+  }
+  // Keep the work from being optimized away.
+  volatile uint32_t sink = machine.counters().transitions;
+  static_cast<void>(sink);
+}
+
+PW_PERF_TEST(VirtualStateHandleEvents, HandleEvents<VirtualMachine>);
+PW_PERF_TEST(TransitionTableHandleEvents, HandleEvents<TableMachine>);
+
+}  // namespace
+}  // namespace sense
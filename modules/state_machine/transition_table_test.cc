@@ -0,0 +1,187 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/state_machine/transition_table.h"
+
+#include <cstdint>
+#include <string_view>
+
+#include "pw_containers/vector.h"
+#include "pw_string/string_builder.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+// Test fixtures.
+
+/// Context for a state machine that models a lockable door.
+struct Door {
+  bool locked = false;
+  pw::Vector<char, 16> log;
+};
+
+enum class DoorState : uint8_t {
+  kClosed,
+  kOpen,
+};
+
+enum class DoorInput : uint8_t {
+  kPush,
+  kPull,
+  kLock,
+};
+
+constexpr Guard<Door> kLocked = {
+    [](const Door& door) { return door.locked; },
+    "locked",
+};
+
+constexpr Action<Door> kToggleLock = {
+    [](Door& door) {
+      door.locked = !door.locked;
+      door.log.push_back('L');
+    },
+    "ToggleLock",
+};
+
+constexpr Action<Door> kRattle = {
+    [](Door& door) { door.log.push_back('R'); },
+    "Rattle",
+};
+
+constexpr Action<Door> kSwing = {
+    [](Door& door) { door.log.push_back('S'); },
+    "Swing",
+};
+
+constexpr Action<Door> kEnterOpen = {
+    [](Door& door) { door.log.push_back('('); },
+    "EnterOpen",
+};
+
+constexpr Action<Door> kExitOpen = {
+    [](Door& door) { door.log.push_back(')'); },
+    "ExitOpen",
+};
+
+constexpr auto kDoorTable = MakeTransitionTable<Door, DoorState, DoorInput>(
+    {
+        {.name = "Closed"},
+        {.name = "Open", .on_entry = kEnterOpen, .on_exit = kExitOpen},
+    },
+    {"Push", "Pull", "Lock"},
+    {
+        {.input = DoorInput::kLock, .action = kToggleLock},
+        {
+            .from = DoorState::kClosed,
+            .input = DoorInput::kPull,
+            .guard = kLocked,
+            .action = kRattle,
+        },
+        {
+            .from = DoorState::kClosed,
+            .input = DoorInput::kPull,
+            .action = kSwing,
+            .to = DoorState::kOpen,
+        },
+        {
+            .from = DoorState::kOpen,
+            .input = DoorInput::kPush,
+            .action = kSwing,
+            .to = DoorState::kClosed,
+        },
+        {.from = DoorState::kOpen, .input = DoorInput::kLock},
+    });
+
+std::string_view Log(const Door& door) {
+  return std::string_view(door.log.data(), door.log.size());
+}
+
+// Unit tests.
+
+TEST(TransitionTableTest, Names) {
+  static_assert(kDoorTable.num_states() == 2);
+  static_assert(kDoorTable.num_inputs() == 3);
+  EXPECT_STREQ(kDoorTable.name(DoorState::kClosed), "Closed");
+  EXPECT_STREQ(kDoorTable.name(DoorState::kOpen), "Open");
+  EXPECT_STREQ(kDoorTable.name(DoorInput::kLock), "Lock");
+}
+
+TEST(TransitionTableTest, NoTransition) {
+  Door door;
+  DoorState state = DoorState::kClosed;
+  EXPECT_FALSE(kDoorTable.Dispatch(door, state, DoorInput::kPush));
+  EXPECT_EQ(state, DoorState::kClosed);
+  EXPECT_TRUE(door.log.empty());
+}
+
+TEST(TransitionTableTest, ExitActionEntryOrder) {
+  Door door;
+  DoorState state = DoorState::kClosed;
+  EXPECT_TRUE(kDoorTable.Dispatch(door, state, DoorInput::kPull));
+  EXPECT_EQ(state, DoorState::kOpen);
+  EXPECT_TRUE(kDoorTable.Dispatch(door, state, DoorInput::kPush));
+  EXPECT_EQ(state, DoorState::kClosed);
+  EXPECT_EQ(Log(door), "S()S");
+}
+
+TEST(TransitionTableTest, InternalTransition) {
+  Door door;
+  DoorState state = DoorState::kClosed;
+  EXPECT_FALSE(kDoorTable.Dispatch(door, state, DoorInput::kLock));
+  EXPECT_EQ(state, DoorState::kClosed);
+  EXPECT_TRUE(door.locked);
+  EXPECT_EQ(Log(door), "L");
+}
+
+TEST(TransitionTableTest, GuardSelectsRow) {
+  Door door;
+  DoorState state = DoorState::kClosed;
+  door.locked = true;
+  EXPECT_FALSE(kDoorTable.Dispatch(door, state, DoorInput::kPull));
+  EXPECT_EQ(state, DoorState::kClosed);
+
+  door.locked = false;
+  EXPECT_TRUE(kDoorTable.Dispatch(door, state, DoorInput::kPull));
+  EXPECT_EQ(state, DoorState::kOpen);
+  EXPECT_EQ(Log(door), "RS(");
+}
+
+TEST(TransitionTableTest, SpecificRowsOverrideDefaults) {
+  Door door;
+  DoorState state = DoorState::kOpen;
+  EXPECT_FALSE(kDoorTable.Dispatch(door, state, DoorInput::kLock));
+  EXPECT_FALSE(door.locked);
+  EXPECT_TRUE(door.log.empty());
+}
+
+TEST(TransitionTableTest, DumpDot) {
+  pw::StringBuffer<512> sb;
+  kDoorTable.DumpDot(sb);
+  EXPECT_STREQ(sb.c_str(),
+               "digraph {\n"
+               "  \"Closed\";\n"
+               "  \"Open\";\n"
+               "  \"Closed\" -> \"Closed\" [label=\"Pull [locked] / Rattle\", "
+               "style=dashed];\n"
+               "  \"Closed\" -> \"Open\" [label=\"Pull / Swing\"];\n"
+               "  \"Closed\" -> \"Closed\" [label=\"Lock / ToggleLock\", "
+               "style=dashed];\n"
+               "  \"Open\" -> \"Closed\" [label=\"Push / Swing\"];\n"
+               "}\n");
+}
+
+}  // namespace
+}  // namespace sense
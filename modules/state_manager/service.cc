@@ -15,17 +15,127 @@
 #include "modules/state_manager/service.h"
 
 #include <mutex>
+#include <string_view>
+#include <tuple>
+#include <utility>
 
 #include "pw_assert/check.h"
+#include "pw_log/log.h"
 #include "pw_string/util.h"
+#include "pw_tokenizer/tokenize.h"
 
 namespace sense {
+namespace {
 
-StateManagerService::StateManagerService(PubSub& pubsub) : pubsub_(&pubsub) {
-  PW_CHECK(pubsub_->SubscribeTo<SenseState>([this](SenseState event) {
-    std::lock_guard lock(current_state_lock_);
-    current_state_ = event;
-  }));
+/// Returns the fields of `current` that differ from `previous`, or all of them
+/// if there is no previous state.
+state_manager_StateDelta MakeDelta(const std::optional<SenseState>& previous,
+                                   const SenseState& current,
+                                   uint32_t version) {
+  state_manager_StateDelta delta = state_manager_StateDelta_init_default;
+  delta.version = version;
+  if (!previous.has_value() || previous->alarm != current.alarm) {
+    delta.has_alarm_active = true;
+    delta.alarm_active = current.alarm;
+  }
+  if (!previous.has_value() ||
+      previous->alarm_threshold != current.alarm_threshold) {
+    delta.has_alarm_threshold = true;
+    delta.alarm_threshold = current.alarm_threshold;
+  }
+  if (!previous.has_value() || previous->air_quality != current.air_quality) {
+    delta.has_aq_score = true;
+    delta.aq_score = current.air_quality;
+  }
+  if (!previous.has_value() ||
+      std::string_view(previous->air_quality_description) !=
+          std::string_view(current.air_quality_description)) {
+    delta.has_aq_description = true;
+    std::ignore = pw::string::Copy(current.air_quality_description,
+                                   delta.aq_description);
+  }
+  return delta;
+}
+
+bool IsEmpty(const state_manager_StateDelta& delta) {
+  return !delta.has_alarm_active && !delta.has_alarm_threshold &&
+         !delta.has_aq_score && !delta.has_aq_description;
+}
+
+}  // namespace
+
+StateManagerService::StateManagerService(PubSub& pubsub,
+                                         Worker& stream_worker)
+    : pubsub_(&pubsub), stream_worker_(stream_worker) {
+  std::optional<PubSub::SubscribeToken> token =
+      pubsub_->SubscribeTo<SenseState>(
+          [this](SenseState event) { OnStateChange(event); },
+          mailbox_,
+          stream_worker_,
+          PW_TOKENIZE_STRING("state manager service"));
+  PW_CHECK(token.has_value());
+
+  // Catch up with the state, in case it was published before this service was
+  // created.
+  pubsub_->SendRetained(*token);
+}
+
+void StateManagerService::OnStateChange(const SenseState& state) {
+  // Start the streams that are waiting first, so that they get this change too.
+  StartNewStreams();
+
+  state_manager_StateDelta delta =
+      MakeDelta(streamed_state_, state, version_ + 1);
+  streamed_state_ = state;
+  if (IsEmpty(delta)) {
+    return;
+  }
+  version_ = delta.version;
+  WriteToStreams(delta);
+}
+
+void StateManagerService::StartNewStreams() {
+  pw::Vector<ServerWriter<state_manager_StateDelta>, kMaxStateStreams> streams;
+  {
+    std::lock_guard lock(new_streams_lock_);
+    for (auto& stream : new_streams_) {
+      streams.push_back(std::move(stream));
+    }
+    new_streams_.clear();
+  }
+
+  for (auto& stream : streams) {
+    if (state_streams_.full()) {
+      if (const auto status = stream.Finish(pw::Status::ResourceExhausted());
+          !status.ok()) {
+        PW_LOG_ERROR("Failed to write response: %s", status.str());
+      }
+      continue;
+    }
+    // Start the stream with the whole state, if there is one yet.
+    if (streamed_state_.has_value() &&
+        !stream.Write(MakeDelta(std::nullopt, *streamed_state_, version_))
+             .ok()) {
+      continue;
+    }
+    state_streams_.push_back(std::move(stream));
+  }
+}
+
+void StateManagerService::WriteToStreams(
+    const state_manager_StateDelta& delta) {
+  for (size_t i = 0; i < state_streams_.size();) {
+    if (state_streams_[i].Write(delta).ok()) {
+      ++i;
+      continue;
+    }
+    // The stream was closed. Streams are not ordered, so move the last one
+    // into its slot.
+    if (i != state_streams_.size() - 1) {
+      state_streams_[i] = std::move(state_streams_.back());
+    }
+    state_streams_.pop_back();
+  }
 }
 
 pw::Status StateManagerService::ChangeThreshold(
@@ -52,19 +162,43 @@ pw::Status StateManagerService::SilenceAlarm(const pw_protobuf_Empty&,
 
 pw::Status StateManagerService::GetState(const pw_protobuf_Empty&,
                                          state_manager_State& response) {
-  std::lock_guard lock(current_state_lock_);
-
-  if (!current_state_.has_value()) {
+  const std::optional<SenseState> state = pubsub_->Retained<SenseState>();
+  if (!state.has_value()) {
     return pw::Status::Unavailable();
   }
 
-  const auto& current_state = current_state_.value();
-  response.alarm_active = current_state.alarm;
-  response.alarm_threshold = current_state.alarm_threshold;
-  response.aq_score = current_state.air_quality;
-  return pw::string::Copy(current_state.air_quality_description,
+  response.alarm_active = state->alarm;
+  response.alarm_threshold = state->alarm_threshold;
+  response.aq_score = state->air_quality;
+  return pw::string::Copy(state->air_quality_description,
                           response.aq_description)
       .status();
 }
 
+void StateManagerService::StateStream(
+    const pw_protobuf_Empty&, ServerWriter<state_manager_StateDelta>& writer) {
+  bool queued = false;
+  bool schedule = false;
+  {
+    std::lock_guard lock(new_streams_lock_);
+    if (!new_streams_.full()) {
+      schedule = new_streams_.empty();
+      new_streams_.push_back(std::move(writer));
+      queued = true;
+    }
+  }
+  if (!queued) {
+    if (const auto status = writer.Finish(pw::Status::ResourceExhausted());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+  if (schedule) {
+    stream_worker_.RunOnceLabeled(
+        PW_TOKENIZE_STRING("state manager service start streams"),
+        [this]() { StartNewStreams(); });
+  }
+}
+
 }  // namespace sense
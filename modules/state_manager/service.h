@@ -13,12 +13,16 @@
 // the License.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 
 #include "modules/pubsub/pubsub_events.h"
 #include "modules/state_manager/state_manager.rpc.pb.h"
-#include "pw_sync/interrupt_spin_lock.h"
+#include "modules/worker/worker.h"
+#include "pw_containers/vector.h"
 #include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
 
 namespace sense {
 
@@ -26,18 +30,59 @@ class StateManagerService final
     : public ::state_manager::pw_rpc::nanopb::StateManager::Service<
           StateManagerService> {
  public:
-  StateManagerService(PubSub& pubsub);
+  /// Maximum number of concurrent `StateStream` calls.
+  static constexpr size_t kMaxStateStreams = 4;
+
+  /// Streams state changes from `pubsub` on `stream_worker`, so that a
+  /// congested transport only delays this service's subscriber.
+  StateManagerService(PubSub& pubsub, Worker& stream_worker);
 
   pw::Status ChangeThreshold(
       const state_manager_ChangeThresholdRequest& request,
       pw_protobuf_Empty& response);
   pw::Status SilenceAlarm(const pw_protobuf_Empty&, pw_protobuf_Empty&);
+  /// Returns the state last published to the pubsub.
   pw::Status GetState(const pw_protobuf_Empty&, state_manager_State& response);
+  /// Opens a stream of state deltas on the stream worker, which starts with
+  /// the whole state, if there is one yet.
+  void StateStream(const pw_protobuf_Empty&,
+                   ServerWriter<state_manager_StateDelta>& writer)
+      PW_LOCKS_EXCLUDED(new_streams_lock_);
 
  private:
+  /// Sends the fields that changed to every state stream. Runs on the stream
+  /// worker.
+  void OnStateChange(const SenseState& state)
+      PW_LOCKS_EXCLUDED(new_streams_lock_);
+
+  /// Starts the streams opened since the last call, with the whole state.
+  /// Runs on the stream worker.
+  void StartNewStreams() PW_LOCKS_EXCLUDED(new_streams_lock_);
+
+  /// Writes a delta to every started stream, and drops the closed ones.
+  void WriteToStreams(const state_manager_StateDelta& delta);
+
   PubSub* pubsub_;
-  pw::sync::InterruptSpinLock current_state_lock_;
-  std::optional<SenseState> current_state_ PW_GUARDED_BY(current_state_lock_);
+  Worker& stream_worker_;
+
+  // Only the latest state is streamed, so a state that arrives while another
+  // waits replaces it.
+  PubSub::MailboxBuffer<1> mailbox_{MailboxOverflow::kConflate};
+
+  // Streams opened on the RPC thread, which wait for the stream worker to
+  // start them. Nothing is written while this is held.
+  pw::sync::Mutex new_streams_lock_;
+  pw::Vector<ServerWriter<state_manager_StateDelta>, kMaxStateStreams>
+      new_streams_ PW_GUARDED_BY(new_streams_lock_);
+
+  // Only used on the stream worker.
+  //
+  // The state that deltas were last made from. The pubsub retains the latest
+  // state for `GetState`, but streams need the one their deltas are based on.
+  std::optional<SenseState> streamed_state_;
+  uint32_t version_ = 0;
+  pw::Vector<ServerWriter<state_manager_StateDelta>, kMaxStateStreams>
+      state_streams_;
 };
 
 }  // namespace sense
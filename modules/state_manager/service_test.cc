@@ -0,0 +1,214 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/state_manager/service.h"
+
+#include "modules/pubsub/pubsub.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/worker/test_worker.h"
+#include "pw_rpc/nanopb/test_method_context.h"
+#include "pw_rpc/test_helpers.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+class StateManagerServiceTest : public ::testing::Test {
+ protected:
+  using PubSub = sense::GenericPubSubBuffer<sense::Event, 4, 4>;
+
+  StateManagerServiceTest() : ::testing::Test(), pubsub_(worker_) {}
+
+  void TearDown() override {
+    stream_worker_.Stop();
+    worker_.Stop();
+  }
+
+  /// Waits for `worker` to run the work queued so far.
+  static void Sync(sense::Worker& worker) {
+    pw::sync::ThreadNotification done;
+    worker.RunOnce([&done] { done.release(); });
+    done.acquire();
+  }
+
+  /// Waits for the service to handle the states published so far. The pubsub
+  /// passes them to the service's mailbox, which is drained on the stream
+  /// worker.
+  void SyncService() {
+    Sync(worker_);
+    Sync(stream_worker_);
+  }
+
+  sense::TestWorker<> worker_;
+  sense::TestWorker<> stream_worker_;
+  PubSub pubsub_;
+};
+
+TEST_F(StateManagerServiceTest, StateStreamSendsChangedFields) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, StateStream)
+  ctx(pubsub_, stream_worker_);
+  ctx.call({});
+
+  // The stream is started on the stream worker.
+  Sync(stream_worker_);
+  pw::rpc::test::WaitForPackets(ctx.output(), 2, [this] {
+    EXPECT_TRUE(pubsub_.Publish(sense::SenseState{
+        .alarm = false,
+        .alarm_threshold = 256,
+        .air_quality = 800,
+        .air_quality_description = "Good",
+    }));
+    // The service's mailbox only keeps the latest state, so let it stream
+    // the first one before publishing the next.
+    SyncService();
+    EXPECT_TRUE(pubsub_.Publish(sense::SenseState{
+        .alarm = false,
+        .alarm_threshold = 256,
+        .air_quality = 750,
+        .air_quality_description = "Good",
+    }));
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 2u);
+  const auto& first = ctx.responses()[0];
+  EXPECT_EQ(first.version, 1u);
+  EXPECT_TRUE(first.has_alarm_active);
+  EXPECT_TRUE(first.has_alarm_threshold);
+  EXPECT_EQ(first.alarm_threshold, 256u);
+  EXPECT_TRUE(first.has_aq_score);
+  EXPECT_EQ(first.aq_score, 800u);
+  EXPECT_TRUE(first.has_aq_description);
+  EXPECT_STREQ(first.aq_description, "Good");
+
+  const auto& second = ctx.responses()[1];
+  EXPECT_EQ(second.version, 2u);
+  EXPECT_FALSE(second.has_alarm_active);
+  EXPECT_FALSE(second.has_alarm_threshold);
+  EXPECT_TRUE(second.has_aq_score);
+  EXPECT_EQ(second.aq_score, 750u);
+  EXPECT_FALSE(second.has_aq_description);
+  SyncService();
+}
+
+TEST_F(StateManagerServiceTest, StateStreamStartsWithCurrentState) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, StateStream)
+  ctx(pubsub_, stream_worker_);
+
+  ASSERT_TRUE(pubsub_.Publish(sense::SenseState{
+      .alarm = true,
+      .alarm_threshold = 128,
+      .air_quality = 100,
+      .air_quality_description = "Terrible",
+  }));
+  SyncService();
+
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [&ctx] { ctx.call({}); });
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  const auto& delta = ctx.responses()[0];
+  EXPECT_EQ(delta.version, 1u);
+  EXPECT_TRUE(delta.has_alarm_active);
+  EXPECT_TRUE(delta.alarm_active);
+  EXPECT_TRUE(delta.has_aq_score);
+  EXPECT_EQ(delta.aq_score, 100u);
+  EXPECT_STREQ(delta.aq_description, "Terrible");
+}
+
+TEST_F(StateManagerServiceTest, StateStreamWaitsForStreamWorker) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, StateStream)
+  ctx(pubsub_, stream_worker_);
+  ASSERT_TRUE(pubsub_.Publish(sense::SenseState{
+      .alarm = false,
+      .alarm_threshold = 256,
+      .air_quality = 600,
+      .air_quality_description = "Good",
+  }));
+  SyncService();
+
+  // Writes happen on the stream worker, so a blocked stream worker holds back
+  // the stream without blocking the call, or the pubsub's worker.
+  pw::sync::ThreadNotification blocked;
+  pw::sync::ThreadNotification unblock;
+  stream_worker_.RunOnce([&blocked, &unblock] {
+    blocked.release();
+    unblock.acquire();
+  });
+  blocked.acquire();
+  ctx.call({});
+  ASSERT_TRUE(pubsub_.Publish(sense::SenseState{
+      .alarm = false,
+      .alarm_threshold = 256,
+      .air_quality = 500,
+      .air_quality_description = "Good",
+  }));
+  Sync(worker_);
+  EXPECT_EQ(ctx.responses().size(), 0u);
+
+  pw::rpc::test::WaitForPackets(
+      ctx.output(), 2, [&unblock] { unblock.release(); });
+  ASSERT_EQ(ctx.responses().size(), 2u);
+  EXPECT_EQ(ctx.responses()[0].aq_score, 600u);
+  EXPECT_EQ(ctx.responses()[1].version, 2u);
+  EXPECT_TRUE(ctx.responses()[1].has_aq_score);
+  EXPECT_EQ(ctx.responses()[1].aq_score, 500u);
+  SyncService();
+}
+
+TEST_F(StateManagerServiceTest, GetStateReturnsLatestState) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, GetState)
+  ctx(pubsub_, stream_worker_);
+  EXPECT_EQ(ctx.call({}), pw::Status::Unavailable());
+
+  pw::sync::ThreadNotification notification;
+  ASSERT_TRUE(pubsub_.SubscribeTo<sense::SenseState>(
+      [&notification](sense::SenseState) { notification.release(); }));
+  ASSERT_TRUE(pubsub_.Publish(sense::SenseState{
+      .alarm = false,
+      .alarm_threshold = 512,
+      .air_quality = 900,
+      .air_quality_description = "Great",
+  }));
+  notification.acquire();
+
+  ASSERT_EQ(ctx.call({}), pw::OkStatus());
+  EXPECT_FALSE(ctx.response().alarm_active);
+  EXPECT_EQ(ctx.response().alarm_threshold, 512u);
+  EXPECT_EQ(ctx.response().aq_score, 900u);
+  EXPECT_STREQ(ctx.response().aq_description, "Great");
+  SyncService();
+}
+
+TEST_F(StateManagerServiceTest, ServiceCreatedLateStreamsRetainedState) {
+  pw::sync::ThreadNotification notification;
+  ASSERT_TRUE(pubsub_.SubscribeTo<sense::SenseState>(
+      [&notification](sense::SenseState) { notification.release(); }));
+  ASSERT_TRUE(pubsub_.Publish(sense::SenseState{
+      .alarm = true,
+      .alarm_threshold = 128,
+      .air_quality = 100,
+      .air_quality_description = "Terrible",
+  }));
+  notification.acquire();
+
+  // The service catches up through its mailbox.
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, StateStream)
+  ctx(pubsub_, stream_worker_);
+  SyncService();
+
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [&ctx] { ctx.call({}); });
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  EXPECT_EQ(ctx.responses()[0].version, 1u);
+  EXPECT_EQ(ctx.responses()[0].aq_score, 100u);
+}
+
+}  // namespace
@@ -19,60 +19,319 @@
 
 #include <chrono>
 #include <cmath>
+#include <optional>
 #include <variant>
 
+#include "modules/state_machine/transition_table.h"
 #include "pw_assert/check.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_log/log.h"
 #include "pw_string/format.h"
 #include "pw_thread/sleep.h"
+#include "pw_tokenizer/nested_tokenization.h"
 
 namespace sense {
 
-template <typename T>
-static void AddAndSmoothExponentially(std::optional<T>& aggregate,
-                                      T next_value) {
-  static constexpr T kDecayFactor = T(4);
-  if (!aggregate.has_value()) {
-    aggregate = next_value;
-  } else {
-    *aggregate += (next_value - *aggregate) / kDecayFactor;
-  }
-}
+/// Guards, actions and transitions of the Sense app state machine.
+///
+/// Rows without a `from` mode give the default behavior of every mode, and are
+/// overridden by rows for specific modes.
+struct StateManager::Machine {
+  using Guard = ::sense::Guard<StateManager>;
+  using Action = ::sense::Action<StateManager>;
+
+  // Guards.
+
+  static constexpr Guard kAlarmActive = {
+      [](const StateManager& m) { return m.alarm_; },
+      "alarm",
+  };
+
+  static constexpr Guard kMessageFinished = {
+      [](const StateManager& m) {
+        return m.morse_code_value_.message_finished;
+      },
+      "finished",
+  };
+
+  static constexpr Guard kMessageFinishedWithAlarm = {
+      [](const StateManager& m) {
+        return m.morse_code_value_.message_finished && m.alarm_;
+      },
+      "finished && alarm",
+  };
+
+  // Actions.
+
+  static constexpr Action kDisplayThreshold = {
+      [](StateManager& m) { m.DisplayThreshold(); },
+      "DisplayThreshold",
+  };
+
+  static constexpr Action kHideThreshold = {
+      [](StateManager& m) { m.led_.HideOverlay(); },
+      "HideThreshold",
+  };
+
+  static constexpr Action kIncrementThreshold = {
+      [](StateManager& m) { m.IncrementThreshold(); },
+      "IncrementThreshold",
+  };
+
+  static constexpr Action kDecrementThreshold = {
+      [](StateManager& m) { m.DecrementThreshold(); },
+      "DecrementThreshold",
+  };
+
+  static constexpr Action kSilenceAlarms = {
+      [](StateManager& m) { m.SilenceAlarms(); },
+      "SilenceAlarms",
+  };
+
+  static constexpr Action kReenableAlarms = {
+      [](StateManager& m) { m.alarm_silenced_ = false; },
+      "ReenableAlarms",
+  };
+
+  static constexpr Action kSetLedColor = {
+      [](StateManager& m) { m.led_.SetColor(m.led_value_); },
+      "SetLedColor",
+  };
+
+  static constexpr Action kSetLedFromMorseCode = {
+      [](StateManager& m) { m.led_.SetOnOff(m.morse_code_value_.turn_on); },
+      "SetLedFromMorseCode",
+  };
+
+  static constexpr Action kSetLedAndRepeatAlarm = {
+      [](StateManager& m) {
+        m.led_.SetOnOff(m.morse_code_value_.turn_on);
+        m.RepeatAlarm();
+      },
+      "SetLedAndRepeatAlarm",
+  };
+
+  // Since Morse code may leave the LED masked off, unmask it when leaving a
+  // mode that uses it.
+  static constexpr Action kTurnLedOn = {
+      [](StateManager& m) { m.led_.SetOnOff(true); },
+      "TurnLedOn",
+  };
+
+  static constexpr Action kFormatAirQuality = {
+      [](StateManager& m) { m.FormatAirQuality(m.msg_); },
+      "FormatAirQuality",
+  };
+
+  // Blink three times before returning to the default mode.
+  static constexpr Action kFormatThresholdTimeout = {
+      [](StateManager& m) { m.msg_ = "TTT"; },
+      "FormatThresholdTimeout",
+  };
+
+  static constexpr Action kStartMorseReadout = {
+      [](StateManager& m) { m.StartMorseReadout(m.msg_); },
+      "StartMorseReadout",
+  };
+
+  static constexpr Action kStartAlarmReadout = {
+      [](StateManager& m) {
+        m.FormatAirQuality(m.msg_);
+        m.StartMorseReadout(m.msg_);
+      },
+      "StartAlarmReadout",
+  };
+
+  static constexpr auto kTable = MakeTransitionTable<StateManager, Mode, Input>(
+      {
+          {.name = "MonitorMode"},
+          {
+              .name = "ThresholdMode",
+              .on_entry = kDisplayThreshold,
+              .on_exit = kHideThreshold,
+          },
+          {
+              .name = "AlarmMode",
+              .on_entry = kStartAlarmReadout,
+              .on_exit = kTurnLedOn,
+          },
+          {
+              .name = "MorseReadoutMode",
+              .on_entry = kStartMorseReadout,
+              .on_exit = kTurnLedOn,
+          },
+      },
+      {
+          "ButtonA",
+          "ButtonB",
+          "ButtonX",
+          "ButtonY",
+          "LedValue",
+          "MorseCodeValue",
+          "ResetMode",
+          "ThresholdTimeout",
+          "RepeatAlarmTimeout",
+          "SilenceAlarmTimeout",
+      },
+      {
+          // Default behavior.
+          {.input = Input::kButtonA, .to = Mode::kThreshold},
+          {.input = Input::kButtonB, .to = Mode::kThreshold},
+          {
+              .input = Input::kButtonX,
+              .guard = kAlarmActive,
+              .to = Mode::kAlarm,
+          },
+          {.input = Input::kButtonX, .to = Mode::kMonitor},
+          {
+              .input = Input::kButtonY,
+              .action = kFormatAirQuality,
+              .to = Mode::kMorseReadout,
+          },
+          {.input = Input::kLedValue, .action = kSetLedColor},
+          {
+              .input = Input::kResetMode,
+              .guard = kAlarmActive,
+              .to = Mode::kAlarm,
+          },
+          {.input = Input::kResetMode, .to = Mode::kMonitor},
+          {.input = Input::kSilenceAlarmTimeout, .action = kReenableAlarms},
+          // Hides thresholds displayed by `StateManagerControl` events.
+          {.input = Input::kThresholdTimeout, .action = kHideThreshold},
 
-StateManager::StateManager(PubSub& pubsub, PolychromeLed& led)
-    : edge_detector_(0, 0), pubsub_(pubsub), led_(led), state_(*this) {
+          // ThresholdMode.
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kButtonA,
+              .action = kIncrementThreshold,
+          },
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kButtonB,
+              .action = kDecrementThreshold,
+          },
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kButtonY,
+              .guard = kAlarmActive,
+              .to = Mode::kAlarm,
+          },
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kButtonY,
+              .to = Mode::kMonitor,
+          },
+          {
+              .from = Mode::kThreshold,
+              .input = Input::kThresholdTimeout,
+              .action = kFormatThresholdTimeout,
+              .to = Mode::kMorseReadout,
+          },
+
+          // AlarmMode.
+          {
+              .from = Mode::kAlarm,
+              .input = Input::kButtonX,
+              .action = kSilenceAlarms,
+              .to = Mode::kMonitor,
+          },
+          {.from = Mode::kAlarm, .input = Input::kButtonY},
+          {
+              .from = Mode::kAlarm,
+              .input = Input::kMorseCodeValue,
+              .guard = kMessageFinished,
+              .action = kSetLedAndRepeatAlarm,
+          },
+          {
+              .from = Mode::kAlarm,
+              .input = Input::kMorseCodeValue,
+              .action = kSetLedFromMorseCode,
+          },
+          {
+              .from = Mode::kAlarm,
+              .input = Input::kRepeatAlarmTimeout,
+              .action = kStartAlarmReadout,
+          },
+
+          // MorseReadoutMode.
+          {.from = Mode::kMorseReadout, .input = Input::kLedValue},
+          {
+              .from = Mode::kMorseReadout,
+              .input = Input::kMorseCodeValue,
+              .guard = kMessageFinishedWithAlarm,
+              .to = Mode::kAlarm,
+          },
+          {
+              .from = Mode::kMorseReadout,
+              .input = Input::kMorseCodeValue,
+              .guard = kMessageFinished,
+              .to = Mode::kMonitor,
+          },
+          {
+              .from = Mode::kMorseReadout,
+              .input = Input::kMorseCodeValue,
+              .action = kSetLedFromMorseCode,
+          },
+      });
+
+  static_assert(kTable.num_states() == kNumModes);
+  static_assert(kTable.num_inputs() == kNumInputs);
+};
+
+StateManager::AsyncTimeout::AsyncTimeout(TimerToken token_arg)
+    : token(token_arg),
+      task(pw::async2::Coro<pw::Status>::Empty(), [](pw::Status) {
+        PW_LOG_ERROR("Failed to allocate timeout coroutine.");
+      }) {}
+
+StateManager::StateManager(PubSub& pubsub, LedCompositor& compositor)
+    : edge_detector_(0, 0),
+      pubsub_(pubsub),
+      led_(compositor),
+      async_timeouts_{AsyncTimeout(kRepeatAlarmToken),
+                      AsyncTimeout(kSilenceAlarmToken),
+                      AsyncTimeout(kThresholdModeToken)} {
   SetAlarmThreshold(alarm_threshold_);
-  PW_CHECK(pubsub_.Subscribe([this](Event event) { Update(event); }));
+  PW_CHECK(pubsub_.Subscribe([this](Event event) { Update(event); },
+                             PW_TOKENIZE_STRING("state manager")));
+}
+
+void StateManager::EnableAsyncTimeouts(pw::async2::Dispatcher& dispatcher,
+                                       pw::Allocator& allocator,
+                                       Worker& worker) {
+  dispatcher_ = &dispatcher;
+  allocator_ = &allocator;
+  worker_ = &worker;
 }
 
 void StateManager::Update(Event event) {
   switch (static_cast<EventType>(event.index())) {
     case kButtonA:
       if (std::get<ButtonA>(event).pressed()) {
-        state_.get().ButtonAPressed();
+        Dispatch(Input::kButtonA);
       }
       break;
     case kButtonB:
       if (std::get<ButtonB>(event).pressed()) {
-        state_.get().ButtonBPressed();
+        Dispatch(Input::kButtonB);
       }
       break;
     case kButtonX:
       if (std::get<ButtonX>(event).pressed()) {
-        state_.get().ButtonXPressed();
+        Dispatch(Input::kButtonX);
       }
       break;
     case kButtonY:
       if (std::get<ButtonY>(event).pressed()) {
-        state_.get().ButtonYPressed();
+        Dispatch(Input::kButtonY);
       }
       break;
     case kTimerExpired:
-      state_.get().OnTimerExpired(std::get<TimerExpired>(event));
+      OnTimerExpired(std::get<TimerExpired>(event).token);
       break;
     case kMorseCodeValue:
-      state_.get().OnMorseCodeValue(std::get<MorseCodeValue>(event));
+      morse_code_value_ = std::get<MorseCodeValue>(event);
+      Dispatch(Input::kMorseCodeValue);
       break;
     case kAmbientLightSample:
       led_.UpdateBrightnessFromAmbientLight(
@@ -81,6 +340,9 @@ void StateManager::Update(Event event) {
     case kStateManagerControl:
       HandleControlEvent(std::get<StateManagerControl>(event));
       break;
+    case kButtonGesture:
+      HandleGesture(std::get<ButtonGesture>(event));
+      break;
     case kAirQuality:
       UpdateAirQuality(std::get<AirQuality>(event).score);
       break;
@@ -93,14 +355,66 @@ void StateManager::Update(Event event) {
   }
 }
 
-void StateManager::DisplayThreshold() {
-  led_.SetColor(AirSensor::GetLedValue(alarm_threshold_));
+void StateManager::StartTimer(TimerToken token, uint16_t timeout_s) {
+  if (dispatcher_ != nullptr && StartAsyncTimer(token, timeout_s)) {
+    return;
+  }
   PW_CHECK(pubsub_.Publish(TimerRequest{
-      .token = kThresholdModeToken,
-      .timeout_s = kThresholdModeTimeout,
+      .token = token,
+      .timeout_s = timeout_s,
   }));
 }
 
+bool StateManager::StartAsyncTimer(TimerToken token, uint16_t timeout_s) {
+  for (auto& timeout : async_timeouts_) {
+    if (timeout.token != token) {
+      continue;
+    }
+    auto delay = pw::chrono::SystemClock::for_at_least(
+        std::chrono::seconds(timeout_s));
+    timeout.task.Deregister();
+    ++timeout.generation;
+    pw::async2::CoroContext coro_cx(*allocator_);
+    auto coro = AwaitTimeout(coro_cx, timeout, timeout.generation, delay);
+    if (!coro.IsValid()) {
+      PW_LOG_WARN("Failed to allocate timeout coroutine");
+      return false;
+    }
+    timeout.task.SetCoro(std::move(coro));
+    dispatcher_->Post(timeout.task);
+    return true;
+  }
+  PW_LOG_WARN("No timeout found for token: " PW_TOKEN_FMT(), token);
+  return false;
+}
+
+pw::async2::Coro<pw::Status> StateManager::AwaitTimeout(
+    pw::async2::CoroContext&,
+    AsyncTimeout& timeout,
+    uint32_t generation,
+    pw::chrono::SystemClock::duration delay) {
+  co_await timeout.timer.WaitFor(delay);
+  const TimerToken token = timeout.token;
+  worker_->RunOnceLabeled(
+      PW_TOKENIZE_STRING("state manager timeout"),
+      [this, token, generation]() { OnAsyncTimeout(token, generation); });
+  co_return pw::OkStatus();
+}
+
+void StateManager::OnAsyncTimeout(TimerToken token, uint32_t generation) {
+  for (const auto& timeout : async_timeouts_) {
+    if (timeout.token == token && timeout.generation == generation) {
+      OnTimerExpired(token);
+      return;
+    }
+  }
+}
+
+void StateManager::DisplayThreshold() {
+  led_.ShowOverlay(AirSensor::GetLedValue(alarm_threshold_));
+  StartTimer(kThresholdModeToken, kThresholdModeTimeout);
+}
+
 void StateManager::IncrementThreshold() {
   if (alarm_threshold_ < kMaxThreshold) {
     SetAlarmThreshold(alarm_threshold_ + kThresholdIncrement);
@@ -135,8 +449,9 @@ void StateManager::SetAlarmThreshold(uint16_t alarm_threshold) {
 }
 
 void StateManager::UpdateAirQuality(uint16_t score) {
-  AddAndSmoothExponentially(air_quality_, score);
-  state_.get().OnLedValue(AirSensor::GetLedValue(*air_quality_));
+  air_quality_ = air_quality_filter_.Update(score);
+  led_value_ = AirSensor::GetLedValue(*air_quality_);
+  Dispatch(Input::kLedValue);
   if (alarm_silenced_) {
     BroadcastState();
     return;
@@ -157,35 +472,68 @@ void StateManager::UpdateAirQuality(uint16_t score) {
 }
 
 void StateManager::RepeatAlarm() {
-  PW_CHECK(pubsub_.Publish(TimerRequest{
-      .token = kRepeatAlarmToken,
-      .timeout_s = kRepeatAlarmTimeout,
-  }));
+  StartTimer(kRepeatAlarmToken, kRepeatAlarmTimeout);
 }
 
 void StateManager::SilenceAlarms() {
   alarm_ = false;
   alarm_silenced_ = true;
   std::ignore = edge_detector_.Update(AirSensor::kMaxScore);
-  PW_CHECK(pubsub_.Publish(TimerRequest{
-      .token = kSilenceAlarmToken,
-      .timeout_s = kSilenceAlarmTimeout,
-  }));
-  ResetMode();
-  BroadcastState();
+  StartTimer(kSilenceAlarmToken, kSilenceAlarmTimeout);
 }
 
-void StateManager::ResetMode() {
-  if (alarm_) {
-    SetState<AlarmMode>();
-  } else {
-    SetState<MonitorMode>();
+void StateManager::Dispatch(Input input) {
+  TakeTransition(input);
+
+  // If a Morse readout could not be started, fall back to the default mode.
+  // This is only attempted once, to avoid looping while the PubSub is full.
+  if (reset_pending_) {
+    TakeTransition(Input::kResetMode);
+    reset_pending_ = false;
+  }
+}
+
+void StateManager::TakeTransition(Input input) {
+  Mode old_mode = mode_;
+  if (Machine::kTable.Dispatch(*this, mode_, input)) {
+    BroadcastState();
+    LogStateChange(old_mode);
   }
 }
 
+void StateManager::OnTimerExpired(TimerToken token) {
+  switch (token) {
+    case kThresholdModeToken:
+      Dispatch(Input::kThresholdTimeout);
+      break;
+    case kRepeatAlarmToken:
+      Dispatch(Input::kRepeatAlarmTimeout);
+      break;
+    case kSilenceAlarmToken:
+      Dispatch(Input::kSilenceAlarmTimeout);
+      break;
+    default:
+      break;
+  }
+}
+
+void StateManager::DumpStateGraph(pw::StringBuilder& sb) {
+  Machine::kTable.DumpDot(sb);
+}
+
 void StateManager::StartMorseReadout(std::string_view msg) {
-  if (!pubsub_.Publish(MorseEncodeRequest{.message = msg, .repeat = 1u})) {
-    ResetMode();
+  PayloadPool* payloads = pubsub_.payloads();
+  std::optional<PayloadRef> message;
+  if (payloads != nullptr) {
+    message = payloads->Allocate(msg);
+  }
+  if (!message.has_value()) {
+    reset_pending_ = true;
+    return;
+  }
+  if (!pubsub_.Publish(MorseEncodeRequest{.payload = *message, .repeat = 1u})) {
+    message->Release();
+    reset_pending_ = true;
   }
 }
 
@@ -225,53 +573,82 @@ void StateManager::FormatAirQuality(MorseCodeString& msg) {
   PW_CHECK_OK(status);
 }
 
-AmbientLightAdjustedLed::AmbientLightAdjustedLed(PolychromeLed& led)
-    : led_(led) {
-  led_.SetColor(0);
-  led_.SetBrightness(kDefaultBrightness);
-  led_.Enable();
-  led_.TurnOn();
-}
-
 void AmbientLightAdjustedLed::UpdateBrightnessFromAmbientLight(
     float ambient_light_sample_lux) {
-  AddAndSmoothExponentially(ambient_light_lux_, ambient_light_sample_lux);
+  const float ambient_light_lux =
+      ambient_light_filter_.Update(ambient_light_sample_lux);
 
   static constexpr float kMinLux = 40.f;
   static constexpr float kMaxLux = 3000.f;
-  if (!ambient_light_lux_.has_value()) {
-    return;
-  }
   uint8_t brightness;
-  if (*ambient_light_lux_ < kMinLux) {
+  if (ambient_light_lux < kMinLux) {
     brightness = kMinBrightness;
-  } else if (*ambient_light_lux_ > kMaxLux) {
+  } else if (ambient_light_lux > kMaxLux) {
     brightness = kMaxBrightness;
   } else {
     constexpr float kBrightnessRange = kMaxBrightness - kMinBrightness;
     brightness = static_cast<uint8_t>(
-        std::lround((*ambient_light_lux_ - kMinLux) / (kMaxLux - kMinLux) *
+        std::lround((ambient_light_lux - kMinLux) / (kMaxLux - kMinLux) *
                     kBrightnessRange) +
         kMinBrightness);
   }
 
   PW_LOG_DEBUG("Ambient light: mean_lux=%.1f, brightness=%hhu",
-               *ambient_light_lux_,
+               ambient_light_lux,
                brightness);
-  led_.SetBrightness(brightness);
+  compositor_.SetBrightness(brightness);
 }
 
-void StateManager::LogStateChange(const char* old_state) const {
-  PW_LOG_INFO("StateManager: %s -> %s", old_state, state_.get().name());
+void StateManager::LogStateChange(Mode old_mode) const {
+  PW_LOG_INFO("StateManager: %s -> %s",
+              Machine::kTable.name(old_mode),
+              Machine::kTable.name(mode_));
 }
 
-void StateManager::BroadcastState() const {
-  std::ignore = pubsub_.Publish(SenseState{
+void StateManager::BroadcastState() {
+  SenseState state{
       .alarm = alarm_,
       .alarm_threshold = alarm_threshold_,
       .air_quality = air_quality(),
       .air_quality_description = AirQualityDescription(air_quality()),
-  });
+  };
+
+  // Most air quality updates and mode changes leave the state as it was. The
+  // description is derived from the air quality, so is not compared.
+  if (last_state_.has_value() && last_state_->alarm == state.alarm &&
+      last_state_->alarm_threshold == state.alarm_threshold &&
+      last_state_->air_quality == state.air_quality) {
+    return;
+  }
+
+  // If the state could not be published, publish it with the next update.
+  if (pubsub_.Publish(state)) {
+    last_state_ = state;
+  }
+}
+
+void StateManager::HandleGesture(const ButtonGesture& gesture) {
+  // Single clicks are only published when raw button events are not, and stand
+  // in for the presses.
+  if (gesture.kind != ButtonGesture::kClick || gesture.clicks != 1) {
+    return;
+  }
+  switch (gesture.buttons) {
+    case ButtonGesture::kA:
+      Dispatch(Input::kButtonA);
+      break;
+    case ButtonGesture::kB:
+      Dispatch(Input::kButtonB);
+      break;
+    case ButtonGesture::kX:
+      Dispatch(Input::kButtonX);
+      break;
+    case ButtonGesture::kY:
+      Dispatch(Input::kButtonY);
+      break;
+    default:
+      break;
+  }
 }
 
 void StateManager::HandleControlEvent(StateManagerControl& event) {
@@ -284,6 +661,7 @@ void StateManager::HandleControlEvent(StateManagerControl& event) {
       break;
     case StateManagerControl::kSilenceAlarms:
       SilenceAlarms();
+      ResetMode();
       break;
   }
 }
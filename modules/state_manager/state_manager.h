@@ -13,43 +13,68 @@
 // the License.
 #pragma once
 
+#include <array>
 #include <optional>
 #include <string_view>
 #include <utility>
 
 #include "modules/air_sensor/air_sensor.h"
 #include "modules/edge_detector/hysteresis_edge_detector.h"
+#include "modules/filter/filter.h"
+#include "modules/led/compositor.h"
 #include "modules/led/polychrome_led.h"
 #include "modules/morse_code/encoder.h"
 #include "modules/pubsub/pubsub_events.h"
-#include "modules/state_manager/common_base_union.h"
+#include "modules/timer_future/timer_future.h"
+#include "modules/worker/worker.h"
+#include "pw_allocator/allocator.h"
+#include "pw_async2/coro.h"
+#include "pw_async2/coro_or_else_task.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_status/status.h"
 #include "pw_string/string.h"
+#include "pw_string/string_builder.h"
 
 namespace sense {
 
-// Wraps a PolychromeLed and sets brightness from ambient light readings.
+// Wraps a LedCompositor and sets brightness from ambient light readings.
+//
+// Color and brightness changes fade in rather than jumping.
 class AmbientLightAdjustedLed {
  public:
   static constexpr uint8_t kMinBrightness = 10;
   static constexpr uint8_t kDefaultBrightness = 160;
   static constexpr uint8_t kMaxBrightness = 255;
 
-  AmbientLightAdjustedLed(PolychromeLed& led);
+  AmbientLightAdjustedLed(LedCompositor& compositor)
+      : compositor_(compositor) {}
+
+  void SetColor(const LedValue& color) { compositor_.SetBase(ToHex(color)); }
 
-  void SetColor(const LedValue& color) {
-    led_.SetColor(color.r(), color.g(), color.b());
+  // Shows a color over the one set by `SetColor` until `HideOverlay` is called.
+  void ShowOverlay(const LedValue& color) {
+    compositor_.SetOverlay(ToHex(color));
   }
 
-  void SetOnOff(bool turn_on) { led_.SetOnOff(turn_on); }
+  void HideOverlay() { compositor_.ClearOverlay(); }
+
+  void SetOnOff(bool turn_on) { compositor_.SetMask(turn_on); }
 
   // Recalculates the brightness level when the ambient light changes.
   void UpdateBrightnessFromAmbientLight(float ambient_light_sample_lux);
 
  private:
+  static constexpr uint32_t ToHex(const LedValue& color) {
+    return PolychromeLed::ColorToHex(color.r(), color.g(), color.b());
+  }
+
   void UpdateAverageAmbientLight(float ambient_light_sample_lux);
 
-  PolychromeLed& led_;
-  std::optional<float> ambient_light_lux_;
+  LedCompositor& compositor_;
+
+  // Ambient light samples are smoothed with a decay factor of 4.
+  EmaFilter<float, 2> ambient_light_filter_;
 };
 
 // Manages state for the "production" Sense app.
@@ -80,194 +105,120 @@ class StateManager {
   static constexpr uint16_t kMaxThreshold =
       static_cast<uint16_t>(AirSensor::Score::kCyan);
 
-  StateManager(PubSub& pubsub, PolychromeLed& led);
+  /// The LED is rendered by `compositor`, which should start with
+  /// `AmbientLightAdjustedLed::kDefaultBrightness`. If it renders frames on a
+  /// worker, it MUST be the PubSub's worker.
+  StateManager(PubSub& pubsub, LedCompositor& compositor);
 
   StateManager(const StateManager&) = delete;
   StateManager& operator=(const StateManager&) = delete;
 
+  /// Drives the state machine's timeouts with coroutines instead of
+  /// `TimerRequest` and `TimerExpired` round trips through the PubSub.
+  ///
+  /// Each timeout awaits an `AsyncTimer` deadline on the dispatcher, which may
+  /// run on any thread, and then hands the expiry to `worker`. Since this class
+  /// is not thread safe, `worker` MUST be the PubSub's worker. If a coroutine
+  /// cannot be allocated, the timeout is requested through the PubSub instead.
+  void EnableAsyncTimeouts(pw::async2::Dispatcher& dispatcher,
+                           pw::Allocator& allocator,
+                           Worker& worker);
+
   static const char* AirQualityDescription(uint16_t score);
 
+  /// Writes the state machine as a Graphviz DOT graph.
+  static void DumpStateGraph(pw::StringBuilder& sb);
+
  private:
   static constexpr size_t kMaxMorseCodeStringLen = 16;
   static_assert(kMaxMorseCodeStringLen <= Encoder::kMaxMsgLen);
   using MorseCodeString = ::pw::InlineString<kMaxMorseCodeStringLen>;
 
-  // Represents a state in the Sense app state machine.
-  class State {
-   public:
-    State(StateManager& manager, const char* name)
-        : manager_(manager), name_(name) {}
-
-    virtual ~State() = default;
-
-    // Name of the state for logging.
-    const char* name() const { return name_; }
-
-    /// Button A enters `ThresholdMode` by default.
-    virtual void ButtonAPressed() { manager_.SetState<ThresholdMode>(); }
-
-    /// Button B enters `ThresholdMode` by default.
-    virtual void ButtonBPressed() { manager_.SetState<ThresholdMode>(); }
-
-    /// Button X enters resets the mode to either `MonitorMode` or `AlarmMode`
-    /// by default, depending on the current air quality..
-    virtual void ButtonXPressed() { manager_.ResetMode(); }
-
-    /// Button Y enters `MorseReadoutMode` by default.
-    virtual void ButtonYPressed() { manager().SetState<MorseReadoutMode>(); }
-
-    // Update the LED color by default.
-    virtual void OnLedValue(const LedValue& value) {
-      manager().led_.SetColor(value);
-    }
-
-    // Ignore Morse code edges by default.
-    virtual void OnMorseCodeValue(const MorseCodeValue&) {}
-
-    // Handles re-enabling alarms that were previously silenced.
-    virtual void OnTimerExpired(const TimerExpired& timer) {
-      if (timer.token == kSilenceAlarmToken) {
-        manager().alarm_silenced_ = false;
-      }
-    }
-
-   protected:
-    StateManager& manager() { return manager_; }
-
-   private:
-    StateManager& manager_;
-    const char* name_;
-  };
-
-  /// Mode for monitoring the air quality.
+  /// Modes of the Sense app state machine.
   ///
-  /// Inherits default button mapping.
-  class MonitorMode final : public State {
-   public:
-    MonitorMode(StateManager& manager) : State(manager, "MonitorMode") {}
-  };
-
-  /// Mode for displaying and modifying the the air quality alarm threshold.
-  ///
-  /// Inherits default button mapping, except:
-  ///  * Button A increments the threshold.
-  ///  * Button B decrements the threshold.
+  /// * `kMonitor`: Monitors the air quality.
+  /// * `kThreshold`: Displays and modifies the air quality alarm threshold.
+  ///   Button A increments and button B decrements the threshold. Times out
+  ///   and returns to the default mode after 3 seconds without a button press.
+  /// * `kAlarm`: A triggered air quality alarm. Button X silences the alarm for
+  ///   60 seconds.
+  /// * `kMorseReadout`: Displays the current air quality in Morse code.
   ///
-  /// The mode will timeout and return to the default mode after 3 seconds of no
-  /// button being pressed.
-  class ThresholdMode final : public State {
-   public:
-    ThresholdMode(StateManager& manager) : State(manager, "ThresholdMode") {
-      manager.DisplayThreshold();
-    }
-
-    void ButtonAPressed() override { manager().IncrementThreshold(); }
-
-    void ButtonBPressed() override { manager().DecrementThreshold(); }
+  /// See `StateManager::Machine` in state_manager.cc for the full transition
+  /// table, or `DumpStateGraph` for a rendering of it.
+  enum class Mode : uint8_t {
+    kMonitor,
+    kThreshold,
+    kAlarm,
+    kMorseReadout,
+  };
+  static constexpr size_t kNumModes = 4;
+
+  /// Inputs to the state machine, derived from PubSub events.
+  enum class Input : uint8_t {
+    kButtonA,
+    kButtonB,
+    kButtonX,
+    kButtonY,
+    kLedValue,
+    kMorseCodeValue,
+    kResetMode,
+    kThresholdTimeout,
+    kRepeatAlarmTimeout,
+    kSilenceAlarmTimeout,
+  };
+  static constexpr size_t kNumInputs = 10;
+
+  /// Guards, actions, and the transition table. Defined in state_manager.cc.
+  struct Machine;
+
+  /// A timeout that is awaited by a coroutine when async timeouts are enabled.
+  struct AsyncTimeout {
+    explicit AsyncTimeout(TimerToken token_arg);
+    ~AsyncTimeout() { task.Deregister(); }
+
+    const TimerToken token;
+    // Counts starts of the timeout on the worker, so that the expiry of a
+    // timeout that was restarted since is ignored.
+    uint32_t generation = 0;
+    AsyncTimer timer;
+    pw::async2::CoroOrElseTask task;
+  };
 
-    void ButtonXPressed() override { manager().ResetMode(); }
+  /// Responds to a PubSub event.
+  void Update(Event event);
 
-    void ButtonYPressed() override { manager().ResetMode(); }
+  /// Starts or restarts the timeout identified by the given token.
+  void StartTimer(TimerToken token, uint16_t timeout_s);
 
-    void OnLedValue(const LedValue&) override {}
+  /// Starts or restarts a timeout on the dispatcher. Returns false if it could
+  /// not be started, in which case it is requested through the PubSub instead.
+  bool StartAsyncTimer(TimerToken token, uint16_t timeout_s);
 
-    void OnTimerExpired(const TimerExpired& timer) override {
-      if (timer.token == kThresholdModeToken) {
-        // Blink three times before returning to the default mode.
-        manager().SetState<MorseReadoutMode>("TTT");
-      } else {
-        State::OnTimerExpired(timer);
-      }
-    }
-  };
+  /// Waits for a timeout to elapse on the dispatcher and then queues
+  /// `OnAsyncTimeout` on the worker.
+  pw::async2::Coro<pw::Status> AwaitTimeout(
+      pw::async2::CoroContext&,
+      AsyncTimeout& timeout,
+      uint32_t generation,
+      pw::chrono::SystemClock::duration delay);
 
-  /// Mode representing a triggered air quality alarm.
-  ///
-  /// Inherits default button mapping, except:
-  ///  * Button X silences the alarm for 60 seconds.
-  ///  * Button Y does nothing.
-  class AlarmMode final : public State {
-   public:
-    AlarmMode(StateManager& manager) : State(manager, "AlarmMode") {
-      manager.FormatAirQuality(msg_);
-      manager.StartMorseReadout(msg_);
-    }
-
-    // Since morse code leaves the LED off, turn it back on.
-    ~AlarmMode() { manager().led_.SetOnOff(true); }
-
-    void ButtonXPressed() override { manager().SilenceAlarms(); }
-
-    void ButtonYPressed() override {}
-
-    void OnMorseCodeValue(const MorseCodeValue& value) override {
-      manager().led_.SetOnOff(value.turn_on);
-      if (value.message_finished) {
-        manager().RepeatAlarm();
-      }
-    }
-
-    void OnTimerExpired(const TimerExpired& timer) override {
-      if (timer.token == kRepeatAlarmToken) {
-        manager().FormatAirQuality(msg_);
-        manager().StartMorseReadout(msg_);
-      } else {
-        State::OnTimerExpired(timer);
-      }
-    }
-
-   private:
-    MorseCodeString msg_;
-  };
+  /// Notifies the current state of an expired timeout, unless the timeout was
+  /// restarted after the coroutine that awaited it was started.
+  void OnAsyncTimeout(TimerToken token, uint32_t generation);
 
-  /// Mode that displays the current air quality in Morse code.
-  ///
-  /// Inherits default button mapping, except:
-  ///  * Button Y restarts the air quality display.
-  class MorseReadoutMode final : public State {
-   public:
-    MorseReadoutMode(StateManager& manager)
-        : State(manager, "MorseReadoutMode") {
-      manager.FormatAirQuality(msg_);
-      manager.StartMorseReadout(msg_);
-    }
-
-    MorseReadoutMode(StateManager& manager, std::string_view msg)
-        : State(manager, "MorseReadoutMode"), msg_(msg) {
-      manager.StartMorseReadout(msg_);
-    }
-
-    // Since morse code leaves the LED off, turn it back on.
-    ~MorseReadoutMode() { manager().led_.SetOnOff(true); }
-
-    // Keep the current color.
-    void OnLedValue(const LedValue&) override {}
-
-    void OnMorseCodeValue(const MorseCodeValue& value) override {
-      manager().led_.SetOnOff(value.turn_on);
-      if (value.message_finished) {
-        manager().ResetMode();
-      }
-    }
-
-   private:
-    MorseCodeString msg_;
-  };
+  /// Passes an input to the state machine, and broadcasts any state change.
+  void Dispatch(Input input);
 
-  /// Responds to a PubSub event.
-  void Update(Event event);
+  /// Takes the transition for an input, if any.
+  void TakeTransition(Input input);
 
-  template <typename StateType, typename... Args>
-  void SetState(Args&&... args) {
-    const char* old_state = state_.get().name();
-    state_.emplace<StateType>(*this, std::forward<Args>(args)...);
-    BroadcastState();
-    LogStateChange(old_state);
-  }
+  /// Maps a timer token to the corresponding timeout input.
+  void OnTimerExpired(TimerToken token);
 
-  /// Sets the state to `MonitorMode` or `AlarmMode`, depending on the current
-  /// air quality.
-  void ResetMode();
+  /// Sets the state to `kMonitor` or `kAlarm`, depending on the current air
+  /// quality.
+  void ResetMode() { Dispatch(Input::kResetMode); }
 
   /// Increases the current alarm threshold.
   void IncrementThreshold();
@@ -275,10 +226,11 @@ class StateManager {
   /// Decreases the current alarm threshold.
   void DecrementThreshold();
 
-  /// Suppresses `AlarmMode` for 60 seconds.
+  /// Suppresses `kAlarm` mode for 60 seconds. The caller is responsible for
+  /// leaving `kAlarm` mode.
   void SilenceAlarms();
 
-  /// Sets the LED to reflect the current alarm threshold.
+  /// Overlays the LED with the color of the current alarm threshold.
   void DisplayThreshold();
 
   /// Sets the current alarm threshold.
@@ -302,17 +254,25 @@ class StateManager {
   /// Sets the given string to a  representation of the current air quality.
   void FormatAirQuality(MorseCodeString& msg);
 
-  void LogStateChange(const char* old_state) const;
+  void LogStateChange(Mode old_mode) const;
 
-  void BroadcastState() const;
+  /// Publishes the current `SenseState`, unless it is the same as the last
+  /// state published.
+  void BroadcastState();
   void HandleControlEvent(StateManagerControl& event);
+  void HandleGesture(const ButtonGesture& gesture);
 
   constexpr uint16_t air_quality() const {
     return air_quality_.value_or(AirSensor::kMaxScore + 1);
   }
 
+  // Air quality scores are smoothed with a decay factor of 4.
+  EmaFilter<uint16_t, 2> air_quality_filter_;
   std::optional<uint16_t> air_quality_;
 
+  // Last state published, if any.
+  std::optional<SenseState> last_state_;
+
   bool alarm_ = false;
   bool alarm_silenced_ = false;
   uint16_t alarm_threshold_ = kDefaultThreshold;
@@ -321,12 +281,22 @@ class StateManager {
   PubSub& pubsub_;
   AmbientLightAdjustedLed led_;
 
-  CommonBaseUnion<State,
-                  MonitorMode,
-                  ThresholdMode,
-                  AlarmMode,
-                  MorseReadoutMode>
-      state_;
+  Mode mode_ = Mode::kMonitor;
+
+  // Payloads of the input currently being dispatched.
+  LedValue led_value_;
+  MorseCodeValue morse_code_value_ = {};
+
+  // Message being read out in Morse code, if any.
+  MorseCodeString msg_;
+
+  // Set if a Morse readout could not be started during a transition.
+  bool reset_pending_ = false;
+
+  pw::async2::Dispatcher* dispatcher_ = nullptr;
+  pw::Allocator* allocator_ = nullptr;
+  Worker* worker_ = nullptr;
+  std::array<AsyncTimeout, 3> async_timeouts_;
 };
 
 }  // namespace sense
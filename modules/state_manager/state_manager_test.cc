@@ -15,12 +15,20 @@
 #include "modules/state_manager/state_manager.h"
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
+#include "modules/led/compositor.h"
 #include "modules/led/polychrome_led_fake.h"
 #include "modules/pubsub/pubsub.h"
 #include "modules/pubsub/pubsub_events.h"
 #include "modules/worker/test_worker.h"
+#include "pw_allocator/null_allocator.h"
+#include "pw_allocator/testing.h"
+#include "pw_async2/dispatcher.h"
 #include "pw_chrono/system_clock.h"
+#include "pw_string/string_builder.h"
 #include "pw_thread/sleep.h"
 #include "pw_unit_test/framework.h"
 
@@ -28,12 +36,15 @@ namespace sense {
 
 using namespace std::chrono_literals;
 
+using AllocatorForTest = ::pw::allocator::test::AllocatorForTest<512>;
+
 class StateManagerTest : public ::testing::Test {
  protected:
   StateManagerTest()
       : ::testing::Test(),
         pubsub_(worker_),
-        state_manager_(pubsub_, led_),
+        compositor_(led_, AmbientLightAdjustedLed::kDefaultBrightness),
+        state_manager_(pubsub_, compositor_),
         event_(TimerExpired{.token = 0}) {}
 
   void SetUp() override {
@@ -41,7 +52,6 @@ class StateManagerTest : public ::testing::Test {
     reference_led_.SetBrightness(AmbientLightAdjustedLed::kDefaultBrightness);
     reference_led_.Enable();
     reference_led_.TurnOn();
-    led_.EnableWaiting();
   }
 
   void SetExpectedColor(uint16_t air_quality) {
@@ -60,9 +70,37 @@ class StateManagerTest : public ::testing::Test {
 
   void TearDown() override { worker_.Stop(); }
 
+  /// Waits for the worker to handle the events published so far.
+  void Sync() {
+    pw::sync::ThreadNotification done;
+    worker_.RunOnce([&done]() { done.release(); });
+    done.acquire();
+  }
+
+  /// Waits for the worker to handle the events published so far, and then
+  /// steps any fade that they started to its end. The compositor is not given
+  /// a worker, so it only renders the frames that are stepped here.
+  void AwaitFade() {
+    pw::sync::ThreadNotification done;
+    worker_.RunOnce([this, &done]() {
+      while (compositor_.fading()) {
+        compositor_.Tick();
+      }
+      done.release();
+    });
+    done.acquire();
+  }
+
+  /// Runs the dispatcher on the test thread. As on the device, this is not
+  /// the worker's thread, so expired timeouts must be handed to the worker.
+  void RunDispatcher() { dispatcher_.RunUntilStalled().IgnorePoll(); }
+
+  AllocatorForTest allocator_;
+  pw::async2::Dispatcher dispatcher_;
   TestWorker<> worker_;
   GenericPubSubBuffer<Event, 20, 10> pubsub_;
   PolychromeLedFake led_;
+  LedCompositor compositor_;
   StateManager state_manager_;
   Event event_;
   pw::sync::ThreadNotification morse_encode_request_;
@@ -76,13 +114,40 @@ class StateManagerTest : public ::testing::Test {
 TEST_F(StateManagerTest, UpdateAirQuality) {
   uint16_t air_quality = 800;
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = air_quality}));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(air_quality);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
   EXPECT_EQ(led_.blue(), GetExpectedBlue());
 }
 
+TEST_F(StateManagerTest, BroadcastStateOnlyWhenChanged) {
+  struct {
+    size_t count = 0;
+    uint16_t air_quality = 0;
+  } states;
+  ASSERT_TRUE(
+      pubsub_.SubscribeTo<SenseState>([this, &states](SenseState state) {
+        ++states.count;
+        states.air_quality = state.air_quality;
+        state_update_notification_.release();
+      }));
+
+  ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = 800}));
+  state_update_notification_.acquire();
+  EXPECT_EQ(states.air_quality, 800u);
+
+  // The same score leaves the state unchanged, so only the second score is
+  // broadcast.
+  ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = 800}));
+  ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = 400}));
+  do {
+    state_update_notification_.acquire();
+  } while (states.air_quality == 800);
+  EXPECT_EQ(states.air_quality, 700u);
+  EXPECT_EQ(states.count, 2u);
+}
+
 TEST_F(StateManagerTest, MorseReadout) {
   ASSERT_TRUE(pubsub_.SubscribeTo<SenseState>(
       [this](SenseState) { state_update_notification_.release(); }));
@@ -90,20 +155,19 @@ TEST_F(StateManagerTest, MorseReadout) {
   // The manager needs at least one score to switch to Morce code mode.
   uint16_t air_quality = 800;
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = air_quality}));
-  led_.Await();
+  AwaitFade();
   state_update_notification_.acquire();
 
   ASSERT_TRUE(pubsub_.SubscribeTo<MorseEncodeRequest>(
       [this](MorseEncodeRequest) { morse_encode_request_.release(); }));
   ASSERT_TRUE(pubsub_.Publish(ButtonY(true)));
   morse_encode_request_.acquire();
-  state_update_notification_.acquire();
 
   // Responds to Morse code edges.
   EXPECT_TRUE(led_.is_on());
   ASSERT_TRUE(pubsub_.Publish(
       MorseCodeValue{.turn_on = false, .message_finished = false}));
-  led_.Await();
+  Sync();
   EXPECT_FALSE(led_.is_on());
 }
 
@@ -113,7 +177,7 @@ TEST_F(StateManagerTest, UpdateAirQualityAndTriggerAlarm) {
 
   uint16_t air_quality = 100;
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = air_quality}));
-  led_.Await();
+  AwaitFade();
 
   SetExpectedColor(air_quality);
   EXPECT_EQ(led_.red(), GetExpectedRed());
@@ -124,7 +188,7 @@ TEST_F(StateManagerTest, UpdateAirQualityAndTriggerAlarm) {
   morse_encode_request_.acquire();
   ASSERT_TRUE(pubsub_.Publish(
       MorseCodeValue{.turn_on = false, .message_finished = false}));
-  led_.Await();
+  Sync();
   EXPECT_FALSE(led_.is_on());
 }
 
@@ -137,26 +201,26 @@ TEST_F(StateManagerTest, UpdateAirQualityAndDisableAlarm) {
   // Alarm triggered; responds to Morse code edges.
   uint16_t air_quality = 200;
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = air_quality}));
-  led_.Await();
+  AwaitFade();
   state_update_notification_.acquire();
 
   // Alarm triggered; responds to Morse code edges.
   morse_encode_request_.acquire();
   ASSERT_TRUE(pubsub_.Publish(
       MorseCodeValue{.turn_on = false, .message_finished = true}));
-  led_.Await();
+  Sync();
   EXPECT_FALSE(led_.is_on());
 
   air_quality = 1000;
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = air_quality}));
-  led_.Await();
+  AwaitFade();
   state_update_notification_.acquire();
 
   // The state manager updates the LED before disabling the alarm. There's no
   // other event to synchronize on, so send another update to synchronize on
   // and ensure the state change is complete.
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = air_quality}));
-  led_.Await();
+  AwaitFade();
   state_update_notification_.acquire();
 
   // Don't check for a specific color. The air quality score is smoothed
@@ -172,7 +236,7 @@ TEST_F(StateManagerTest, SilenceAlarm) {
 
   // Trigger an alarm.
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = 100}));
-  led_.Await();
+  AwaitFade();
   state_update_notification_.acquire();
 
   // Alarm triggered; responds to Morse code edges.
@@ -180,21 +244,21 @@ TEST_F(StateManagerTest, SilenceAlarm) {
   EXPECT_TRUE(led_.is_on());
   ASSERT_TRUE(pubsub_.Publish(
       MorseCodeValue{.turn_on = false, .message_finished = false}));
-  led_.Await();
+  Sync();
   EXPECT_FALSE(led_.is_on());
 
   // Disable alarm.
   ASSERT_TRUE(pubsub_.Publish(ButtonX(true)));
 
   ASSERT_TRUE(pubsub_.Publish(AirQuality{.score = 100}));
-  led_.Await();
+  AwaitFade();
   state_update_notification_.acquire();
 
   // Alarm disabled; does not respond to Morse code events
   EXPECT_TRUE(led_.is_on());
   ASSERT_TRUE(pubsub_.Publish(
       MorseCodeValue{.turn_on = false, .message_finished = false}));
-  EXPECT_FALSE(led_.TryAwaitFor(100ms));
+  Sync();
   EXPECT_TRUE(led_.is_on());
 }
 
@@ -209,7 +273,7 @@ TEST_F(StateManagerTest, IncrementThresholdAndTimeout) {
       [this](SenseState) { state_update_notification_.release(); }));
 
   ASSERT_TRUE(pubsub_.Publish(ButtonB(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kYellow);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -221,7 +285,7 @@ TEST_F(StateManagerTest, IncrementThresholdAndTimeout) {
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
   ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kLightGreen);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -232,7 +296,7 @@ TEST_F(StateManagerTest, IncrementThresholdAndTimeout) {
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
   ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kGreen);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -243,7 +307,7 @@ TEST_F(StateManagerTest, IncrementThresholdAndTimeout) {
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
   ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kBlueGreen);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -254,7 +318,7 @@ TEST_F(StateManagerTest, IncrementThresholdAndTimeout) {
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
   ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kCyan);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -275,11 +339,13 @@ TEST_F(StateManagerTest, IncrementThresholdAndTimeout) {
   EXPECT_EQ(request.token, StateManager::kThresholdModeToken);
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
-  // Now time out of the threshold mode.
+  // Now time out of the threshold mode. The threshold color fades out.
   ASSERT_TRUE(pubsub_.Publish(
       TimerExpired{.token = StateManager::kThresholdModeToken}));
   morse_encode_request_.acquire();
   state_update_notification_.acquire();
+  AwaitFade();
+  EXPECT_FALSE(led_.is_on());
 }
 
 TEST_F(StateManagerTest, DecrementThresholdAndTimeout) {
@@ -293,7 +359,7 @@ TEST_F(StateManagerTest, DecrementThresholdAndTimeout) {
       [this](SenseState) { state_update_notification_.release(); }));
 
   ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kYellow);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -304,7 +370,7 @@ TEST_F(StateManagerTest, DecrementThresholdAndTimeout) {
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
   ASSERT_TRUE(pubsub_.Publish(ButtonB(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kOrange);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -315,7 +381,7 @@ TEST_F(StateManagerTest, DecrementThresholdAndTimeout) {
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
   ASSERT_TRUE(pubsub_.Publish(ButtonB(true)));
-  led_.Await();
+  AwaitFade();
   SetExpectedColor(AirSensor::Score::kRed);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -336,21 +402,77 @@ TEST_F(StateManagerTest, DecrementThresholdAndTimeout) {
   EXPECT_EQ(request.token, StateManager::kThresholdModeToken);
   EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
 
-  // Now time out of the threshold mode.
+  // Now time out of the threshold mode. The threshold color fades out.
   ASSERT_TRUE(pubsub_.Publish(
       TimerExpired{.token = StateManager::kThresholdModeToken}));
   morse_encode_request_.acquire();
   state_update_notification_.acquire();
+  AwaitFade();
+  EXPECT_FALSE(led_.is_on());
+}
+
+TEST_F(StateManagerTest, ThresholdModeAsyncTimeout) {
+  state_manager_.EnableAsyncTimeouts(dispatcher_, allocator_, worker_);
+  ASSERT_TRUE(pubsub_.SubscribeTo<TimerRequest>([this](TimerRequest request) {
+    event_ = request;
+    timer_request_.release();
+  }));
+  ASSERT_TRUE(pubsub_.SubscribeTo<MorseEncodeRequest>(
+      [this](MorseEncodeRequest) { morse_encode_request_.release(); }));
+  ASSERT_TRUE(pubsub_.SubscribeTo<SenseState>(
+      [this](SenseState) { state_update_notification_.release(); }));
+
+  ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
+  AwaitFade();
+  SetExpectedColor(AirSensor::Score::kYellow);
+  EXPECT_EQ(led_.red(), GetExpectedRed());
+  EXPECT_EQ(led_.green(), GetExpectedGreen());
+  EXPECT_EQ(led_.blue(), GetExpectedBlue());
+  state_update_notification_.acquire();
+
+  // The timeout is awaited directly instead of being requested via the PubSub.
+  EXPECT_FALSE(timer_request_.try_acquire());
+  RunDispatcher();
+  EXPECT_FALSE(morse_encode_request_.try_acquire());
+
+  // Time out of the threshold mode.
+  pw::this_thread::sleep_for(
+      std::chrono::seconds(StateManager::kThresholdModeTimeout) + 100ms);
+  RunDispatcher();
+  morse_encode_request_.acquire();
+  EXPECT_FALSE(timer_request_.try_acquire());
+  AwaitFade();
+}
+
+TEST_F(StateManagerTest, AsyncTimeoutWithoutMemoryUsesTimerRequest) {
+  state_manager_.EnableAsyncTimeouts(
+      dispatcher_, pw::allocator::GetNullAllocator(), worker_);
+  ASSERT_TRUE(pubsub_.SubscribeTo<TimerRequest>([this](TimerRequest request) {
+    event_ = request;
+    timer_request_.release();
+  }));
+  ASSERT_TRUE(pubsub_.SubscribeTo<MorseEncodeRequest>(
+      [this](MorseEncodeRequest) { morse_encode_request_.release(); }));
+
+  ASSERT_TRUE(pubsub_.Publish(ButtonA(true)));
+  timer_request_.acquire();
+  TimerRequest request = std::get<TimerRequest>(event_);
+  EXPECT_EQ(request.token, StateManager::kThresholdModeToken);
+  EXPECT_EQ(request.timeout_s, StateManager::kThresholdModeTimeout);
+
+  ASSERT_TRUE(pubsub_.Publish(
+      TimerExpired{.token = StateManager::kThresholdModeToken}));
+  morse_encode_request_.acquire();
 }
 
 TEST_F(StateManagerTest, AdjustBrightness) {
   ASSERT_TRUE(pubsub_.Publish(AmbientLightSample{.sample_lux = 2000.f}));
-  led_.Await();
+  AwaitFade();
 }
 
 TEST_F(StateManagerTest, AdjustBrightnessMin) {
   ASSERT_TRUE(pubsub_.Publish(AmbientLightSample{.sample_lux = 20.f}));
-  led_.Await();
+  AwaitFade();
   SetExpectedBrightness(AmbientLightAdjustedLed::kMinBrightness);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
@@ -359,11 +481,31 @@ TEST_F(StateManagerTest, AdjustBrightnessMin) {
 
 TEST_F(StateManagerTest, AdjustBrightnessMax) {
   ASSERT_TRUE(pubsub_.Publish(AmbientLightSample{.sample_lux = 20000.f}));
-  led_.Await();
+  AwaitFade();
   SetExpectedBrightness(AmbientLightAdjustedLed::kMaxBrightness);
   EXPECT_EQ(led_.red(), GetExpectedRed());
   EXPECT_EQ(led_.green(), GetExpectedGreen());
   EXPECT_EQ(led_.blue(), GetExpectedBlue());
 }
 
+TEST(StateManagerGraphTest, DumpStateGraph) {
+  pw::StringBuffer<4096> sb;
+  StateManager::DumpStateGraph(sb);
+  ASSERT_TRUE(sb.ok());
+  std::string_view graph(sb.view());
+  EXPECT_EQ(graph.find("digraph {\n"), 0u);
+  EXPECT_NE(graph.find("\"MonitorMode\" -> \"ThresholdMode\" "
+                       "[label=\"ButtonA\"];"),
+            std::string_view::npos);
+  EXPECT_NE(graph.find("\"ThresholdMode\" -> \"MorseReadoutMode\" "
+                       "[label=\"ThresholdTimeout / FormatThresholdTimeout\"];"),
+            std::string_view::npos);
+  EXPECT_NE(graph.find("\"AlarmMode\" -> \"MonitorMode\" "
+                       "[label=\"ButtonX / SilenceAlarms\"];"),
+            std::string_view::npos);
+  EXPECT_NE(graph.find("\"MorseReadoutMode\" -> \"AlarmMode\" "
+                       "[label=\"MorseCodeValue [finished && alarm]\"];"),
+            std::string_view::npos);
+}
+
 }  // namespace sense
@@ -0,0 +1,103 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "pw_containers/vector.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+/// Sends samples from one sampling loop to several clients, each of which
+/// receives every Nth sample.
+///
+/// This class is not thread safe.
+///
+/// @tparam   Writer        Move-only stream to a client, e.g. a `ServerWriter`.
+/// @tparam   kMaxClients   Maximum number of concurrent clients.
+template <typename Writer, size_t kMaxClients>
+class TelemetryFanout {
+ public:
+  /// Adds a client that is sent the next sample and then every
+  /// `decimation`th sample, with the given field mask.
+  ///
+  /// @returns  RESOURCE_EXHAUSTED if there are already `kMaxClients` clients,
+  ///           in which case `writer` is not moved from.
+  pw::Status Add(Writer&& writer, uint32_t decimation, uint32_t fields) {
+    if (clients_.full()) {
+      return pw::Status::ResourceExhausted();
+    }
+    clients_.push_back({
+        .writer = std::move(writer),
+        .decimation = decimation == 0 ? 1 : decimation,
+        .countdown = 1,
+        .fields = fields,
+    });
+    return pw::OkStatus();
+  }
+
+  bool empty() const { return clients_.empty(); }
+
+  size_t size() const { return clients_.size(); }
+
+  /// Returns the union of the fields of clients that are sent the next sample.
+  uint32_t DueFields() const {
+    uint32_t fields = 0;
+    for (const Client& client : clients_) {
+      if (client.countdown == 1) {
+        fields |= client.fields;
+      }
+    }
+    return fields;
+  }
+
+  /// Sends a sample to every client that is due, by calling
+  /// `write(writer, fields)`, which returns a `pw::Status`. Clients whose write
+  /// fails, e.g. because they closed the stream, are removed.
+  template <typename WriteFunction>
+  void Publish(WriteFunction&& write) {
+    for (size_t i = 0; i < clients_.size();) {
+      Client& client = clients_[i];
+      if (--client.countdown != 0) {
+        ++i;
+        continue;
+      }
+      client.countdown = client.decimation;
+      if (write(client.writer, client.fields).ok()) {
+        ++i;
+        continue;
+      }
+      // Clients are not ordered, so move the last one into this slot.
+      if (i != clients_.size() - 1) {
+        client = std::move(clients_.back());
+      }
+      clients_.pop_back();
+    }
+  }
+
+ private:
+  struct Client {
+    Writer writer;
+    uint32_t decimation;
+    uint32_t countdown;
+    uint32_t fields;
+  };
+
+  pw::Vector<Client, kMaxClients> clients_;
+};
+
+}  // namespace sense
@@ -0,0 +1,142 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/telemetry/fanout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "pw_containers/vector.h"
+#include "pw_status/status.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+/// Move-only stand-in for a `ServerWriter`, which can be closed.
+class FakeWriter {
+ public:
+  explicit FakeWriter(int id) : id_(id) {}
+
+  FakeWriter(FakeWriter&& other) : id_(other.id_), open_(other.open_) {
+    other.open_ = false;
+  }
+
+  FakeWriter& operator=(FakeWriter&& other) {
+    id_ = other.id_;
+    open_ = other.open_;
+    other.open_ = false;
+    return *this;
+  }
+
+  int id() const { return id_; }
+  bool open() const { return open_; }
+  void Close() { open_ = false; }
+
+ private:
+  int id_;
+  bool open_ = true;
+};
+
+struct Write {
+  int id;
+  uint32_t fields;
+};
+
+using Fanout = TelemetryFanout<FakeWriter, 3>;
+
+/// Publishes a sample and returns the writes, failing on closed writers.
+pw::Vector<Write, 3> Publish(Fanout& fanout) {
+  pw::Vector<Write, 3> writes;
+  fanout.Publish([&writes](FakeWriter& writer, uint32_t fields) {
+    if (!writer.open()) {
+      return pw::Status::FailedPrecondition();
+    }
+    writes.push_back({.id = writer.id(), .fields = fields});
+    return pw::OkStatus();
+  });
+  return writes;
+}
+
+TEST(TelemetryFanoutTest, SendsEveryNthSample) {
+  Fanout fanout;
+  ASSERT_EQ(fanout.Add(FakeWriter(1), 1, 0x1), pw::OkStatus());
+  ASSERT_EQ(fanout.Add(FakeWriter(2), 3, 0x2), pw::OkStatus());
+
+  size_t writes_1 = 0;
+  size_t writes_2 = 0;
+  for (int i = 0; i < 6; ++i) {
+    for (const Write& write : Publish(fanout)) {
+      if (write.id == 1) {
+        EXPECT_EQ(write.fields, 0x1u);
+        ++writes_1;
+      } else {
+        EXPECT_EQ(write.fields, 0x2u);
+        ++writes_2;
+      }
+    }
+  }
+  EXPECT_EQ(writes_1, 6u);
+  EXPECT_EQ(writes_2, 2u);
+}
+
+TEST(TelemetryFanoutTest, DueFieldsOnlyIncludesDueClients) {
+  Fanout fanout;
+  ASSERT_EQ(fanout.Add(FakeWriter(1), 1, 0x1), pw::OkStatus());
+  ASSERT_EQ(fanout.Add(FakeWriter(2), 2, 0x6), pw::OkStatus());
+
+  // Both clients are sent the first sample.
+  EXPECT_EQ(fanout.DueFields(), 0x7u);
+  EXPECT_EQ(Publish(fanout).size(), 2u);
+
+  EXPECT_EQ(fanout.DueFields(), 0x1u);
+  EXPECT_EQ(Publish(fanout).size(), 1u);
+
+  EXPECT_EQ(fanout.DueFields(), 0x7u);
+}
+
+TEST(TelemetryFanoutTest, RemovesClientsWhoseWriteFails) {
+  Fanout fanout;
+  FakeWriter closed(2);
+  closed.Close();
+  ASSERT_EQ(fanout.Add(FakeWriter(1), 1, 0x1), pw::OkStatus());
+  ASSERT_EQ(fanout.Add(std::move(closed), 1, 0x1), pw::OkStatus());
+  ASSERT_EQ(fanout.Add(FakeWriter(3), 1, 0x1), pw::OkStatus());
+
+  auto writes = Publish(fanout);
+  ASSERT_EQ(writes.size(), 2u);
+  EXPECT_EQ(fanout.size(), 2u);
+
+  // The client moved into the removed client's slot was still sent the sample.
+  EXPECT_EQ(writes[0].id, 1);
+  EXPECT_EQ(writes[1].id, 3);
+  EXPECT_EQ(Publish(fanout).size(), 2u);
+}
+
+TEST(TelemetryFanoutTest, RejectsClientsWhenFull) {
+  Fanout fanout;
+  ASSERT_EQ(fanout.Add(FakeWriter(1), 1, 0x1), pw::OkStatus());
+  ASSERT_EQ(fanout.Add(FakeWriter(2), 1, 0x1), pw::OkStatus());
+  ASSERT_EQ(fanout.Add(FakeWriter(3), 1, 0x1), pw::OkStatus());
+
+  FakeWriter writer(4);
+  EXPECT_EQ(fanout.Add(std::move(writer), 1, 0x1),
+            pw::Status::ResourceExhausted());
+  EXPECT_TRUE(writer.open());
+  EXPECT_EQ(fanout.size(), 3u);
+}
+
+}  // namespace
+}  // namespace sense
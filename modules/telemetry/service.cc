@@ -0,0 +1,188 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/telemetry/service.h"
+
+#include <chrono>
+#include <mutex>
+#include <utility>
+
+#include "pw_log/log.h"
+#include "pw_tokenizer/tokenize.h"
+
+namespace sense {
+
+TelemetryService::TelemetryService()
+    : sample_timer_([this](pw::chrono::SystemClock::time_point) {
+        // Timer callbacks must not block, so the sample is taken on the worker.
+        worker_->RunOnceLabeled(PW_TOKENIZE_STRING("telemetry sample"),
+                                [this]() { Sample(); });
+      }) {}
+
+void TelemetryService::Init(Worker& worker,
+                            Board& board,
+                            AirSensor& air_sensor) {
+  worker_ = &worker;
+  board_ = &board;
+  air_sensor_ = &air_sensor;
+}
+
+void TelemetryService::Stream(const telemetry_StreamRequest& request,
+                              ServerWriter<telemetry_Sample>& writer) {
+  if (request.interval_ms < kSamplePeriodMs) {
+    if (const auto status = writer.Finish(pw::Status::InvalidArgument());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+  uint32_t decimation =
+      (request.interval_ms + kSamplePeriodMs / 2) / kSamplePeriodMs;
+  uint32_t fields = request.fields == telemetry_Field_ALL_FIELDS
+                        ? ~uint32_t(0)
+                        : request.fields;
+
+  bool queued = false;
+  bool start_sampling = false;
+  {
+    std::lock_guard lock(lock_);
+    if (!new_clients_.full()) {
+      new_clients_.push_back({
+          .writer = std::move(writer),
+          .decimation = decimation,
+          .fields = fields,
+      });
+      queued = true;
+      start_sampling = !sampling_;
+      sampling_ = true;
+    }
+  }
+  if (!queued) {
+    if (const auto status = writer.Finish(pw::Status::ResourceExhausted());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+  if (start_sampling) {
+    worker_->RunOnceLabeled(PW_TOKENIZE_STRING("telemetry start sampling"),
+                            [this]() { StartSampling(); });
+  }
+}
+
+void TelemetryService::StartSampling() {
+  next_sample_ =
+      pw::chrono::SystemClock::TimePointAfterAtLeast(kSamplePeriod);
+  sample_timer_.InvokeAt(next_sample_);
+}
+
+void TelemetryService::AddNewClients() {
+  pw::Vector<NewClient, kMaxClients> new_clients;
+  {
+    std::lock_guard lock(lock_);
+    for (NewClient& client : new_clients_) {
+      new_clients.push_back(std::move(client));
+    }
+    new_clients_.clear();
+  }
+
+  for (NewClient& client : new_clients) {
+    if (const auto status = clients_.Add(
+            std::move(client.writer), client.decimation, client.fields);
+        !status.ok()) {
+      if (const auto result = client.writer.Finish(status); !result.ok()) {
+        PW_LOG_ERROR("Failed to write response: %s", result.str());
+      }
+    }
+  }
+}
+
+telemetry_Sample TelemetryService::ReadSample(uint32_t fields) {
+  telemetry_Sample sample = telemetry_Sample_init_default;
+  sample.collection_time_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          pw::chrono::SystemClock::now().time_since_epoch())
+          .count();
+  if ((fields & telemetry_Field_ONBOARD_TEMPERATURE) != 0) {
+    sample.has_onboard_temperature = true;
+    sample.onboard_temperature = board_->ReadInternalTemperature();
+  }
+  if ((fields & telemetry_Field_TEMPERATURE) != 0) {
+    sample.has_temperature = true;
+    sample.temperature = air_sensor_->temperature();
+  }
+  if ((fields & telemetry_Field_PRESSURE) != 0) {
+    sample.has_pressure = true;
+    sample.pressure = air_sensor_->pressure();
+  }
+  if ((fields & telemetry_Field_HUMIDITY) != 0) {
+    sample.has_humidity = true;
+    sample.humidity = air_sensor_->humidity();
+  }
+  if ((fields & telemetry_Field_GAS_RESISTANCE) != 0) {
+    sample.has_gas_resistance = true;
+    sample.gas_resistance = air_sensor_->gas_resistance();
+  }
+  if ((fields & telemetry_Field_SCORE) != 0) {
+    sample.has_score = true;
+    sample.score = air_sensor_->score();
+  }
+  return sample;
+}
+
+void TelemetryService::Sample() {
+  AddNewClients();
+
+  const telemetry_Sample sample = ReadSample(clients_.DueFields());
+  clients_.Publish([&sample](ServerWriter<telemetry_Sample>& writer,
+                             uint32_t fields) {
+    telemetry_Sample masked = sample;
+    masked.has_onboard_temperature &=
+        (fields & telemetry_Field_ONBOARD_TEMPERATURE) != 0;
+    masked.has_temperature &= (fields & telemetry_Field_TEMPERATURE) != 0;
+    masked.has_pressure &= (fields & telemetry_Field_PRESSURE) != 0;
+    masked.has_humidity &= (fields & telemetry_Field_HUMIDITY) != 0;
+    masked.has_gas_resistance &=
+        (fields & telemetry_Field_GAS_RESISTANCE) != 0;
+    masked.has_score &= (fields & telemetry_Field_SCORE) != 0;
+    return writer.Write(masked);
+  });
+
+  if (clients_.empty()) {
+    bool stopped = false;
+    {
+      std::lock_guard lock(lock_);
+      // A client that called `Stream` since the new clients were added keeps
+      // the sampling going.
+      if (new_clients_.empty()) {
+        sampling_ = false;
+        stopped = true;
+      }
+    }
+    if (stopped) {
+      PW_LOG_INFO("Telemetry streams closed; ending periodic sampling");
+      return;
+    }
+  }
+
+  // Sample on a fixed schedule, skipping samples if the timer fell behind.
+  next_sample_ += pw::chrono::SystemClock::for_at_least(kSamplePeriod);
+  auto now = pw::chrono::SystemClock::now();
+  if (next_sample_ < now) {
+    next_sample_ = now;
+  }
+  sample_timer_.InvokeAt(next_sample_);
+}
+
+}  // namespace sense
@@ -0,0 +1,92 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/air_sensor/air_sensor.h"
+#include "modules/board/board.h"
+#include "modules/telemetry/fanout.h"
+#include "modules/telemetry/telemetry.rpc.pb.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/system_timer.h"
+#include "pw_containers/vector.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+
+namespace sense {
+
+/// Streams board and air sensor readings to several clients at once.
+///
+/// One timer samples every `kSamplePeriod` while any client is streaming, and
+/// each client is sent every Nth sample. Only the fields that a due client
+/// asked for are read, and air sensor fields are read from the sensor's most
+/// recent measurement, so streaming does not add measurements.
+///
+/// The timer only hands each sample to the worker, which reads the sensors
+/// and writes to the clients, so that neither blocks the timer's thread.
+class TelemetryService final
+    : public ::telemetry::pw_rpc::nanopb::Telemetry::Service<TelemetryService> {
+ public:
+  static constexpr size_t kMaxClients = 4;
+  static constexpr uint32_t kSamplePeriodMs = 100;
+  static constexpr auto kSamplePeriod = std::chrono::milliseconds(100);
+
+  TelemetryService();
+
+  void Init(Worker& worker, Board& board, AirSensor& air_sensor);
+
+  void Stream(const telemetry_StreamRequest& request,
+              ServerWriter<telemetry_Sample>& writer) PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  /// A client that has called `Stream`, and waits for the worker to add it.
+  struct NewClient {
+    ServerWriter<telemetry_Sample> writer;
+    uint32_t decimation;
+    uint32_t fields;
+  };
+
+  /// Starts the timer. Runs on the worker.
+  void StartSampling();
+
+  /// Reads and sends a sample to the clients that are due, then restarts the
+  /// timer. Runs on the worker.
+  void Sample() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Adds the clients that called `Stream` since the last sample. Runs on the
+  /// worker.
+  void AddNewClients() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Reads the given fields.
+  telemetry_Sample ReadSample(uint32_t fields);
+
+  Worker* worker_ = nullptr;
+  Board* board_ = nullptr;
+  AirSensor* air_sensor_ = nullptr;
+  pw::chrono::SystemTimer sample_timer_;
+
+  // Nothing is read or written while this is held.
+  pw::sync::Mutex lock_;
+  pw::Vector<NewClient, kMaxClients> new_clients_ PW_GUARDED_BY(lock_);
+  bool sampling_ PW_GUARDED_BY(lock_) = false;
+
+  // Only used on the worker.
+  TelemetryFanout<ServerWriter<telemetry_Sample>, kMaxClients> clients_;
+  pw::chrono::SystemClock::time_point next_sample_;
+};
+
+}  // namespace sense
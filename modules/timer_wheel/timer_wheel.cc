@@ -0,0 +1,337 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/timer_wheel/timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+
+#include "pw_assert/assert.h"
+#include "pw_thread/sleep.h"
+
+namespace sense {
+
+WheelTimer::~WheelTimer() {
+  if (TimerWheel* wheel = wheel_.load(); wheel != nullptr) {
+    wheel->Detach(*this);
+  }
+}
+
+TimerWheel::TimerWheel(Clock::duration resolution)
+    : resolution_(resolution),
+      epoch_(Clock::now()),
+      system_timer_(pw::bind_member<&TimerWheel::OnExpired>(this)) {
+  PW_ASSERT(resolution_.count() > 0);
+}
+
+TimerWheel::~TimerWheel() {
+  system_timer_.Cancel();
+  std::lock_guard lock(lock_);
+  auto detach = [](WheelTimer* timer) {
+    while (timer != nullptr) {
+      WheelTimer* next = timer->next_;
+      timer->prev_ = nullptr;
+      timer->next_ = nullptr;
+      timer->wheel_ = nullptr;
+      timer->scheduled_ = false;
+      timer = next;
+    }
+  };
+  for (auto& level : slots_) {
+    for (WheelTimer* head : level) {
+      detach(head);
+    }
+  }
+  detach(overflow_);
+  detach(due_);
+}
+
+void TimerWheel::InvokeAt(WheelTimer& timer, Clock::time_point deadline) {
+  std::lock_guard lock(lock_);
+  ScheduleLocked(timer, TicksCeil(deadline), 0);
+}
+
+void TimerWheel::InvokeAfter(WheelTimer& timer, Clock::duration delay) {
+  InvokeAt(timer, Clock::TimePointAfterAtLeast(delay));
+}
+
+void TimerWheel::InvokeEvery(WheelTimer& timer, Clock::duration period) {
+  uint32_t period_ticks = std::max(DurationToTicks(period), uint32_t(1));
+  Clock::time_point deadline = Clock::TimePointAfterAtLeast(period);
+  std::lock_guard lock(lock_);
+  ScheduleLocked(timer, TicksCeil(deadline), period_ticks);
+}
+
+void TimerWheel::Cancel(WheelTimer& timer) {
+  std::lock_guard lock(lock_);
+  CancelLocked(timer);
+}
+
+void TimerWheel::Detach(WheelTimer& timer) {
+  lock_.lock();
+  CancelLocked(timer);
+  while (running_ == &timer) {
+    // The callback runs on the system timer's thread, which must be let run
+    // to finish it. It may schedule the timer again, so cancel it again.
+    lock_.unlock();
+    pw::this_thread::sleep_for(Clock::duration(1));
+    lock_.lock();
+    CancelLocked(timer);
+  }
+  lock_.unlock();
+}
+
+void TimerWheel::CancelLocked(WheelTimer& timer) {
+  if (timer.wheel_ != this || !timer.scheduled_) {
+    return;
+  }
+  UnlinkLocked(timer);
+  timer.scheduled_ = false;
+  // A running timer stays on the wheel until its callback returns.
+  if (running_ != &timer) {
+    timer.wheel_ = nullptr;
+  }
+  --pending_;
+  ArmLocked();
+}
+
+size_t TimerWheel::pending() const {
+  std::lock_guard lock(lock_);
+  return pending_;
+}
+
+uint64_t TimerWheel::TicksFloor(Clock::time_point time_point) const {
+  if (time_point <= epoch_) {
+    return 0;
+  }
+  return static_cast<uint64_t>((time_point - epoch_) / resolution_);
+}
+
+uint64_t TimerWheel::TicksCeil(Clock::time_point time_point) const {
+  if (time_point <= epoch_) {
+    return 0;
+  }
+  auto elapsed = (time_point - epoch_).count();
+  auto resolution = resolution_.count();
+  return static_cast<uint64_t>((elapsed + resolution - 1) / resolution);
+}
+
+uint32_t TimerWheel::DurationToTicks(Clock::duration duration) const {
+  if (duration.count() <= 0) {
+    return 0;
+  }
+  auto resolution = resolution_.count();
+  auto ticks = (duration.count() + resolution - 1) / resolution;
+  constexpr auto kMax = std::numeric_limits<uint32_t>::max();
+  return static_cast<uint64_t>(ticks) > kMax ? kMax
+                                             : static_cast<uint32_t>(ticks);
+}
+
+TimerWheel::Clock::time_point TimerWheel::TickToTime(uint64_t tick) const {
+  return epoch_ + resolution_ * static_cast<Clock::rep>(tick);
+}
+
+void TimerWheel::ScheduleLocked(WheelTimer& timer,
+                                uint64_t expiry,
+                                uint32_t period) {
+  if (timer.wheel_ != this) {
+    PW_ASSERT(timer.wheel_ == nullptr);
+    timer.wheel_ = this;
+  }
+  if (timer.scheduled_) {
+    UnlinkLocked(timer);
+  } else {
+    timer.scheduled_ = true;
+    ++pending_;
+  }
+
+  // An idle wheel may have fallen behind the clock. Since there are no timers
+  // whose position depends on it, it can simply be moved forward.
+  if (pending_ == 1) {
+    current_ = std::max(current_, TicksFloor(Clock::now()));
+  }
+
+  timer.expiry_ = expiry;
+  timer.period_ = period;
+  InsertLocked(timer);
+  ArmLocked();
+}
+
+WheelTimer*& TimerWheel::HeadLocked(uint8_t level, uint8_t slot) {
+  if (level < kNumLevels) {
+    return slots_[level][slot];
+  }
+  return level == kOverflowLevel ? overflow_ : due_;
+}
+
+void TimerWheel::InsertLocked(WheelTimer& timer) {
+  uint8_t level = kDueLevel;
+  uint8_t slot = 0;
+  if (timer.expiry_ > current_) {
+    // The level is chosen by the most significant group of bits in which the
+    // expiry differs from the current tick. This means the timer will be
+    // cascaded exactly when the wheel reaches the start of its slot.
+    uint64_t diff = timer.expiry_ ^ current_;
+    if (diff >= kMaxTicks) {
+      level = kOverflowLevel;
+    } else {
+      level = static_cast<uint8_t>((std::bit_width(diff) - 1) / kBitsPerLevel);
+      slot = static_cast<uint8_t>((timer.expiry_ >> (level * kBitsPerLevel)) &
+                                  kSlotMask);
+    }
+  }
+  timer.level_ = level;
+  timer.slot_ = slot;
+
+  WheelTimer*& head = HeadLocked(level, slot);
+  timer.prev_ = nullptr;
+  timer.next_ = head;
+  if (head != nullptr) {
+    head->prev_ = &timer;
+  }
+  head = &timer;
+  if (level < kNumLevels) {
+    occupied_[level] |= uint32_t(1) << slot;
+  }
+}
+
+void TimerWheel::UnlinkLocked(WheelTimer& timer) {
+  WheelTimer*& head = HeadLocked(timer.level_, timer.slot_);
+  if (timer.prev_ != nullptr) {
+    timer.prev_->next_ = timer.next_;
+  } else {
+    head = timer.next_;
+  }
+  if (timer.next_ != nullptr) {
+    timer.next_->prev_ = timer.prev_;
+  }
+  if (timer.level_ < kNumLevels && head == nullptr) {
+    occupied_[timer.level_] &= ~(uint32_t(1) << timer.slot_);
+  }
+  timer.prev_ = nullptr;
+  timer.next_ = nullptr;
+}
+
+uint64_t TimerWheel::NextEventTickLocked() const {
+  if (due_ != nullptr) {
+    return current_;
+  }
+  uint64_t next = kNever;
+  for (size_t level = 0; level < kNumLevels; ++level) {
+    if (occupied_[level] == 0) {
+      continue;
+    }
+    // Every occupied slot in a level is ahead of the current position in that
+    // level, so the lowest one is the next to be reached.
+    size_t shift = level * kBitsPerLevel;
+    uint64_t block = current_ >> (shift + kBitsPerLevel);
+    uint64_t slot = static_cast<uint64_t>(std::countr_zero(occupied_[level]));
+    next = std::min(next, ((block << kBitsPerLevel) | slot) << shift);
+  }
+  if (overflow_ != nullptr) {
+    next = std::min(next, ((current_ / kMaxTicks) + 1) * kMaxTicks);
+  }
+  return next;
+}
+
+WheelTimer* TimerWheel::PopExpiredLocked(uint64_t now) {
+  while (true) {
+    if (due_ != nullptr) {
+      WheelTimer* timer = due_;
+      UnlinkLocked(*timer);
+      return timer;
+    }
+    uint64_t next = NextEventTickLocked();
+    if (next > now) {
+      // Nothing happens between here and `now`, so skip ahead.
+      current_ = std::max(current_, now);
+      return nullptr;
+    }
+    current_ = next;
+    if (overflow_ != nullptr && current_ % kMaxTicks == 0) {
+      CascadeLocked(kOverflowLevel, 0);
+    }
+    for (size_t i = kNumLevels; i > 0; --i) {
+      auto level = static_cast<uint8_t>(i - 1);
+      size_t shift = level * kBitsPerLevel;
+      if ((current_ & ((uint64_t(1) << shift) - 1)) != 0) {
+        continue;
+      }
+      auto slot = static_cast<uint8_t>((current_ >> shift) & kSlotMask);
+      if ((occupied_[level] & (uint32_t(1) << slot)) != 0) {
+        CascadeLocked(level, slot);
+      }
+    }
+  }
+}
+
+void TimerWheel::CascadeLocked(uint8_t level, uint8_t slot) {
+  WheelTimer*& head = HeadLocked(level, slot);
+  WheelTimer* timer = head;
+  head = nullptr;
+  if (level < kNumLevels) {
+    occupied_[level] &= ~(uint32_t(1) << slot);
+  }
+  while (timer != nullptr) {
+    WheelTimer* next = timer->next_;
+    InsertLocked(*timer);
+    timer = next;
+  }
+}
+
+void TimerWheel::ArmLocked() {
+  uint64_t next = NextEventTickLocked();
+  if (next == armed_) {
+    return;
+  }
+  armed_ = next;
+  if (next == kNever) {
+    system_timer_.Cancel();
+  } else {
+    system_timer_.InvokeAt(TickToTime(next));
+  }
+}
+
+void TimerWheel::OnExpired(Clock::time_point) {
+  lock_.lock();
+  armed_ = kNever;
+  const uint64_t now = TicksFloor(Clock::now());
+  while (WheelTimer* timer = PopExpiredLocked(now)) {
+    uint64_t expiry = timer->expiry_;
+    if (timer->period_ != 0) {
+      timer->expiry_ += timer->period_;
+      InsertLocked(*timer);
+    } else {
+      timer->scheduled_ = false;
+      --pending_;
+    }
+
+    // Release the lock while running the callback so that it may schedule or
+    // cancel timers, including itself. The timer's destructor waits until it
+    // is no longer running.
+    running_ = timer;
+    lock_.unlock();
+    timer->callback_(TickToTime(expiry));
+    lock_.lock();
+    running_ = nullptr;
+    if (!timer->scheduled_) {
+      timer->wheel_ = nullptr;
+    }
+  }
+  ArmLocked();
+  lock_.unlock();
+}
+
+}  // namespace sense
@@ -0,0 +1,225 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/system_timer.h"
+#include "pw_function/function.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+class TimerWheel;
+
+/// A logical timer that is scheduled on a `TimerWheel`.
+///
+/// Any number of `WheelTimer`s may share a single wheel, and thus a single
+/// underlying `pw::chrono::SystemTimer`.
+///
+/// As with `pw::chrono::SystemTimer`, the callback is invoked from the context
+/// of the system timer and must not block.
+class WheelTimer {
+ public:
+  using Callback = pw::Function<void(pw::chrono::SystemClock::time_point)>;
+
+  explicit WheelTimer(Callback&& callback) : callback_(std::move(callback)) {}
+
+  // WheelTimers are not movable since the wheel keeps pointers to them.
+  WheelTimer(const WheelTimer&) = delete;
+  WheelTimer& operator=(const WheelTimer&) = delete;
+  WheelTimer(WheelTimer&&) = delete;
+  WheelTimer& operator=(WheelTimer&&) = delete;
+
+  /// Cancels the timer if it is still scheduled, and waits for its callback
+  /// to return if it is running, like `pw::chrono::SystemTimer`. Must not be
+  /// called from the timer's own callback.
+  ~WheelTimer();
+
+ private:
+  friend class TimerWheel;
+
+  Callback callback_;
+
+  // Intrusive list links for the slot this timer currently occupies.
+  WheelTimer* prev_ = nullptr;
+  WheelTimer* next_ = nullptr;
+
+  // The wheel this timer is scheduled or running on, or null if idle. Only
+  // written with the wheel's lock held, but read by the destructor without it.
+  std::atomic<TimerWheel*> wheel_ = nullptr;
+  bool scheduled_ = false;
+
+  // Expiration time and period, in wheel ticks. A period of 0 is a one-shot.
+  uint64_t expiry_ = 0;
+  uint32_t period_ = 0;
+
+  // Location of this timer in the wheel.
+  uint8_t level_ = 0;
+  uint8_t slot_ = 0;
+};
+
+/// A hierarchical timer wheel that multiplexes many logical timers onto a
+/// single `pw::chrono::SystemTimer`.
+///
+/// Time is quantized into ticks of a fixed resolution. Timers are stored in
+/// one of several levels of slots, where each level covers a range of time that
+/// is `kSlotsPerLevel` times longer than the level below it. Scheduling and
+/// cancelling a timer are constant time operations. As time advances, timers
+/// in the higher levels are "cascaded" into lower levels until they expire.
+///
+/// The underlying system timer is only armed for the next tick that has work to
+/// do, so an idle wheel causes no wakeups at all.
+///
+/// This class is thread safe. Timers may be scheduled and cancelled from any
+/// thread, including from within timer callbacks.
+class TimerWheel {
+ public:
+  using Clock = ::pw::chrono::SystemClock;
+
+  static constexpr Clock::duration kDefaultResolution =
+      Clock::for_at_least(std::chrono::milliseconds(10));
+
+  static constexpr size_t kBitsPerLevel = 5;
+  static constexpr size_t kSlotsPerLevel = size_t(1) << kBitsPerLevel;
+  static constexpr size_t kNumLevels = 4;
+
+  /// Span, in ticks, covered by all levels of the wheel. Timers further in the
+  /// future than this are parked in an overflow list until the wheel catches
+  /// up to them.
+  static constexpr uint64_t kMaxTicks = uint64_t(1)
+                                        << (kBitsPerLevel * kNumLevels);
+
+  explicit TimerWheel(Clock::duration resolution = kDefaultResolution);
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  ~TimerWheel();
+
+  /// Returns the duration of a single wheel tick.
+  Clock::duration resolution() const { return resolution_; }
+
+  /// Schedules a timer to expire at or after the given deadline, replacing any
+  /// previous schedule for the timer.
+  void InvokeAt(WheelTimer& timer, Clock::time_point deadline)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Schedules a timer to expire after at least the given delay, replacing any
+  /// previous schedule for the timer.
+  void InvokeAfter(WheelTimer& timer, Clock::duration delay)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Schedules a timer to expire repeatedly with the given period, replacing
+  /// any previous schedule for the timer. The timer is re-armed relative to
+  /// its previous deadline, so it does not drift.
+  void InvokeEvery(WheelTimer& timer, Clock::duration period)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Stops a timer from expiring. Does nothing if the timer is not scheduled.
+  /// Does not wait for the timer's callback if it is running.
+  void Cancel(WheelTimer& timer) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of scheduled timers.
+  size_t pending() const PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  friend class WheelTimer;
+
+  // Marker `level_` for timers that expire beyond the span of the wheel.
+  static constexpr uint8_t kOverflowLevel = kNumLevels;
+
+  // Marker `level_` for timers whose deadline has been reached and that are
+  // waiting to have their callback invoked.
+  static constexpr uint8_t kDueLevel = kNumLevels + 1;
+
+  static constexpr uint32_t kSlotMask = kSlotsPerLevel - 1;
+  static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+  /// Converts a time point to the tick containing it.
+  uint64_t TicksFloor(Clock::time_point time_point) const;
+
+  /// Converts a time point to the first tick starting at or after it.
+  uint64_t TicksCeil(Clock::time_point time_point) const;
+
+  /// Converts a duration to a number of ticks, rounding up.
+  uint32_t DurationToTicks(Clock::duration duration) const;
+
+  /// Returns the time at which the given tick starts.
+  Clock::time_point TickToTime(uint64_t tick) const;
+
+  void ScheduleLocked(WheelTimer& timer, uint64_t expiry, uint32_t period)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Places a timer into the slot matching its expiration.
+  void InsertLocked(WheelTimer& timer) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Removes a timer from whichever slot it occupies.
+  void UnlinkLocked(WheelTimer& timer) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Returns the head of the list for the given level and slot.
+  WheelTimer*& HeadLocked(uint8_t level, uint8_t slot)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Returns the next tick at which a timer either expires or must be moved to
+  /// a lower level, or `kNever` if no timers are scheduled.
+  uint64_t NextEventTickLocked() const PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Advances the wheel up to `now`, and returns the next timer whose deadline
+  /// has been reached, if any.
+  WheelTimer* PopExpiredLocked(uint64_t now)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Re-inserts all timers from the given list, which moves them closer to
+  /// expiring.
+  void CascadeLocked(uint8_t level, uint8_t slot)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Arms the system timer for the next event, if it differs from the current
+  /// one.
+  void ArmLocked() PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Cancels a timer, and waits until its callback is not running.
+  void Detach(WheelTimer& timer) PW_LOCKS_EXCLUDED(lock_);
+
+  void CancelLocked(WheelTimer& timer) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Callback for the system timer.
+  void OnExpired(Clock::time_point);
+
+  const Clock::duration resolution_;
+  const Clock::time_point epoch_;
+  pw::chrono::SystemTimer system_timer_;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  uint64_t current_ PW_GUARDED_BY(lock_) = 0;
+  uint64_t armed_ PW_GUARDED_BY(lock_) = kNever;
+  size_t pending_ PW_GUARDED_BY(lock_) = 0;
+  std::array<uint32_t, kNumLevels> occupied_ PW_GUARDED_BY(lock_) = {};
+  std::array<std::array<WheelTimer*, kSlotsPerLevel>, kNumLevels> slots_
+      PW_GUARDED_BY(lock_) = {};
+  WheelTimer* overflow_ PW_GUARDED_BY(lock_) = nullptr;
+  WheelTimer* due_ PW_GUARDED_BY(lock_) = nullptr;
+  // The timer whose callback is running, if any.
+  WheelTimer* running_ PW_GUARDED_BY(lock_) = nullptr;
+};
+
+}  // namespace sense
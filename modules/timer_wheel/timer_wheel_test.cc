@@ -0,0 +1,202 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/timer_wheel/timer_wheel.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_containers/vector.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/timed_thread_notification.h"
+#include "pw_thread/sleep.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+
+// Test fixtures.
+
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  using Clock = ::pw::chrono::SystemClock;
+
+  static constexpr Clock::duration kResolution =
+      Clock::for_at_least(std::chrono::milliseconds(1));
+  static constexpr Clock::duration kInterval =
+      Clock::for_at_least(std::chrono::milliseconds(10));
+  static constexpr Clock::duration kTimeout =
+      Clock::for_at_least(std::chrono::seconds(1));
+
+  // TODO(b/352327457): Ideally this would use simulated time, but no
+  // simulated system timer exists yet. For now, relax the constraints by
+  // checking that timers fire no earlier than requested and in order.
+  TimerWheelTest() : wheel_(kResolution) {}
+
+  /// Returns a callback that records the given ID when invoked.
+  WheelTimer::Callback Record(char id) {
+    return [this, id](Clock::time_point) {
+      std::lock_guard lock(lock_);
+      if (!fired_.full()) {
+        fired_.push_back(id);
+      }
+      fire_times_[static_cast<size_t>(id - 'a')] = Clock::now();
+      notification_.release();
+    };
+  }
+
+  TimerWheel wheel_;
+  pw::sync::TimedThreadNotification notification_;
+  pw::sync::InterruptSpinLock lock_;
+  pw::Vector<char, 16> fired_;
+  std::array<Clock::time_point, 4> fire_times_;
+};
+
+// Unit tests.
+
+TEST_F(TimerWheelTest, InvokeAfter) {
+  WheelTimer timer(Record('a'));
+  auto start = Clock::now();
+  wheel_.InvokeAfter(timer, kInterval);
+  EXPECT_EQ(wheel_.pending(), 1u);
+
+  ASSERT_TRUE(notification_.try_acquire_for(kTimeout));
+  EXPECT_GE(fire_times_[0] - start, kInterval);
+  EXPECT_EQ(wheel_.pending(), 0u);
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+  WheelTimer timer(Record('a'));
+  wheel_.InvokeAfter(timer, kInterval);
+  wheel_.Cancel(timer);
+  EXPECT_EQ(wheel_.pending(), 0u);
+
+  EXPECT_FALSE(notification_.try_acquire_for(kInterval * 3));
+  EXPECT_TRUE(fired_.empty());
+}
+
+TEST_F(TimerWheelTest, CancelOnDestruction) {
+  {
+    WheelTimer timer(Record('a'));
+    wheel_.InvokeAfter(timer, kInterval);
+  }
+  EXPECT_EQ(wheel_.pending(), 0u);
+  EXPECT_FALSE(notification_.try_acquire_for(kInterval * 3));
+}
+
+TEST_F(TimerWheelTest, DestructionWaitsForRunningCallback) {
+  struct {
+    pw::sync::TimedThreadNotification started;
+    std::atomic<bool> finished = false;
+  } state;
+  std::optional<WheelTimer> timer;
+  timer.emplace([&state](Clock::time_point) {
+    state.started.release();
+    pw::this_thread::sleep_for(kInterval * 5);
+    state.finished = true;
+  });
+  wheel_.InvokeAfter(*timer, kInterval);
+
+  ASSERT_TRUE(state.started.try_acquire_for(kTimeout));
+  timer.reset();
+  EXPECT_TRUE(state.finished);
+  EXPECT_EQ(wheel_.pending(), 0u);
+}
+
+TEST_F(TimerWheelTest, FiresInDeadlineOrder) {
+  WheelTimer timer_a(Record('a'));
+  WheelTimer timer_b(Record('b'));
+  WheelTimer timer_c(Record('c'));
+  wheel_.InvokeAfter(timer_c, kInterval * 3);
+  wheel_.InvokeAfter(timer_a, kInterval * 1);
+  wheel_.InvokeAfter(timer_b, kInterval * 2);
+
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(notification_.try_acquire_for(kTimeout));
+  }
+  std::lock_guard lock(lock_);
+  ASSERT_EQ(fired_.size(), 3u);
+  EXPECT_EQ(fired_[0], 'a');
+  EXPECT_EQ(fired_[1], 'b');
+  EXPECT_EQ(fired_[2], 'c');
+}
+
+TEST_F(TimerWheelTest, Reschedule) {
+  WheelTimer timer(Record('a'));
+  auto start = Clock::now();
+  wheel_.InvokeAfter(timer, kInterval);
+  wheel_.InvokeAfter(timer, kInterval * 5);
+  EXPECT_EQ(wheel_.pending(), 1u);
+
+  ASSERT_TRUE(notification_.try_acquire_for(kTimeout));
+  EXPECT_GE(fire_times_[0] - start, kInterval * 5);
+  EXPECT_FALSE(notification_.try_acquire_for(kInterval * 3));
+}
+
+TEST_F(TimerWheelTest, CascadesFromHigherLevels) {
+  // With 32 slots per level, this delay cannot be placed in the lowest level
+  // directly.
+  constexpr Clock::duration kDelay = kResolution * 100;
+  WheelTimer timer(Record('a'));
+  auto start = Clock::now();
+  wheel_.InvokeAfter(timer, kDelay);
+
+  ASSERT_TRUE(notification_.try_acquire_for(kTimeout));
+  EXPECT_GE(fire_times_[0] - start, kDelay);
+}
+
+TEST_F(TimerWheelTest, InvokeEvery) {
+  WheelTimer timer(Record('a'));
+  auto start = Clock::now();
+  wheel_.InvokeEvery(timer, kInterval);
+
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(notification_.try_acquire_for(kTimeout));
+  }
+  EXPECT_GE(fire_times_[0] - start, kInterval * 5);
+  EXPECT_EQ(wheel_.pending(), 1u);
+
+  wheel_.Cancel(timer);
+  EXPECT_EQ(wheel_.pending(), 0u);
+  pw::this_thread::sleep_for(kInterval * 2);
+  std::lock_guard lock(lock_);
+  EXPECT_LE(fired_.size(), 7u);
+}
+
+TEST_F(TimerWheelTest, RescheduleFromCallback) {
+  struct {
+    WheelTimer* timer = nullptr;
+    int count = 0;
+  } state;
+  WheelTimer timer([this, &state](Clock::time_point) {
+    if (++state.count < 3) {
+      wheel_.InvokeAfter(*state.timer, kInterval);
+    }
+    notification_.release();
+  });
+  state.timer = &timer;
+  wheel_.InvokeAfter(timer, kInterval);
+
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(notification_.try_acquire_for(kTimeout));
+  }
+  EXPECT_EQ(state.count, 3);
+  EXPECT_EQ(wheel_.pending(), 0u);
+}
+
+}  // namespace sense
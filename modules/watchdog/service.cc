@@ -0,0 +1,86 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/watchdog/service.h"
+
+#include <array>
+#include <chrono>
+#include <utility>
+
+namespace sense {
+namespace {
+
+uint32_t ToMicroseconds(WorkerWatchdog::Clock::duration duration) {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+watchdog_Breach BreachToProto(const WorkerWatchdog::Breach& breach) {
+  return {
+      .sequence = breach.sequence,
+      .label = breach.label,
+      .run_time_us = ToMicroseconds(breach.run_time),
+      .ongoing = breach.ongoing,
+  };
+}
+
+}  // namespace
+
+WatchdogService::WatchdogService(WorkerWatchdog& watchdog,
+                                 Worker& stream_worker)
+    : watchdog_(watchdog), stream_worker_(stream_worker) {
+  watchdog_.set_breach_callback([this]() {
+    stream_worker_.RunOnce([this]() { StreamBreaches(); });
+  });
+}
+
+pw::Status WatchdogService::GetReport(const pw_protobuf_Empty&,
+                                      watchdog_Report& response) {
+  response.work_budget_us = ToMicroseconds(watchdog_.options().work_budget);
+  response.work_count = watchdog_.work_count();
+  response.queue_wait_p50_us =
+      static_cast<uint32_t>(watchdog_.QueueWaitPercentile(50).count());
+  response.queue_wait_p90_us =
+      static_cast<uint32_t>(watchdog_.QueueWaitPercentile(90).count());
+  response.queue_wait_p99_us =
+      static_cast<uint32_t>(watchdog_.QueueWaitPercentile(99).count());
+  response.breach_count = watchdog_.breach_count();
+
+  std::array<WorkerWatchdog::Breach,
+             sizeof(response.breaches) / sizeof(response.breaches[0])>
+      breaches;
+  const size_t count = watchdog_.RecentBreaches(0, breaches);
+  for (size_t i = 0; i < count; ++i) {
+    response.breaches[i] = BreachToProto(breaches[i]);
+  }
+  response.breaches_count = static_cast<pb_size_t>(count);
+  return pw::OkStatus();
+}
+
+void WatchdogService::WatchBreaches(const pw_protobuf_Empty&,
+                                    ServerWriter<watchdog_Breach>& writer) {
+  stream_ = std::move(writer);
+}
+
+void WatchdogService::StreamBreaches() {
+  std::array<WorkerWatchdog::Breach, WorkerWatchdog::kMaxBreaches> breaches;
+  const size_t count = watchdog_.RecentBreaches(streamed_sequence_, breaches);
+  for (size_t i = 0; i < count; ++i) {
+    streamed_sequence_ = breaches[i].sequence;
+    // Writing to an unopened stream is okay here, so we IgnoreError.
+    stream_.Write(BreachToProto(breaches[i])).IgnoreError();
+  }
+}
+
+}  // namespace sense
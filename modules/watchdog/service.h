@@ -0,0 +1,49 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "modules/watchdog/watchdog.h"
+#include "modules/watchdog/watchdog.rpc.pb.h"
+#include "modules/worker/worker.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+/// Lets a host read a `WorkerWatchdog`'s report, and watch for breaches.
+class WatchdogService final
+    : public ::watchdog::pw_rpc::nanopb::Watchdog::Service<WatchdogService> {
+ public:
+  /// Streams breaches on `stream_worker`, since the worker that `watchdog`
+  /// watches may be stalled.
+  WatchdogService(WorkerWatchdog& watchdog, Worker& stream_worker);
+
+  pw::Status GetReport(const pw_protobuf_Empty&, watchdog_Report& response);
+
+  /// Opens a stream of the breaches detected from now on.
+  void WatchBreaches(const pw_protobuf_Empty&,
+                     ServerWriter<watchdog_Breach>& writer);
+
+ private:
+  /// Writes the breaches that have not been streamed yet.
+  void StreamBreaches();
+
+  WorkerWatchdog& watchdog_;
+  Worker& stream_worker_;
+  uint32_t streamed_sequence_ = 0;
+  ServerWriter<watchdog_Breach> stream_;
+};
+
+}  // namespace sense
@@ -0,0 +1,193 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/watchdog/watchdog.h"
+
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "pw_status/status.h"
+#include "pw_tokenizer/tokenize.h"
+
+namespace sense {
+
+WorkerWatchdog::WorkerWatchdog(TimerWheel& wheel,
+                               const Options& options,
+                               pw::Function<void()>&& kick)
+    : options_(options),
+      kick_(std::move(kick)),
+      wheel_(wheel),
+      timer_([this](Clock::time_point) { Check(Clock::now()); }) {}
+
+void WorkerWatchdog::Start() {
+  wheel_.InvokeEvery(timer_, options_.check_interval);
+}
+
+void WorkerWatchdog::Check(Clock::time_point now) {
+  bool breached = false;
+  bool stalled = false;
+  bool idle = false;
+  {
+    std::lock_guard lock(lock_);
+    // A worker that has started work since the last check is not blocked, so
+    // it does not need a probe.
+    idle = !running_ && work_count_ == checked_work_count_;
+    checked_work_count_ = work_count_;
+    if (running_) {
+      const Clock::duration run_time = now - running_since_;
+      if (!running_reported_ && run_time > options_.work_budget) {
+        RecordBreach(running_label_, run_time, /*ongoing=*/true);
+        running_reported_ = true;
+        breached = true;
+      }
+      stalled = run_time > options_.stall_limit;
+    }
+  }
+
+  // Work that waits too long means that the worker is blocked by something
+  // other than the work it runs, e.g. work given directly to its worker.
+  if (worker_ != nullptr) {
+    const std::optional<Clock::time_point> queued = worker_->OldestQueued();
+    if (queued.has_value() && now - *queued > options_.stall_limit) {
+      stalled = true;
+    }
+    if (idle) {
+      QueueProbe(now);
+    }
+  }
+
+  if (breached && breach_callback_ != nullptr) {
+    breach_callback_();
+  }
+  if (!stalled && kick_ != nullptr) {
+    kick_();
+  }
+}
+
+void WorkerWatchdog::QueueProbe(Clock::time_point now) {
+  {
+    std::lock_guard lock(lock_);
+    if (probe_queued_) {
+      return;
+    }
+    probe_queued_ = true;
+  }
+  const pw::Status status =
+      worker_->RunOnceBefore(now + options_.check_interval,
+                             PW_TOKENIZE_STRING("watchdog probe"),
+                             [this]() {
+                               std::lock_guard lock(lock_);
+                               probe_queued_ = false;
+                             });
+  if (!status.ok()) {
+    // The queue is full, so the work in it is checked instead.
+    std::lock_guard lock(lock_);
+    probe_queued_ = false;
+  }
+}
+
+void WorkerWatchdog::WorkStarted(uint32_t label,
+                                 Clock::time_point queued,
+                                 Clock::time_point started) {
+  const auto wait =
+      std::chrono::duration_cast<std::chrono::microseconds>(started - queued);
+  size_t bucket = 0;
+  while (bucket < kWaitBuckets - 1 && wait > kShortestWait * (1 << bucket)) {
+    ++bucket;
+  }
+
+  std::lock_guard lock(lock_);
+  running_ = true;
+  running_reported_ = false;
+  running_label_ = label;
+  running_since_ = started;
+  ++work_count_;
+  ++waits_[bucket];
+}
+
+void WorkerWatchdog::WorkFinished(Clock::time_point finished) {
+  bool breached = false;
+  {
+    std::lock_guard lock(lock_);
+    running_ = false;
+    const Clock::duration run_time = finished - running_since_;
+    if (run_time > options_.work_budget) {
+      RecordBreach(running_label_, run_time, /*ongoing=*/false);
+      breached = true;
+    }
+  }
+
+  if (breached && breach_callback_ != nullptr) {
+    breach_callback_();
+  }
+}
+
+std::chrono::microseconds WorkerWatchdog::QueueWaitPercentile(
+    uint32_t percent) const {
+  std::lock_guard lock(lock_);
+  // The nearest rank, rounded up.
+  const uint64_t rank =
+      (static_cast<uint64_t>(work_count_) * percent + 99) / 100;
+  uint64_t count = 0;
+  for (size_t bucket = 0; bucket < kWaitBuckets; ++bucket) {
+    count += waits_[bucket];
+    if (count >= rank && count > 0) {
+      return kShortestWait * (1 << bucket);
+    }
+  }
+  return std::chrono::microseconds(0);
+}
+
+uint32_t WorkerWatchdog::work_count() const {
+  std::lock_guard lock(lock_);
+  return work_count_;
+}
+
+uint32_t WorkerWatchdog::breach_count() const {
+  std::lock_guard lock(lock_);
+  return breach_count_;
+}
+
+size_t WorkerWatchdog::RecentBreaches(uint32_t after_sequence,
+                                      pw::span<Breach> breaches) const {
+  std::lock_guard lock(lock_);
+  size_t count = 0;
+  for (const Breach& breach : breaches_) {
+    if (count == breaches.size()) {
+      break;
+    }
+    // Sequence numbers wrap around, so compare their difference.
+    if (static_cast<int32_t>(breach.sequence - after_sequence) > 0) {
+      breaches[count++] = breach;
+    }
+  }
+  return count;
+}
+
+void WorkerWatchdog::RecordBreach(uint32_t label,
+                                  Clock::duration run_time,
+                                  bool ongoing) {
+  if (breaches_.full()) {
+    breaches_.pop_front();
+  }
+  breaches_.push_back({
+      .sequence = ++breach_count_,
+      .label = label,
+      .run_time = run_time,
+      .ongoing = ongoing,
+  });
+}
+
+}  // namespace sense
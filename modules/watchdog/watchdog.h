@@ -0,0 +1,172 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/timer_wheel/timer_wheel.h"
+#include "modules/worker/deadline_worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_containers/inline_deque.h"
+#include "pw_function/function.h"
+#include "pw_span/span.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// Watches the work run by a `DeadlineWorker`, and reports work that blocks
+/// the worker for longer than a budget.
+///
+/// Work that runs past the budget is reported as a breach by a periodic check
+/// on a timer wheel, while it is still running, so that work that never
+/// finishes, e.g. a hung bus transaction, is reported too. When it finishes,
+/// it is reported again with its full run time. The watchdog also keeps a
+/// histogram of how long work waited in the queue before it started.
+///
+/// If a kick function is given, the periodic check calls it while the worker
+/// makes progress, i.e. unless a piece of work has run for longer than the
+/// stall limit. The kick function should feed a hardware watchdog, which then
+/// resets the device if the worker stalls.
+///
+/// The worker may also be blocked by something it does not observe, e.g. work
+/// given directly to the worker it runs on. If the watchdog is told which
+/// worker to `Watch`, the kicks also stop once queued work has waited for
+/// longer than the stall limit.
+class WorkerWatchdog final : public WorkObserver {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  struct Options {
+    /// Longest time a piece of work may run before it is reported.
+    Clock::duration work_budget;
+    /// Longest time a piece of work may run before the kicks stop.
+    Clock::duration stall_limit;
+    /// Time between periodic checks.
+    Clock::duration check_interval;
+  };
+
+  /// The checks wake the device, so they are only as frequent as stall
+  /// detection needs. A stalled worker is kicked for the last time at most a
+  /// check interval after the stall limit, which must stay well within the
+  /// hardware watchdog's timeout of two seconds on the RP2.
+  static constexpr Options kDefaultOptions = {
+      .work_budget = Clock::for_at_least(std::chrono::milliseconds(100)),
+      .stall_limit = Clock::for_at_least(std::chrono::seconds(1)),
+      .check_interval = Clock::for_at_least(std::chrono::milliseconds(500)),
+  };
+
+  /// A piece of work that ran past the budget.
+  struct Breach {
+    /// Numbers breaches from 1, in the order they were detected.
+    uint32_t sequence = 0;
+    uint32_t label = 0;
+    /// How long the work had run when the breach was recorded.
+    Clock::duration run_time = Clock::duration(0);
+    /// True if the work was still running when the breach was recorded.
+    bool ongoing = false;
+  };
+
+  /// Number of recent breaches kept. Older breaches are only counted.
+  static constexpr size_t kMaxBreaches = 8;
+
+  /// Upper bound of the shortest queue wait histogram bucket. Each further
+  /// bucket doubles the bound, and the last bucket holds every longer wait.
+  static constexpr std::chrono::microseconds kShortestWait{100};
+  static constexpr size_t kWaitBuckets = 16;
+
+  explicit WorkerWatchdog(TimerWheel& wheel,
+                          const Options& options = kDefaultOptions,
+                          pw::Function<void()>&& kick = nullptr);
+
+  /// Starts the periodic checks.
+  void Start();
+
+  /// Watches the queue of the worker that this watchdog observes. A check
+  /// then queues a probe on the worker if no work has started since the last
+  /// check, so that a blocked worker is detected even if no other work is
+  /// waiting.
+  void Watch(DeadlineWorker& worker) { worker_ = &worker; }
+
+  /// Checks the work that is running, as of `now`. Called periodically once
+  /// the watchdog is started.
+  void Check(Clock::time_point now) PW_LOCKS_EXCLUDED(lock_);
+
+  void WorkStarted(uint32_t label,
+                   Clock::time_point queued,
+                   Clock::time_point started) override PW_LOCKS_EXCLUDED(lock_);
+
+  void WorkFinished(Clock::time_point finished) override
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Sets a function that is called after each breach is recorded, from the
+  /// worker's thread or the watchdog's timer. It must not block, and must not
+  /// rely on the watched worker, which may be stalled.
+  void set_breach_callback(pw::Function<void()>&& callback) {
+    breach_callback_ = std::move(callback);
+  }
+
+  const Options& options() const { return options_; }
+
+  /// Returns the queue wait that `percent` percent of the work waited no
+  /// longer than, rounded up to a histogram bucket bound.
+  std::chrono::microseconds QueueWaitPercentile(uint32_t percent) const
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Number of pieces of work that have started.
+  uint32_t work_count() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Number of breaches recorded.
+  uint32_t breach_count() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Copies the recent breaches with a sequence number after `after_sequence`
+  /// into `breaches`, oldest first. Returns the number copied.
+  size_t RecentBreaches(uint32_t after_sequence,
+                        pw::span<Breach> breaches) const
+      PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  /// Queues a probe on the watched worker, unless one is already queued.
+  void QueueProbe(Clock::time_point now) PW_LOCKS_EXCLUDED(lock_);
+
+  void RecordBreach(uint32_t label, Clock::duration run_time, bool ongoing)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const Options options_;
+  pw::Function<void()> kick_;
+  pw::Function<void()> breach_callback_;
+  TimerWheel& wheel_;
+  WheelTimer timer_;
+  DeadlineWorker* worker_ = nullptr;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  bool running_ PW_GUARDED_BY(lock_) = false;
+  bool running_reported_ PW_GUARDED_BY(lock_) = false;
+  uint32_t running_label_ PW_GUARDED_BY(lock_) = 0;
+  Clock::time_point running_since_ PW_GUARDED_BY(lock_);
+  bool probe_queued_ PW_GUARDED_BY(lock_) = false;
+  /// `work_count_` as of the last check.
+  uint32_t checked_work_count_ PW_GUARDED_BY(lock_) = 0;
+
+  uint32_t work_count_ PW_GUARDED_BY(lock_) = 0;
+  std::array<uint32_t, kWaitBuckets> waits_ PW_GUARDED_BY(lock_) = {};
+
+  uint32_t breach_count_ PW_GUARDED_BY(lock_) = 0;
+  pw::InlineDeque<Breach, kMaxBreaches> breaches_ PW_GUARDED_BY(lock_);
+};
+
+}  // namespace sense
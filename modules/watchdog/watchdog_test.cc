@@ -0,0 +1,224 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/watchdog/watchdog.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "modules/timer_wheel/timer_wheel.h"
+#include "modules/worker/deadline_worker.h"
+#include "modules/worker/test_worker.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using Clock = WorkerWatchdog::Clock;
+using namespace std::chrono_literals;
+
+constexpr uint32_t kLabel = 0x1234;
+
+class WorkerWatchdogTest : public ::testing::Test {
+ protected:
+  WorkerWatchdogTest()
+      : watchdog_(
+            wheel_, WorkerWatchdog::kDefaultOptions, [this]() { ++kicks_; }) {
+    watchdog_.set_breach_callback([this]() { ++callbacks_; });
+  }
+
+  /// Reports a piece of work that waited `wait`, then ran for `run_time`.
+  void Run(Clock::duration wait, Clock::duration run_time) {
+    watchdog_.WorkStarted(kLabel, start_ - wait, start_);
+    watchdog_.WorkFinished(start_ + run_time);
+  }
+
+  const WorkerWatchdog::Options& options() const {
+    return watchdog_.options();
+  }
+
+  const Clock::time_point start_ = Clock::now();
+  TimerWheel wheel_;
+  WorkerWatchdog watchdog_;
+  uint32_t kicks_ = 0;
+  uint32_t callbacks_ = 0;
+};
+
+TEST_F(WorkerWatchdogTest, ReportsWorkOverBudget) {
+  Run(0ms, options().work_budget);
+  EXPECT_EQ(watchdog_.breach_count(), 0u);
+
+  Run(0ms, options().work_budget + Clock::duration(1));
+  EXPECT_EQ(watchdog_.breach_count(), 1u);
+  EXPECT_EQ(callbacks_, 1u);
+
+  std::array<WorkerWatchdog::Breach, 2> breaches;
+  ASSERT_EQ(watchdog_.RecentBreaches(0, breaches), 1u);
+  EXPECT_EQ(breaches[0].sequence, 1u);
+  EXPECT_EQ(breaches[0].label, kLabel);
+  EXPECT_EQ(breaches[0].run_time, options().work_budget + Clock::duration(1));
+  EXPECT_FALSE(breaches[0].ongoing);
+}
+
+TEST_F(WorkerWatchdogTest, ReportsOngoingWorkOnce) {
+  watchdog_.WorkStarted(kLabel, start_, start_);
+  watchdog_.Check(start_ + options().work_budget);
+  EXPECT_EQ(watchdog_.breach_count(), 0u);
+
+  watchdog_.Check(start_ + 2 * options().work_budget);
+  watchdog_.Check(start_ + 3 * options().work_budget);
+  EXPECT_EQ(watchdog_.breach_count(), 1u);
+
+  // The work is reported again with its full run time when it finishes.
+  watchdog_.WorkFinished(start_ + 4 * options().work_budget);
+  EXPECT_EQ(watchdog_.breach_count(), 2u);
+  EXPECT_EQ(callbacks_, 2u);
+
+  std::array<WorkerWatchdog::Breach, 2> breaches;
+  ASSERT_EQ(watchdog_.RecentBreaches(0, breaches), 2u);
+  EXPECT_TRUE(breaches[0].ongoing);
+  EXPECT_EQ(breaches[0].run_time, 2 * options().work_budget);
+  EXPECT_FALSE(breaches[1].ongoing);
+  EXPECT_EQ(breaches[1].run_time, 4 * options().work_budget);
+}
+
+TEST_F(WorkerWatchdogTest, StopsKickingWhenStalled) {
+  watchdog_.Check(start_);
+  EXPECT_EQ(kicks_, 1u);
+
+  watchdog_.WorkStarted(kLabel, start_, start_);
+  watchdog_.Check(start_ + options().stall_limit);
+  EXPECT_EQ(kicks_, 2u);
+  watchdog_.Check(start_ + options().stall_limit + Clock::duration(1));
+  EXPECT_EQ(kicks_, 2u);
+
+  // Kicks resume once the worker makes progress.
+  watchdog_.WorkFinished(start_ + 2 * options().stall_limit);
+  watchdog_.Check(start_ + 2 * options().stall_limit);
+  EXPECT_EQ(kicks_, 3u);
+}
+
+TEST_F(WorkerWatchdogTest, StopsKickingWhenQueuedWorkWaits) {
+  TestWorker<> test_worker;
+  DeadlineWorker worker(test_worker, nullptr, &watchdog_);
+  watchdog_.Watch(worker);
+
+  // Block the worker with work that the watchdog does not observe.
+  pw::sync::ThreadNotification blocked;
+  pw::sync::ThreadNotification resume;
+  test_worker.RunOnce([&blocked, &resume]() {
+    blocked.release();
+    resume.acquire();
+  });
+  blocked.acquire();
+
+  // The first check queues a probe, which waits behind the blocking work.
+  const Clock::time_point start = Clock::now();
+  watchdog_.Check(start);
+  EXPECT_EQ(kicks_, 1u);
+  watchdog_.Check(start + options().stall_limit + options().check_interval);
+  EXPECT_EQ(kicks_, 1u);
+  EXPECT_EQ(watchdog_.work_count(), 0u);
+
+  // Kicks resume once the probe has run.
+  resume.release();
+  pw::sync::ThreadNotification done;
+  worker.RunOnce([&done]() { done.release(); });
+  done.acquire();
+  EXPECT_EQ(watchdog_.work_count(), 2u);
+  watchdog_.Check(start + 2 * options().stall_limit);
+  EXPECT_EQ(kicks_, 2u);
+
+  test_worker.Stop();
+}
+
+TEST_F(WorkerWatchdogTest, ProbesOnlyIdleWorker) {
+  TestWorker<> test_worker;
+  DeadlineWorker worker(test_worker, nullptr, &watchdog_);
+  watchdog_.Watch(worker);
+  auto sync = [&worker]() {
+    pw::sync::ThreadNotification done;
+    worker.RunOnce([&done]() { done.release(); });
+    done.acquire();
+  };
+
+  // The worker ran work since the last check, so no probe is queued.
+  sync();
+  watchdog_.Check(Clock::now());
+  sync();
+  EXPECT_EQ(watchdog_.work_count(), 2u);
+
+  // A check that follows a check with no work in between probes.
+  watchdog_.Check(Clock::now());
+  watchdog_.Check(Clock::now());
+  sync();
+  EXPECT_EQ(watchdog_.work_count(), 4u);
+
+  test_worker.Stop();
+}
+
+TEST_F(WorkerWatchdogTest, KeepsRecentBreaches) {
+  constexpr uint32_t kBreaches = WorkerWatchdog::kMaxBreaches + 2;
+  for (uint32_t i = 0; i < kBreaches; ++i) {
+    Run(0ms, 2 * options().work_budget);
+  }
+  EXPECT_EQ(watchdog_.breach_count(), kBreaches);
+
+  std::array<WorkerWatchdog::Breach, kBreaches> breaches;
+  ASSERT_EQ(watchdog_.RecentBreaches(0, breaches),
+            WorkerWatchdog::kMaxBreaches);
+  EXPECT_EQ(breaches[0].sequence, 3u);
+  EXPECT_EQ(breaches[WorkerWatchdog::kMaxBreaches - 1].sequence, kBreaches);
+
+  ASSERT_EQ(watchdog_.RecentBreaches(kBreaches - 1, breaches), 1u);
+  EXPECT_EQ(breaches[0].sequence, kBreaches);
+}
+
+TEST_F(WorkerWatchdogTest, QueueWaitPercentiles) {
+  EXPECT_EQ(watchdog_.QueueWaitPercentile(50), 0us);
+
+  for (int i = 0; i < 90; ++i) {
+    Run(Clock::for_at_least(50us), 0ms);
+  }
+  for (int i = 0; i < 9; ++i) {
+    Run(Clock::for_at_least(1ms), 0ms);
+  }
+  Run(Clock::for_at_least(1min), 0ms);
+  EXPECT_EQ(watchdog_.work_count(), 100u);
+
+  EXPECT_EQ(watchdog_.QueueWaitPercentile(50), 100us);
+  EXPECT_EQ(watchdog_.QueueWaitPercentile(90), 100us);
+  EXPECT_EQ(watchdog_.QueueWaitPercentile(99), 1600us);
+  // Waits longer than the histogram are counted in its last bucket.
+  EXPECT_EQ(watchdog_.QueueWaitPercentile(100),
+            WorkerWatchdog::kShortestWait *
+                (1 << (WorkerWatchdog::kWaitBuckets - 1)));
+}
+
+TEST_F(WorkerWatchdogTest, ObservesDeadlineWorker) {
+  TestWorker<> test_worker;
+  DeadlineWorker worker(test_worker, nullptr, &watchdog_);
+  pw::sync::ThreadNotification done;
+  worker.RunOnceLabeled(kLabel, [&done]() { done.release(); });
+  done.acquire();
+  test_worker.Stop();
+
+  EXPECT_EQ(watchdog_.work_count(), 1u);
+  EXPECT_EQ(watchdog_.breach_count(), 0u);
+}
+
+}  // namespace
+}  // namespace sense
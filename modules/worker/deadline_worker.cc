@@ -0,0 +1,202 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/worker/deadline_worker.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+#include "pw_log/log.h"
+#include "pw_trace/trace.h"
+
+namespace sense {
+
+void DeadlineWorker::RunOnceLabeled(uint32_t label,
+                                    pw::Function<void()>&& work) {
+  if (!RunOnceBefore(Clock::now() + kDefaultDeadline, label, std::move(work))
+           .ok()) {
+    PW_LOG_ERROR("Unable to schedule deadline work.");
+  }
+}
+
+pw::Status DeadlineWorker::RunOnceBefore(Clock::time_point deadline,
+                                         uint32_t label,
+                                         pw::Function<void()>&& work) {
+  uint32_t sequence;
+  {
+    std::lock_guard lock(lock_);
+    if (pending_.full()) {
+      return pw::Status::ResourceExhausted();
+    }
+    sequence = next_sequence_++;
+    pending_.push_back({
+        .queued = Clock::now(),
+        .deadline = deadline,
+        .sequence = sequence,
+        .label = label,
+        .work = std::move(work),
+    });
+  }
+  PW_TRACE_INSTANT("Schedule", "Worker", label);
+
+  const pw::Status status = ScheduleRun();
+  if (status.ok()) {
+    return pw::OkStatus();
+  }
+
+  // Take the work back, so that the caller can retry it. If a run scheduled
+  // for other work already took it, it has run, and that run makes up for the
+  // missing one.
+  std::lock_guard lock(lock_);
+  auto queued = std::find_if(
+      pending_.begin(), pending_.end(), [sequence](const PendingWork& pending) {
+        return pending.sequence == sequence;
+      });
+  if (queued == pending_.end()) {
+    return pw::OkStatus();
+  }
+  if (queued != pending_.end() - 1) {
+    *queued = std::move(pending_.back());
+  }
+  pending_.pop_back();
+  return status;
+}
+
+DeadlineWorker::Lateness DeadlineWorker::lateness() const {
+  std::lock_guard lock(lock_);
+  return lateness_;
+}
+
+std::optional<DeadlineWorker::Clock::time_point>
+DeadlineWorker::OldestQueued() const {
+  std::lock_guard lock(lock_);
+  std::optional<Clock::time_point> oldest;
+  for (const PendingWork& pending : pending_) {
+    if (!oldest.has_value() || pending.queued < *oldest) {
+      oldest = pending.queued;
+    }
+  }
+  return oldest;
+}
+
+pw::Status DeadlineWorker::ScheduleRun() {
+  const pw::Status status = worker_.TryRunOnce([this]() { RunNext(); });
+  if (status.ok()) {
+    std::lock_guard lock(lock_);
+    ++scheduled_runs_;
+  }
+  return status;
+}
+
+void DeadlineWorker::RunNext() {
+  {
+    std::lock_guard lock(lock_);
+    --scheduled_runs_;
+  }
+  while (true) {
+    PendingWork next;
+    {
+      std::lock_guard lock(lock_);
+      if (pending_.empty()) {
+        return;
+      }
+      next = TakeEarliest();
+    }
+    Run(next);
+
+    // Each piece of pending work normally has a run scheduled. One is missing
+    // if scheduling failed after its work was taken by another run.
+    {
+      std::lock_guard lock(lock_);
+      if (static_cast<int32_t>(pending_.size()) <= scheduled_runs_) {
+        return;
+      }
+    }
+    if (ScheduleRun().ok()) {
+      return;
+    }
+    // The other worker's queue is full. Run the next piece of work here,
+    // rather than leave it stranded until more work is queued.
+  }
+}
+
+DeadlineWorker::PendingWork DeadlineWorker::TakeEarliest() {
+  auto earliest = std::min_element(
+      pending_.begin(),
+      pending_.end(),
+      [](const PendingWork& a, const PendingWork& b) {
+        if (a.deadline != b.deadline) {
+          return a.deadline < b.deadline;
+        }
+        // Sequence numbers wrap around, so compare their difference.
+        return static_cast<int32_t>(a.sequence - b.sequence) < 0;
+      });
+  PendingWork next = std::move(*earliest);
+
+  // Pending work is not kept in order, so move the last piece of work into
+  // the gap.
+  if (earliest != pending_.end() - 1) {
+    *earliest = std::move(pending_.back());
+  }
+  pending_.pop_back();
+  return next;
+}
+
+void DeadlineWorker::Run(PendingWork& work) {
+  const Clock::time_point start = Clock::now();
+  RecordLateness(work, start);
+  if (observer_ != nullptr) {
+    observer_->WorkStarted(work.label, work.queued, start);
+  }
+  {
+    PW_TRACE_SCOPE("Run", "Worker", work.label);
+    Profiler::Measurement measurement(profiler_, Profiler::kWork, work.label);
+    work.work();
+  }
+  if (observer_ != nullptr) {
+    observer_->WorkFinished(Clock::now());
+  }
+}
+
+void DeadlineWorker::RecordLateness(const PendingWork& work,
+                                    Clock::time_point start) {
+  const Clock::duration lateness = start - work.deadline;
+  {
+    std::lock_guard lock(lock_);
+    ++lateness_.runs;
+    if (lateness <= Clock::duration(0)) {
+      return;
+    }
+    ++lateness_.late;
+    lateness_.max = std::max(lateness_.max, lateness);
+  }
+
+  // The profiler records cycles, so lateness is only recorded when the
+  // profiler knows how long a cycle is.
+  if (profiler_ == nullptr || profiler_->frequency_hz() == 0) {
+    return;
+  }
+  const uint64_t micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(lateness).count();
+  const uint64_t cycles = micros * profiler_->frequency_hz() / 1'000'000;
+  profiler_->Record(
+      Profiler::kLateness,
+      work.label,
+      static_cast<uint32_t>(
+          std::min<uint64_t>(cycles, std::numeric_limits<uint32_t>::max())));
+}
+
+}  // namespace sense
@@ -0,0 +1,161 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "modules/profiler/profiler.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_containers/vector.h"
+#include "pw_function/function.h"
+#include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// Observes each piece of work that a `DeadlineWorker` runs, e.g. to detect
+/// work that blocks the worker. Called from the worker's thread.
+class WorkObserver {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  /// Called before a piece of work runs.
+  virtual void WorkStarted(uint32_t label,
+                           Clock::time_point queued,
+                           Clock::time_point started) = 0;
+
+  /// Called after the piece of work that last started has finished.
+  virtual void WorkFinished(Clock::time_point finished) = 0;
+
+ protected:
+  ~WorkObserver() = default;
+};
+
+/// A worker that runs the pending work with the earliest deadline first on
+/// another worker.
+///
+/// Work is queued here, and the other worker is only given a small function
+/// that runs the next piece of queued work. When work
+/// backs up, time-critical work, e.g. toggling an LED at the next Morse code
+/// edge, overtakes bulk work, e.g. encoding events for an RPC stream.
+///
+/// Work without a deadline is due `kDefaultDeadline` after it is queued, so a
+/// steady stream of work with deadlines can delay it, but not starve it. Work
+/// with the same deadline runs in the order it was queued.
+///
+/// If the other worker's queue is full, `RunOnceBefore` returns an error and
+/// the work is not queued. Work that is queued is never stranded: if a run
+/// cannot be scheduled after a piece of work, the remaining work runs in
+/// place.
+///
+/// If a profiler is given, each piece of work is timed under its label, and
+/// work that starts after its deadline is recorded as `Profiler::kLateness`.
+/// If an observer is given, it is told when each piece of work starts and
+/// finishes.
+class DeadlineWorker final : public Worker {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  /// Maximum number of pieces of work waiting to run. Further work is not
+  /// queued, as when the other worker's queue is full.
+  static constexpr size_t kMaxPendingWork = 32;
+
+  /// Deadline of work queued without one, relative to when it is queued.
+  static constexpr Clock::duration kDefaultDeadline =
+      Clock::for_at_least(std::chrono::milliseconds(100));
+
+  /// How far behind deadline work has run.
+  struct Lateness {
+    /// Number of pieces of work that have run.
+    uint32_t runs = 0;
+    /// Number of those that started after their deadline.
+    uint32_t late = 0;
+    /// Longest time that work started after its deadline.
+    Clock::duration max = Clock::duration(0);
+  };
+
+  DeadlineWorker(Worker& worker,
+                 Profiler* profiler = nullptr,
+                 WorkObserver* observer = nullptr)
+      : worker_(worker), profiler_(profiler), observer_(observer) {}
+
+  void RunOnce(pw::Function<void()>&& work) override {
+    RunOnceLabeled(Profiler::kUnlabeled, std::move(work));
+  }
+
+  void RunOnceLabeled(uint32_t label, pw::Function<void()>&& work) override;
+
+  pw::Status TryRunOnce(pw::Function<void()>&& work) override {
+    return RunOnceBefore(Clock::now() + kDefaultDeadline,
+                         Profiler::kUnlabeled,
+                         std::move(work));
+  }
+
+  /// Queues work, or returns RESOURCE_EXHAUSTED if either this worker's or
+  /// the other worker's queue is full. Does not log, so it may be called from
+  /// interrupts if the other worker's `TryRunOnce` may be.
+  pw::Status RunOnceBefore(Clock::time_point deadline,
+                           uint32_t label,
+                           pw::Function<void()>&& work) override
+      PW_LOCKS_EXCLUDED(lock_);
+
+  Lateness lateness() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns when the work that has waited longest was queued, or nothing if
+  /// no work is waiting.
+  std::optional<Clock::time_point> OldestQueued() const
+      PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct PendingWork {
+    Clock::time_point queued;
+    Clock::time_point deadline;
+    /// Breaks ties between equal deadlines, in the order work was queued.
+    uint32_t sequence = 0;
+    uint32_t label = Profiler::kUnlabeled;
+    pw::Function<void()> work;
+  };
+
+  /// Gives the other worker a function that runs the next piece of work.
+  pw::Status ScheduleRun() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Runs the queued work with the earliest deadline.
+  void RunNext() PW_LOCKS_EXCLUDED(lock_);
+
+  PendingWork TakeEarliest() PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  void Run(PendingWork& work) PW_LOCKS_EXCLUDED(lock_);
+
+  void RecordLateness(const PendingWork& work, Clock::time_point start)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  Worker& worker_;
+  Profiler* profiler_;
+  WorkObserver* observer_;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  pw::Vector<PendingWork, kMaxPendingWork> pending_ PW_GUARDED_BY(lock_);
+  uint32_t next_sequence_ PW_GUARDED_BY(lock_) = 0;
+  /// Number of runs given to the other worker that have not started. Runs are
+  /// counted once they are scheduled, so this may briefly be negative.
+  int32_t scheduled_runs_ PW_GUARDED_BY(lock_) = 0;
+  Lateness lateness_ PW_GUARDED_BY(lock_);
+};
+
+}  // namespace sense
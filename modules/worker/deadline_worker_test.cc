@@ -0,0 +1,284 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/worker/deadline_worker.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "modules/profiler/profiler.h"
+#include "modules/worker/test_worker.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using Clock = DeadlineWorker::Clock;
+using namespace std::chrono_literals;
+
+constexpr uint32_t kBulkLabel = 0x1234;
+constexpr uint32_t kUrgentLabel = 0x5678;
+
+class MicrosecondCounter final : public CycleCounter {
+ public:
+  uint32_t Read() override { return 0; }
+  uint32_t frequency_hz() const override { return 1'000'000; }
+};
+
+/// Forwards work to another worker, but can be made to reject it, as a full
+/// queue would.
+class RejectingWorker final : public Worker {
+ public:
+  explicit RejectingWorker(Worker& worker) : worker_(worker) {}
+
+  void RunOnce(pw::Function<void()>&& work) override {
+    TryRunOnce(std::move(work)).IgnoreError();
+  }
+
+  pw::Status TryRunOnce(pw::Function<void()>&& work) override {
+    if (before_reject_ != nullptr) {
+      pw::Function<void()> before = std::move(before_reject_);
+      before_reject_ = nullptr;
+      before();
+      return pw::Status::ResourceExhausted();
+    }
+    if (rejects_.load() > 0) {
+      --rejects_;
+      return pw::Status::ResourceExhausted();
+    }
+    return worker_.TryRunOnce(std::move(work));
+  }
+
+  /// Rejects the next `count` pieces of work.
+  void Reject(int count) { rejects_ = count; }
+
+  /// Calls `before` when the next piece of work is queued, then rejects it.
+  void RejectAfter(pw::Function<void()>&& before) {
+    before_reject_ = std::move(before);
+  }
+
+ private:
+  Worker& worker_;
+  std::atomic<int> rejects_ = 0;
+  pw::Function<void()> before_reject_;
+};
+
+class DeadlineWorkerTest : public ::testing::Test {
+ protected:
+  DeadlineWorkerTest()
+      : profiler_(counter_),
+        rejecting_worker_(test_worker_),
+        worker_(rejecting_worker_, &profiler_) {}
+
+  void TearDown() override { test_worker_.Stop(); }
+
+  /// Blocks the other worker until `ResumeAndWait` is called, so that work backs up.
+  void Pause() {
+    test_worker_.RunOnce([this]() { resume_.acquire(); });
+  }
+
+  /// Unblocks the other worker, and waits until the queued work has run.
+  void ResumeAndWait() {
+    resume_.release();
+    EXPECT_EQ(worker_.RunOnceBefore(Clock::time_point::max(),
+                                    Profiler::kUnlabeled,
+                                    [this]() { done_.release(); }),
+              pw::OkStatus());
+    done_.acquire();
+  }
+
+  /// Queues bulk work, then urgent work whose run is rejected only after the
+  /// run scheduled for the bulk work has taken the urgent work instead. Then
+  /// rejects `rejects_after_taken_` more runs. Returns the status of queueing
+  /// the urgent work.
+  pw::Status QueueUrgentWorkTakenByBulkRun();
+
+  /// Queues work that records when it ran.
+  pw::Function<void()> Record(int id) {
+    return [this, id]() { order_[runs_++] = id; };
+  }
+
+  TestWorker<DeadlineWorker::kMaxPendingWork + 2> test_worker_;
+  MicrosecondCounter counter_;
+  Profiler profiler_;
+  RejectingWorker rejecting_worker_;
+  DeadlineWorker worker_;
+
+  pw::sync::ThreadNotification resume_;
+  pw::sync::ThreadNotification done_;
+  pw::sync::ThreadNotification urgent_ran_;
+  int rejects_after_taken_ = 0;
+  std::array<int, 4> order_ = {};
+  size_t runs_ = 0;
+};
+
+TEST_F(DeadlineWorkerTest, RunsEarliestDeadlineFirst) {
+  const Clock::time_point now = Clock::now();
+  Pause();
+  worker_.RunOnceLabeled(kBulkLabel, Record(1));
+  EXPECT_EQ(worker_.RunOnceBefore(
+                now + Clock::for_at_least(50ms), kUrgentLabel, Record(2)),
+            pw::OkStatus());
+  EXPECT_EQ(worker_.RunOnceBefore(
+                now + Clock::for_at_least(10ms), kUrgentLabel, Record(3)),
+            pw::OkStatus());
+  ResumeAndWait();
+
+  ASSERT_EQ(runs_, 3u);
+  EXPECT_EQ(order_[0], 3);
+  EXPECT_EQ(order_[1], 2);
+  EXPECT_EQ(order_[2], 1);
+}
+
+TEST_F(DeadlineWorkerTest, EqualDeadlinesRunInOrder) {
+  const Clock::time_point deadline = Clock::now() + Clock::for_at_least(10ms);
+  Pause();
+  EXPECT_EQ(worker_.RunOnceBefore(deadline, kUrgentLabel, Record(1)),
+            pw::OkStatus());
+  EXPECT_EQ(worker_.RunOnceBefore(deadline, kUrgentLabel, Record(2)),
+            pw::OkStatus());
+  EXPECT_EQ(worker_.RunOnceBefore(deadline, kUrgentLabel, Record(3)),
+            pw::OkStatus());
+  ResumeAndWait();
+
+  ASSERT_EQ(runs_, 3u);
+  EXPECT_EQ(order_[0], 1);
+  EXPECT_EQ(order_[1], 2);
+  EXPECT_EQ(order_[2], 3);
+}
+
+TEST_F(DeadlineWorkerTest, WorkWithoutDeadlineIsNotStarved) {
+  // Work with a deadline later than the default deadline does not overtake
+  // work without one.
+  Pause();
+  worker_.RunOnce(Record(1));
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now() +
+                                      DeadlineWorker::kDefaultDeadline +
+                                      Clock::for_at_least(1s),
+                                  kUrgentLabel,
+                                  Record(2)),
+            pw::OkStatus());
+  ResumeAndWait();
+
+  ASSERT_EQ(runs_, 2u);
+  EXPECT_EQ(order_[0], 1);
+  EXPECT_EQ(order_[1], 2);
+}
+
+TEST_F(DeadlineWorkerTest, RecordsLateness) {
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now() - Clock::for_at_least(20ms),
+                                  kUrgentLabel,
+                                  Record(1)),
+            pw::OkStatus());
+  Pause();
+  ResumeAndWait();
+
+  DeadlineWorker::Lateness lateness = worker_.lateness();
+  EXPECT_EQ(lateness.runs, 2u);
+  EXPECT_EQ(lateness.late, 1u);
+  EXPECT_GE(lateness.max, Clock::for_at_least(20ms));
+
+  std::array<Profiler::Entry, 4> entries;
+  size_t count = profiler_.Report(entries);
+  auto late = std::find_if(
+      entries.begin(), entries.begin() + count, [](const Profiler::Entry& e) {
+        return e.kind == Profiler::kLateness;
+      });
+  ASSERT_NE(late, entries.begin() + count);
+  EXPECT_EQ(late->label, kUrgentLabel);
+  EXPECT_EQ(late->calls, 1u);
+  EXPECT_GE(late->max_cycles, 20'000u);
+}
+
+TEST_F(DeadlineWorkerTest, ReturnsErrorWhenFull) {
+  Pause();
+  for (size_t i = 0; i < DeadlineWorker::kMaxPendingWork - 1; ++i) {
+    EXPECT_EQ(worker_.RunOnceBefore(Clock::now(), kBulkLabel, []() {}),
+              pw::OkStatus());
+  }
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now() + Clock::for_at_least(1s),
+                                  kBulkLabel,
+                                  [this]() { done_.release(); }),
+            pw::OkStatus());
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now(), kUrgentLabel, Record(1)),
+            pw::Status::ResourceExhausted());
+
+  resume_.release();
+  done_.acquire();
+  EXPECT_EQ(runs_, 0u);
+}
+
+TEST_F(DeadlineWorkerTest, RejectedWorkIsNotQueued) {
+  rejecting_worker_.Reject(1);
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now(), kUrgentLabel, Record(1)),
+            pw::Status::ResourceExhausted());
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now(), kUrgentLabel, Record(2)),
+            pw::OkStatus());
+  Pause();
+  ResumeAndWait();
+
+  ASSERT_EQ(runs_, 1u);
+  EXPECT_EQ(order_[0], 2);
+}
+
+pw::Status DeadlineWorkerTest::QueueUrgentWorkTakenByBulkRun() {
+  Pause();
+  EXPECT_EQ(worker_.RunOnceBefore(Clock::now() + Clock::for_at_least(1s),
+                                  kBulkLabel,
+                                  [this]() {
+                                    order_[runs_++] = 1;
+                                    done_.release();
+                                  }),
+            pw::OkStatus());
+  rejecting_worker_.RejectAfter([this]() {
+    rejecting_worker_.Reject(rejects_after_taken_);
+    resume_.release();
+    urgent_ran_.acquire();
+  });
+  return worker_.RunOnceBefore(Clock::now(), kUrgentLabel, [this]() {
+    order_[runs_++] = 2;
+    urgent_ran_.release();
+  });
+}
+
+TEST_F(DeadlineWorkerTest, ReschedulesRunTakenByOtherWork) {
+  // The urgent work ran, so queueing it succeeded, and the bulk work is run by
+  // a new run rather than stranded.
+  EXPECT_EQ(QueueUrgentWorkTakenByBulkRun(), pw::OkStatus());
+  done_.acquire();
+
+  ASSERT_EQ(runs_, 2u);
+  EXPECT_EQ(order_[0], 2);
+  EXPECT_EQ(order_[1], 1);
+}
+
+TEST_F(DeadlineWorkerTest, RunsWorkInPlaceWhenRunCannotBeScheduled) {
+  // The new run for the bulk work is rejected too, so the bulk work runs right
+  // after the urgent work, in the same run.
+  rejects_after_taken_ = 1;
+  EXPECT_EQ(QueueUrgentWorkTakenByBulkRun(), pw::OkStatus());
+  done_.acquire();
+
+  ASSERT_EQ(runs_, 2u);
+  EXPECT_EQ(order_[0], 2);
+  EXPECT_EQ(order_[1], 1);
+}
+
+}  // namespace
+}  // namespace sense
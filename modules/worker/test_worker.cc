@@ -29,7 +29,11 @@ void GenericTestWorker::RunOnce(pw::Function<void()>&& work) {
   // TODO: CHECK-ing this error causes flakes in the state manager tests due to
   // their repeated use of the work queue. Investigate whether that can be
   // resolved.
-  work_queue_->PushWork(std::move(work)).IgnoreError();
+  TryRunOnce(std::move(work)).IgnoreError();
+}
+
+pw::Status GenericTestWorker::TryRunOnce(pw::Function<void()>&& work) {
+  return work_queue_->PushWork(std::move(work));
 }
 
 GenericTestWorker::~GenericTestWorker() {
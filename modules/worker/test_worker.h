@@ -40,6 +40,8 @@ class GenericTestWorker : public Worker {
 
   void RunOnce(pw::Function<void()>&& work) final;
 
+  pw::Status TryRunOnce(pw::Function<void()>&& work) final;
+
   // Stops the work queue. This method MUST be called before leaving the test
   // body. Otherwise, the work queue may reference objects that have gone out of
   // scope.
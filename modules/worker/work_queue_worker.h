@@ -0,0 +1,51 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "modules/worker/worker.h"
+#include "pw_log/log.h"
+#include "pw_thread/detached_thread.h"
+#include "pw_thread/options.h"
+#include "pw_work_queue/work_queue.h"
+
+namespace sense {
+
+/// A worker that runs work on its own thread, so that work that blocks, e.g.
+/// writing to a congested RPC stream, does not hold up the system worker.
+template <size_t kMaxWork>
+class WorkQueueWorker final : public Worker {
+ public:
+  /// Starts the worker's thread. Work can be queued before it is started.
+  void Start(const pw::thread::Options& options) {
+    pw::thread::DetachedThread(options, work_queue_);
+  }
+
+  void RunOnce(pw::Function<void()>&& work) override {
+    if (!TryRunOnce(std::move(work)).ok()) {
+      PW_LOG_ERROR("Unable to schedule work on work queue worker.");
+    }
+  }
+
+  pw::Status TryRunOnce(pw::Function<void()>&& work) override {
+    return work_queue_.PushWork(std::move(work));
+  }
+
+ private:
+  pw::work_queue::WorkQueueWithBuffer<kMaxWork> work_queue_;
+};
+
+}  // namespace sense
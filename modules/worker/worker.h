@@ -13,7 +13,12 @@
 // the License.
 #pragma once
 
+#include <cstdint>
+#include <utility>
+
+#include "pw_chrono/system_clock.h"
 #include "pw_function/function.h"
+#include "pw_status/status.h"
 
 namespace sense {
 
@@ -25,6 +30,41 @@ class Worker {
   /// Ambiently execute a function.
   virtual void RunOnce(pw::Function<void()>&& work) = 0;
 
+  /// Ambiently execute a function, or return an error if it cannot be queued,
+  /// e.g. RESOURCE_EXHAUSTED if the worker's queue is full. Unlike `RunOnce`,
+  /// this does not log, so callers can recover from the failure.
+  ///
+  /// Workers that cannot report failures always return OK.
+  virtual pw::Status TryRunOnce(pw::Function<void()>&& work) {
+    RunOnce(std::move(work));
+    return pw::OkStatus();
+  }
+
+  /// Ambiently execute a function, labeled with a tokenized string that names
+  /// the call site, e.g. `PW_TOKENIZE_STRING("sample buttons")`.
+  ///
+  /// Workers that profile their work record its run time under the label.
+  /// Other workers ignore it.
+  virtual void RunOnceLabeled(uint32_t label, pw::Function<void()>&& work) {
+    static_cast<void>(label);
+    RunOnce(std::move(work));
+  }
+
+  /// Ambiently execute a labeled function that should start by `deadline`.
+  ///
+  /// Workers that order work by deadline run it ahead of work with later
+  /// deadlines. Other workers run it in order with the rest of their work.
+  ///
+  /// Like `TryRunOnce`, returns an error rather than logging if the work
+  /// cannot be queued. Workers that use the label override this.
+  virtual pw::Status RunOnceBefore(pw::chrono::SystemClock::time_point deadline,
+                                   uint32_t label,
+                                   pw::Function<void()>&& work) {
+    static_cast<void>(deadline);
+    static_cast<void>(label);
+    return TryRunOnce(std::move(work));
+  }
+
  protected:
   ~Worker() = default;
 };
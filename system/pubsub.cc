@@ -19,11 +19,28 @@
 namespace sense::system {
 
 sense::PubSub& PubSub() {
+  // Events are packed in the queue, so it holds 20 of the largest events, or
+  // several times as many of the small ones that are usually published.
   constexpr size_t kMaxEvents = 20;
   constexpr size_t kMaxSubscribers = 10;
-  static GenericPubSubBuffer<Event, kMaxEvents, kMaxSubscribers> pubsub(
-      GetWorker());
+  // Payloads are short, e.g. Morse code messages.
+  constexpr size_t kPayloadBlockSize = 32;
+  constexpr size_t kPayloadBlocks = 4;
+  static GenericPubSubBuffer<Event,
+                             kMaxEvents,
+                             kMaxSubscribers,
+                             kPayloadBlockSize,
+                             kPayloadBlocks>
+      pubsub(GetWorker(), &GetProfiler());
   return pubsub;
 }
 
+sense::CoreBridge& SamplingBridge() {
+  // Each pass of the sampling loop publishes at most three events.
+  constexpr size_t kCapacity = 8;
+  static GenericCoreBridgeBuffer<Event, kCapacity> bridge(PubSub(),
+                                                          GetWorker());
+  return bridge;
+}
+
 }  // namespace sense::system
@@ -19,4 +19,8 @@ namespace sense::system {
 
 PubSub& PubSub();
 
+/// Bridge that the sampling thread publishes through, so that publishing
+/// never waits for the pubsub's lock.
+CoreBridge& SamplingBridge();
+
 }  // namespace sense::system
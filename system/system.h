@@ -19,6 +19,7 @@
 #include "modules/led/monochrome_led.h"
 #include "modules/led/polychrome_led.h"
 #include "modules/light/sensor.h"
+#include "modules/profiler/profiler.h"
 #include "modules/proximity/sensor.h"
 
 // The functions in this file return specific implementations of singleton types
@@ -46,4 +47,11 @@ MonochromeLed& MonochromeLed();
 
 PolychromeLed& PolychromeLed();
 
+/// Returns the counter used to profile work on the system worker.
+sense::CycleCounter& CycleCounter();
+
+/// Feeds the hardware watchdog, if the target has one. The first call enables
+/// it, after which the device resets unless it is fed every few seconds.
+void KickHardwareWatchdog();
+
 }  // namespace sense::system
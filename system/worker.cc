@@ -14,8 +14,11 @@
 
 #include "system/worker.h"
 
+#include "modules/worker/deadline_worker.h"
 #include "pw_log/log.h"
 #include "pw_system/system.h"
+#include "system/system.h"
+#include "system/timer_wheel.h"
 
 namespace sense::system {
 namespace internal {
@@ -24,17 +27,44 @@ namespace internal {
 class SystemWorker final : public Worker {
  public:
   void RunOnce(pw::Function<void()>&& work) override {
-    if (!pw::System().RunOnce(std::move(work))) {
+    if (!TryRunOnce(std::move(work)).ok()) {
       PW_LOG_ERROR("Unable to schedule work on system worker.");
     }
   }
+
+  pw::Status TryRunOnce(pw::Function<void()>&& work) override {
+    if (!pw::System().RunOnce(std::move(work))) {
+      return pw::Status::ResourceExhausted();
+    }
+    return pw::OkStatus();
+  }
 };
 
 }  // namespace internal
 
 Worker& GetWorker() {
-  static internal::SystemWorker worker;
+  static internal::SystemWorker system_worker;
+  static DeadlineWorker worker(
+      system_worker, &GetProfiler(), &GetWorkerWatchdog());
+  // Work given directly to pw::System, or other tasks on its dispatcher, can
+  // also block the worker, so the watchdog watches its queue too.
+  [[maybe_unused]] static const bool watched = [] {
+    GetWorkerWatchdog().Watch(worker);
+    return true;
+  }();
   return worker;
 }
 
+Profiler& GetProfiler() {
+  static Profiler profiler(system::CycleCounter());
+  return profiler;
+}
+
+WorkerWatchdog& GetWorkerWatchdog() {
+  static WorkerWatchdog watchdog(system::TimerWheel(),
+                                 WorkerWatchdog::kDefaultOptions,
+                                 []() { KickHardwareWatchdog(); });
+  return watchdog;
+}
+
 }  // namespace sense::system
@@ -13,11 +13,23 @@
 // the License.
 #pragma once
 
+#include "modules/profiler/profiler.h"
+#include "modules/watchdog/watchdog.h"
 #include "modules/worker/worker.h"
 
 namespace sense::system {
 
-/// Returns a worker which delegates work to `pw::System`.
+/// Returns the system worker, which runs the pending work with the earliest
+/// deadline first on `pw::System`. Work run on it is timed by `GetProfiler`,
+/// and watched by `GetWorkerWatchdog`.
 Worker& GetWorker();
 
+/// Returns the profiler for work on the system worker and for pubsub
+/// subscribers.
+Profiler& GetProfiler();
+
+/// Returns the watchdog for work on the system worker. While the worker makes
+/// progress, it kicks the hardware watchdog.
+WorkerWatchdog& GetWorkerWatchdog();
+
 }  // namespace sense::system
@@ -22,4 +22,9 @@ const pw::thread::Options& SamplingThreadOptions() {
   return kOptions;
 }
 
+const pw::thread::Options& RpcStreamThreadOptions() {
+  static constexpr pw::thread::stl::Options kOptions;
+  return kOptions;
+}
+
 }  // namespace sense
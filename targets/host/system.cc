@@ -19,7 +19,9 @@
 
 #include "modules/air_sensor/air_sensor_fake.h"
 #include "modules/board/board_fake.h"
+#include "modules/buttons/virtual_input.h"
 #include "modules/light/fake_sensor.h"
+#include "modules/profiler/host_cycle_counter.h"
 #include "modules/proximity/fake_sensor.h"
 #include "pw_assert/check.h"
 #include "pw_channel/stream_channel.h"
@@ -30,7 +32,6 @@
 #include "pw_thread_stl/options.h"
 
 using ::pw::channel::StreamChannel;
-using ::pw::digital_io::DigitalIn;
 using ::pw::digital_io::State;
 
 extern "C" {
@@ -51,16 +52,8 @@ void InstallCtrlCSignalHandler() {
 }
 
 namespace {
-class VirtualInput : public DigitalIn {
- public:
-  VirtualInput(State state) : state_(state) {}
 
- private:
-  pw::Status DoEnable(bool) override { return pw::OkStatus(); }
-  pw::Result<State> DoGetState() override { return state_; }
-
-  State state_;
-};
+using ::sense::VirtualInput;
 
 VirtualInput io_sw_a(State::kInactive);
 VirtualInput io_sw_b(State::kInactive);
@@ -126,4 +119,11 @@ sense::ProximitySensor& ProximitySensor() {
   return fake_prox;
 }
 
+sense::CycleCounter& CycleCounter() {
+  static HostCycleCounter counter;
+  return counter;
+}
+
+void KickHardwareWatchdog() {}
+
 }  // namespace sense::system
@@ -0,0 +1,30 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include <chrono>
+#include <cstddef>
+
+#include "pw_trace_tokenized/config.h"
+
+// Trace time is in microseconds, as on the RP2, so that simulator traces line
+// up with device traces.
+
+PW_TRACE_TIME_TYPE pw_trace_GetTraceTime() {
+  return static_cast<PW_TRACE_TIME_TYPE>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+size_t pw_trace_GetTraceTimeTicksPerSecond() { return 1'000'000; }
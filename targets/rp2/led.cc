@@ -12,9 +12,13 @@
 // License for the specific language governing permissions and limitations under
 // the License.
 
+#include <cstdint>
+
 #include "device/pico_pwm_gpio.h"
+#include "device/pico_pwm_ticker.h"
 #include "modules/led/monochrome_led.h"
 #include "modules/led/polychrome_led.h"
+#include "modules/pwm/animator.h"
 #include "pico/stdlib.h"
 #include "pw_digital_io_rp2040/digital_io.h"
 #include "system/system.h"
@@ -22,6 +26,28 @@
 
 namespace sense::system {
 
+static constexpr uint32_t kAnimationTickHz = 1000;
+
+// No pin is muxed to slice 7, so it is free to use as a timer.
+static constexpr uint16_t kAnimationPwmSlice = 7;
+
+/// Returns the animator shared by all LEDs, starting it on first use.
+///
+/// The ticker is paused while no animation plays, so that its interrupt does
+/// not wake the core 1000 times a second while the LEDs hold steady levels.
+static sense::PwmAnimator& LedAnimator() {
+  static ::sense::PwmAnimator animator(kAnimationTickHz);
+  static ::sense::PicoPwmTicker ticker(kAnimationPwmSlice, animator);
+  static bool started = false;
+  if (!started) {
+    ticker.Start();
+    animator.set_activity_callback(
+        [](bool active) { ticker.SetPaused(!active); });
+    started = true;
+  }
+  return animator;
+}
+
 static constexpr pw::digital_io::Rp2040Config kDefaultLedConfig = {
     .pin = PICO_DEFAULT_LED_PIN,
     .polarity = pw::digital_io::Polarity::kActiveHigh,
@@ -30,7 +56,7 @@ static constexpr pw::digital_io::Rp2040Config kDefaultLedConfig = {
 sense::MonochromeLed& MonochromeLed() {
   static ::pw::digital_io::Rp2040DigitalInOut led_sio(kDefaultLedConfig);
   static ::sense::PicoPwmGpio led_pwm(kDefaultLedConfig);
-  static ::sense::MonochromeLed led(led_sio, led_pwm);
+  static ::sense::MonochromeLed led(led_sio, led_pwm, LedAnimator());
   return led;
 }
 
@@ -53,7 +79,8 @@ sense::PolychromeLed& PolychromeLed() {
   static ::sense::PicoPwmGpio red_pwm(kRedLedConfig);
   static ::sense::PicoPwmGpio green_pwm(kGreenLedConfig);
   static ::sense::PicoPwmGpio blue_pwm(kBlueLedConfig);
-  static ::sense::PolychromeLed rgb_led(red_pwm, green_pwm, blue_pwm);
+  static ::sense::PolychromeLed rgb_led(
+      red_pwm, green_pwm, blue_pwm, LedAnimator());
   return rgb_led;
 }
 
@@ -19,6 +19,7 @@
 namespace sense {
 
 pw::thread::freertos::StaticContextWithStack<1024> sensor_thread_context;
+pw::thread::freertos::StaticContextWithStack<1024> rpc_stream_thread_context;
 
 const pw::thread::Options& SamplingThreadOptions() {
   static constexpr auto kOptions =
@@ -29,4 +30,13 @@ const pw::thread::Options& SamplingThreadOptions() {
   return kOptions;
 }
 
+const pw::thread::Options& RpcStreamThreadOptions() {
+  static constexpr auto kOptions =
+      pw::thread::freertos::Options()
+          .set_name("RpcStreamThread")
+          .set_static_context(rpc_stream_thread_context)
+          .set_priority(tskIDLE_PRIORITY + 1);
+  return kOptions;
+}
+
 }  // namespace sense
@@ -14,11 +14,16 @@
 
 #include "system/system.h"
 
+#include <chrono>
+
 #include "device/bme688.h"
 #include "device/ltr559_light_and_prox_sensor.h"
 #include "device/pico_board.h"
+#include "device/pico_cycle_counter.h"
+#include "device/pico_digital_in_interrupt.h"
 #include "hardware/adc.h"
 #include "hardware/exception.h"
+#include "hardware/watchdog.h"
 #include "modules/air_sensor/air_sensor.h"
 #include "modules/buttons/manager.h"
 #include "pico/stdlib.h"
@@ -38,8 +43,6 @@
 #include "system/worker.h"
 #include "targets/rp2/enviro_pins.h"
 
-using pw::digital_io::Rp2040DigitalIn;
-
 namespace sense::system {
 namespace {
 
@@ -67,25 +70,25 @@ Ltr559ProxAndLightSensorImpl& Ltr559() {
 }  // namespace
 
 namespace {
-Rp2040DigitalIn io_sw_a({
+PicoDigitalInInterrupt io_sw_a({
     .pin = board::kEnviroPinSwA,
     .polarity = pw::digital_io::Polarity::kActiveLow,
     .enable_pull_up = true,
 });
 
-Rp2040DigitalIn io_sw_b({
+PicoDigitalInInterrupt io_sw_b({
     .pin = board::kEnviroPinSwB,
     .polarity = pw::digital_io::Polarity::kActiveLow,
     .enable_pull_up = true,
 });
 
-Rp2040DigitalIn io_sw_x({
+PicoDigitalInInterrupt io_sw_x({
     .pin = board::kEnviroPinSwX,
     .polarity = pw::digital_io::Polarity::kActiveLow,
     .enable_pull_up = true,
 });
 
-Rp2040DigitalIn io_sw_y({
+PicoDigitalInInterrupt io_sw_y({
     .pin = board::kEnviroPinSwY,
     .polarity = pw::digital_io::Polarity::kActiveLow,
     .enable_pull_up = true,
@@ -131,4 +134,26 @@ sense::AmbientLightSensor& AmbientLightSensor() { return Ltr559(); }
 
 sense::ProximitySensor& ProximitySensor() { return Ltr559(); }
 
+sense::CycleCounter& CycleCounter() {
+  static PicoCycleCounter counter;
+  return counter;
+}
+
+void KickHardwareWatchdog() {
+  // Longer than the system worker watchdog's stall limit plus a check
+  // interval, so that the device only resets once the worker has stalled.
+  constexpr uint32_t kTimeoutMs = 2000;
+  constexpr WorkerWatchdog::Options kOptions = WorkerWatchdog::kDefaultOptions;
+  static_assert(std::chrono::milliseconds(kTimeoutMs) >
+                    kOptions.stall_limit + kOptions.check_interval,
+                "The hardware watchdog must outlast the worker's stall limit");
+  static bool enabled = false;
+  if (!enabled) {
+    // Pausing on debug keeps the watchdog from resetting a halted device.
+    watchdog_enable(kTimeoutMs, /*pause_on_debug=*/true);
+    enabled = true;
+  }
+  watchdog_update();
+}
+
 }  // namespace sense::system
@@ -0,0 +1,59 @@
+# Copyright 2024 The Pigweed Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+"""Capture a trace from a device into a Chrome/Perfetto JSON timeline.
+
+Open the output in https://ui.perfetto.dev or chrome://tracing. The simulator
+records the same traces as a device, other than BME688 I2C transactions.
+"""
+
+import argparse
+import logging
+from pathlib import Path
+import time
+
+from sense.device import get_device_connection
+
+_LOG = logging.getLogger(__file__)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        '--duration',
+        type=float,
+        default=5,
+        help='Seconds to trace for.',
+    )
+    parser.add_argument(
+        '--output',
+        type=Path,
+        default=Path('trace.json'),
+        help='File to write the trace to.',
+    )
+    args, _remaining_args = parser.parse_known_args()
+
+    device_connection = get_device_connection()
+
+    # Open the connection to the device.
+    with device_connection as device:
+        device.start_tracing()
+        _LOG.info('Tracing for %.1f seconds', args.duration)
+        time.sleep(args.duration)
+        device.stop_tracing(trace_output_path=str(args.output))
+
+    _LOG.info('Wrote trace to %s', args.output)
+
+
+if __name__ == '__main__':
+    main()
@@ -15,8 +15,9 @@
 
 import argparse
 import logging
+import struct
 from types import ModuleType
-from typing import Any
+from typing import Any, Callable
 
 import pw_cli.log
 from pw_protobuf_protos import common_pb2
@@ -34,10 +35,15 @@ from pw_system.device_connection import (
 from blinky_pb import blinky_pb2
 from modules.air_sensor import air_sensor_pb2
 from modules.board import board_pb2
+from modules.telemetry import telemetry_pb2
 from factory_pb import factory_pb2
 from pubsub_pb import pubsub_pb2
+import event_log_pb2
 import morse_code_pb2
+import profiler_pb2
+import sampling_pb2
 import state_manager_pb2
+import watchdog_pb2
 
 
 _LOG = logging.getLogger(__file__)
@@ -118,6 +124,99 @@ class Device(PwSystemDevice):
         """Fetches an air measurement from the device."""
         return self.rpcs.air_sensor.AirSensor.Measure().unwrap_or_raise()
 
+    def read_event_log(self) -> bytes:
+        """Reads the device's pubsub event log, in its exported format."""
+        event_log = self.rpcs.event_log.EventLog
+        data = bytearray()
+        total_size = None
+        while total_size is None or len(data) < total_size:
+            response = event_log.Read(offset=len(data)).unwrap_or_raise()
+            total_size = response.total_size
+            if not response.data:
+                break
+            data.extend(response.data)
+        if response.dropped:
+            _LOG.warning(
+                'Event log dropped %d older events', response.dropped
+            )
+        return bytes(data)
+
+    def get_profile_report(self) -> profiler_pb2.Report:
+        """Fetches the system worker's profile, most expensive call first."""
+        return self.rpcs.profiler.Profiler.GetReport().unwrap_or_raise()
+
+    def reset_profile(self) -> None:
+        """Clears the system worker's profile."""
+        self.rpcs.profiler.Profiler.Reset().unwrap_or_raise()
+
+    def get_watchdog_report(self) -> watchdog_pb2.Report:
+        """Fetches the system worker's queue waits and recent breaches."""
+        return self.rpcs.watchdog.Watchdog.GetReport().unwrap_or_raise()
+
+    def profile_label(self, label: int) -> str:
+        """Returns the detokenized name of a profiled call site."""
+        if label == 0:
+            return '<unlabeled>'
+        if self.detokenizer is not None:
+            result = self.detokenizer.detokenize(struct.pack('<I', label))
+            if result.ok():
+                return str(result)
+        return f'${label:08x}'
+
+    def get_report_stats(self) -> sampling_pb2.ReportStats:
+        """Fetches each sensor channel's report policy and counters."""
+        return self.rpcs.sampling.Sampling.GetReportStats().unwrap_or_raise()
+
+    def set_report_policy(
+        self,
+        channel: sampling_pb2.Channel.ValueType,
+        absolute_deadband: float = 0.0,
+        relative_deadband: float = 0.0,
+        min_interval_ms: int = 0,
+        max_silence_ms: int = 0,
+    ) -> None:
+        """Changes when a sensor channel's samples are published.
+
+        A sample is published if it changed by more than the larger
+        deadband, no sooner than `min_interval_ms` after the last one. After
+        `max_silence_ms` without a publish, the next sample is published
+        regardless. A zero `max_silence_ms` never republishes unchanged
+        samples.
+        """
+        self.rpcs.sampling.Sampling.SetReportPolicy(
+            channel=channel,
+            policy=sampling_pb2.Policy(
+                absolute_deadband=absolute_deadband,
+                relative_deadband=relative_deadband,
+                min_interval_ms=min_interval_ms,
+                max_silence_ms=max_silence_ms,
+            ),
+        ).unwrap_or_raise()
+
+    def stream_telemetry(
+        self,
+        on_sample: Callable[[telemetry_pb2.Sample], None],
+        interval_ms: int = 1000,
+        fields: int = telemetry_pb2.ALL_FIELDS,
+    ):
+        """Streams telemetry samples to `on_sample` until the call is cancelled.
+
+        Several clients can stream telemetry at once, each with its own
+        interval and fields.
+
+        Args:
+          on_sample: Called with each sample.
+          interval_ms: The interval between samples, a multiple of 100ms.
+          fields: Bitwise OR of `telemetry_pb2.Field` values, or ALL_FIELDS.
+
+        Returns:
+          The streaming call, which can be cancelled.
+        """
+        return self.rpcs.telemetry.Telemetry.Stream.invoke(
+            telemetry_pb2.StreamRequest(interval_ms=interval_ms, fields=fields),
+            on_next=lambda call_, sample: on_sample(sample),
+        )
+
     def toggle_led(self):
         """Toggles the onboard (non-RGB) LED."""
         self.rpcs.blinky.Blinky.ToggleLed()
@@ -137,9 +236,8 @@ class Device(PwSystemDevice):
         self.rpcs.blinky.Blinky.Pulse(interval_ms=interval_ms)
 
 
-class DeviceWithTracing(PwSystemDeviceWithTracing):
-    def __init__(self, *args, **kwargs):
-        super().__init__(*args, **kwargs)
+class DeviceWithTracing(Device, PwSystemDeviceWithTracing):
+    """A Pigweed Sense device that can download its pw_trace ring buffer."""
 
 
 def get_all_protos() -> list[ModuleType]:
@@ -149,10 +247,15 @@ def get_all_protos() -> list[ModuleType]:
         board_pb2,
         common_pb2,
         echo_pb2,
+        event_log_pb2,
         factory_pb2,
         morse_code_pb2,
+        profiler_pb2,
         pubsub_pb2,
+        sampling_pb2,
         state_manager_pb2,
+        telemetry_pb2,
+        watchdog_pb2,
     ]
 
 
@@ -183,8 +286,7 @@ def get_device_connection(
         rpc_logging=args.rpc_logging,
         hdlc_encoding=args.hdlc_encoding,
         channel_id=args.channel_id,
-        # Device tracing is not hooked up yet for Pigweed Sense.
-        device_tracing=False,
+        device_tracing=True,
         device_class=Device,
         device_tracing_class=DeviceWithTracing,
     )
@@ -0,0 +1,47 @@
+# Copyright 2024 The Pigweed Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+"""Capture the pubsub event log from a device into a file."""
+
+import argparse
+import logging
+from pathlib import Path
+
+from sense.device import get_device_connection
+
+_LOG = logging.getLogger(__file__)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        '--output',
+        type=Path,
+        default=Path('event_log.bin'),
+        help='File to write the captured log to.',
+    )
+    args, _remaining_args = parser.parse_known_args()
+
+    device_connection = get_device_connection()
+
+    # Open the connection to the device.
+    with device_connection as device:
+        _LOG.info('Reading event log')
+        data = device.read_event_log()
+
+    args.output.write_bytes(data)
+    _LOG.info('Wrote %d bytes to %s', len(data), args.output)
+
+
+if __name__ == '__main__':
+    main()
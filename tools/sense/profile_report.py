@@ -0,0 +1,78 @@
+# Copyright 2024 The Pigweed Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+"""Print where a device's system worker spends its time."""
+
+import argparse
+import logging
+import time
+
+from sense.device import get_device_connection
+import profiler_pb2
+
+_LOG = logging.getLogger(__file__)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        '--duration',
+        type=float,
+        default=0,
+        help=(
+            'If set, reset the profile and wait this many seconds before '
+            'reading it. Otherwise, read the profile since boot.'
+        ),
+    )
+    args, _remaining_args = parser.parse_known_args()
+
+    device_connection = get_device_connection()
+
+    # Open the connection to the device.
+    with device_connection as device:
+        if args.duration > 0:
+            device.reset_profile()
+            _LOG.info('Profiling for %.1f seconds', args.duration)
+            time.sleep(args.duration)
+        report = device.get_profile_report()
+
+        if report.cycles_per_second:
+            unit = 'us'
+            scale = 1e6 / report.cycles_per_second
+        else:
+            unit = 'cycles'
+            scale = 1.0
+
+        print(
+            f'{"kind":<10} {"calls":>8} {"total " + unit:>14} '
+            f'{"mean " + unit:>12} {"max " + unit:>12}  call site'
+        )
+        for entry in report.entries:
+            kind = profiler_pb2.Entry.Kind.Name(entry.kind).lower()
+            mean = entry.total_cycles / entry.calls if entry.calls else 0
+            print(
+                f'{kind:<10} {entry.calls:>8} '
+                f'{entry.total_cycles * scale:>14.0f} '
+                f'{mean * scale:>12.1f} '
+                f'{entry.max_cycles * scale:>12.0f}  '
+                f'{device.profile_label(entry.label)}'
+            )
+        if report.dropped:
+            _LOG.warning(
+                '%d calls from further call sites were not recorded',
+                report.dropped,
+            )
+
+
+if __name__ == '__main__':
+    main()
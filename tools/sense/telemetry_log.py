@@ -0,0 +1,106 @@
+# Copyright 2024 The Pigweed Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+"""Log a device's telemetry to a CSV file.
+
+Other clients, such as the console or the web app, can stream telemetry at the
+same time.
+"""
+
+import argparse
+import csv
+import logging
+import sys
+import threading
+import time
+
+from sense.device import get_device_connection
+from modules.telemetry import telemetry_pb2
+
+_LOG = logging.getLogger(__file__)
+
+_FIELDS = {
+    'onboard_temperature': telemetry_pb2.ONBOARD_TEMPERATURE,
+    'temperature': telemetry_pb2.TEMPERATURE,
+    'pressure': telemetry_pb2.PRESSURE,
+    'humidity': telemetry_pb2.HUMIDITY,
+    'gas_resistance': telemetry_pb2.GAS_RESISTANCE,
+    'score': telemetry_pb2.SCORE,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        '--interval-ms',
+        type=int,
+        default=1000,
+        help='Interval between samples, a multiple of 100ms.',
+    )
+    parser.add_argument(
+        '--fields',
+        nargs='+',
+        choices=sorted(_FIELDS),
+        default=sorted(_FIELDS),
+        help='Fields to log.',
+    )
+    parser.add_argument(
+        '--duration',
+        type=float,
+        default=None,
+        help='Seconds to log for. Logs until interrupted if not set.',
+    )
+    parser.add_argument(
+        '--output',
+        type=argparse.FileType('w'),
+        default=sys.stdout,
+        help='CSV file to write. Defaults to stdout.',
+    )
+    args, _remaining_args = parser.parse_known_args()
+
+    mask = 0
+    for field in args.fields:
+        mask |= _FIELDS[field]
+    columns = ['collection_time_ms'] + args.fields
+
+    writer = csv.writer(args.output)
+    writer.writerow(columns)
+    lock = threading.Lock()
+
+    def on_sample(sample: telemetry_pb2.Sample) -> None:
+        row = [sample.collection_time_ms]
+        for field in args.fields:
+            row.append(getattr(sample, field) if sample.HasField(field) else '')
+        with lock:
+            writer.writerow(row)
+            args.output.flush()
+
+    device_connection = get_device_connection()
+
+    # Open the connection to the device.
+    with device_connection as device:
+        call = device.stream_telemetry(on_sample, args.interval_ms, mask)
+        _LOG.info('Logging telemetry every %d ms', args.interval_ms)
+        try:
+            if args.duration is None:
+                while True:
+                    time.sleep(1)
+            time.sleep(args.duration)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            call.cancel()
+
+
+if __name__ == '__main__':
+    main()
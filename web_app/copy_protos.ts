@@ -41,6 +41,10 @@ const protos: ProtoSet[] = [
     prefix: "state_manager",
     protos: ["../modules/state_manager/state_manager.proto"],
   },
+  {
+    prefix: "telemetry",
+    protos: ["../modules/telemetry/telemetry.proto"],
+  },
 ];
 
 /**
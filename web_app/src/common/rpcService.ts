@@ -20,10 +20,14 @@ import {
   OnboardTempResponse,
 } from "../../protos/collection/board/board_pb";
 import {
-  MeasureStreamRequest,
-  Measurement,
-} from "../../protos/collection/air_sensor/air_sensor_pb";
-import { State } from "../../protos/collection/state_manager/state_manager_pb";
+  Field,
+  Sample,
+  StreamRequest,
+} from "../../protos/collection/telemetry/telemetry_pb";
+import {
+  State,
+  StateDelta,
+} from "../../protos/collection/state_manager/state_manager_pb";
 class RPCService {
   transport;
   decoder;
@@ -35,6 +39,10 @@ class RPCService {
   boardTempService;
   measureService;
   stateService;
+  stateStreamService;
+  // Latest state from `streamState`, and its version.
+  currentState: State | undefined;
+  stateVersion = 0;
   constructor(rpcAddress = 82) {
     this.transport = new WebSerial.WebSerialTransport();
     this.decoder = new pw_hdlc.Decoder();
@@ -57,10 +65,13 @@ class RPCService {
       .methodStub("board.Board.OnboardTempStream");
     this.measureService = this.client
       .channel()
-      .methodStub("air_sensor.AirSensor.MeasureStream");
+      .methodStub("telemetry.Telemetry.Stream");
     this.stateService = this.client
       .channel()
       .methodStub("state_manager.StateManager.GetState");
+    this.stateStreamService = this.client
+      .channel()
+      .methodStub("state_manager.StateManager.StateStream");
   }
 
   async connect() {
@@ -103,16 +114,19 @@ class RPCService {
     );
   }
 
-  async streamMeasure(onMeasure?: (measurement: Measurement) => void) {
+  async streamMeasure(onMeasure?: (sample: Sample) => void) {
     // We check if this RPC exists on device,
     // if not we fallback to just onboardTemp.
     return new Promise(async (resolve, reject) => {
       let resolveCalled = false;
-      const req = new MeasureStreamRequest();
-      req.setSampleIntervalMs(500);
+      // Telemetry streams can be shared with other clients, such as the
+      // console, so only ask for the fields that are shown.
+      const req = new StreamRequest();
+      req.setIntervalMs(500);
+      req.setFields(Field.TEMPERATURE | Field.HUMIDITY | Field.SCORE);
       await this.measureService.invoke(
         req,
-        (m: Measurement) => {
+        (m: Sample) => {
           if (!resolveCalled) {
             resolveCalled = true;
             resolve(true);
@@ -133,6 +147,45 @@ class RPCService {
     const [status, response] = await this.stateService.call();
     return response;
   }
+
+  /**
+   * Keeps `currentState` up to date with the device, which only sends the
+   * fields that changed.
+   */
+  async streamState(onState?: (state: State) => void) {
+    await this.stateStreamService.invoke(
+      undefined,
+      async (delta: StateDelta) => {
+        let state = this.currentState ?? new State();
+        const missed =
+          this.currentState !== undefined &&
+          delta.getVersion() !== this.stateVersion + 1;
+        if (delta.hasAlarmActive()) {
+          state.setAlarmActive(delta.getAlarmActive());
+        }
+        if (delta.hasAlarmThreshold()) {
+          state.setAlarmThreshold(delta.getAlarmThreshold());
+        }
+        if (delta.hasAqScore()) {
+          state.setAqScore(delta.getAqScore());
+        }
+        if (delta.hasAqDescription()) {
+          state.setAqDescription(delta.getAqDescription());
+        }
+        if (missed) {
+          // Fields changed by the missed deltas may be stale.
+          state = await this.getState();
+        }
+        this.currentState = state;
+        this.stateVersion = delta.getVersion();
+        if (onState) onState(state);
+      },
+      undefined,
+      (err) => {
+        console.error(err);
+      },
+    );
+  }
 }
 
 // We keep a singleton of this service.
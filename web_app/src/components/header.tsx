@@ -61,10 +61,11 @@ export function Header(){
                 {!connected && <button className='header-button' onClick={async ()=> {
                     await rpc.connect();
                     try{
+                        await rpc.streamState();
                         await rpc.streamMeasure(async (reading)=>{
-                        const state = await rpc.getState();
-                        console.log("AirSensor.MeasureStream", reading.toObject())
-                        console.log("StateManager.GetState", state.toObject())
+                        const state = rpc.currentState ?? await rpc.getState();
+                        console.log("Telemetry.Stream", reading.toObject())
+                        console.log("StateManager.State", state.toObject())
                         appState.addReading({
                             temperature: reading.getTemperature(),
                             score: Math.round((reading.getScore() / 1024) * 100),